@@ -732,6 +732,47 @@ AC_DEFUN([OCOMS_CHECK_SPARCV8PLUS],[
 ])dnl
 
 
+dnl #################################################################
+dnl
+dnl OCOMS_CHECK_CMPXCHG16B
+dnl
+dnl Check if the processor and assembler support the x86_64
+dnl cmpxchg16b instruction.  AC_DEFINE OCOMS_HAVE_CMPXCHG16B to
+dnl the result.
+dnl
+dnl #################################################################
+AC_DEFUN([OCOMS_CHECK_CMPXCHG16B],[
+    OCOMS_VAR_SCOPE_PUSH([cmpxchg16b_result])
+
+    AC_ARG_ENABLE([cross-cmpxchg16b],[AC_HELP_STRING([--enable-cross-cmpxchg16b],
+                  [enable the use of the cmpxchg16b instruction when cross compiling])])
+
+    if test ! "$enable_cross_cmpxchg16b" = "yes" ; then
+        AC_MSG_CHECKING([if processor supports x86_64 16-byte compare-and-exchange])
+        AC_RUN_IFELSE([AC_LANG_PROGRAM([[unsigned char tmp[16] __attribute__((aligned(16)));]],[[
+__asm__ __volatile__ ("lock cmpxchg16b (%%rsi)" : : "S" (tmp) : "memory", "cc");]])],
+            [AC_MSG_RESULT([yes])
+             cmpxchg16b_result=1],
+            [AC_MSG_RESULT([no])
+             cmpxchg16b_result=0],
+            [AC_MSG_RESULT([no (cross compiling)])
+             cmpxchg16b_result=0])
+    else
+        AC_MSG_CHECKING([if assembler supports x86_64 16-byte compare-and-exchange])
+        AC_LINK_IFELSE([AC_LANG_PROGRAM([[unsigned char tmp[16] __attribute__((aligned(16)));]],[[
+__asm__ __volatile__ ("lock cmpxchg16b (%%rsi)" : : "S" (tmp) : "memory", "cc");]])],
+            [AC_MSG_RESULT([yes])
+             cmpxchg16b_result=1],
+            [AC_MSG_RESULT([no])
+             cmpxchg16b_result=0])
+    fi
+
+    AC_DEFINE_UNQUOTED([OCOMS_HAVE_CMPXCHG16B], [$cmpxchg16b_result],
+                       [Whether the processor supports the cmpxchg16b instruction])
+    OCOMS_VAR_SCOPE_POP
+])dnl
+
+
 dnl #################################################################
 dnl
 dnl OCOMS_CHECK_INLINE_GCC
@@ -1014,6 +1055,20 @@ AC_DEFUN([OCOMS_CONFIG_ASM],[
     AC_DEFINE_UNQUOTED([OCOMS_WANT_SMP_LOCKS], [$want_smp_locks],
                        [whether we want to have smp locks in atomic ops or not])
 
+    AC_MSG_CHECKING([whether to use 128-bit compare-and-swap in the atomic LIFO])
+    AC_ARG_ENABLE([lifo-cmpset128],
+        [AC_HELP_STRING([--enable-lifo-cmpset128],
+            [use a counted head pointer updated with a 128-bit compare-and-swap in the atomic LIFO when the processor supports it (default: enabled)])])
+    if test "$enable_lifo_cmpset128" != "no"; then
+        AC_MSG_RESULT([yes])
+        want_lifo_cmpset128=1
+    else
+        AC_MSG_RESULT([no])
+        want_lifo_cmpset128=0
+    fi
+    AC_DEFINE_UNQUOTED([OCOMS_WANT_LIFO_CMPSET_128], [$want_lifo_cmpset128],
+                       [whether the atomic LIFO should use a 128-bit compare-and-swap on a counted head pointer])
+
 
         OCOMS_CHECK_ASM_PROC
         OCOMS_CHECK_ASM_TEXT
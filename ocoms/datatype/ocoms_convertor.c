@@ -31,6 +31,7 @@
 #endif
 
 #include "ocoms/primitives/prefetch.h"
+#include "ocoms/sys/atomic.h"
 #include "ocoms/util/arch.h"
 #include "ocoms/util/output.h"
 
@@ -39,6 +40,7 @@
 #include "ocoms/datatype/ocoms_convertor.h"
 #include "ocoms/datatype/ocoms_datatype_checksum.h"
 #include "ocoms/datatype/ocoms_datatype_prototypes.h"
+#include "ocoms/datatype/ocoms_datatype_reduce.h"
 #include "ocoms/datatype/ocoms_convertor_internal.h"
 #if OCOMS_CUDA_SUPPORT
 #include "ocoms/datatype/ocoms_datatype_cuda.h"
@@ -56,6 +58,8 @@ static void ocoms_convertor_construct( ocoms_convertor_t* convertor )
     convertor->partial_length = 0;
     convertor->remoteArch     = ocoms_local_arch;
     convertor->flags          = OCOMS_DATATYPE_FLAG_NO_GAPS | CONVERTOR_COMPLETED;
+    convertor->fChecksum      = ocoms_datatype_checksum_functions[ocoms_datatype_checksum_type];
+    convertor->reduce_op      = OCOMS_DATATYPE_OP_SUM;
 #if OCOMS_CUDA_SUPPORT
     convertor->cbmemcpy       = &ocoms_cuda_memcpy;
 #endif
@@ -72,6 +76,7 @@ OBJ_CLASS_INSTANCE(ocoms_convertor_t, ocoms_object_t, ocoms_convertor_construct,
 static ocoms_convertor_master_t* ocoms_convertor_master_list = NULL;
 
 extern conversion_fct_t ocoms_datatype_heterogeneous_copy_functions[OCOMS_DATATYPE_MAX_PREDEFINED];
+extern conversion_fct_t ocoms_datatype_swap_copy_functions[OCOMS_DATATYPE_MAX_PREDEFINED];
 extern conversion_fct_t ocoms_datatype_copy_functions[OCOMS_DATATYPE_MAX_PREDEFINED];
 
 void ocoms_convertor_destroy_masters( void )
@@ -85,6 +90,7 @@ void ocoms_convertor_destroy_masters( void )
         if( (master->pFunctions != ocoms_datatype_heterogeneous_copy_functions) &&
             (master->pFunctions != ocoms_datatype_copy_functions) )
             free( master->pFunctions );
+        free( master->pPackFunctions );
 
         free( master );
         master = ocoms_convertor_master_list;
@@ -96,27 +102,32 @@ void ocoms_convertor_destroy_masters( void )
  * is already a master convertor for this architecture then return it.
  * Otherwise, create and initialize a full featured master convertor.
  */
-ocoms_convertor_master_t* ocoms_convertor_find_or_create_master( uint32_t remote_arch )
+ocoms_convertor_master_t* ocoms_convertor_find_or_create_master( uint32_t remote_arch,
+                                                               int32_t wire_format )
 {
     ocoms_convertor_master_t* master = ocoms_convertor_master_list;
+    uint32_t swap_mask = 0;
     int i;
     size_t* remote_sizes;
 
     while( NULL != master ) {
-        if( master->remote_arch == remote_arch )
+        if( (master->remote_arch == remote_arch) && (master->wire_format == wire_format) )
             return master;
         master = master->next;
     }
+    /* the reduced wire formats only exist between identical architectures */
+    if( (OCOMS_CONVERTOR_WIRE_NATIVE != wire_format) && (remote_arch != ocoms_local_arch) )
+        return NULL;
     /**
      * Create a new convertor matching the specified architecture and add it to the
      * master convertor list.
      */
     master = (ocoms_convertor_master_t*)malloc( sizeof(ocoms_convertor_master_t) );
-    master->next = ocoms_convertor_master_list;
-    ocoms_convertor_master_list = master;
     master->remote_arch = remote_arch;
     master->flags       = 0;
     master->hetero_mask = 0;
+    master->wire_format = wire_format;
+    master->pPackFunctions = NULL;
     /**
      * Most of the sizes will be identical, so for now just make a copy of
      * the local ones. As master->remote_sizes is defined as being an array of
@@ -132,6 +143,13 @@ ocoms_convertor_master_t* ocoms_convertor_find_or_create_master( uint32_t remote
     if( master->remote_arch == ocoms_local_arch ) {
         master->pFunctions = ocoms_datatype_copy_functions;
         master->flags |= CONVERTOR_HOMOGENEOUS;
+        if( (OCOMS_CONVERTOR_WIRE_NATIVE != wire_format) &&
+            (OCOMS_SUCCESS != ocoms_convertor_lossy_master_init( master, wire_format )) ) {
+            free( master );
+            return NULL;
+        }
+        master->next = ocoms_convertor_master_list;
+        ocoms_convertor_master_list = master;
         return master;
     }
 
@@ -165,6 +183,8 @@ ocoms_convertor_master_t* ocoms_convertor_find_or_create_master( uint32_t remote
                 hetero_mask |= (((uint32_t)1) << i);
         }
         hetero_mask &= ~(((uint32_t)1) << OCOMS_DATATYPE_BOOL);
+        /* the types of the same size on both sides only need a byte swap */
+        swap_mask = hetero_mask & ~master->hetero_mask;
         master->hetero_mask |= hetero_mask;
     }
     master->pFunctions = (conversion_fct_t*)malloc( sizeof(ocoms_datatype_heterogeneous_copy_functions) );
@@ -173,11 +193,15 @@ ocoms_convertor_master_t* ocoms_convertor_find_or_create_master( uint32_t remote
      * try to minimize the usage of the heterogeneous versions.
      */
     for( i = OCOMS_DATATYPE_FIRST_TYPE; i < OCOMS_DATATYPE_MAX_PREDEFINED; i++ ) {
-        if( master->hetero_mask & (((uint32_t)1) << i) )
+        if( (swap_mask & (((uint32_t)1) << i)) && (NULL != ocoms_datatype_swap_copy_functions[i]) )
+            master->pFunctions[i] = ocoms_datatype_swap_copy_functions[i];
+        else if( master->hetero_mask & (((uint32_t)1) << i) )
             master->pFunctions[i] = ocoms_datatype_heterogeneous_copy_functions[i];
         else
             master->pFunctions[i] = ocoms_datatype_copy_functions[i];
     }
+    master->next = ocoms_convertor_master_list;
+    ocoms_convertor_master_list = master;
 
     /* We're done so far, return the mater convertor */
     return master;
@@ -189,7 +213,7 @@ ocoms_convertor_t* ocoms_convertor_create( int32_t remote_arch, int32_t mode )
     ocoms_convertor_t* convertor = OBJ_NEW(ocoms_convertor_t);
     ocoms_convertor_master_t* master;
 
-    master = ocoms_convertor_find_or_create_master( remote_arch );
+    master = ocoms_convertor_find_or_create_master( remote_arch, OCOMS_CONVERTOR_WIRE_NATIVE );
 
     convertor->remoteArch = remote_arch;
     convertor->stack_pos  = 0;
@@ -274,6 +298,9 @@ complete_contiguous_data_pack:
         return 1;
     }
 
+    if( OCOMS_UNLIKELY(OCOMS_CONVERTOR_PARALLEL( pConv )) ) {
+        return ocoms_convertor_parallel_advance( pConv, iov, out_size, max_data );
+    }
     return pConv->fAdvance( pConv, iov, out_size, max_data );
 }
 
@@ -326,6 +353,9 @@ complete_contiguous_data_unpack:
         return 1;
     }
 
+    if( OCOMS_UNLIKELY(OCOMS_CONVERTOR_PARALLEL( pConv )) ) {
+        return ocoms_convertor_parallel_advance( pConv, iov, out_size, max_data );
+    }
     return pConv->fAdvance( pConv, iov, out_size, max_data );
 }
 
@@ -356,18 +386,18 @@ static inline int ocoms_convertor_create_stack_with_pos_contig( ocoms_convertor_
     /* now compute the number of pending bytes */
     count = (uint32_t)(starting_point - count * pData->size);
     /**
-     * We save the current displacement starting from the begining
-     * of this data.
+     * The contiguous pack functions add both displacements to the one of
+     * the first element, so the second level only holds the bytes
+     * already done in the current element.
      */
     if( OCOMS_LIKELY(0 == count) ) {
         pStack[1].type     = pElems->elem.common.type;
         pStack[1].count    = pElems->elem.count;
-        pStack[1].disp     = pElems->elem.disp;
     } else {
         pStack[1].type  = OCOMS_DATATYPE_UINT1;
         pStack[1].count = pData->size - count;
-        pStack[1].disp  = pData->true_lb + count;
     }
+    pStack[1].disp     = count;
     pStack[1].index    = 0;  /* useless */
 
     pConvertor->bConverted = starting_point;
@@ -417,6 +447,16 @@ int32_t ocoms_convertor_set_position_nocheck( ocoms_convertor_t* convertor,
 {
     int32_t rc;
 
+    /**
+     * The pack plans find their place from bConverted alone, any byte is
+     * a valid position.
+     */
+    if( (ocoms_pack_plan == convertor->fAdvance) || (ocoms_unpack_plan == convertor->fAdvance) ) {
+        convertor->bConverted = *position;
+        convertor->partial_length = 0;
+        return OCOMS_SUCCESS;
+    }
+
     /**
      * If we plan to rollback the convertor then first we have to set it
      * at the beginning.
@@ -425,7 +465,12 @@ int32_t ocoms_convertor_set_position_nocheck( ocoms_convertor_t* convertor,
         rc = ocoms_convertor_create_stack_at_begining( convertor, ocoms_datatype_local_sizes );
         if( 0 == (*position) ) return rc;
     }
-    if( OCOMS_LIKELY(convertor->flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS) ) {
+    if( OCOMS_UNLIKELY(convertor->flags & CONVERTOR_LOSSY) ) {
+        return ocoms_convertor_lossy_position( convertor, position );
+    }
+    /* the reductions always walk the description, even when contiguous */
+    if( OCOMS_LIKELY((convertor->flags & (OCOMS_DATATYPE_FLAG_CONTIGUOUS | CONVERTOR_WITH_REDUCE))
+                     == OCOMS_DATATYPE_FLAG_CONTIGUOUS) ) {
         rc = ocoms_convertor_create_stack_with_pos_contig( convertor, (*position),
                                                           ocoms_datatype_local_sizes );
     } else {
@@ -448,17 +493,21 @@ int32_t ocoms_convertor_set_position_nocheck( ocoms_convertor_t* convertor,
 
 
 /**
- * Compute the remote size.
+ * Compute the remote size. Without the heterogeneous support only the
+ * reduced wire formats change the size of the predefined types.
  */
-#if OCOMS_ENABLE_HETEROGENEOUS_SUPPORT
 #define OCOMS_CONVERTOR_COMPUTE_REMOTE_SIZE(convertor, datatype, bdt_mask) \
 {                                                                         \
     if( OCOMS_UNLIKELY(0 != (bdt_mask)) ) {                                \
         ocoms_convertor_master_t* master;                                  \
         int i;                                                            \
         uint32_t mask = datatype->bdt_used;                               \
-        convertor->flags ^= CONVERTOR_HOMOGENEOUS;                        \
         master = convertor->master;                                       \
+        assert( OCOMS_ENABLE_HETEROGENEOUS_SUPPORT ||                      \
+                (OCOMS_CONVERTOR_WIRE_NATIVE != master->wire_format) );    \
+        convertor->flags ^= CONVERTOR_HOMOGENEOUS;                        \
+        if( OCOMS_CONVERTOR_WIRE_NATIVE != master->wire_format )           \
+            convertor->flags |= CONVERTOR_LOSSY;                          \
         convertor->remote_size = 0;                                       \
         for( i = OCOMS_DATATYPE_FIRST_TYPE; mask && (i < OCOMS_DATATYPE_MAX_PREDEFINED); i++ ) { \
             if( mask & ((uint32_t)1 << i) ) {                             \
@@ -471,10 +520,21 @@ int32_t ocoms_convertor_set_position_nocheck( ocoms_convertor_t* convertor,
         convertor->use_desc = &(datatype->desc);                          \
     }                                                                     \
 }
+
+/*
+ * The pack plans copy the data with the local memcpy, they only fit the
+ * homogeneous convertors on host memory.
+ */
+#if OCOMS_CUDA_SUPPORT
+#define OCOMS_CONVERTOR_USE_PLAN( convertor )                             \
+    ((NULL != (convertor)->pDesc->plan) &&                                \
+     ((convertor)->use_desc == &((convertor)->pDesc->opt_desc)) &&        \
+     !((convertor)->flags & CONVERTOR_CUDA))
 #else
-#define OCOMS_CONVERTOR_COMPUTE_REMOTE_SIZE(convertor, datatype, bdt_mask) \
-    assert(0 == (bdt_mask))
-#endif  /* OCOMS_ENABLE_HETEROGENEOUS_SUPPORT */
+#define OCOMS_CONVERTOR_USE_PLAN( convertor )                             \
+    ((NULL != (convertor)->pDesc->plan) &&                                \
+     ((convertor)->use_desc == &((convertor)->pDesc->opt_desc)))
+#endif  /* OCOMS_CUDA_SUPPORT */
 
 /**
  * This macro will initialize a convertor based on a previously created
@@ -509,32 +569,38 @@ int32_t ocoms_convertor_set_position_nocheck( ocoms_convertor_t* convertor,
         convertor->bConverted = 0;                                      \
         /* By default consider the optimized description */             \
         convertor->use_desc = &(datatype->opt_desc);                    \
+        /* the reductions need the real type of every element */       \
+        if( convertor->flags & CONVERTOR_WITH_REDUCE )                  \
+            convertor->use_desc = &(datatype->desc);                    \
                                                                         \
         convertor->remote_size = convertor->local_size;                 \
-        if( OCOMS_LIKELY(convertor->remoteArch == ocoms_local_arch) ) {   \
-            if( (convertor->flags & (CONVERTOR_WITH_CHECKSUM | OCOMS_DATATYPE_FLAG_NO_GAPS)) == OCOMS_DATATYPE_FLAG_NO_GAPS ) { \
+        bdt_mask = datatype->bdt_used & convertor->master->hetero_mask; \
+        if( OCOMS_LIKELY(convertor->remoteArch == ocoms_local_arch) &&   \
+            OCOMS_LIKELY(0 == bdt_mask) ) {                               \
+            if( (convertor->flags & (CONVERTOR_WITH_CHECKSUM | CONVERTOR_WITH_REDUCE | OCOMS_DATATYPE_FLAG_NO_GAPS)) == OCOMS_DATATYPE_FLAG_NO_GAPS ) { \
                 return OCOMS_SUCCESS;                                    \
             }                                                           \
-            if( ((convertor->flags & (CONVERTOR_WITH_CHECKSUM | OCOMS_DATATYPE_FLAG_CONTIGUOUS)) \
+            if( ((convertor->flags & (CONVERTOR_WITH_CHECKSUM | CONVERTOR_WITH_REDUCE | OCOMS_DATATYPE_FLAG_CONTIGUOUS)) \
                  == OCOMS_DATATYPE_FLAG_CONTIGUOUS) && (1 == count) ) {             \
                 return OCOMS_SUCCESS;                                    \
             }                                                           \
         }                                                               \
                                                                         \
-        bdt_mask = datatype->bdt_used & convertor->master->hetero_mask; \
         OCOMS_CONVERTOR_COMPUTE_REMOTE_SIZE( convertor, datatype,        \
                                             bdt_mask );                 \
         assert( NULL != convertor->use_desc->desc );                    \
         /* For predefined datatypes (contiguous) do nothing more */     \
-        /* if checksum is enabled then always continue */               \
-        if( ((convertor->flags & (CONVERTOR_WITH_CHECKSUM | OCOMS_DATATYPE_FLAG_NO_GAPS)) \
+        /* if checksum, reduce or lossy then always continue */         \
+        if( ((convertor->flags & (CONVERTOR_WITH_CHECKSUM | CONVERTOR_WITH_REDUCE | \
+                                  CONVERTOR_LOSSY | OCOMS_DATATYPE_FLAG_NO_GAPS)) \
              == OCOMS_DATATYPE_FLAG_NO_GAPS) &&                                     \
             (convertor->flags & (CONVERTOR_SEND | CONVERTOR_HOMOGENEOUS)) ) { \
             return OCOMS_SUCCESS;                                        \
         }                                                               \
         convertor->flags &= ~CONVERTOR_NO_OP;                           \
         {                                                               \
-            uint32_t required_stack_length = datatype->btypes[OCOMS_DATATYPE_LOOP] + 1; \
+            /* the loops, the whole datatype and the current element */ \
+            uint32_t required_stack_length = datatype->depth + 2;      \
                                                                         \
             if( required_stack_length > convertor->stack_size ) {       \
                 assert(convertor->pStack == convertor->static_stack);   \
@@ -547,6 +613,124 @@ int32_t ocoms_convertor_set_position_nocheck( ocoms_convertor_t* convertor,
     }
 
 
+int ocoms_convertor_template_max = 4;
+
+/*
+ * Prepare the convertor from a template of the datatype, return 0 if
+ * there is none for this count and convertor.
+ */
+static inline int
+ocoms_convertor_prepare_from_template( ocoms_convertor_t* convertor,
+                                       const ocoms_datatype_t* datatype,
+                                       int32_t count, const void* pUserBuf )
+{
+    const ocoms_convertor_template_t* tpl;
+    uint32_t type_flags = convertor->flags & CONVERTOR_TYPE_MASK;
+
+    for( tpl = datatype->templates; NULL != tpl; tpl = tpl->next ) {
+        if( (tpl->count == (ocoms_datatype_count_t)count) &&
+            (tpl->type_flags == type_flags) &&
+            (tpl->master == convertor->master) ) {
+            break;
+        }
+    }
+    if( NULL == tpl ) return 0;
+
+    convertor->flags          = tpl->flags;
+    convertor->local_size     = tpl->local_size;
+    convertor->remote_size    = tpl->remote_size;
+    convertor->pDesc          = datatype;
+    convertor->use_desc       = tpl->use_desc;
+    convertor->count          = tpl->count;
+    convertor->pBaseBuf       = (unsigned char*)pUserBuf;
+    convertor->fAdvance       = tpl->fAdvance;
+    convertor->stack_pos      = tpl->stack_pos;
+    convertor->partial_length = 0;
+    convertor->bConverted     = 0;
+    memcpy( convertor->pStack, tpl->stack, sizeof(dt_stack_t) * (tpl->stack_pos + 1) );
+    return 1;
+}
+
+/*
+ * Keep a freshly prepared convertor as a template of its datatype. Only
+ * the convertors with a stack are worth it, the others are prepared at
+ * once. The predefined datatypes are read-only and never get templates.
+ */
+static inline void
+ocoms_convertor_save_template( const ocoms_convertor_t* convertor, uint32_t type_flags )
+{
+    ocoms_datatype_t* datatype = (ocoms_datatype_t*)convertor->pDesc;
+    ocoms_convertor_template_t *tpl, *head, *iter;
+    int length = 0;
+
+    if( (convertor->flags & CONVERTOR_NO_OP) ||
+        (datatype->flags & OCOMS_DATATYPE_FLAG_PREDEFINED) ||
+        (convertor->pStack != convertor->static_stack) ) return;
+    for( tpl = datatype->templates; NULL != tpl; tpl = tpl->next ) length++;
+    if( length >= ocoms_convertor_template_max ) return;
+
+    tpl = (ocoms_convertor_template_t*)malloc( sizeof(ocoms_convertor_template_t) );
+    if( NULL == tpl ) return;
+    tpl->master      = convertor->master;
+    tpl->type_flags  = type_flags;
+    tpl->flags       = convertor->flags;
+    tpl->count       = convertor->count;
+    tpl->stack_pos   = convertor->stack_pos;
+    tpl->local_size  = convertor->local_size;
+    tpl->remote_size = convertor->remote_size;
+    tpl->use_desc    = convertor->use_desc;
+    tpl->fAdvance    = convertor->fAdvance;
+    memcpy( tpl->stack, convertor->pStack, sizeof(dt_stack_t) * (convertor->stack_pos + 1) );
+
+    /* the readers do not lock, the template is complete before being visible.
+     * The list only grows, so counting it from the head the CAS succeeds on
+     * keeps the concurrent preparers under the cap.
+     */
+    do {
+        head = datatype->templates;
+        for( length = 0, iter = head; NULL != iter; iter = iter->next ) length++;
+        if( length >= ocoms_convertor_template_max ) {
+            free( tpl );
+            return;
+        }
+        tpl->next = head;
+        ocoms_atomic_wmb();
+    } while( !ocoms_atomic_cmpset_ptr( &datatype->templates, head, tpl ) );
+}
+
+void ocoms_convertor_release_templates( ocoms_datatype_t* datatype )
+{
+    ocoms_convertor_template_t* tpl;
+
+    while( NULL != (tpl = datatype->templates) ) {
+        datatype->templates = tpl->next;
+        free( tpl );
+    }
+}
+
+/*
+ * Check that the reduction of a CONVERTOR_WITH_REDUCE convertor has a
+ * kernel for every predefined type of the datatype.
+ */
+static inline int
+ocoms_convertor_reduce_supported( const ocoms_convertor_t* convertor,
+                                  const ocoms_datatype_t* datatype )
+{
+    uint32_t mask = datatype->bdt_used;
+    int i;
+
+#if OCOMS_CUDA_SUPPORT
+    if( convertor->flags & CONVERTOR_CUDA ) return 0;
+#endif
+    for( i = OCOMS_DATATYPE_FIRST_TYPE; mask && (i < OCOMS_DATATYPE_MAX_PREDEFINED); i++ ) {
+        if( mask & ((uint32_t)1 << i) ) {
+            if( NULL == ocoms_datatype_reduce_functions[convertor->reduce_op][i] ) return 0;
+            mask ^= ((uint32_t)1 << i);
+        }
+    }
+    return 1;
+}
+
 int32_t ocoms_convertor_prepare_for_recv( ocoms_convertor_t* convertor,
                                          const struct ocoms_datatype_t* datatype,
                                          int32_t count,
@@ -554,14 +738,40 @@ int32_t ocoms_convertor_prepare_for_recv( ocoms_convertor_t* convertor,
 {
     /* Here I should check that the data is not overlapping */
 
+    uint32_t type_flags;
+
     convertor->flags |= CONVERTOR_RECV;
 #if OCOMS_CUDA_SUPPORT
     ocoms_cuda_convertor_init(convertor, pUserBuf);
 #endif
 
+    if( OCOMS_UNLIKELY(convertor->flags & CONVERTOR_WITH_REDUCE) &&
+        !ocoms_convertor_reduce_supported( convertor, datatype ) )
+        return OCOMS_ERR_NOT_SUPPORTED;
+    if( ocoms_convertor_prepare_from_template( convertor, datatype, count, pUserBuf ) )
+        return OCOMS_SUCCESS;
+    type_flags = convertor->flags & CONVERTOR_TYPE_MASK;
+
     OCOMS_CONVERTOR_PREPARE( convertor, datatype, count, pUserBuf );
 
-    if( convertor->flags & CONVERTOR_WITH_CHECKSUM ) {
+    if( OCOMS_UNLIKELY(convertor->flags & CONVERTOR_WITH_REDUCE) ) {
+        if( !(convertor->flags & CONVERTOR_HOMOGENEOUS) )
+            return OCOMS_ERR_NOT_SUPPORTED;
+        /* a single type without gaps is one array of elements */
+        if( (convertor->pDesc->flags & OCOMS_DATATYPE_FLAG_NO_GAPS) &&
+            (0 == (datatype->bdt_used & (datatype->bdt_used - 1))) ) {
+            convertor->fAdvance = ocoms_unpack_reduce_contig;
+        } else {
+            convertor->fAdvance = ocoms_generic_simple_unpack_reduce;
+        }
+    } else if( OCOMS_UNLIKELY(convertor->flags & CONVERTOR_LOSSY) ) {
+        if( (convertor->pDesc->flags & OCOMS_DATATYPE_FLAG_NO_GAPS) &&
+            (0 == (datatype->bdt_used & (datatype->bdt_used - 1))) ) {
+            convertor->fAdvance = ocoms_unpack_lossy_contig;
+        } else {
+            convertor->fAdvance = ocoms_generic_simple_unpack_lossy;
+        }
+    } else if( convertor->flags & CONVERTOR_WITH_CHECKSUM ) {
 #if OCOMS_ENABLE_HETEROGENEOUS_SUPPORT
         if( !(convertor->flags & CONVERTOR_HOMOGENEOUS) ) {
             convertor->fAdvance = ocoms_unpack_general_checksum;
@@ -580,10 +790,13 @@ int32_t ocoms_convertor_prepare_for_recv( ocoms_convertor_t* convertor,
 #endif
         if( convertor->pDesc->flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS ) {
             convertor->fAdvance = ocoms_unpack_homogeneous_contig;
+        } else if( OCOMS_CONVERTOR_USE_PLAN( convertor ) ) {
+            convertor->fAdvance = ocoms_unpack_plan;
         } else {
             convertor->fAdvance = ocoms_generic_simple_unpack;
         }
     }
+    ocoms_convertor_save_template( convertor, type_flags );
     return OCOMS_SUCCESS;
 }
 
@@ -593,14 +806,27 @@ int32_t ocoms_convertor_prepare_for_send( ocoms_convertor_t* convertor,
                                          int32_t count,
                                          const void* pUserBuf )
 {
+    uint32_t type_flags;
+
     convertor->flags |= CONVERTOR_SEND;
 #if OCOMS_CUDA_SUPPORT
     ocoms_cuda_convertor_init(convertor, pUserBuf);
 #endif
 
+    if( ocoms_convertor_prepare_from_template( convertor, datatype, count, pUserBuf ) )
+        return OCOMS_SUCCESS;
+    type_flags = convertor->flags & CONVERTOR_TYPE_MASK;
+
     OCOMS_CONVERTOR_PREPARE( convertor, datatype, count, pUserBuf );
 
-    if( convertor->flags & CONVERTOR_WITH_CHECKSUM ) {
+    if( OCOMS_UNLIKELY(convertor->flags & CONVERTOR_LOSSY) ) {
+        if( (datatype->flags & OCOMS_DATATYPE_FLAG_NO_GAPS) &&
+            (0 == (datatype->bdt_used & (datatype->bdt_used - 1))) ) {
+            convertor->fAdvance = ocoms_pack_lossy_contig;
+        } else {
+            convertor->fAdvance = ocoms_generic_simple_pack_lossy;
+        }
+    } else if( convertor->flags & CONVERTOR_WITH_CHECKSUM ) {
         if( datatype->flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS ) {
             if( ((datatype->ub - datatype->lb) == (OCOMS_PTRDIFF_TYPE)datatype->size)
                 || (1 >= convertor->count) )
@@ -617,10 +843,13 @@ int32_t ocoms_convertor_prepare_for_send( ocoms_convertor_t* convertor,
                 convertor->fAdvance = ocoms_pack_homogeneous_contig;
             else
                 convertor->fAdvance = ocoms_pack_homogeneous_contig_with_gaps;
+        } else if( OCOMS_CONVERTOR_USE_PLAN( convertor ) ) {
+            convertor->fAdvance = ocoms_pack_plan;
         } else {
             convertor->fAdvance = ocoms_generic_simple_pack;
         }
     }
+    ocoms_convertor_save_template( convertor, type_flags );
     return OCOMS_SUCCESS;
 }
 
@@ -648,6 +877,8 @@ int ocoms_convertor_clone( const ocoms_convertor_t* source,
     destination->master            = source->master;
     destination->local_size        = source->local_size;
     destination->remote_size       = source->remote_size;
+    destination->fChecksum         = source->fChecksum;
+    destination->reduce_op         = source->reduce_op;
     /* create the stack */
     if( OCOMS_UNLIKELY(source->stack_size > DT_STATIC_STACK_SIZE) ) {
         destination->pStack = (dt_stack_t*)malloc(sizeof(dt_stack_t) * source->stack_size );
@@ -672,6 +903,41 @@ int ocoms_convertor_clone( const ocoms_convertor_t* source,
 }
 
 
+int32_t ocoms_convertor_set_checksum_type( ocoms_convertor_t* convertor,
+                                           int32_t type )
+{
+    if( (type < 0) || (type >= OCOMS_CONVERTOR_CHECKSUM_MAX) )
+        return OCOMS_ERR_BAD_PARAM;
+    convertor->fChecksum = ocoms_datatype_checksum_functions[type];
+    return OCOMS_SUCCESS;
+}
+
+
+int32_t ocoms_convertor_set_reduce_op( ocoms_convertor_t* convertor,
+                                       int32_t op )
+{
+    if( (op < 0) || (op >= OCOMS_DATATYPE_OP_MINLOC) )
+        return OCOMS_ERR_BAD_PARAM;
+    convertor->reduce_op = op;
+    return OCOMS_SUCCESS;
+}
+
+
+int32_t ocoms_convertor_set_wire_format( ocoms_convertor_t* convertor,
+                                         int32_t format )
+{
+    ocoms_convertor_master_t* master;
+
+    if( (format < 0) || (format >= OCOMS_CONVERTOR_WIRE_MAX) )
+        return OCOMS_ERR_BAD_PARAM;
+    master = ocoms_convertor_find_or_create_master( convertor->remoteArch, format );
+    if( NULL == master )
+        return OCOMS_ERR_NOT_SUPPORTED;
+    convertor->master = master;
+    return OCOMS_SUCCESS;
+}
+
+
 void ocoms_convertor_dump( ocoms_convertor_t* convertor )
 {
     printf( "Convertor %p count %d stack position %d bConverted %ld\n", (void*)convertor,
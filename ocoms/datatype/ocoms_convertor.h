@@ -59,11 +59,26 @@ BEGIN_C_DECLS
 #define CONVERTOR_WITH_CHECKSUM    0x00200000
 #define CONVERTOR_CUDA             0x00400000
 #define CONVERTOR_CUDA_ASYNC       0x00800000
-#define CONVERTOR_TYPE_MASK        0x00FF0000
+#define CONVERTOR_TYPE_MASK        0x10FF0000
 #define CONVERTOR_STATE_START      0x01000000
 #define CONVERTOR_STATE_COMPLETE   0x02000000
 #define CONVERTOR_STATE_ALLOC      0x04000000
 #define CONVERTOR_COMPLETED        0x08000000
+#define CONVERTOR_WITH_REDUCE      0x10000000
+#define CONVERTOR_LOSSY            0x20000000
+
+/* checksums computed by the convertors with CONVERTOR_WITH_CHECKSUM */
+#define OCOMS_CONVERTOR_CHECKSUM_SUM          0  /**< sum of 32 bits words */
+#define OCOMS_CONVERTOR_CHECKSUM_CRC32C       1  /**< CRC-32C (Castagnoli) */
+#define OCOMS_CONVERTOR_CHECKSUM_FLETCHER64   2  /**< Fletcher sums modulo 2^32-1 */
+#define OCOMS_CONVERTOR_CHECKSUM_MAX          3
+
+/* representations of the reals in the packed data, see ocoms_convertor_set_wire_format */
+#define OCOMS_CONVERTOR_WIRE_NATIVE           0  /**< the local representation */
+#define OCOMS_CONVERTOR_WIRE_FLOAT4           1  /**< float8 sent as float4 */
+#define OCOMS_CONVERTOR_WIRE_FLOAT2           2  /**< float8 and float4 sent as IEEE half precision */
+#define OCOMS_CONVERTOR_WIRE_BFLOAT16         3  /**< float8 and float4 sent as bfloat16 */
+#define OCOMS_CONVERTOR_WIRE_MAX              4
 
 union dt_elem_desc;
 typedef struct ocoms_convertor_t ocoms_convertor_t;
@@ -72,6 +87,10 @@ typedef int32_t (*convertor_advance_fct_t)( ocoms_convertor_t* pConvertor,
                                             struct iovec* iov,
                                             uint32_t* out_size,
                                             size_t* max_data );
+/* copy length bytes from src to dst (no copy if dst is NULL) and add them
+ * to the checksum of the convertor */
+typedef void (*convertor_checksum_fct_t)( ocoms_convertor_t* pConvertor,
+                                          void* dst, const void* src, size_t length );
 typedef void*(*memalloc_fct_t)( size_t* pLength, void* userdata );
 typedef void*(*memcpy_fct_t)( void* dest, const void* src, size_t n, ocoms_convertor_t* pConvertor );
 
@@ -117,13 +136,16 @@ struct ocoms_convertor_t {
      /* --- cacheline 2 boundary (128 bytes) --- */
     dt_stack_t                    static_stack[DT_STATIC_STACK_SIZE];  /**< local stack for small datatypes */
     /* --- cacheline 3 boundary (192 bytes) was 56 bytes ago --- */
+    convertor_checksum_fct_t      fChecksum;      /**< copy and checksum function */
+    /* --- cacheline 4 boundary (256 bytes) --- */
+    unsigned char                 partial_data[32]; /**< partial element left over by a reducing or lossy unpack */
+    int32_t                       reduce_op;      /**< operation of the CONVERTOR_WITH_REDUCE unpack */
 
 #if OCOMS_CUDA_SUPPORT
     memcpy_fct_t                  cbmemcpy;       /**< memcpy or cuMemcpy */
     void *                        stream;         /**< CUstream for async copy */
 #endif
-    /* size: 248, cachelines: 4, members: 20 */
-    /* last cacheline: 56 bytes */
+    /* size: 296, cachelines: 5, members: 23 */
 };
 OCOMS_DECLSPEC OBJ_CLASS_DECLARATION( ocoms_convertor_t );
 
@@ -136,6 +158,38 @@ static inline uint32_t ocoms_convertor_get_checksum( ocoms_convertor_t* converto
     return convertor->checksum;
 }
 
+/*
+ * Select the checksum (OCOMS_CONVERTOR_CHECKSUM_*) computed when the
+ * convertor has the CONVERTOR_WITH_CHECKSUM flag. The default is given
+ * by the ddt_checksum MCA variable.
+ */
+OCOMS_DECLSPEC int32_t ocoms_convertor_set_checksum_type( ocoms_convertor_t* convertor,
+                                                          int32_t type );
+
+/*
+ * Select the operation (OCOMS_DATATYPE_OP_* but MINLOC and MAXLOC) of a
+ * receive convertor with the CONVERTOR_WITH_REDUCE flag: the unpack does
+ * user = packed op user instead of copying the packed data. The default
+ * is SUM. The preparation fails with OCOMS_ERR_NOT_SUPPORTED when the
+ * operation is not defined on one of the types of the datatype, or on a
+ * heterogeneous or CUDA convertor. Such a convertor can only be moved to
+ * positions on predefined element boundaries.
+ */
+OCOMS_DECLSPEC int32_t ocoms_convertor_set_reduce_op( ocoms_convertor_t* convertor,
+                                                      int32_t op );
+
+/*
+ * Select the representation (OCOMS_CONVERTOR_WIRE_*) of the float8 and
+ * float4 elements in the packed data, before the preparation. Both peers
+ * have to use the same format. The reduced formats round to the nearest
+ * even, lose precision and range, and are only available between peers
+ * of the local architecture (OCOMS_ERR_NOT_SUPPORTED otherwise). The
+ * packed size and the positions then count packed bytes, the packing
+ * stops and the positions are rounded down on element boundaries.
+ */
+OCOMS_DECLSPEC int32_t ocoms_convertor_set_wire_format( ocoms_convertor_t* convertor,
+                                                        int32_t format );
+
 
 /*
  *
@@ -187,9 +241,7 @@ static inline int ocoms_convertor_cleanup( ocoms_convertor_t* convertor )
  */
 static inline int32_t ocoms_convertor_need_buffers( const ocoms_convertor_t* pConvertor )
 {
-#if OCOMS_ENABLE_HETEROGENEOUS_SUPPORT
     if (OCOMS_UNLIKELY(0 == (pConvertor->flags & CONVERTOR_HOMOGENEOUS))) return 1;
-#endif
 #if OCOMS_CUDA_SUPPORT
     if( pConvertor->flags & CONVERTOR_CUDA ) return 1;
 #endif
@@ -206,6 +258,7 @@ static inline void ocoms_convertor_get_packed_size( const ocoms_convertor_t* pCo
                                                    size_t* pSize )
 {
     *pSize = pConv->local_size;
+    if( OCOMS_UNLIKELY(pConv->flags & CONVERTOR_LOSSY) ) *pSize = pConv->remote_size;
 }
 
 
@@ -283,6 +336,21 @@ ocoms_convertor_raw( ocoms_convertor_t* convertor,  /* [IN/OUT] */
                     uint32_t* iov_count,          /* [IN/OUT] */
                     size_t* length );             /* [OUT]    */
 
+/*
+ * Same as ocoms_convertor_raw, but the pieces of memory following each
+ * other are merged in a single iovec, including across the loops of the
+ * datatype, so the at most *iov_count iovecs cover as much data as
+ * possible. If small is not NULL, small[i] tells if iov[i] is shorter
+ * than min_segment, i.e. better copied than exposed as zero-copy.
+ */
+OCOMS_DECLSPEC int32_t
+ocoms_convertor_raw_coalesced( ocoms_convertor_t* convertor,  /* [IN/OUT] */
+                               struct iovec* iov,            /* [IN/OUT] */
+                               uint32_t* iov_count,          /* [IN/OUT] */
+                               size_t* length,               /* [OUT]    */
+                               size_t min_segment,           /* [IN]     */
+                               bool* small );                /* [OUT]    */
+
 /*
  * Upper level does not need to call the _nocheck function directly.
  */
@@ -312,7 +380,7 @@ ocoms_convertor_set_position( ocoms_convertor_t* convertor,
     /* Remove the completed flag if it's already set */
     convertor->flags &= ~CONVERTOR_COMPLETED;
 
-    if( !(convertor->flags & CONVERTOR_WITH_CHECKSUM) &&
+    if( !(convertor->flags & (CONVERTOR_WITH_CHECKSUM | CONVERTOR_WITH_REDUCE | CONVERTOR_LOSSY)) &&
         (convertor->flags & OCOMS_DATATYPE_FLAG_NO_GAPS) &&
         (convertor->flags & (CONVERTOR_SEND | CONVERTOR_HOMOGENEOUS)) ) {
         /* Contiguous and no checkpoint and no homogeneous unpack */
@@ -22,6 +22,7 @@
 #include "../platform/ocoms_constants.h"
 #include "ocoms_datatype.h"
 #include "ocoms_convertor.h"
+#include "ocoms/threads/mutex.h"
 
 BEGIN_C_DECLS
 
@@ -37,14 +38,44 @@ typedef struct ocoms_convertor_master_t {
     uint32_t                        hetero_mask;
     const size_t                    remote_sizes[OCOMS_DATATYPE_MAX_PREDEFINED];
     conversion_fct_t*               pFunctions;   /**< the convertor functions pointer */
+    int32_t                         wire_format;  /**< OCOMS_CONVERTOR_WIRE_* of the reals */
+    conversion_fct_t*               pPackFunctions;  /**< packing conversions of the reduced wire formats */
 } ocoms_convertor_master_t;
 
 /*
  * Find or create a new master convertor based on a specific architecture. The master
  * convertor hold all informations related to a defined architecture, such as the sizes
  * of the predefined data-types, the conversion functions, ...
+ * There is one master per wire format, NULL when the format is not
+ * supported for this architecture.
  */
-ocoms_convertor_master_t* ocoms_convertor_find_or_create_master( uint32_t remote_arch );
+ocoms_convertor_master_t* ocoms_convertor_find_or_create_master( uint32_t remote_arch,
+                                                               int32_t wire_format );
+
+/*
+ * The reduced wire formats. The sizes, the hetero_mask and the conversions
+ * of a new master are set for the format, a copy of the native master of
+ * the local architecture. The conversions follow the unpack convention
+ * of the master: pFunctions widen count packed elements from_extent bytes
+ * apart, as many as from_len holds; pPackFunctions narrow the elements of
+ * the user memory into packed elements to_extent bytes apart, as many as
+ * to_length holds. Both return the number of elements and set advance to
+ * the amount of packed bytes.
+ */
+int32_t ocoms_convertor_lossy_master_init( ocoms_convertor_master_t* master,
+                                           int32_t wire_format );
+
+/*
+ * Move a convertor using a reduced wire format to an element boundary at
+ * or before the packed position, once rewound if the position is behind.
+ */
+int32_t ocoms_convertor_lossy_position( ocoms_convertor_t* convertor,
+                                        size_t* position );
+
+/*
+ * Select the narrowing and widening kernels, called by ocoms_datatype_init().
+ */
+int32_t ocoms_datatype_lossy_init( void );
 
 /*
  * Destroy all pending master convertors. This function is usually called when we
@@ -52,6 +83,79 @@ ocoms_convertor_master_t* ocoms_convertor_find_or_create_master( uint32_t remote
  */
 void ocoms_convertor_destroy_masters( void );
 
+/*
+ * Prepared convertors cached by the datatypes. A template holds all the
+ * convertor fields set by a prepare, except the user buffer, for a count,
+ * a remote architecture and the type flags of the convertor. The list
+ * of a datatype only grows (up to ocoms_convertor_template_max entries)
+ * until the next commit or the destruction of the datatype.
+ */
+typedef struct ocoms_convertor_template_t {
+    struct ocoms_convertor_template_t* next;
+    const struct ocoms_convertor_master_t* master;
+    uint32_t                      type_flags;  /**< CONVERTOR_TYPE_MASK flags before the prepare */
+    uint32_t                      flags;       /**< flags after the prepare */
+    ocoms_datatype_count_t        count;
+    uint32_t                      stack_pos;
+    size_t                        local_size;
+    size_t                        remote_size;
+    const dt_type_desc_t*         use_desc;
+    convertor_advance_fct_t       fAdvance;
+    dt_stack_t                    stack[DT_STATIC_STACK_SIZE];
+} ocoms_convertor_template_t;
+
+OCOMS_DECLSPEC extern int ocoms_convertor_template_max;
+
+/*
+ * Release the templates of a datatype, the datatype cannot be used by
+ * another thread at the same time.
+ */
+void ocoms_convertor_release_templates( ocoms_datatype_t* datatype );
+
+/*
+ * Parallel pack and unpack. The homogeneous convertors using a pack plan
+ * split the iovecs of at least two segments between the calling thread
+ * and ocoms_convertor_parallel_threads - 1 helper threads (1 = disabled).
+ * The split only happens once the process has enabled the threads with
+ * ocoms_set_using_threads, the others pack and unpack serially.
+ */
+OCOMS_DECLSPEC extern int ocoms_convertor_parallel_threads;
+OCOMS_DECLSPEC extern size_t ocoms_convertor_parallel_segment_size;
+
+#define OCOMS_CONVERTOR_PARALLEL_SPLIT( length )                          \
+    ((0 != ocoms_convertor_parallel_segment_size) &&                      \
+     ((length) >= 2 * ocoms_convertor_parallel_segment_size))
+
+#if OCOMS_ENABLE_MULTI_THREADS
+int32_t ocoms_convertor_parallel_init( void );
+int32_t ocoms_convertor_parallel_finalize( void );
+int32_t ocoms_convertor_parallel_advance( ocoms_convertor_t* pConv,
+                                          struct iovec* iov, uint32_t* out_size,
+                                          size_t* max_data );
+
+#define OCOMS_CONVERTOR_PARALLEL( convertor )                             \
+    ((ocoms_convertor_parallel_threads > 1) && ocoms_using_threads() &&   \
+     ((ocoms_pack_plan == (convertor)->fAdvance) ||                       \
+      (ocoms_unpack_plan == (convertor)->fAdvance)) &&                    \
+     OCOMS_CONVERTOR_PARALLEL_SPLIT( (convertor)->local_size - (convertor)->bConverted ))
+#else
+#define ocoms_convertor_parallel_init()        OCOMS_SUCCESS
+#define ocoms_convertor_parallel_finalize()    OCOMS_SUCCESS
+#define OCOMS_CONVERTOR_PARALLEL( convertor )  0
+#endif  /* OCOMS_ENABLE_MULTI_THREADS */
+
+/*
+ * Pipelined pack and unpack, see ocoms_convertor_pipeline.h.
+ */
+int32_t ocoms_convertor_pipeline_init( void );
+int32_t ocoms_convertor_pipeline_finalize( void );
+
+/*
+ * Select the byte swapping used by the heterogeneous conversions between
+ * architectures of different endianness, called by ocoms_datatype_init().
+ */
+int32_t ocoms_datatype_swap_init( void );
+
 END_C_DECLS
 
 #endif  /* OCOMS_CONVERTOR_INTERNAL_HAS_BEEN_INCLUDED */
@@ -0,0 +1,953 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/datatype/ocoms_convertor_internal.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+#include "ocoms/datatype/ocoms_datatype_prototypes.h"
+#include "ocoms/datatype/ocoms_datatype_reduce.h"
+
+#if OCOMS_ENABLE_DEBUG
+#include "ocoms/util/output.h"
+
+extern bool ocoms_pack_debug;
+#define DO_DEBUG(INST)  if( ocoms_pack_debug ) { INST }
+#else
+#define DO_DEBUG(INST)
+#endif  /* OCOMS_ENABLE_DEBUG */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define OCOMS_LOSSY_X86 1
+#include <immintrin.h>
+#else
+#define OCOMS_LOSSY_X86 0
+#endif
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_NEON)
+#define OCOMS_LOSSY_NEON 1
+#include <arm_neon.h>
+#else
+#define OCOMS_LOSSY_NEON 0
+#endif
+
+/* the reduced formats narrow the IEEE binary32 and binary64 reals */
+#if (SIZEOF_FLOAT == 4) && (SIZEOF_DOUBLE == 8)
+#define OCOMS_LOSSY_SUPPORT 1
+#else
+#define OCOMS_LOSSY_SUPPORT 0
+#endif
+
+extern conversion_fct_t ocoms_datatype_copy_functions[OCOMS_DATATYPE_MAX_PREDEFINED];
+
+/*
+ * The reduced wire formats.
+ *
+ * A convertor using one of them gets a master of its own, where the
+ * float8 and float4 elements have the size of their packed form and the
+ * conversions between both. The convertor is then CONVERTOR_LOSSY and
+ * works on the full description of the datatype with the functions
+ * below, which copy the other types as they are. The sizes and positions
+ * of these convertors count packed bytes.
+ *
+ * The narrowing rounds to the nearest even. From float8 to half precision
+ * or bfloat16 the conversion first rounds to a float4 with an odd last
+ * bit when inexact, the second rounding is then exact, as if done at
+ * once. The NaN stay NaN and the overflows become infinities.
+ */
+
+/*
+ * Scalar conversions, the reference of the vector kernels.
+ */
+static inline float ocoms_lossy_as_float( uint32_t x )
+{
+    float f;
+    memcpy( &f, &x, sizeof(float) );
+    return f;
+}
+
+static inline uint32_t ocoms_lossy_float_bits( float f )
+{
+    uint32_t x;
+    memcpy( &x, &f, sizeof(float) );
+    return x;
+}
+
+static inline uint16_t ocoms_lossy_float_to_half( float f )
+{
+    uint32_t x = ocoms_lossy_float_bits( f );
+    uint32_t sign = x & 0x80000000u;
+    uint16_t h;
+
+    x ^= sign;
+    if( x >= 0x47800000u ) {  /* 2^16: infinity, NaN or overflow */
+        h = (x > 0x7f800000u) ? 0x7e00 : 0x7c00;
+    } else if( x < 0x38800000u ) {  /* 2^-14: subnormal or zero */
+        /* the addition aligns the mantissa and rounds it */
+        x = ocoms_lossy_float_bits( ocoms_lossy_as_float( x ) + ocoms_lossy_as_float( 0x3f000000u ) );
+        h = (uint16_t)(x - 0x3f000000u);
+    } else {
+        x += 0xc8000fffu + ((x >> 13) & 1);  /* rebias, round to nearest even */
+        h = (uint16_t)(x >> 13);
+    }
+    return h | (uint16_t)(sign >> 16);
+}
+
+static inline float ocoms_lossy_half_to_float( uint16_t h )
+{
+    uint32_t x = ((uint32_t)h & 0x7fff) << 13;
+    uint32_t exponent = x & 0x0f800000u;
+
+    x += 0x38000000u;  /* rebias */
+    if( 0x0f800000u == exponent ) {  /* infinity or NaN */
+        x += 0x38000000u;
+    } else if( 0 == exponent ) {  /* subnormal or zero */
+        x = ocoms_lossy_float_bits( ocoms_lossy_as_float( x + 0x00800000u ) -
+                                    ocoms_lossy_as_float( 0x38800000u ) );
+    }
+    return ocoms_lossy_as_float( x | (((uint32_t)h & 0x8000) << 16) );
+}
+
+static inline uint16_t ocoms_lossy_float_to_bfloat16( float f )
+{
+    uint32_t x = ocoms_lossy_float_bits( f );
+
+    if( (x & 0x7fffffffu) > 0x7f800000u )
+        return (uint16_t)((x >> 16) | 0x40);  /* quiet NaN */
+    return (uint16_t)((x + 0x7fffu + ((x >> 16) & 1)) >> 16);
+}
+
+static inline float ocoms_lossy_bfloat16_to_float( uint16_t b )
+{
+    return ocoms_lossy_as_float( (uint32_t)b << 16 );
+}
+
+/* round to float with an odd last bit when inexact */
+static inline float ocoms_lossy_double_to_float_odd( double d )
+{
+    float f = (float)d;
+    uint32_t x;
+
+    if( ((double)f != d) && (d == d) ) {
+        x = ocoms_lossy_float_bits( f );
+        if( 0 == (x & 1) ) {
+            if( ((f < 0) ? -(double)f : (double)f) > ((d < 0) ? -d : d) ) x--;
+            else x++;
+        }
+        f = ocoms_lossy_as_float( x );
+    }
+    return f;
+}
+
+#define OCOMS_LOSSY_D2F( A )  ((float)(A))
+#define OCOMS_LOSSY_F2D( A )  ((double)(A))
+#define OCOMS_LOSSY_D2H( A )  ocoms_lossy_float_to_half( ocoms_lossy_double_to_float_odd( A ) )
+#define OCOMS_LOSSY_F2H( A )  ocoms_lossy_float_to_half( A )
+#define OCOMS_LOSSY_H2D( A )  ((double)ocoms_lossy_half_to_float( A ))
+#define OCOMS_LOSSY_H2F( A )  ocoms_lossy_half_to_float( A )
+#define OCOMS_LOSSY_D2B( A )  ocoms_lossy_float_to_bfloat16( ocoms_lossy_double_to_float_odd( A ) )
+#define OCOMS_LOSSY_F2B( A )  ocoms_lossy_float_to_bfloat16( A )
+#define OCOMS_LOSSY_B2D( A )  ((double)ocoms_lossy_bfloat16_to_float( A ))
+#define OCOMS_LOSSY_B2F( A )  ocoms_lossy_bfloat16_to_float( A )
+
+/*
+ * The kernels convert count elements between arrays which might be
+ * misaligned and cannot overlap. Like the reduction kernels they are
+ * compiled for the default target, and for AVX2 and AVX-512 on x86-64
+ * where the half precision conversions use F16C and their AVX-512F
+ * forms.
+ */
+typedef void (*ocoms_lossy_kernel_t)( const void* from, void* to, size_t count );
+
+typedef struct {
+    ocoms_lossy_kernel_t d2f, f2d, d2h, f2h, h2d, h2f, d2b, f2b, b2d, b2f;
+} ocoms_lossy_kernels_t;
+
+static ocoms_lossy_kernels_t ocoms_lossy_kernels;
+
+#define OCOMS_LOSSY_KERNEL( NAME, CONVERT, FROM_TYPE, TO_TYPE, VARIANT, ATTRIBUTE ) \
+static ATTRIBUTE void                                                   \
+ocoms_lossy_##NAME##_##VARIANT( const void* from, void* to, size_t count ) \
+{                                                                       \
+    const unsigned char* in = (const unsigned char*)from;               \
+    unsigned char* out = (unsigned char*)to;                            \
+    FROM_TYPE a;                                                        \
+    TO_TYPE b;                                                          \
+    size_t i;                                                           \
+                                                                        \
+    for( i = 0; i < count; i++ ) {                                      \
+        memcpy( &a, in + i * sizeof(FROM_TYPE), sizeof(FROM_TYPE) );    \
+        b = CONVERT( a );                                               \
+        memcpy( out + i * sizeof(TO_TYPE), &b, sizeof(TO_TYPE) );       \
+    }                                                                   \
+}
+
+#define OCOMS_LOSSY_KERNELS( VARIANT, ATTRIBUTE )                       \
+    OCOMS_LOSSY_KERNEL( d2f, OCOMS_LOSSY_D2F, double, float, VARIANT, ATTRIBUTE ) \
+    OCOMS_LOSSY_KERNEL( f2d, OCOMS_LOSSY_F2D, float, double, VARIANT, ATTRIBUTE ) \
+    OCOMS_LOSSY_KERNEL( d2b, OCOMS_LOSSY_D2B, double, uint16_t, VARIANT, ATTRIBUTE ) \
+    OCOMS_LOSSY_KERNEL( f2b, OCOMS_LOSSY_F2B, float, uint16_t, VARIANT, ATTRIBUTE ) \
+    OCOMS_LOSSY_KERNEL( b2d, OCOMS_LOSSY_B2D, uint16_t, double, VARIANT, ATTRIBUTE ) \
+    OCOMS_LOSSY_KERNEL( b2f, OCOMS_LOSSY_B2F, uint16_t, float, VARIANT, ATTRIBUTE )
+
+#if OCOMS_LOSSY_SUPPORT
+OCOMS_LOSSY_KERNELS( generic, )
+OCOMS_LOSSY_KERNEL( d2h, OCOMS_LOSSY_D2H, double, uint16_t, scalar, )
+OCOMS_LOSSY_KERNEL( f2h, OCOMS_LOSSY_F2H, float, uint16_t, scalar, )
+OCOMS_LOSSY_KERNEL( h2d, OCOMS_LOSSY_H2D, uint16_t, double, scalar, )
+OCOMS_LOSSY_KERNEL( h2f, OCOMS_LOSSY_H2F, uint16_t, float, scalar, )
+
+#if OCOMS_LOSSY_NEON
+static void ocoms_lossy_d2h_generic( const void* from, void* to, size_t count )
+{
+    const double* in = (const double*)from;
+    uint16_t* out = (uint16_t*)to;
+    size_t i = 0;
+
+    /* FCVTXN rounds to odd */
+    for( ; (i + 4) <= count; i += 4 ) {
+        float32x4_t f = vcombine_f32( vcvtx_f32_f64( vld1q_f64( in + i ) ),
+                                      vcvtx_f32_f64( vld1q_f64( in + i + 2 ) ) );
+        vst1_u16( out + i, vreinterpret_u16_f16( vcvt_f16_f32( f ) ) );
+    }
+    ocoms_lossy_d2h_scalar( in + i, out + i, count - i );
+}
+
+static void ocoms_lossy_f2h_generic( const void* from, void* to, size_t count )
+{
+    const float* in = (const float*)from;
+    uint16_t* out = (uint16_t*)to;
+    size_t i = 0;
+
+    for( ; (i + 4) <= count; i += 4 )
+        vst1_u16( out + i, vreinterpret_u16_f16( vcvt_f16_f32( vld1q_f32( in + i ) ) ) );
+    ocoms_lossy_f2h_scalar( in + i, out + i, count - i );
+}
+
+static void ocoms_lossy_h2d_generic( const void* from, void* to, size_t count )
+{
+    const uint16_t* in = (const uint16_t*)from;
+    double* out = (double*)to;
+    size_t i = 0;
+
+    for( ; (i + 4) <= count; i += 4 ) {
+        float32x4_t f = vcvt_f32_f16( vreinterpret_f16_u16( vld1_u16( in + i ) ) );
+        vst1q_f64( out + i, vcvt_f64_f32( vget_low_f32( f ) ) );
+        vst1q_f64( out + i + 2, vcvt_high_f64_f32( f ) );
+    }
+    ocoms_lossy_h2d_scalar( in + i, out + i, count - i );
+}
+
+static void ocoms_lossy_h2f_generic( const void* from, void* to, size_t count )
+{
+    const uint16_t* in = (const uint16_t*)from;
+    float* out = (float*)to;
+    size_t i = 0;
+
+    for( ; (i + 4) <= count; i += 4 )
+        vst1q_f32( out + i, vcvt_f32_f16( vreinterpret_f16_u16( vld1_u16( in + i ) ) ) );
+    ocoms_lossy_h2f_scalar( in + i, out + i, count - i );
+}
+#else
+#define ocoms_lossy_d2h_generic  ocoms_lossy_d2h_scalar
+#define ocoms_lossy_f2h_generic  ocoms_lossy_f2h_scalar
+#define ocoms_lossy_h2d_generic  ocoms_lossy_h2d_scalar
+#define ocoms_lossy_h2f_generic  ocoms_lossy_h2f_scalar
+#endif  /* OCOMS_LOSSY_NEON */
+
+#if OCOMS_LOSSY_X86
+#define OCOMS_LOSSY_AVX2    __attribute__((target("avx2,f16c")))
+#if defined(__clang__)
+#define OCOMS_LOSSY_AVX512  __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl")))
+#else
+#define OCOMS_LOSSY_AVX512  __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,prefer-vector-width=512")))
+#endif  /* defined(__clang__) */
+
+OCOMS_LOSSY_KERNELS( avx2, OCOMS_LOSSY_AVX2 )
+OCOMS_LOSSY_KERNELS( avx512, OCOMS_LOSSY_AVX512 )
+
+/* _mm256_cvtpd_ps rounding to odd */
+static inline OCOMS_LOSSY_AVX2 __m128 ocoms_lossy_cvtpd_ps_odd_avx2( __m256d d )
+{
+    const __m256d abs_mask = _mm256_castsi256_pd( _mm256_set1_epi64x( 0x7fffffffffffffffLL ) );
+    const __m256i low_words = _mm256_setr_epi32( 0, 2, 4, 6, 0, 2, 4, 6 );
+    const __m128i one = _mm_set1_epi32( 1 );
+    __m128 f = _mm256_cvtpd_ps( d );
+    __m256d back = _mm256_cvtps_pd( f );
+    __m256d inexact = _mm256_cmp_pd( back, d, _CMP_NEQ_OQ );
+    __m256d larger = _mm256_cmp_pd( _mm256_and_pd( back, abs_mask ),
+                                    _mm256_and_pd( d, abs_mask ), _CMP_GT_OQ );
+    __m128i x = _mm_castps_si128( f ), even, adjust;
+
+    /* the 64 bits masks to 32 bits */
+    inexact = _mm256_castsi256_pd( _mm256_permutevar8x32_epi32( _mm256_castpd_si256( inexact ), low_words ) );
+    larger  = _mm256_castsi256_pd( _mm256_permutevar8x32_epi32( _mm256_castpd_si256( larger ), low_words ) );
+    even = _mm_cmpeq_epi32( _mm_and_si128( x, one ), _mm_setzero_si128() );
+    /* -1 toward zero when the float is larger, +1 otherwise */
+    adjust = _mm_and_si128( _mm_and_si128( _mm256_castsi256_si128( _mm256_castpd_si256( inexact ) ), even ),
+                            _mm_or_si128( _mm256_castsi256_si128( _mm256_castpd_si256( larger ) ), one ) );
+    return _mm_castsi128_ps( _mm_add_epi32( x, adjust ) );
+}
+
+static OCOMS_LOSSY_AVX2 void ocoms_lossy_d2h_avx2( const void* from, void* to, size_t count )
+{
+    const double* in = (const double*)from;
+    uint16_t* out = (uint16_t*)to;
+    size_t i = 0;
+
+    for( ; (i + 8) <= count; i += 8 ) {
+        __m256 f = _mm256_set_m128( ocoms_lossy_cvtpd_ps_odd_avx2( _mm256_loadu_pd( in + i + 4 ) ),
+                                    ocoms_lossy_cvtpd_ps_odd_avx2( _mm256_loadu_pd( in + i ) ) );
+        _mm_storeu_si128( (__m128i*)(out + i), _mm256_cvtps_ph( f, _MM_FROUND_TO_NEAREST_INT ) );
+    }
+    ocoms_lossy_d2h_scalar( in + i, out + i, count - i );
+}
+
+static OCOMS_LOSSY_AVX2 void ocoms_lossy_f2h_avx2( const void* from, void* to, size_t count )
+{
+    const float* in = (const float*)from;
+    uint16_t* out = (uint16_t*)to;
+    size_t i = 0;
+
+    for( ; (i + 8) <= count; i += 8 )
+        _mm_storeu_si128( (__m128i*)(out + i),
+                          _mm256_cvtps_ph( _mm256_loadu_ps( in + i ), _MM_FROUND_TO_NEAREST_INT ) );
+    ocoms_lossy_f2h_scalar( in + i, out + i, count - i );
+}
+
+static OCOMS_LOSSY_AVX2 void ocoms_lossy_h2d_avx2( const void* from, void* to, size_t count )
+{
+    const uint16_t* in = (const uint16_t*)from;
+    double* out = (double*)to;
+    size_t i = 0;
+
+    for( ; (i + 8) <= count; i += 8 ) {
+        __m256 f = _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)(in + i) ) );
+        _mm256_storeu_pd( out + i, _mm256_cvtps_pd( _mm256_castps256_ps128( f ) ) );
+        _mm256_storeu_pd( out + i + 4, _mm256_cvtps_pd( _mm256_extractf128_ps( f, 1 ) ) );
+    }
+    ocoms_lossy_h2d_scalar( in + i, out + i, count - i );
+}
+
+static OCOMS_LOSSY_AVX2 void ocoms_lossy_h2f_avx2( const void* from, void* to, size_t count )
+{
+    const uint16_t* in = (const uint16_t*)from;
+    float* out = (float*)to;
+    size_t i = 0;
+
+    for( ; (i + 8) <= count; i += 8 )
+        _mm256_storeu_ps( out + i, _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)(in + i) ) ) );
+    ocoms_lossy_h2f_scalar( in + i, out + i, count - i );
+}
+
+/* _mm512_cvtpd_ps rounding to odd */
+static inline OCOMS_LOSSY_AVX512 __m256 ocoms_lossy_cvtpd_ps_odd_avx512( __m512d d )
+{
+    const __m256i one = _mm256_set1_epi32( 1 );
+    __m256 f = _mm512_cvtpd_ps( d );
+    __m512d back = _mm512_cvtps_pd( f );
+    __mmask8 inexact = _mm512_cmp_pd_mask( back, d, _CMP_NEQ_OQ );
+    __mmask8 larger = _mm512_cmp_pd_mask( _mm512_abs_pd( back ), _mm512_abs_pd( d ), _CMP_GT_OQ );
+    __m256i x = _mm256_castps_si256( f );
+
+    inexact &= _mm256_testn_epi32_mask( x, one );  /* only the even ones move */
+    x = _mm256_mask_sub_epi32( x, inexact & larger, x, one );
+    x = _mm256_mask_add_epi32( x, inexact & (__mmask8)~larger, x, one );
+    return _mm256_castsi256_ps( x );
+}
+
+static OCOMS_LOSSY_AVX512 void ocoms_lossy_d2h_avx512( const void* from, void* to, size_t count )
+{
+    const double* in = (const double*)from;
+    uint16_t* out = (uint16_t*)to;
+    size_t i = 0;
+
+    for( ; (i + 16) <= count; i += 16 ) {
+        __m512 f = _mm512_insertf32x8( _mm512_castps256_ps512( ocoms_lossy_cvtpd_ps_odd_avx512( _mm512_loadu_pd( in + i ) ) ),
+                                       ocoms_lossy_cvtpd_ps_odd_avx512( _mm512_loadu_pd( in + i + 8 ) ), 1 );
+        _mm256_storeu_si256( (__m256i*)(out + i),
+                             _mm512_cvtps_ph( f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ) );
+    }
+    ocoms_lossy_d2h_avx2( in + i, out + i, count - i );
+}
+
+static OCOMS_LOSSY_AVX512 void ocoms_lossy_f2h_avx512( const void* from, void* to, size_t count )
+{
+    const float* in = (const float*)from;
+    uint16_t* out = (uint16_t*)to;
+    size_t i = 0;
+
+    for( ; (i + 16) <= count; i += 16 )
+        _mm256_storeu_si256( (__m256i*)(out + i),
+                             _mm512_cvtps_ph( _mm512_loadu_ps( in + i ),
+                                              _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ) );
+    ocoms_lossy_f2h_avx2( in + i, out + i, count - i );
+}
+
+static OCOMS_LOSSY_AVX512 void ocoms_lossy_h2d_avx512( const void* from, void* to, size_t count )
+{
+    const uint16_t* in = (const uint16_t*)from;
+    double* out = (double*)to;
+    size_t i = 0;
+
+    for( ; (i + 16) <= count; i += 16 ) {
+        __m512 f = _mm512_cvtph_ps( _mm256_loadu_si256( (const __m256i*)(in + i) ) );
+        _mm512_storeu_pd( out + i, _mm512_cvtps_pd( _mm512_castps512_ps256( f ) ) );
+        _mm512_storeu_pd( out + i + 8, _mm512_cvtps_pd( _mm512_extractf32x8_ps( f, 1 ) ) );
+    }
+    ocoms_lossy_h2d_avx2( in + i, out + i, count - i );
+}
+
+static OCOMS_LOSSY_AVX512 void ocoms_lossy_h2f_avx512( const void* from, void* to, size_t count )
+{
+    const uint16_t* in = (const uint16_t*)from;
+    float* out = (float*)to;
+    size_t i = 0;
+
+    for( ; (i + 16) <= count; i += 16 )
+        _mm512_storeu_ps( out + i, _mm512_cvtph_ps( _mm256_loadu_si256( (const __m256i*)(in + i) ) ) );
+    ocoms_lossy_h2f_avx2( in + i, out + i, count - i );
+}
+#endif  /* OCOMS_LOSSY_X86 */
+
+#define OCOMS_LOSSY_SET_KERNELS( VARIANT )                              \
+    do {                                                                \
+        ocoms_lossy_kernels.d2f = ocoms_lossy_d2f_##VARIANT;            \
+        ocoms_lossy_kernels.f2d = ocoms_lossy_f2d_##VARIANT;            \
+        ocoms_lossy_kernels.d2h = ocoms_lossy_d2h_##VARIANT;            \
+        ocoms_lossy_kernels.f2h = ocoms_lossy_f2h_##VARIANT;            \
+        ocoms_lossy_kernels.h2d = ocoms_lossy_h2d_##VARIANT;            \
+        ocoms_lossy_kernels.h2f = ocoms_lossy_h2f_##VARIANT;            \
+        ocoms_lossy_kernels.d2b = ocoms_lossy_d2b_##VARIANT;            \
+        ocoms_lossy_kernels.f2b = ocoms_lossy_f2b_##VARIANT;            \
+        ocoms_lossy_kernels.b2d = ocoms_lossy_b2d_##VARIANT;            \
+        ocoms_lossy_kernels.b2f = ocoms_lossy_b2f_##VARIANT;            \
+    } while(0)
+#endif  /* OCOMS_LOSSY_SUPPORT */
+
+/*
+ * The kernels follow the variant of the reduction kernels (MCA variable
+ * ddt_reduce), AVX2 also needs F16C.
+ */
+int32_t ocoms_datatype_lossy_init( void )
+{
+#if OCOMS_LOSSY_SUPPORT
+    OCOMS_LOSSY_SET_KERNELS( generic );
+#if OCOMS_LOSSY_X86
+    if( OCOMS_DATATYPE_REDUCE_AVX512 == ocoms_datatype_reduce_variant ) {
+        OCOMS_LOSSY_SET_KERNELS( avx512 );
+    } else if( (OCOMS_DATATYPE_REDUCE_AVX2 == ocoms_datatype_reduce_variant) &&
+               __builtin_cpu_supports( "f16c" ) ) {
+        OCOMS_LOSSY_SET_KERNELS( avx2 );
+    }
+#endif  /* OCOMS_LOSSY_X86 */
+#endif  /* OCOMS_LOSSY_SUPPORT */
+    return OCOMS_SUCCESS;
+}
+
+#if OCOMS_LOSSY_SUPPORT
+#define OCOMS_LOSSY_CHUNK  64
+
+/*
+ * Convert count elements, from_extent and to_extent bytes apart. The
+ * kernels work on arrays, one strided side goes through a local buffer.
+ */
+static inline void
+ocoms_lossy_convert( ocoms_lossy_kernel_t kernel, size_t count,
+                     const unsigned char* from, size_t from_size, OCOMS_PTRDIFF_TYPE from_extent,
+                     unsigned char* to, size_t to_size, OCOMS_PTRDIFF_TYPE to_extent )
+{
+    unsigned char bounce[OCOMS_LOSSY_CHUNK * sizeof(double)];
+    size_t length, i;
+
+    if( ((OCOMS_PTRDIFF_TYPE)from_size == from_extent) && ((OCOMS_PTRDIFF_TYPE)to_size == to_extent) ) {
+        kernel( from, to, count );
+        return;
+    }
+    while( 0 != count ) {
+        length = (count < OCOMS_LOSSY_CHUNK) ? count : OCOMS_LOSSY_CHUNK;
+        if( (OCOMS_PTRDIFF_TYPE)to_size == to_extent ) {
+            for( i = 0; i < length; i++ )
+                memcpy( bounce + i * from_size, from + i * from_extent, from_size );
+            kernel( bounce, to, length );
+        } else if( (OCOMS_PTRDIFF_TYPE)from_size == from_extent ) {
+            kernel( from, bounce, length );
+            for( i = 0; i < length; i++ )
+                memcpy( to + i * to_extent, bounce + i * to_size, to_size );
+        } else {
+            for( i = 0; i < length; i++ )
+                kernel( from + i * from_extent, to + i * to_extent, 1 );
+        }
+        from  += length * from_extent;
+        to    += length * to_extent;
+        count -= length;
+    }
+}
+
+/* the conversion functions of the masters, see ocoms_convertor_lossy_master_init */
+#define OCOMS_LOSSY_CONVERSION( NAME, LOCAL_SIZE, WIRE_SIZE, NARROW, WIDEN ) \
+static int32_t                                                          \
+ocoms_lossy_pack_##NAME( ocoms_convertor_t* pConvertor, uint32_t count, \
+                         const void* from, size_t from_len, OCOMS_PTRDIFF_TYPE from_extent, \
+                         void* to, size_t to_length, OCOMS_PTRDIFF_TYPE to_extent, \
+                         OCOMS_PTRDIFF_TYPE* advance )                  \
+{                                                                       \
+    if( ((size_t)count * (WIRE_SIZE)) > to_length )                     \
+        count = (uint32_t)(to_length / (WIRE_SIZE));                    \
+    ocoms_lossy_convert( ocoms_lossy_kernels.NARROW, count,             \
+                         (const unsigned char*)from, (LOCAL_SIZE), from_extent, \
+                         (unsigned char*)to, (WIRE_SIZE), to_extent );  \
+    *advance = (OCOMS_PTRDIFF_TYPE)count * to_extent;                   \
+    return (int32_t)count;                                              \
+}                                                                       \
+static int32_t                                                          \
+ocoms_lossy_unpack_##NAME( ocoms_convertor_t* pConvertor, uint32_t count, \
+                           const void* from, size_t from_len, OCOMS_PTRDIFF_TYPE from_extent, \
+                           void* to, size_t to_length, OCOMS_PTRDIFF_TYPE to_extent, \
+                           OCOMS_PTRDIFF_TYPE* advance )                \
+{                                                                       \
+    if( ((size_t)count * (WIRE_SIZE)) > from_len )                      \
+        count = (uint32_t)(from_len / (WIRE_SIZE));                     \
+    ocoms_lossy_convert( ocoms_lossy_kernels.WIDEN, count,              \
+                         (const unsigned char*)from, (WIRE_SIZE), from_extent, \
+                         (unsigned char*)to, (LOCAL_SIZE), to_extent ); \
+    *advance = (OCOMS_PTRDIFF_TYPE)count * from_extent;                 \
+    return (int32_t)count;                                              \
+}
+
+OCOMS_LOSSY_CONVERSION( float8_float4,   8, 4, d2f, f2d )
+OCOMS_LOSSY_CONVERSION( float8_float2,   8, 2, d2h, h2d )
+OCOMS_LOSSY_CONVERSION( float4_float2,   4, 2, f2h, h2f )
+OCOMS_LOSSY_CONVERSION( float8_bfloat16, 8, 2, d2b, b2d )
+OCOMS_LOSSY_CONVERSION( float4_bfloat16, 4, 2, f2b, b2f )
+
+#define OCOMS_LOSSY_SET_CONVERSION( ID, WIRE_SIZE, NAME )               \
+    do {                                                                \
+        remote_sizes[OCOMS_DATATYPE_##ID] = (WIRE_SIZE);                \
+        master->hetero_mask |= ((uint32_t)1 << OCOMS_DATATYPE_##ID);    \
+        master->pFunctions[OCOMS_DATATYPE_##ID] = ocoms_lossy_unpack_##NAME; \
+        master->pPackFunctions[OCOMS_DATATYPE_##ID] = ocoms_lossy_pack_##NAME; \
+    } while(0)
+#endif  /* OCOMS_LOSSY_SUPPORT */
+
+int32_t ocoms_convertor_lossy_master_init( ocoms_convertor_master_t* master,
+                                           int32_t wire_format )
+{
+#if OCOMS_LOSSY_SUPPORT
+    size_t* remote_sizes = (size_t*)master->remote_sizes;
+
+    master->pFunctions = (conversion_fct_t*)malloc( sizeof(ocoms_datatype_copy_functions) );
+    master->pPackFunctions = (conversion_fct_t*)calloc( OCOMS_DATATYPE_MAX_PREDEFINED,
+                                                        sizeof(conversion_fct_t) );
+    if( (NULL == master->pFunctions) || (NULL == master->pPackFunctions) ) {
+        free( master->pFunctions );
+        free( master->pPackFunctions );
+        return OCOMS_ERR_OUT_OF_RESOURCE;
+    }
+    memcpy( master->pFunctions, ocoms_datatype_copy_functions, sizeof(ocoms_datatype_copy_functions) );
+
+    switch( wire_format ) {
+    case OCOMS_CONVERTOR_WIRE_FLOAT4:
+        OCOMS_LOSSY_SET_CONVERSION( FLOAT8, 4, float8_float4 );
+        break;
+    case OCOMS_CONVERTOR_WIRE_FLOAT2:
+        OCOMS_LOSSY_SET_CONVERSION( FLOAT8, 2, float8_float2 );
+        OCOMS_LOSSY_SET_CONVERSION( FLOAT4, 2, float4_float2 );
+        break;
+    case OCOMS_CONVERTOR_WIRE_BFLOAT16:
+        OCOMS_LOSSY_SET_CONVERSION( FLOAT8, 2, float8_bfloat16 );
+        OCOMS_LOSSY_SET_CONVERSION( FLOAT4, 2, float4_bfloat16 );
+        break;
+    }
+    master->flags |= CONVERTOR_LOSSY;
+    return OCOMS_SUCCESS;
+#else
+    return OCOMS_ERR_NOT_SUPPORTED;
+#endif  /* OCOMS_LOSSY_SUPPORT */
+}
+
+#define OCOMS_LOSSY_PACK    0
+#define OCOMS_LOSSY_UNPACK  1
+#define OCOMS_LOSSY_SKIP    2  /* move the position only */
+
+/*
+ * Convert, or copy when the type keeps its representation, as many
+ * elements of the description as there is space for in the packed data.
+ */
+static inline void
+ocoms_lossy_predefined_data( ocoms_convertor_t* pConvertor,
+                             dt_elem_desc_t* pElem,
+                             uint32_t* count_desc,
+                             unsigned char** packed_buffer,
+                             unsigned char** user_memory,
+                             size_t* space, const int mode )
+{
+    const ocoms_convertor_master_t* master = pConvertor->master;
+    ddt_elem_desc_t* elem = &(pElem->elem);
+    int type = elem->common.type;
+    size_t wire_size = master->remote_sizes[type];
+    uint32_t count = *count_desc, i;
+    unsigned char* user = *user_memory + elem->disp;
+    unsigned char* packed = *packed_buffer;
+    OCOMS_PTRDIFF_TYPE advance;
+
+    if( ((size_t)count * wire_size) > *space ) {
+        count = (uint32_t)(*space / wire_size);
+        if( 0 == count ) return;  /* nothing to do */
+    }
+    if( OCOMS_LOSSY_SKIP != mode ) {
+        OCOMS_DATATYPE_SAFEGUARD_POINTER( user + (count - 1) * elem->extent,
+                                          ocoms_datatype_basicDatatypes[type]->size,
+                                          pConvertor->pBaseBuf, pConvertor->pDesc, pConvertor->count );
+    }
+    if( master->hetero_mask & ((uint32_t)1 << type) ) {
+        if( OCOMS_LOSSY_PACK == mode ) {
+            master->pPackFunctions[type]( pConvertor, count, user, 0, elem->extent,
+                                          packed, *space, wire_size, &advance );
+        } else if( OCOMS_LOSSY_UNPACK == mode ) {
+            master->pFunctions[type]( pConvertor, count, packed, *space, wire_size,
+                                      user, 0, elem->extent, &advance );
+        }
+    } else if( OCOMS_LOSSY_SKIP != mode ) {
+        unsigned char* to   = (OCOMS_LOSSY_PACK == mode) ? packed : user;
+        unsigned char* from = (OCOMS_LOSSY_PACK == mode) ? user : packed;
+        OCOMS_PTRDIFF_TYPE to_extent   = (OCOMS_LOSSY_PACK == mode) ? (OCOMS_PTRDIFF_TYPE)wire_size : elem->extent;
+        OCOMS_PTRDIFF_TYPE from_extent = (OCOMS_LOSSY_PACK == mode) ? elem->extent : (OCOMS_PTRDIFF_TYPE)wire_size;
+
+        if( (OCOMS_PTRDIFF_TYPE)wire_size == elem->extent ) {
+            memcpy( to, from, count * wire_size );
+        } else {
+            for( i = 0; i < count; i++ ) {
+                memcpy( to, from, wire_size );
+                to   += to_extent;
+                from += from_extent;
+            }
+        }
+    }
+    *packed_buffer += count * wire_size;
+    *user_memory   += count * elem->extent;
+    *space         -= count * wire_size;
+    *count_desc    -= count;
+}
+
+/*
+ * The datatype is an array of a single predefined type without gaps, the
+ * position in the user memory follows from bConverted. The packing stops
+ * on element boundaries, the unpacking keeps the bytes of an incomplete
+ * element in the convertor.
+ */
+static inline int32_t
+ocoms_convertor_lossy_contig( ocoms_convertor_t* pConv,
+                              struct iovec* iov, uint32_t* out_size,
+                              size_t* max_data, const int mode )
+{
+    const ocoms_datatype_t *pData = pConv->pDesc;
+    const ocoms_convertor_master_t* master = pConv->master;
+    unsigned char *user_memory, *packed_buffer;
+    uint32_t iov_count, count;
+    size_t remaining, length, size, wire_size, initial_bytes_converted = pConv->bConverted;
+    OCOMS_PTRDIFF_TYPE initial_displ = pConv->use_desc->desc[pConv->use_desc->used].end_loop.first_elem_disp;
+    OCOMS_PTRDIFF_TYPE advance;
+    conversion_fct_t fct;
+    int type;
+
+    for( type = OCOMS_DATATYPE_FIRST_TYPE; !(pData->bdt_used & ((uint32_t)1 << type)); type++ );
+    size      = ocoms_datatype_basicDatatypes[type]->size;
+    wire_size = master->remote_sizes[type];
+    fct = (OCOMS_LOSSY_PACK == mode) ? master->pPackFunctions[type] : master->pFunctions[type];
+
+    DO_DEBUG( ocoms_output( 0, "lossy_contig( pBaseBuf %p, iov_count %d, %s )\n",
+                            pConv->pBaseBuf, *out_size,
+                            (OCOMS_LOSSY_PACK == mode) ? "pack" : "unpack" ); );
+    for( iov_count = 0; iov_count < (*out_size); iov_count++ ) {
+        packed_buffer = (unsigned char*)iov[iov_count].iov_base;
+        remaining = pConv->remote_size - pConv->bConverted;
+        if( remaining > iov[iov_count].iov_len )
+            remaining = iov[iov_count].iov_len;
+        if( OCOMS_LOSSY_PACK == mode )
+            remaining -= remaining % wire_size;  /* whole elements only */
+        iov[iov_count].iov_len = remaining;
+        user_memory = pConv->pBaseBuf + initial_displ +
+            ((pConv->bConverted - pConv->partial_length) / wire_size) * size;
+        pConv->bConverted += remaining;
+
+        /* complete the element left over by the previous iovec */
+        if( 0 != pConv->partial_length ) {
+            length = wire_size - pConv->partial_length;
+            if( length > remaining ) length = remaining;
+            memcpy( pConv->partial_data + pConv->partial_length, packed_buffer, length );
+            pConv->partial_length += (uint32_t)length;
+            packed_buffer += length;
+            remaining     -= length;
+            if( pConv->partial_length < wire_size ) goto complete_iov;
+            fct( pConv, 1, pConv->partial_data, wire_size, wire_size,
+                 user_memory, 0, size, &advance );
+            user_memory += size;
+            pConv->partial_length = 0;
+        }
+        length = remaining / wire_size;
+        OCOMS_DATATYPE_SAFEGUARD_POINTER( user_memory, length * size, pConv->pBaseBuf,
+                                          pData, pConv->count );
+        remaining -= length * wire_size;
+        while( 0 != length ) {
+            count = (length > INT32_MAX) ? INT32_MAX : (uint32_t)length;
+            if( OCOMS_LOSSY_PACK == mode ) {
+                fct( pConv, count, user_memory, 0, size,
+                     packed_buffer, count * wire_size, wire_size, &advance );
+            } else {
+                fct( pConv, count, packed_buffer, count * wire_size, wire_size,
+                     user_memory, 0, size, &advance );
+            }
+            user_memory   += count * size;
+            packed_buffer += count * wire_size;
+            length        -= count;
+        }
+        /* keep the beginning of the last element until the next iovec */
+        if( 0 != remaining ) {
+            memcpy( pConv->partial_data, packed_buffer, remaining );
+            pConv->partial_length = (uint32_t)remaining;
+        }
+    complete_iov:
+        if( pConv->flags & CONVERTOR_WITH_CHECKSUM )
+            pConv->fChecksum( pConv, NULL, iov[iov_count].iov_base, iov[iov_count].iov_len );
+    }
+    *out_size = iov_count;
+    *max_data = (pConv->bConverted - initial_bytes_converted);
+    if( pConv->bConverted == pConv->remote_size ) {
+        pConv->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    return 0;
+}
+
+int32_t
+ocoms_pack_lossy_contig( ocoms_convertor_t* pConv,
+                        struct iovec* iov, uint32_t* out_size,
+                        size_t* max_data )
+{
+    return ocoms_convertor_lossy_contig( pConv, iov, out_size, max_data, OCOMS_LOSSY_PACK );
+}
+
+int32_t
+ocoms_unpack_lossy_contig( ocoms_convertor_t* pConv,
+                          struct iovec* iov, uint32_t* out_size,
+                          size_t* max_data )
+{
+    return ocoms_convertor_lossy_contig( pConv, iov, out_size, max_data, OCOMS_LOSSY_UNPACK );
+}
+
+/*
+ * The generic_simple functions converting the float8 and float4 elements.
+ * The contiguous loops are walked element by element, their content might
+ * mix several types.
+ */
+static inline int32_t
+ocoms_convertor_lossy_generic( ocoms_convertor_t* pConvertor,
+                               struct iovec* iov, uint32_t* out_size,
+                               size_t* max_data, const int mode )
+{
+    dt_stack_t* pStack;                /* pointer to the position on the stack */
+    uint32_t pos_desc;                 /* actual position in the description of the derived datatype */
+    uint32_t count_desc;               /* the number of items already done in the actual pos_desc */
+    size_t total_packed = 0;           /* total amount of packed bytes this time */
+    dt_elem_desc_t* description;
+    dt_elem_desc_t* pElem;
+    const ocoms_datatype_t *pData = pConvertor->pDesc;
+    unsigned char *user_memory_base, *packed_buffer;
+    size_t iov_len_local;
+    uint32_t iov_count;
+
+    DO_DEBUG( ocoms_output( 0, "ocoms_convertor_lossy_generic( %p, {%p, %lu}, %u, %d )\n",
+                            (void*)pConvertor, iov[0].iov_base, (unsigned long)iov[0].iov_len,
+                            *out_size, mode ); );
+
+    description = pConvertor->use_desc->desc;
+
+    pStack = pConvertor->pStack + pConvertor->stack_pos;
+    pos_desc          = pStack->index;
+    user_memory_base  = pConvertor->pBaseBuf + pStack->disp;
+    count_desc        = (uint32_t)pStack->count;
+    pStack--;
+    pConvertor->stack_pos--;
+    pElem = &(description[pos_desc]);
+    user_memory_base += pStack->disp;
+
+    for( iov_count = 0; iov_count < (*out_size); iov_count++ ) {
+
+        packed_buffer = (unsigned char *) iov[iov_count].iov_base;
+        iov_len_local = iov[iov_count].iov_len;
+        if( (OCOMS_LOSSY_UNPACK == mode) && (0 != pConvertor->partial_length) ) {
+            size_t element_length = pConvertor->master->remote_sizes[pElem->elem.common.type];
+            size_t missing_length = element_length - pConvertor->partial_length;
+            unsigned char* pending = pConvertor->partial_data;
+            uint32_t one = 1;
+
+            assert( pElem->elem.common.flags & OCOMS_DATATYPE_FLAG_DATA );
+            if( missing_length > iov_len_local ) missing_length = iov_len_local;
+            memcpy( pConvertor->partial_data + pConvertor->partial_length,
+                    packed_buffer, missing_length );
+            pConvertor->partial_length += (uint32_t)missing_length;
+            packed_buffer += missing_length;
+            iov_len_local -= missing_length;
+            if( pConvertor->partial_length < element_length ) goto complete_loop;
+
+            ocoms_lossy_predefined_data( pConvertor, pElem, &one, &pending,
+                                         &user_memory_base, &element_length, mode );
+            pConvertor->partial_length = 0;  /* nothing more inside */
+            --count_desc;
+            if( 0 == count_desc ) {
+                user_memory_base = pConvertor->pBaseBuf + pStack->disp;
+                pos_desc++;  /* advance to the next data */
+                UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+            }
+        }
+        while( 1 ) {
+            while( pElem->elem.common.flags & OCOMS_DATATYPE_FLAG_DATA ) {
+                /* now here we have a basic datatype */
+                ocoms_lossy_predefined_data( pConvertor, pElem, &count_desc, &packed_buffer,
+                                             &user_memory_base, &iov_len_local, mode );
+                if( 0 == count_desc ) {  /* completed */
+                    user_memory_base = pConvertor->pBaseBuf + pStack->disp;
+                    pos_desc++;  /* advance to the next data */
+                    UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+                    continue;
+                }
+                if( (OCOMS_LOSSY_UNPACK == mode) && (0 != iov_len_local) ) {
+                    /* keep the beginning of the element until the next iovec */
+                    assert( iov_len_local < pConvertor->master->remote_sizes[pElem->elem.common.type] );
+                    memcpy( pConvertor->partial_data, packed_buffer, iov_len_local );
+                    pConvertor->partial_length = (uint32_t)iov_len_local;
+                    iov_len_local = 0;
+                }
+                goto complete_loop;
+            }
+            if( OCOMS_DATATYPE_END_LOOP == pElem->elem.common.type ) { /* end of the current loop */
+                if( --(pStack->count) == 0 ) { /* end of loop */
+                    if( pConvertor->stack_pos == 0 ) {
+                        iov[iov_count].iov_len -= iov_len_local;  /* update the amount of valid data */
+                        if( (OCOMS_LOSSY_SKIP != mode) && (pConvertor->flags & CONVERTOR_WITH_CHECKSUM) )
+                            pConvertor->fChecksum( pConvertor, NULL, iov[iov_count].iov_base,
+                                                   iov[iov_count].iov_len );
+                        total_packed += iov[iov_count].iov_len;
+                        iov_count++;  /* go to the next */
+                        goto complete_conversion;
+                    }
+                    pConvertor->stack_pos--;
+                    pStack--;
+                    pos_desc++;
+                } else {
+                    pos_desc = pStack->index + 1;
+                    if( pStack->index == -1 ) {
+                        pStack->disp += (pData->ub - pData->lb);
+                    } else {
+                        assert( OCOMS_DATATYPE_LOOP == description[pStack->index].loop.common.type );
+                        pStack->disp += description[pStack->index].loop.extent;
+                    }
+                }
+                user_memory_base = pConvertor->pBaseBuf + pStack->disp;
+                UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+            }
+            if( OCOMS_DATATYPE_LOOP == pElem->elem.common.type ) {
+                PUSH_STACK( pStack, pConvertor->stack_pos, pos_desc, OCOMS_DATATYPE_LOOP, count_desc,
+                            pStack->disp );
+                pos_desc++;
+                user_memory_base = pConvertor->pBaseBuf + pStack->disp;
+                UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+                DDT_DUMP_STACK( pConvertor->pStack, pConvertor->stack_pos, pElem, "advance loop" );
+                continue;
+            }
+        }
+    complete_loop:
+        iov[iov_count].iov_len -= iov_len_local;  /* update the amount of valid data */
+        if( (OCOMS_LOSSY_SKIP != mode) && (pConvertor->flags & CONVERTOR_WITH_CHECKSUM) )
+            pConvertor->fChecksum( pConvertor, NULL, iov[iov_count].iov_base, iov[iov_count].iov_len );
+        total_packed += iov[iov_count].iov_len;
+    }
+ complete_conversion:
+    *max_data = total_packed;
+    pConvertor->bConverted += total_packed;  /* update the already converted bytes */
+    *out_size = iov_count;
+    if( pConvertor->bConverted == pConvertor->remote_size ) {
+        pConvertor->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    PUSH_STACK( pStack, pConvertor->stack_pos, pos_desc, OCOMS_DATATYPE_UINT1, count_desc,
+                user_memory_base - pStack->disp - pConvertor->pBaseBuf );
+    return 0;
+}
+
+int32_t
+ocoms_generic_simple_pack_lossy( ocoms_convertor_t* pConvertor,
+                                struct iovec* iov, uint32_t* out_size,
+                                size_t* max_data )
+{
+    return ocoms_convertor_lossy_generic( pConvertor, iov, out_size, max_data, OCOMS_LOSSY_PACK );
+}
+
+int32_t
+ocoms_generic_simple_unpack_lossy( ocoms_convertor_t* pConvertor,
+                                  struct iovec* iov, uint32_t* out_size,
+                                  size_t* max_data )
+{
+    return ocoms_convertor_lossy_generic( pConvertor, iov, out_size, max_data, OCOMS_LOSSY_UNPACK );
+}
+
+int32_t ocoms_convertor_lossy_position( ocoms_convertor_t* convertor,
+                                        size_t* position )
+{
+    const ocoms_datatype_t* pData = convertor->pDesc;
+    struct iovec iov;
+    uint32_t iov_count = 1;
+    size_t length, count;
+    int type;
+
+    if( (*position) >= convertor->remote_size ) {
+        convertor->flags |= CONVERTOR_COMPLETED;
+        convertor->bConverted = convertor->remote_size;
+        *position = convertor->bConverted;
+        return OCOMS_SUCCESS;
+    }
+    /* an incomplete element is dropped, the stack is still before it */
+    convertor->bConverted    -= convertor->partial_length;
+    convertor->partial_length = 0;
+
+    if( (ocoms_pack_lossy_contig == convertor->fAdvance) ||
+        (ocoms_unpack_lossy_contig == convertor->fAdvance) ) {
+        for( type = OCOMS_DATATYPE_FIRST_TYPE; !(pData->bdt_used & ((uint32_t)1 << type)); type++ );
+        length = convertor->master->remote_sizes[type];
+        convertor->bConverted = *position - (*position % length);
+    } else {
+        /* from the beginning, jump over the complete datatypes */
+        if( 0 == convertor->bConverted ) {
+            length = convertor->remote_size / convertor->count;
+            count  = *position / length;
+            convertor->pStack[0].count -= count;
+            convertor->pStack[0].disp  += count * (pData->ub - pData->lb);
+            convertor->bConverted       = count * length;
+        }
+        iov.iov_base = NULL;
+        iov.iov_len  = *position - convertor->bConverted;
+        if( 0 != iov.iov_len )
+            ocoms_convertor_lossy_generic( convertor, &iov, &iov_count, &length, OCOMS_LOSSY_SKIP );
+    }
+    *position = convertor->bConverted;
+    return OCOMS_SUCCESS;
+}
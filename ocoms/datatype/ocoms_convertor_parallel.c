@@ -0,0 +1,291 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/threads/threads.h"
+#include "ocoms/datatype/ocoms_convertor_internal.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+#include "ocoms/datatype/ocoms_datatype_prototypes.h"
+
+/*
+ * Parallel pack and unpack.
+ *
+ * A large iovec is cut into segments of ocoms_convertor_parallel_segment_size
+ * bytes. Each segment is converted by a clone of the convertor moved to
+ * the position of the segment, either by the thread that called the
+ * pack (or unpack) or by one of the ocoms_convertor_parallel_threads - 1
+ * helper threads, started the first time they are needed. The calling
+ * thread returns once all the segments of its iovec are done. Nothing is
+ * split before the process enables the threads, as the queue lock and
+ * the conditions do not block until then.
+ *
+ * Only the convertors using a pack plan are split: they can be moved to
+ * any byte in O(log n) and they fill their iovecs to the last byte, so
+ * the segments do not depend on each other.
+ */
+
+int ocoms_convertor_parallel_threads = 1;
+size_t ocoms_convertor_parallel_segment_size = 1024 * 1024;
+
+#if OCOMS_ENABLE_MULTI_THREADS
+
+typedef struct ocoms_convertor_parallel_request_t {
+    struct ocoms_convertor_parallel_request_t* next;
+    const ocoms_convertor_t* convertor;  /**< the convertor to clone */
+    unsigned char* buffer;               /**< the packed data */
+    size_t position;                     /**< position of the packed data in the convertor */
+    size_t length;                       /**< length of the packed data */
+    size_t segments;                     /**< number of segments */
+    size_t next_segment;                 /**< first segment not started */
+    size_t done;                         /**< number of segments completed */
+    int32_t rc;                          /**< OCOMS_SUCCESS or the first error */
+} ocoms_convertor_parallel_request_t;
+
+static struct {
+    ocoms_mutex_t lock;
+    ocoms_condition_t work;     /**< signaled when a request is queued */
+    ocoms_condition_t done;     /**< signaled when a request completes */
+    ocoms_convertor_parallel_request_t* queue;  /**< requests with segments not started */
+    ocoms_thread_t* threads;
+    int nthreads;
+    bool initialized;
+    bool started;
+    bool shutdown;
+} ocoms_convertor_parallel;
+
+int32_t ocoms_convertor_parallel_init( void )
+{
+    OBJ_CONSTRUCT( &ocoms_convertor_parallel.lock, ocoms_mutex_t );
+    OBJ_CONSTRUCT( &ocoms_convertor_parallel.work, ocoms_condition_t );
+    OBJ_CONSTRUCT( &ocoms_convertor_parallel.done, ocoms_condition_t );
+    ocoms_convertor_parallel.queue = NULL;
+    ocoms_convertor_parallel.threads = NULL;
+    ocoms_convertor_parallel.nthreads = 0;
+    ocoms_convertor_parallel.started = false;
+    ocoms_convertor_parallel.shutdown = false;
+    ocoms_convertor_parallel.initialized = true;
+    return OCOMS_SUCCESS;
+}
+
+int32_t ocoms_convertor_parallel_finalize( void )
+{
+    int i;
+
+    if( !ocoms_convertor_parallel.initialized ) return OCOMS_SUCCESS;
+
+    ocoms_mutex_lock( &ocoms_convertor_parallel.lock );
+    ocoms_convertor_parallel.shutdown = true;
+    ocoms_condition_broadcast( &ocoms_convertor_parallel.work );
+    ocoms_mutex_unlock( &ocoms_convertor_parallel.lock );
+
+    for( i = 0; i < ocoms_convertor_parallel.nthreads; i++ ) {
+        ocoms_thread_join( &ocoms_convertor_parallel.threads[i], NULL );
+        OBJ_DESTRUCT( &ocoms_convertor_parallel.threads[i] );
+    }
+    free( ocoms_convertor_parallel.threads );
+    ocoms_convertor_parallel.threads = NULL;
+    ocoms_convertor_parallel.nthreads = 0;
+
+    OBJ_DESTRUCT( &ocoms_convertor_parallel.done );
+    OBJ_DESTRUCT( &ocoms_convertor_parallel.work );
+    OBJ_DESTRUCT( &ocoms_convertor_parallel.lock );
+    ocoms_convertor_parallel.initialized = false;
+    return OCOMS_SUCCESS;
+}
+
+/* Convert one segment of the request, without holding the lock. */
+static int32_t
+ocoms_convertor_parallel_segment( ocoms_convertor_parallel_request_t* request, size_t segment )
+{
+    ocoms_convertor_t clone;
+    struct iovec iov;
+    uint32_t iov_count = 1;
+    size_t offset, length, position;
+    int32_t rc = OCOMS_SUCCESS;
+
+    offset = segment * ocoms_convertor_parallel_segment_size;
+    length = request->length - offset;
+    if( length > ocoms_convertor_parallel_segment_size )
+        length = ocoms_convertor_parallel_segment_size;
+
+    OBJ_CONSTRUCT( &clone, ocoms_convertor_t );
+    ocoms_convertor_clone( request->convertor, &clone, 0 );
+    position = request->position + offset;
+    ocoms_convertor_set_position( &clone, &position );
+
+    iov.iov_base = (IOVBASE_TYPE*)(request->buffer + offset);
+    iov.iov_len  = length;
+    if( (position != (request->position + offset)) ||
+        (0 > clone.fAdvance( &clone, &iov, &iov_count, &position )) ||
+        (position != length) ) {
+        rc = OCOMS_ERROR;
+    }
+    OBJ_DESTRUCT( &clone );
+    return rc;
+}
+
+/* Take the next segment of a request, the lock must be held. The
+ * request leaves the queue with its last segment.
+ */
+static size_t
+ocoms_convertor_parallel_take( ocoms_convertor_parallel_request_t* request )
+{
+    ocoms_convertor_parallel_request_t** prev;
+    size_t segment = request->next_segment++;
+
+    if( request->next_segment == request->segments ) {
+        for( prev = &ocoms_convertor_parallel.queue; *prev != request; prev = &((*prev)->next) );
+        *prev = request->next;
+    }
+    return segment;
+}
+
+static void
+ocoms_convertor_parallel_complete( ocoms_convertor_parallel_request_t* request, int32_t rc )
+{
+    if( (OCOMS_SUCCESS != rc) && (OCOMS_SUCCESS == request->rc) )
+        request->rc = rc;
+    if( ++request->done == request->segments )
+        ocoms_condition_broadcast( &ocoms_convertor_parallel.done );
+}
+
+static void* ocoms_convertor_parallel_worker( ocoms_object_t* object )
+{
+    ocoms_convertor_parallel_request_t* request;
+    size_t segment;
+    int32_t rc;
+
+    ocoms_mutex_lock( &ocoms_convertor_parallel.lock );
+    while( 1 ) {
+        while( (NULL == ocoms_convertor_parallel.queue) && !ocoms_convertor_parallel.shutdown )
+            ocoms_condition_wait( &ocoms_convertor_parallel.work, &ocoms_convertor_parallel.lock );
+        if( ocoms_convertor_parallel.shutdown ) break;
+        request = ocoms_convertor_parallel.queue;
+        segment = ocoms_convertor_parallel_take( request );
+        ocoms_mutex_unlock( &ocoms_convertor_parallel.lock );
+
+        rc = ocoms_convertor_parallel_segment( request, segment );
+
+        ocoms_mutex_lock( &ocoms_convertor_parallel.lock );
+        ocoms_convertor_parallel_complete( request, rc );
+    }
+    ocoms_mutex_unlock( &ocoms_convertor_parallel.lock );
+    return NULL;
+}
+
+/* Start the helper threads, the lock must be held. If some of them
+ * cannot be started the remaining ones (maybe none) share the work.
+ */
+static void ocoms_convertor_parallel_start( void )
+{
+    int i, nthreads = ocoms_convertor_parallel_threads - 1;
+
+    ocoms_convertor_parallel.started = true;
+    ocoms_convertor_parallel.threads = (ocoms_thread_t*)calloc( nthreads, sizeof(ocoms_thread_t) );
+    if( NULL == ocoms_convertor_parallel.threads ) return;
+
+    for( i = 0; i < nthreads; i++ ) {
+        OBJ_CONSTRUCT( &ocoms_convertor_parallel.threads[i], ocoms_thread_t );
+        ocoms_convertor_parallel.threads[i].t_run = ocoms_convertor_parallel_worker;
+        if( OCOMS_SUCCESS != ocoms_thread_start( &ocoms_convertor_parallel.threads[i] ) ) {
+            OBJ_DESTRUCT( &ocoms_convertor_parallel.threads[i] );
+            break;
+        }
+    }
+    ocoms_convertor_parallel.nthreads = i;
+}
+
+static int32_t
+ocoms_convertor_parallel_run( ocoms_convertor_t* pConv, unsigned char* buffer, size_t length )
+{
+    ocoms_convertor_parallel_request_t request;
+    size_t segment;
+    int32_t rc;
+
+    request.next         = NULL;
+    request.convertor    = pConv;
+    request.buffer       = buffer;
+    request.position     = pConv->bConverted;
+    request.length       = length;
+    request.segments     = (length + ocoms_convertor_parallel_segment_size - 1) / ocoms_convertor_parallel_segment_size;
+    request.next_segment = 0;
+    request.done         = 0;
+    request.rc           = OCOMS_SUCCESS;
+
+    ocoms_mutex_lock( &ocoms_convertor_parallel.lock );
+    if( !ocoms_convertor_parallel.started ) {
+        ocoms_convertor_parallel_start();
+    }
+    /* queue it for the helpers and work on it in the meantime */
+    request.next = ocoms_convertor_parallel.queue;
+    ocoms_convertor_parallel.queue = &request;
+    ocoms_condition_broadcast( &ocoms_convertor_parallel.work );
+    while( request.next_segment < request.segments ) {
+        segment = ocoms_convertor_parallel_take( &request );
+        ocoms_mutex_unlock( &ocoms_convertor_parallel.lock );
+
+        rc = ocoms_convertor_parallel_segment( &request, segment );
+
+        ocoms_mutex_lock( &ocoms_convertor_parallel.lock );
+        ocoms_convertor_parallel_complete( &request, rc );
+    }
+    while( request.done < request.segments ) {
+        ocoms_condition_wait( &ocoms_convertor_parallel.done, &ocoms_convertor_parallel.lock );
+    }
+    ocoms_mutex_unlock( &ocoms_convertor_parallel.lock );
+    return request.rc;
+}
+
+int32_t
+ocoms_convertor_parallel_advance( ocoms_convertor_t* pConv,
+                                  struct iovec* iov, uint32_t* out_size,
+                                  size_t* max_data )
+{
+    size_t total = 0, length, converted;
+    uint32_t iov_count, one;
+    int32_t rc;
+
+    for( iov_count = 0; iov_count < (*out_size); iov_count++ ) {
+        length = pConv->local_size - pConv->bConverted;
+        if( 0 == length ) break;
+        if( (size_t)iov[iov_count].iov_len > length )
+            iov[iov_count].iov_len = length;
+        length = iov[iov_count].iov_len;
+        if( OCOMS_CONVERTOR_PARALLEL_SPLIT( length ) ) {
+            rc = ocoms_convertor_parallel_run( pConv, (unsigned char*)iov[iov_count].iov_base, length );
+            if( OCOMS_SUCCESS != rc ) return -1;
+            pConv->bConverted += length;
+        } else {
+            one = 1;
+            if( 0 > pConv->fAdvance( pConv, &iov[iov_count], &one, &converted ) ) return -1;
+            assert( converted == length );
+        }
+        total += length;
+    }
+    *max_data = total;
+    *out_size = iov_count;
+    if( pConv->bConverted == pConv->local_size ) {
+        pConv->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    return 0;
+}
+
+#endif  /* OCOMS_ENABLE_MULTI_THREADS */
@@ -0,0 +1,366 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/util/arch.h"
+#include "ocoms/datatype/ocoms_convertor_internal.h"
+#include "ocoms/datatype/ocoms_convertor_pipeline.h"
+
+/*
+ * The segments leave the ring (the free list, limited to depth items)
+ * when they are packed or taken by the receiver, and come back when they
+ * are released or unpacked, so at most depth segments are in flight.
+ * The convertor is only used by the helper thread, or by the caller of
+ * the progress functions, while the lock protects the list of posted
+ * segments and the condition the helper thread waits on.
+ */
+
+static struct {
+    ocoms_mutex_t lock;
+    ocoms_list_t pipelines;  /**< the polled pipelines */
+    bool initialized;
+} ocoms_convertor_pipeline_polled;
+
+int32_t ocoms_convertor_pipeline_init( void )
+{
+    OBJ_CONSTRUCT( &ocoms_convertor_pipeline_polled.lock, ocoms_mutex_t );
+    OBJ_CONSTRUCT( &ocoms_convertor_pipeline_polled.pipelines, ocoms_list_t );
+    ocoms_convertor_pipeline_polled.initialized = true;
+    return OCOMS_SUCCESS;
+}
+
+int32_t ocoms_convertor_pipeline_finalize( void )
+{
+    if( !ocoms_convertor_pipeline_polled.initialized ) return OCOMS_SUCCESS;
+    OBJ_DESTRUCT( &ocoms_convertor_pipeline_polled.pipelines );
+    OBJ_DESTRUCT( &ocoms_convertor_pipeline_polled.lock );
+    ocoms_convertor_pipeline_polled.initialized = false;
+    return OCOMS_SUCCESS;
+}
+
+static void* ocoms_convertor_pipeline_alloc( void* context, size_t size, size_t align,
+                                             uint32_t flags, void** registration )
+{
+    void* ptr;
+
+    *registration = NULL;
+    if( 0 != posix_memalign( &ptr, align, size ) ) return NULL;
+    return ptr;
+}
+
+static void ocoms_convertor_pipeline_free( void* context, void* addr, void* registration )
+{
+    free( addr );
+}
+
+static void ocoms_convertor_pipeline_segment_construct( ocoms_convertor_pipeline_segment_t* segment )
+{
+    segment->position = 0;
+    segment->length   = 0;
+}
+
+OBJ_CLASS_INSTANCE( ocoms_convertor_pipeline_segment_t, ocoms_free_list_item_t,
+                    ocoms_convertor_pipeline_segment_construct, NULL );
+
+static void ocoms_convertor_pipeline_construct( ocoms_convertor_pipeline_t* pipeline )
+{
+    pipeline->convertor    = NULL;
+    OBJ_CONSTRUCT( &pipeline->segments, ocoms_free_list_t );
+    OBJ_CONSTRUCT( &pipeline->posted, ocoms_list_t );
+    OBJ_CONSTRUCT( &pipeline->lock, ocoms_mutex_t );
+    OBJ_CONSTRUCT( &pipeline->cond, ocoms_condition_t );
+    OBJ_CONSTRUCT( &pipeline->thread, ocoms_thread_t );
+    pipeline->cb_fn        = NULL;
+    pipeline->cb_data      = NULL;
+    pipeline->segment_size = 0;
+    pipeline->depth        = 0;
+    pipeline->posted_bytes = 0;
+    pipeline->outstanding  = 0;
+    pipeline->rc           = OCOMS_SUCCESS;
+    pipeline->flags        = 0;
+    pipeline->started      = false;
+    pipeline->polled       = false;
+    pipeline->shutdown     = false;
+    pipeline->alloc        = ocoms_convertor_pipeline_alloc;
+    pipeline->free         = ocoms_convertor_pipeline_free;
+    pipeline->alloc_handle.allocator_context = NULL;
+    pipeline->alloc_handle.flags = 0;
+}
+
+static void ocoms_convertor_pipeline_destruct( ocoms_convertor_pipeline_t* pipeline )
+{
+    if( pipeline->polled ) {
+        ocoms_mutex_lock( &ocoms_convertor_pipeline_polled.lock );
+        ocoms_list_remove_item( &ocoms_convertor_pipeline_polled.pipelines, &pipeline->super );
+        ocoms_mutex_unlock( &ocoms_convertor_pipeline_polled.lock );
+        pipeline->polled = false;
+    }
+#if OCOMS_ENABLE_MULTI_THREADS
+    if( pipeline->started && (pipeline->flags & OCOMS_CONVERTOR_PIPELINE_THREAD) ) {
+        ocoms_mutex_lock( &pipeline->lock );
+        pipeline->shutdown = true;
+        ocoms_condition_signal( &pipeline->cond );
+        ocoms_mutex_unlock( &pipeline->lock );
+        ocoms_thread_join( &pipeline->thread, NULL );
+    }
+#endif  /* OCOMS_ENABLE_MULTI_THREADS */
+    /* forget the segments posted but not unpacked, the ring releases them */
+    while( NULL != ocoms_list_remove_first( &pipeline->posted ) );
+    OBJ_DESTRUCT( &pipeline->thread );
+    OBJ_DESTRUCT( &pipeline->cond );
+    OBJ_DESTRUCT( &pipeline->lock );
+    OBJ_DESTRUCT( &pipeline->posted );
+    OBJ_DESTRUCT( &pipeline->segments );
+}
+
+OBJ_CLASS_INSTANCE( ocoms_convertor_pipeline_t, ocoms_list_item_t,
+                    ocoms_convertor_pipeline_construct, ocoms_convertor_pipeline_destruct );
+
+static inline void
+ocoms_convertor_pipeline_error( ocoms_convertor_pipeline_t* pipeline, int32_t rc )
+{
+    if( OCOMS_SUCCESS == pipeline->rc ) pipeline->rc = rc;
+}
+
+/* Pack the next segment, if the data is not all packed and there is a free segment. */
+static int ocoms_convertor_pipeline_pack( ocoms_convertor_pipeline_t* pipeline )
+{
+    ocoms_convertor_pipeline_segment_t* segment;
+    ocoms_free_list_item_t* item;
+    struct iovec iov;
+    uint32_t iov_count = 1;
+    size_t max_data = pipeline->segment_size;
+    int rc;
+
+    if( (pipeline->convertor->flags & CONVERTOR_COMPLETED) || (OCOMS_SUCCESS != pipeline->rc) )
+        return 0;
+    OCOMS_FREE_LIST_GET( &pipeline->segments, item, rc );
+    if( NULL == item ) return 0;
+    segment = (ocoms_convertor_pipeline_segment_t*)item;
+
+    segment->position = pipeline->convertor->bConverted;
+    iov.iov_base = (IOVBASE_TYPE*)item->ptr;
+    iov.iov_len  = pipeline->segment_size;
+    rc = ocoms_convertor_pack( pipeline->convertor, &iov, &iov_count, &max_data );
+    if( (0 > rc) || (0 == max_data) ) {
+        /* the segments are too small to hold a single element */
+        ocoms_convertor_pipeline_error( pipeline, (0 > rc) ? OCOMS_ERROR : OCOMS_ERR_BAD_PARAM );
+        OCOMS_FREE_LIST_RETURN( &pipeline->segments, item );
+        return 0;
+    }
+    segment->length = max_data;
+    OCOMS_THREAD_ADD32( &pipeline->outstanding, 1 );
+    pipeline->cb_fn( pipeline, segment, pipeline->cb_data );
+    return 1;
+}
+
+/* Unpack the oldest posted segment and put it back in the ring. */
+static int ocoms_convertor_pipeline_unpack( ocoms_convertor_pipeline_t* pipeline )
+{
+    ocoms_convertor_pipeline_segment_t* segment;
+    struct iovec iov;
+    uint32_t iov_count = 1;
+    size_t max_data;
+    int rc;
+
+    OCOMS_THREAD_LOCK( &pipeline->lock );
+    segment = (ocoms_convertor_pipeline_segment_t*)ocoms_list_remove_first( &pipeline->posted );
+    OCOMS_THREAD_UNLOCK( &pipeline->lock );
+    if( NULL == segment ) return 0;
+
+    if( OCOMS_SUCCESS == pipeline->rc ) {
+        iov.iov_base = (IOVBASE_TYPE*)segment->super.ptr;
+        iov.iov_len  = segment->length;
+        max_data     = segment->length;
+        rc = ocoms_convertor_unpack( pipeline->convertor, &iov, &iov_count, &max_data );
+        if( (0 > rc) || (max_data != segment->length) )
+            ocoms_convertor_pipeline_error( pipeline, OCOMS_ERROR );
+    }
+    pipeline->cb_fn( pipeline, segment, pipeline->cb_data );
+    OCOMS_FREE_LIST_RETURN( &pipeline->segments, &segment->super );
+    OCOMS_THREAD_ADD32( &pipeline->outstanding, -1 );
+    return 1;
+}
+
+static inline int ocoms_convertor_pipeline_step( ocoms_convertor_pipeline_t* pipeline )
+{
+    if( pipeline->convertor->flags & CONVERTOR_SEND )
+        return ocoms_convertor_pipeline_pack( pipeline );
+    return ocoms_convertor_pipeline_unpack( pipeline );
+}
+
+#if OCOMS_ENABLE_MULTI_THREADS
+static void* ocoms_convertor_pipeline_worker( ocoms_object_t* object )
+{
+    ocoms_convertor_pipeline_t* pipeline =
+        (ocoms_convertor_pipeline_t*)((ocoms_thread_t*)object)->t_arg;
+
+    ocoms_mutex_lock( &pipeline->lock );
+    while( !pipeline->shutdown ) {
+        ocoms_mutex_unlock( &pipeline->lock );
+        if( ocoms_convertor_pipeline_step( pipeline ) ) {
+            ocoms_mutex_lock( &pipeline->lock );
+            continue;
+        }
+        ocoms_mutex_lock( &pipeline->lock );
+        /* check again with the lock held, so no signal is missed */
+        if( pipeline->shutdown ) break;
+        if( pipeline->convertor->flags & CONVERTOR_SEND ) {
+            if( (pipeline->convertor->flags & CONVERTOR_COMPLETED) ||
+                (OCOMS_SUCCESS != pipeline->rc) || (pipeline->outstanding >= (int32_t)pipeline->depth) ) {
+                ocoms_condition_wait( &pipeline->cond, &pipeline->lock );
+            }
+        } else if( ocoms_list_is_empty( &pipeline->posted ) ) {
+            ocoms_condition_wait( &pipeline->cond, &pipeline->lock );
+        }
+    }
+    ocoms_mutex_unlock( &pipeline->lock );
+    return NULL;
+}
+#endif  /* OCOMS_ENABLE_MULTI_THREADS */
+
+int32_t
+ocoms_convertor_pipeline_start( ocoms_convertor_pipeline_t* pipeline,
+                                ocoms_convertor_t* convertor,
+                                size_t segment_size, uint32_t depth, uint32_t flags,
+                                ocoms_convertor_pipeline_cb_fn_t cb_fn, void* cb_data )
+{
+    int32_t rc;
+
+    if( pipeline->started || (NULL == cb_fn) || (0 == segment_size) || (0 == depth) ||
+        !(convertor->flags & (CONVERTOR_SEND | CONVERTOR_RECV)) )
+        return OCOMS_ERR_BAD_PARAM;
+    /* the helper thread needs blocking conditions and real locks, which
+     * the caller has to ask for with ocoms_set_using_threads */
+    if( (flags & OCOMS_CONVERTOR_PIPELINE_THREAD) &&
+        (!OCOMS_ENABLE_MULTI_THREADS || !ocoms_using_threads()) )
+        return OCOMS_ERR_NOT_SUPPORTED;
+
+    rc = ocoms_free_list_init_ex_new( &pipeline->segments,
+                                      sizeof(ocoms_convertor_pipeline_segment_t), ocoms_cache_line_size,
+                                      OBJ_CLASS(ocoms_convertor_pipeline_segment_t),
+                                      segment_size, ocoms_cache_line_size,
+                                      depth, depth, depth, NULL, NULL,
+                                      pipeline->alloc, pipeline->free, pipeline->alloc_handle,
+                                      NULL );
+    if( OCOMS_SUCCESS != rc ) return rc;
+
+    pipeline->convertor    = convertor;
+    pipeline->segment_size = segment_size;
+    pipeline->depth        = depth;
+    pipeline->posted_bytes = convertor->bConverted;
+    pipeline->cb_fn        = cb_fn;
+    pipeline->cb_data      = cb_data;
+    pipeline->flags        = flags;
+    pipeline->started      = true;
+
+#if OCOMS_ENABLE_MULTI_THREADS
+    if( flags & OCOMS_CONVERTOR_PIPELINE_THREAD ) {
+        pipeline->thread.t_run = ocoms_convertor_pipeline_worker;
+        pipeline->thread.t_arg = pipeline;
+        rc = ocoms_thread_start( &pipeline->thread );
+        if( OCOMS_SUCCESS != rc ) pipeline->started = false;
+        return rc;
+    }
+#endif  /* OCOMS_ENABLE_MULTI_THREADS */
+    ocoms_mutex_lock( &ocoms_convertor_pipeline_polled.lock );
+    ocoms_list_append( &ocoms_convertor_pipeline_polled.pipelines, &pipeline->super );
+    ocoms_mutex_unlock( &ocoms_convertor_pipeline_polled.lock );
+    pipeline->polled = true;
+    return OCOMS_SUCCESS;
+}
+
+/* Wake up the helper thread, if any. */
+static inline void ocoms_convertor_pipeline_signal( ocoms_convertor_pipeline_t* pipeline )
+{
+    if( pipeline->flags & OCOMS_CONVERTOR_PIPELINE_THREAD ) {
+        ocoms_mutex_lock( &pipeline->lock );
+        ocoms_condition_signal( &pipeline->cond );
+        ocoms_mutex_unlock( &pipeline->lock );
+    }
+}
+
+int32_t
+ocoms_convertor_pipeline_release( ocoms_convertor_pipeline_t* pipeline,
+                                  ocoms_convertor_pipeline_segment_t* segment )
+{
+    assert( pipeline->convertor->flags & CONVERTOR_SEND );
+    OCOMS_FREE_LIST_RETURN( &pipeline->segments, &segment->super );
+    OCOMS_THREAD_ADD32( &pipeline->outstanding, -1 );
+    ocoms_convertor_pipeline_signal( pipeline );
+    return OCOMS_SUCCESS;
+}
+
+int32_t
+ocoms_convertor_pipeline_get( ocoms_convertor_pipeline_t* pipeline,
+                              ocoms_convertor_pipeline_segment_t** segment )
+{
+    ocoms_free_list_item_t* item;
+    int rc;
+
+    assert( pipeline->convertor->flags & CONVERTOR_RECV );
+    OCOMS_FREE_LIST_GET( &pipeline->segments, item, rc );
+    if( OCOMS_SUCCESS != rc ) return rc;
+    OCOMS_THREAD_ADD32( &pipeline->outstanding, 1 );
+    *segment = (ocoms_convertor_pipeline_segment_t*)item;
+    return OCOMS_SUCCESS;
+}
+
+int32_t
+ocoms_convertor_pipeline_post( ocoms_convertor_pipeline_t* pipeline,
+                               ocoms_convertor_pipeline_segment_t* segment,
+                               size_t length )
+{
+    assert( pipeline->convertor->flags & CONVERTOR_RECV );
+    if( length > pipeline->segment_size ) return OCOMS_ERR_BAD_PARAM;
+
+    OCOMS_THREAD_LOCK( &pipeline->lock );
+    segment->position = pipeline->posted_bytes;
+    segment->length   = length;
+    pipeline->posted_bytes += length;
+    ocoms_list_append( &pipeline->posted, &segment->super.super );
+    if( pipeline->flags & OCOMS_CONVERTOR_PIPELINE_THREAD )
+        ocoms_condition_signal( &pipeline->cond );
+    OCOMS_THREAD_UNLOCK( &pipeline->lock );
+    return OCOMS_SUCCESS;
+}
+
+int ocoms_convertor_pipeline_progress_one( ocoms_convertor_pipeline_t* pipeline )
+{
+    if( !pipeline->polled ) return 0;
+    return ocoms_convertor_pipeline_step( pipeline );
+}
+
+int ocoms_convertor_pipeline_progress( void )
+{
+    ocoms_list_item_t* item;
+    int count = 0;
+
+    if( ocoms_list_is_empty( &ocoms_convertor_pipeline_polled.pipelines ) ) return 0;
+
+    OCOMS_THREAD_LOCK( &ocoms_convertor_pipeline_polled.lock );
+    for( item = ocoms_list_get_first( &ocoms_convertor_pipeline_polled.pipelines );
+         item != ocoms_list_get_end( &ocoms_convertor_pipeline_polled.pipelines );
+         item = ocoms_list_get_next( item ) ) {
+        count += ocoms_convertor_pipeline_step( (ocoms_convertor_pipeline_t*)item );
+    }
+    OCOMS_THREAD_UNLOCK( &ocoms_convertor_pipeline_polled.lock );
+    return count;
+}
@@ -0,0 +1,163 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef OCOMS_CONVERTOR_PIPELINE_H_HAS_BEEN_INCLUDED
+#define OCOMS_CONVERTOR_PIPELINE_H_HAS_BEEN_INCLUDED
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include "ocoms/datatype/ocoms_convertor.h"
+#include "ocoms/threads/threads.h"
+#include "ocoms/util/ocoms_free_list.h"
+#include "ocoms/util/ocoms_list.h"
+
+BEGIN_C_DECLS
+
+/*
+ * Pipelined pack and unpack.
+ *
+ * A pipeline drives a convertor across a ring of depth staging segments
+ * of segment_size bytes each, taken from a free list, so the packing of
+ * a segment can overlap with the transfer of the previous ones.
+ *
+ * For a send convertor the pipeline packs the data into the free
+ * segments and calls the callback with each filled one, in order. The
+ * segment belongs to the caller until it gives it back with
+ * ocoms_convertor_pipeline_release, once it has been transmitted.
+ *
+ * For a receive convertor the caller takes a free segment with
+ * ocoms_convertor_pipeline_get, copies the packed data into it and
+ * posts it, in the order of the packed data. The pipeline unpacks the
+ * posted segments in the same order and calls the callback with each
+ * of them before putting it back in the ring.
+ *
+ * With OCOMS_CONVERTOR_PIPELINE_THREAD a helper thread packs or unpacks
+ * the segments, and calls the callbacks. This requires the process to
+ * have enabled the threads (ocoms_set_using_threads) beforehand, the
+ * start fails with OCOMS_ERR_NOT_SUPPORTED otherwise. Otherwise the work is done by
+ * ocoms_convertor_pipeline_progress, an ocoms_progress_fn_t that moves
+ * all the polled pipelines one segment forward, or by
+ * ocoms_convertor_pipeline_progress_one for a single pipeline. A pipeline
+ * cannot be released from its own callback.
+ */
+
+#define OCOMS_CONVERTOR_PIPELINE_THREAD  0x0001  /* use a helper thread */
+
+struct ocoms_convertor_pipeline_t;
+
+struct ocoms_convertor_pipeline_segment_t {
+    ocoms_free_list_item_t super;  /**< super.ptr is the staging buffer */
+    size_t position;               /**< position of the packed data in the convertor */
+    size_t length;                 /**< packed bytes in the segment */
+};
+typedef struct ocoms_convertor_pipeline_segment_t ocoms_convertor_pipeline_segment_t;
+OCOMS_DECLSPEC OBJ_CLASS_DECLARATION( ocoms_convertor_pipeline_segment_t );
+
+/* Called with each packed (send) or unpacked (receive) segment */
+typedef void (*ocoms_convertor_pipeline_cb_fn_t)( struct ocoms_convertor_pipeline_t* pipeline,
+                                                   ocoms_convertor_pipeline_segment_t* segment,
+                                                   void* cb_data );
+
+struct ocoms_convertor_pipeline_t {
+    ocoms_list_item_t                super;         /**< in the list of the polled pipelines */
+    ocoms_convertor_t*               convertor;     /**< the prepared convertor to drive */
+    ocoms_free_list_t                segments;      /**< the ring of staging segments */
+    ocoms_list_t                     posted;        /**< receive: the segments to unpack, in order */
+    ocoms_mutex_t                    lock;
+    ocoms_condition_t                cond;          /**< signaled when the helper has work */
+    ocoms_thread_t                   thread;        /**< the helper thread, if any */
+    ocoms_convertor_pipeline_cb_fn_t cb_fn;
+    void*                            cb_data;
+    size_t                           segment_size;
+    uint32_t                         depth;         /**< number of segments in the ring */
+    size_t                           posted_bytes;  /**< receive: packed bytes already posted */
+    volatile int32_t                 outstanding;   /**< segments out of the ring */
+    volatile int32_t                 rc;            /**< OCOMS_SUCCESS or the first error */
+    uint32_t                         flags;         /**< OCOMS_CONVERTOR_PIPELINE_* */
+    bool                             started;
+    bool                             polled;        /**< in the list of the polled pipelines */
+    volatile bool                    shutdown;
+    /* allocator of the staging buffers, malloc by default. They may be
+     * changed between the construction and ocoms_convertor_pipeline_start,
+     * for instance to use registered memory. */
+    ocoms_free_list_alloc_fn_t       alloc;
+    ocoms_free_list_free_fn_t        free;
+    allocator_handle_t               alloc_handle;
+};
+typedef struct ocoms_convertor_pipeline_t ocoms_convertor_pipeline_t;
+OCOMS_DECLSPEC OBJ_CLASS_DECLARATION( ocoms_convertor_pipeline_t );
+
+/*
+ * Start driving a prepared convertor, positioned where the pipeline
+ * should begin. The convertor should not be used by anyone else until
+ * the pipeline completes, and the pipeline is released (OBJ_RELEASE or
+ * OBJ_DESTRUCT) once it is complete or to abort it.
+ */
+OCOMS_DECLSPEC int32_t
+ocoms_convertor_pipeline_start( ocoms_convertor_pipeline_t* pipeline,
+                                ocoms_convertor_t* convertor,
+                                size_t segment_size, uint32_t depth, uint32_t flags,
+                                ocoms_convertor_pipeline_cb_fn_t cb_fn, void* cb_data );
+
+/*
+ * Give back a segment delivered to the callback of a send pipeline.
+ */
+OCOMS_DECLSPEC int32_t
+ocoms_convertor_pipeline_release( ocoms_convertor_pipeline_t* pipeline,
+                                  ocoms_convertor_pipeline_segment_t* segment );
+
+/*
+ * Take a free segment of a receive pipeline, OCOMS_ERR_TEMP_OUT_OF_RESOURCE
+ * if all of them are in use.
+ */
+OCOMS_DECLSPEC int32_t
+ocoms_convertor_pipeline_get( ocoms_convertor_pipeline_t* pipeline,
+                              ocoms_convertor_pipeline_segment_t** segment );
+
+/*
+ * Queue length bytes of packed data, stored in a segment taken with
+ * ocoms_convertor_pipeline_get, to be unpacked after the previous ones.
+ */
+OCOMS_DECLSPEC int32_t
+ocoms_convertor_pipeline_post( ocoms_convertor_pipeline_t* pipeline,
+                               ocoms_convertor_pipeline_segment_t* segment,
+                               size_t length );
+
+/*
+ * Move a polled pipeline one segment forward. Returns the number of
+ * segments packed or unpacked (0 or 1).
+ */
+OCOMS_DECLSPEC int ocoms_convertor_pipeline_progress_one( ocoms_convertor_pipeline_t* pipeline );
+
+/*
+ * Move all the polled pipelines one segment forward, to be registered
+ * with the progress engine. Returns the number of segments packed or
+ * unpacked.
+ */
+OCOMS_DECLSPEC int ocoms_convertor_pipeline_progress( void );
+
+/*
+ * A pipeline is complete when all the data has been converted and, for
+ * a send pipeline, all the segments have been released.
+ */
+static inline bool
+ocoms_convertor_pipeline_is_complete( const ocoms_convertor_pipeline_t* pipeline )
+{
+    return (0 != (pipeline->convertor->flags & CONVERTOR_COMPLETED)) &&
+           (0 == pipeline->outstanding);
+}
+
+END_C_DECLS
+
+#endif  /* OCOMS_CONVERTOR_PIPELINE_H_HAS_BEEN_INCLUDED */
@@ -29,15 +29,36 @@ extern int ocoms_pack_debug;
 #define DO_DEBUG(INST)
 #endif  /* OCOMS_ENABLE_DEBUG */
 
+/*
+ * Append a piece of memory to the iovecs. When coalescing, a piece
+ * following the last iovec extends it. Return false if there is no
+ * iovec left for the piece.
+ */
+static inline bool
+ocoms_convertor_raw_append( struct iovec* iov, uint32_t* index, uint32_t iov_count,
+                            unsigned char* base, size_t blength, bool coalesce )
+{
+    if( coalesce && (0 != *index) &&
+        (((unsigned char*)iov[*index - 1].iov_base + iov[*index - 1].iov_len) == base) ) {
+        iov[*index - 1].iov_len += blength;
+        return true;
+    }
+    if( *index == iov_count ) return false;
+    iov[*index].iov_base = (IOVBASE_TYPE *) base;
+    iov[*index].iov_len  = blength;
+    (*index)++;
+    return true;
+}
+
 /**
  * This function always work in local representation. This means no representation
  * conversion (i.e. no heterogeneity) has to be taken into account, and that all
  * length we're working on are local.
  */
-int32_t
-ocoms_convertor_raw( ocoms_convertor_t* pConvertor, 
-		    struct iovec* iov, uint32_t* iov_count,
-		    size_t* length )
+static inline int32_t
+ocoms_convertor_raw_generic( ocoms_convertor_t* pConvertor,
+                             struct iovec* iov, uint32_t* iov_count,
+                             size_t* length, bool coalesce )
 {
     const ocoms_datatype_t *pData = pConvertor->pDesc;
     dt_stack_t* pStack;       /* pointer to the position on the stack */
@@ -46,7 +67,7 @@ ocoms_convertor_raw( ocoms_convertor_t* pConvertor,
     dt_elem_desc_t* description, *pElem;
     unsigned char *source_base;  /* origin of the data */
     size_t raw_data = 0;      /* sum of raw data lengths in the iov_len fields */
-    uint32_t index = 0, i;    /* the iov index and a simple counter */
+    uint32_t index = 0;       /* the iov index */
 
     assert( (*iov_count) > 0 );
     if( OCOMS_LIKELY(pConvertor->flags & CONVERTOR_COMPLETED) ) {
@@ -96,29 +117,27 @@ ocoms_convertor_raw( ocoms_convertor_t* pConvertor,
             size_t blength = ocoms_datatype_basicDatatypes[pElem->elem.common.type]->size;
             source_base += pElem->elem.disp;
             if( blength == (size_t)pElem->elem.extent ) { /* no resized data */
-                if( index < *iov_count ) {
-                    blength *= count_desc;
-                    /* now here we have a basic datatype */
-                    OCOMS_DATATYPE_SAFEGUARD_POINTER( source_base, blength, pConvertor->pBaseBuf,
-                                                pConvertor->pDesc, pConvertor->count );
-                    DO_DEBUG( ocoms_output( 0, "raw 1. iov[%d] = {base %p, length %lu}\n",
-                                           index, source_base, (unsigned long)blength ); );
-                    iov[index].iov_base = (IOVBASE_TYPE *) source_base;
-                    iov[index].iov_len  = blength;
+                blength *= count_desc;
+                /* now here we have a basic datatype */
+                OCOMS_DATATYPE_SAFEGUARD_POINTER( source_base, blength, pConvertor->pBaseBuf,
+                                            pConvertor->pDesc, pConvertor->count );
+                DO_DEBUG( ocoms_output( 0, "raw 1. iov[%d] = {base %p, length %lu}\n",
+                                       index, source_base, (unsigned long)blength ); );
+                if( ocoms_convertor_raw_append( iov, &index, *iov_count, source_base,
+                                                blength, coalesce ) ) {
                     source_base += blength;
                     raw_data += blength;
-                    index++;
                     count_desc = 0;
                 }
             } else {
-                for( i = count_desc; (i > 0) && (index < *iov_count); i--, index++ ) {
+                while( count_desc > 0 ) {
                     OCOMS_DATATYPE_SAFEGUARD_POINTER( source_base, blength, pConvertor->pBaseBuf,
                                                 pConvertor->pDesc, pConvertor->count );
                     DO_DEBUG( ocoms_output( 0, "raw 2. iov[%d] = {base %p, length %lu}\n",
                                            index, source_base, (unsigned long)blength ); );
-                    iov[index].iov_base = (IOVBASE_TYPE *) source_base;
-                    iov[index].iov_len  = blength;
-                    source_base += blength;
+                    if( !ocoms_convertor_raw_append( iov, &index, *iov_count, source_base,
+                                                     blength, coalesce ) ) break;
+                    source_base += pElem->elem.extent;
                     raw_data += blength;
                     count_desc--;
                 }
@@ -169,13 +188,12 @@ ocoms_convertor_raw( ocoms_convertor_t* pConvertor,
             ddt_endloop_desc_t* end_loop = (ddt_endloop_desc_t*)(pElem + pElem->loop.items);
 
             if( pElem->loop.common.flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS ) {
-                uint32_t i;
                 source_base += end_loop->first_elem_disp;
-                for( i = count_desc; (i > 0) && (index < *iov_count); i--, index++ ) {
+                while( count_desc > 0 ) {
                     OCOMS_DATATYPE_SAFEGUARD_POINTER( source_base, end_loop->size, pConvertor->pBaseBuf,
                                                 pConvertor->pDesc, pConvertor->count );
-                    iov[index].iov_base = (IOVBASE_TYPE *) source_base;
-                    iov[index].iov_len  = end_loop->size;
+                    if( !ocoms_convertor_raw_append( iov, &index, *iov_count, source_base,
+                                                     end_loop->size, coalesce ) ) break;
                     source_base += pElem->loop.extent;
                     raw_data += end_loop->size;
                     count_desc--;
@@ -212,3 +230,26 @@ complete_loop:
                            pConvertor->stack_pos, pStack->index, (int)pStack->count, (long)pStack->disp ); );
     return 0;
 }
+
+int32_t
+ocoms_convertor_raw( ocoms_convertor_t* pConvertor,
+                     struct iovec* iov, uint32_t* iov_count,
+                     size_t* length )
+{
+    return ocoms_convertor_raw_generic( pConvertor, iov, iov_count, length, false );
+}
+
+int32_t
+ocoms_convertor_raw_coalesced( ocoms_convertor_t* pConvertor,
+                               struct iovec* iov, uint32_t* iov_count,
+                               size_t* length, size_t min_segment, bool* small )
+{
+    int32_t rc = ocoms_convertor_raw_generic( pConvertor, iov, iov_count, length, true );
+    uint32_t i;
+
+    if( NULL != small ) {
+        for( i = 0; i < *iov_count; i++ )
+            small[i] = ((size_t)iov[i].iov_len < min_segment);
+    }
+    return rc;
+}
@@ -0,0 +1,329 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "ocoms/datatype/ocoms_convertor_internal.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+#include "ocoms/datatype/ocoms_datatype_prototypes.h"
+#include "ocoms/datatype/ocoms_datatype_reduce.h"
+
+#if OCOMS_ENABLE_DEBUG
+#include "ocoms/util/output.h"
+
+extern bool ocoms_unpack_debug;
+#define DO_DEBUG(INST)  if( ocoms_unpack_debug ) { INST }
+#else
+#define DO_DEBUG(INST)
+#endif  /* OCOMS_ENABLE_DEBUG */
+
+/*
+ * The unpack functions of the convertors with CONVERTOR_WITH_REDUCE. They
+ * work on the full description of the datatype, as the kernels need the
+ * real type of every element, and keep the bytes of an incomplete element
+ * in the convertor until the rest of it is received.
+ */
+
+#define OCOMS_REDUCE_BOUNCE_LENGTH  512
+
+/*
+ * Reduce count packed elements of size bytes into the user memory, where
+ * they are extent bytes apart. The kernels work on aligned arrays, the
+ * misaligned packed data goes through a local buffer.
+ */
+static inline void
+ocoms_unpack_reduce_elements( ocoms_datatype_reduce_fct_t fct, size_t size,
+                              const unsigned char* packed, unsigned char* user,
+                              OCOMS_PTRDIFF_TYPE extent, size_t count )
+{
+    union {
+        long double   align;
+        unsigned char data[OCOMS_REDUCE_BOUNCE_LENGTH];
+    } bounce;
+    size_t alignment = size & (~size + 1), length, i;
+
+    if( alignment > sizeof(long double) ) alignment = sizeof(long double);
+    while( 0 != count ) {
+        const unsigned char* in = packed;
+
+        length = count;
+        if( 0 != ((uintptr_t)packed & (alignment - 1)) ) {
+            if( (length * size) > OCOMS_REDUCE_BOUNCE_LENGTH )
+                length = OCOMS_REDUCE_BOUNCE_LENGTH / size;
+            memcpy( bounce.data, packed, length * size );
+            in = bounce.data;
+        }
+        if( (OCOMS_PTRDIFF_TYPE)size == extent ) {
+            fct( in, user, length );
+            user += length * size;
+        } else {
+            for( i = 0; i < length; i++ ) {
+                fct( in, user, 1 );
+                in   += size;
+                user += extent;
+            }
+        }
+        packed += length * size;
+        count  -= length;
+    }
+}
+
+/*
+ * Like unpack_predefined_data, reduce as many elements of the description
+ * as there is space for.
+ */
+static inline void
+ocoms_unpack_reduce_predefined_data( ocoms_convertor_t* pConvertor,
+                                     dt_elem_desc_t* pElem,
+                                     uint32_t* count_desc,
+                                     unsigned char** packed_buffer,
+                                     unsigned char** user_memory,
+                                     size_t* space )
+{
+    ddt_elem_desc_t* elem = &(pElem->elem);
+    size_t size = ocoms_datatype_basicDatatypes[elem->common.type]->size;
+    size_t count = *count_desc;
+
+    if( (count * size) > *space ) {
+        count = *space / size;
+        if( 0 == count ) return;  /* nothing to do */
+    }
+    OCOMS_DATATYPE_SAFEGUARD_POINTER( *user_memory + elem->disp + (count - 1) * elem->extent, size,
+                                      pConvertor->pBaseBuf, pConvertor->pDesc, pConvertor->count );
+    DO_DEBUG( ocoms_output( 0, "unpack reduce %lu elements of type %d from %p to %p\n",
+                            (unsigned long)count, (int)elem->common.type,
+                            (void*)*packed_buffer, (void*)(*user_memory + elem->disp) ); );
+    ocoms_unpack_reduce_elements( ocoms_datatype_reduce_functions[pConvertor->reduce_op][elem->common.type],
+                                  size, *packed_buffer, *user_memory + elem->disp,
+                                  elem->extent, count );
+    *packed_buffer += count * size;
+    *user_memory   += count * elem->extent;
+    *space         -= count * size;
+    *count_desc    -= (uint32_t)count;
+}
+
+/*
+ * The datatype is an array of a single predefined type without gaps, the
+ * position in the user memory follows from bConverted.
+ */
+int32_t
+ocoms_unpack_reduce_contig( ocoms_convertor_t* pConv,
+                           struct iovec* iov, uint32_t* out_size,
+                           size_t* max_data )
+{
+    const ocoms_datatype_t *pData = pConv->pDesc;
+    unsigned char *user_memory, *packed_buffer;
+    uint32_t iov_count;
+    size_t remaining, length, size, initial_bytes_converted = pConv->bConverted;
+    OCOMS_PTRDIFF_TYPE initial_displ = pConv->use_desc->desc[pConv->use_desc->used].end_loop.first_elem_disp;
+    ocoms_datatype_reduce_fct_t fct;
+    int type;
+
+    for( type = OCOMS_DATATYPE_FIRST_TYPE; !(pData->bdt_used & ((uint32_t)1 << type)); type++ );
+    size = ocoms_datatype_basicDatatypes[type]->size;
+    fct  = ocoms_datatype_reduce_functions[pConv->reduce_op][type];
+
+    DO_DEBUG( ocoms_output( 0, "unpack_reduce_contig( pBaseBuf %p, iov_count %d )\n",
+                            pConv->pBaseBuf, *out_size ); );
+    for( iov_count = 0; iov_count < (*out_size); iov_count++ ) {
+        packed_buffer = (unsigned char*)iov[iov_count].iov_base;
+        remaining = pConv->local_size - pConv->bConverted;
+        if( remaining > iov[iov_count].iov_len )
+            remaining = iov[iov_count].iov_len;
+        iov[iov_count].iov_len = remaining;
+        if( pConv->flags & CONVERTOR_WITH_CHECKSUM )
+            pConv->fChecksum( pConv, NULL, packed_buffer, remaining );
+        user_memory = pConv->pBaseBuf + initial_displ + (pConv->bConverted - pConv->partial_length);
+        pConv->bConverted += remaining;
+
+        /* complete the element left over by the previous iovec */
+        if( 0 != pConv->partial_length ) {
+            length = size - pConv->partial_length;
+            if( length > remaining ) length = remaining;
+            memcpy( pConv->partial_data + pConv->partial_length, packed_buffer, length );
+            pConv->partial_length += (uint32_t)length;
+            packed_buffer += length;
+            remaining     -= length;
+            if( pConv->partial_length < size ) continue;
+            ocoms_unpack_reduce_elements( fct, size, pConv->partial_data, user_memory,
+                                          (OCOMS_PTRDIFF_TYPE)size, 1 );
+            user_memory += size;
+            pConv->partial_length = 0;
+        }
+        length = remaining / size;
+        if( 0 != length ) {
+            OCOMS_DATATYPE_SAFEGUARD_POINTER( user_memory, length * size, pConv->pBaseBuf,
+                                              pData, pConv->count );
+            ocoms_unpack_reduce_elements( fct, size, packed_buffer, user_memory,
+                                          (OCOMS_PTRDIFF_TYPE)size, length );
+            packed_buffer += length * size;
+            remaining     -= length * size;
+        }
+        /* keep the beginning of the last element until the next iovec */
+        if( 0 != remaining ) {
+            memcpy( pConv->partial_data, packed_buffer, remaining );
+            pConv->partial_length = (uint32_t)remaining;
+        }
+    }
+    *out_size = iov_count;
+    *max_data = (pConv->bConverted - initial_bytes_converted);
+    if( pConv->bConverted == pConv->local_size ) {
+        pConv->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * ocoms_generic_simple_unpack reducing every predefined element into the
+ * user memory. The contiguous loops are walked element by element, their
+ * content might mix several types.
+ */
+int32_t
+ocoms_generic_simple_unpack_reduce( ocoms_convertor_t* pConvertor,
+                                   struct iovec* iov, uint32_t* out_size,
+                                   size_t* max_data )
+{
+    dt_stack_t* pStack;                /* pointer to the position on the stack */
+    uint32_t pos_desc;                 /* actual position in the description of the derived datatype */
+    uint32_t count_desc;               /* the number of items already done in the actual pos_desc */
+    size_t total_unpacked = 0;         /* total size unpacked this time */
+    dt_elem_desc_t* description;
+    dt_elem_desc_t* pElem;
+    const ocoms_datatype_t *pData = pConvertor->pDesc;
+    unsigned char *user_memory_base, *packed_buffer;
+    size_t iov_len_local;
+    uint32_t iov_count;
+
+    DO_DEBUG( ocoms_output( 0, "ocoms_convertor_generic_simple_unpack_reduce( %p, {%p, %lu}, %u )\n",
+                            (void*)pConvertor, iov[0].iov_base, (unsigned long)iov[0].iov_len, *out_size ); );
+
+    description = pConvertor->use_desc->desc;
+
+    pStack = pConvertor->pStack + pConvertor->stack_pos;
+    pos_desc          = pStack->index;
+    user_memory_base  = pConvertor->pBaseBuf + pStack->disp;
+    count_desc        = (uint32_t)pStack->count;
+    pStack--;
+    pConvertor->stack_pos--;
+    pElem = &(description[pos_desc]);
+    user_memory_base += pStack->disp;
+
+    for( iov_count = 0; iov_count < (*out_size); iov_count++ ) {
+
+        packed_buffer = (unsigned char *) iov[iov_count].iov_base;
+        iov_len_local = iov[iov_count].iov_len;
+        if( 0 != pConvertor->partial_length ) {
+            size_t element_length = ocoms_datatype_basicDatatypes[pElem->elem.common.type]->size;
+            size_t missing_length = element_length - pConvertor->partial_length;
+
+            assert( pElem->elem.common.flags & OCOMS_DATATYPE_FLAG_DATA );
+            if( missing_length > iov_len_local ) missing_length = iov_len_local;
+            memcpy( pConvertor->partial_data + pConvertor->partial_length,
+                    packed_buffer, missing_length );
+            pConvertor->partial_length += (uint32_t)missing_length;
+            packed_buffer += missing_length;
+            iov_len_local -= missing_length;
+            if( pConvertor->partial_length < element_length ) goto complete_loop;
+
+            ocoms_unpack_reduce_elements( ocoms_datatype_reduce_functions[pConvertor->reduce_op][pElem->elem.common.type],
+                                          element_length, pConvertor->partial_data,
+                                          user_memory_base + pElem->elem.disp,
+                                          pElem->elem.extent, 1 );
+            user_memory_base += pElem->elem.extent;
+            pConvertor->partial_length = 0;  /* nothing more inside */
+            --count_desc;
+            if( 0 == count_desc ) {
+                user_memory_base = pConvertor->pBaseBuf + pStack->disp;
+                pos_desc++;  /* advance to the next data */
+                UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+            }
+        }
+        while( 1 ) {
+            while( pElem->elem.common.flags & OCOMS_DATATYPE_FLAG_DATA ) {
+                /* now here we have a basic datatype */
+                ocoms_unpack_reduce_predefined_data( pConvertor, pElem, &count_desc,
+                                                     &packed_buffer, &user_memory_base, &iov_len_local );
+                if( 0 == count_desc ) {  /* completed */
+                    user_memory_base = pConvertor->pBaseBuf + pStack->disp;
+                    pos_desc++;  /* advance to the next data */
+                    UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+                    continue;
+                }
+                if( 0 != iov_len_local ) {
+                    /* keep the beginning of the element until the next iovec */
+                    assert( iov_len_local < ocoms_datatype_basicDatatypes[pElem->elem.common.type]->size );
+                    memcpy( pConvertor->partial_data, packed_buffer, iov_len_local );
+                    pConvertor->partial_length = (uint32_t)iov_len_local;
+                    iov_len_local = 0;
+                }
+                goto complete_loop;
+            }
+            if( OCOMS_DATATYPE_END_LOOP == pElem->elem.common.type ) { /* end of the current loop */
+                if( --(pStack->count) == 0 ) { /* end of loop */
+                    if( pConvertor->stack_pos == 0 ) {
+                        iov[iov_count].iov_len -= iov_len_local;  /* update the amount of valid data */
+                        if( pConvertor->flags & CONVERTOR_WITH_CHECKSUM )
+                            pConvertor->fChecksum( pConvertor, NULL, iov[iov_count].iov_base,
+                                                   iov[iov_count].iov_len );
+                        total_unpacked += iov[iov_count].iov_len;
+                        iov_count++;  /* go to the next */
+                        goto complete_conversion;
+                    }
+                    pConvertor->stack_pos--;
+                    pStack--;
+                    pos_desc++;
+                } else {
+                    pos_desc = pStack->index + 1;
+                    if( pStack->index == -1 ) {
+                        pStack->disp += (pData->ub - pData->lb);
+                    } else {
+                        assert( OCOMS_DATATYPE_LOOP == description[pStack->index].loop.common.type );
+                        pStack->disp += description[pStack->index].loop.extent;
+                    }
+                }
+                user_memory_base = pConvertor->pBaseBuf + pStack->disp;
+                UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+            }
+            if( OCOMS_DATATYPE_LOOP == pElem->elem.common.type ) {
+                PUSH_STACK( pStack, pConvertor->stack_pos, pos_desc, OCOMS_DATATYPE_LOOP, count_desc,
+                            pStack->disp );
+                pos_desc++;
+                user_memory_base = pConvertor->pBaseBuf + pStack->disp;
+                UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+                DDT_DUMP_STACK( pConvertor->pStack, pConvertor->stack_pos, pElem, "advance loop" );
+                continue;
+            }
+        }
+    complete_loop:
+        iov[iov_count].iov_len -= iov_len_local;  /* update the amount of valid data */
+        if( pConvertor->flags & CONVERTOR_WITH_CHECKSUM )
+            pConvertor->fChecksum( pConvertor, NULL, iov[iov_count].iov_base, iov[iov_count].iov_len );
+        total_unpacked += iov[iov_count].iov_len;
+    }
+ complete_conversion:
+    *max_data = total_unpacked;
+    pConvertor->bConverted += total_unpacked;  /* update the already converted bytes */
+    *out_size = iov_count;
+    if( pConvertor->bConverted == pConvertor->remote_size ) {
+        pConvertor->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    PUSH_STACK( pStack, pConvertor->stack_pos, pos_desc, OCOMS_DATATYPE_UINT1, count_desc,
+                user_memory_base - pStack->disp - pConvertor->pBaseBuf );
+    return 0;
+}
@@ -16,9 +16,19 @@
 #include "ocoms/platform/ocoms_config.h"
 
 #include <stddef.h>
+#include <string.h>
 #ifdef HAVE_STDINT_H
 #include <stdint.h>
 #endif
+#if defined(__GNUC__) && defined(__x86_64__)
+#define OCOMS_DT_SWAP_X86 1
+#include <immintrin.h>
+#else
+#define OCOMS_DT_SWAP_X86 0
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 #include "ocoms/util/arch.h"
 
@@ -53,6 +63,154 @@ ocoms_dt_swap_bytes(void *to_p, const void *from_p, const size_t size)
     }
 }
 
+static inline void
+ocoms_dt_swap_element(char *to, const char *from, const size_t size)
+{
+#if defined(__GNUC__)
+    uint16_t v2;
+    uint32_t v4;
+    uint64_t v8, w8;
+
+    switch (size) {
+    case 2:
+        memcpy(&v2, from, 2); v2 = __builtin_bswap16(v2); memcpy(to, &v2, 2);
+        return;
+    case 4:
+        memcpy(&v4, from, 4); v4 = __builtin_bswap32(v4); memcpy(to, &v4, 4);
+        return;
+    case 8:
+        memcpy(&v8, from, 8); v8 = __builtin_bswap64(v8); memcpy(to, &v8, 8);
+        return;
+    case 16:
+        memcpy(&v8, from, 8); memcpy(&w8, from + 8, 8);
+        v8 = __builtin_bswap64(v8); w8 = __builtin_bswap64(w8);
+        memcpy(to, &w8, 8); memcpy(to + 8, &v8, 8);
+        return;
+    }
+#endif  /* defined(__GNUC__) */
+    ocoms_dt_swap_bytes(to, from, size);
+}
+
+/*
+ * Byte swap of count contiguous elements of 2, 4, 8 or 16 bytes. The
+ * bulk of the data goes through a byte shuffle of 16 or 32 bytes at a
+ * time, pshufb with SSSE3 or AVX2 on x86-64 and vrev on ARMv8, selected
+ * at runtime by ocoms_datatype_swap_init.
+ */
+typedef void (*ocoms_dt_swap_fct_t)(char *to, const char *from, size_t count, size_t size);
+
+static void
+ocoms_dt_swap_generic(char *to, const char *from, size_t count, size_t size)
+{
+    for ( ; count > 0; count--, to += size, from += size) {
+        ocoms_dt_swap_element(to, from, size);
+    }
+}
+
+#if OCOMS_DT_SWAP_X86
+/* shuffle masks indexed by log2 of the size, the same in both 128 bits lanes */
+static unsigned char ocoms_dt_swap_masks[5][32] __attribute__((aligned(32)));
+
+__attribute__((target("ssse3")))
+static void
+ocoms_dt_swap_ssse3(char *to, const char *from, size_t count, size_t size)
+{
+    const __m128i mask = _mm_load_si128((const __m128i*)ocoms_dt_swap_masks[__builtin_ctzl(size)]);
+    size_t i, length = count * size;
+
+    for (i = 0; (i + 16) <= length; i += 16) {
+        _mm_storeu_si128((__m128i*)(to + i),
+                         _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(from + i)), mask));
+    }
+    ocoms_dt_swap_generic(to + i, from + i, (length - i) / size, size);
+}
+
+__attribute__((target("avx2")))
+static void
+ocoms_dt_swap_avx2(char *to, const char *from, size_t count, size_t size)
+{
+    const __m256i mask = _mm256_load_si256((const __m256i*)ocoms_dt_swap_masks[__builtin_ctzl(size)]);
+    size_t i, length = count * size;
+    __m256i v0, v1;
+
+    for (i = 0; (i + 64) <= length; i += 64) {
+        v0 = _mm256_loadu_si256((const __m256i*)(from + i));
+        v1 = _mm256_loadu_si256((const __m256i*)(from + i + 32));
+        _mm256_storeu_si256((__m256i*)(to + i), _mm256_shuffle_epi8(v0, mask));
+        _mm256_storeu_si256((__m256i*)(to + i + 32), _mm256_shuffle_epi8(v1, mask));
+    }
+    if ((i + 32) <= length) {
+        v0 = _mm256_loadu_si256((const __m256i*)(from + i));
+        _mm256_storeu_si256((__m256i*)(to + i), _mm256_shuffle_epi8(v0, mask));
+        i += 32;
+    }
+    ocoms_dt_swap_generic(to + i, from + i, (length - i) / size, size);
+}
+#endif  /* OCOMS_DT_SWAP_X86 */
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define OCOMS_DT_SWAP_NEON_LOOP(OPERATION)                              \
+    for (i = 0; (i + 16) <= length; i += 16) {                          \
+        v = vld1q_u8((const uint8_t*)(from + i));                       \
+        OPERATION;                                                      \
+        vst1q_u8((uint8_t*)(to + i), v);                                \
+    }
+
+static void
+ocoms_dt_swap_neon(char *to, const char *from, size_t count, size_t size)
+{
+    size_t i, length = count * size;
+    uint8x16_t v;
+
+    switch (size) {
+    case 2:  OCOMS_DT_SWAP_NEON_LOOP(v = vrev16q_u8(v)); break;
+    case 4:  OCOMS_DT_SWAP_NEON_LOOP(v = vrev32q_u8(v)); break;
+    case 8:  OCOMS_DT_SWAP_NEON_LOOP(v = vrev64q_u8(v)); break;
+    default: OCOMS_DT_SWAP_NEON_LOOP(v = vrev64q_u8(v); v = vextq_u8(v, v, 8)); break;
+    }
+    ocoms_dt_swap_generic(to + i, from + i, (length - i) / size, size);
+}
+#endif  /* defined(__ARM_NEON) && defined(__aarch64__) */
+
+static ocoms_dt_swap_fct_t ocoms_dt_swap = ocoms_dt_swap_generic;
+
+int32_t ocoms_datatype_swap_init( void )
+{
+#if OCOMS_DT_SWAP_X86
+    int i, j, size;
+
+    for (i = 1; i < 5; i++) {
+        size = 1 << i;
+        for (j = 0; j < 32; j++) {
+            ocoms_dt_swap_masks[i][j] = (unsigned char)(((j % 16) / size) * size + (size - 1 - (j % size)));
+        }
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        ocoms_dt_swap = ocoms_dt_swap_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        ocoms_dt_swap = ocoms_dt_swap_ssse3;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    ocoms_dt_swap = ocoms_dt_swap_neon;
+#endif
+    return OCOMS_SUCCESS;
+}
+
+static inline void
+ocoms_dt_swap_array(char *to, OCOMS_PTRDIFF_TYPE to_extent,
+                    const char *from, OCOMS_PTRDIFF_TYPE from_extent,
+                    uint32_t count, const size_t size)
+{
+    if (((OCOMS_PTRDIFF_TYPE)size == to_extent) && ((OCOMS_PTRDIFF_TYPE)size == from_extent) &&
+        (size >= 2) && (size <= 16) && (0 == (size & (size - 1)))) {
+        ocoms_dt_swap(to, from, count, size);
+        return;
+    }
+    for ( ; count > 0; count--, to += to_extent, from += from_extent) {
+        ocoms_dt_swap_element(to, from, size);
+    }
+}
+
 
 #define COPY_TYPE_HETEROGENEOUS( TYPENAME, TYPE )                                         \
 static int32_t                                                                            \
@@ -69,11 +227,7 @@ copy_##TYPENAME##_heterogeneous(ocoms_convertor_t *pConvertor, uint32_t count,
                                                                         \
     if ((pConvertor->remoteArch & OCOMS_ARCH_ISBIGENDIAN) !=             \
         (ocoms_local_arch & OCOMS_ARCH_ISBIGENDIAN)) {                    \
-        for( i = 0; i < count; i++ ) {                                  \
-            ocoms_dt_swap_bytes(to, from, sizeof(TYPE));                 \
-            to += to_extent;                                            \
-            from += from_extent;                                        \
-        }                                                               \
+        ocoms_dt_swap_array(to, to_extent, from, from_extent, count, sizeof(TYPE)); \
     } else if ((OCOMS_PTRDIFF_TYPE)sizeof(TYPE) == to_extent &&          \
                (OCOMS_PTRDIFF_TYPE)sizeof(TYPE) == from_extent) {        \
          MEMCPY( to, from, count * sizeof(TYPE) );                      \
@@ -89,6 +243,57 @@ copy_##TYPENAME##_heterogeneous(ocoms_convertor_t *pConvertor, uint32_t count,
     return count;                                                       \
 }
 
+/*
+ * The conversion between architectures differing only by the endianness:
+ * the elements have the same size on both sides and are always swapped.
+ */
+#define COPY_TYPE_SWAP( TYPENAME, TYPE )                                \
+static int32_t                                                          \
+copy_##TYPENAME##_swap(ocoms_convertor_t *pConvertor, uint32_t count,   \
+                       const char* from, size_t from_len, OCOMS_PTRDIFF_TYPE from_extent, \
+                       char* to, size_t to_length, OCOMS_PTRDIFF_TYPE to_extent, \
+                       OCOMS_PTRDIFF_TYPE *advance)                     \
+{                                                                       \
+    datatype_check( #TYPE, sizeof(TYPE), sizeof(TYPE), &count,          \
+                   from, from_len, from_extent,                         \
+                   to, to_length, to_extent);                           \
+                                                                        \
+    ocoms_dt_swap_array(to, to_extent, from, from_extent, count, sizeof(TYPE)); \
+    *advance = count * from_extent;                                     \
+    return count;                                                       \
+}
+
+/*
+ * The complex types are swapped as two elements of TYPE, the real and
+ * the imaginary parts keeping their place.
+ */
+#define COPY_TYPE_SWAP_COMPLEX( TYPENAME, TYPE )                        \
+static int32_t                                                          \
+copy_##TYPENAME##_swap(ocoms_convertor_t *pConvertor, uint32_t count,   \
+                       const char* from, size_t from_len, OCOMS_PTRDIFF_TYPE from_extent, \
+                       char* to, size_t to_length, OCOMS_PTRDIFF_TYPE to_extent, \
+                       OCOMS_PTRDIFF_TYPE *advance)                     \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    datatype_check( #TYPENAME, 2 * sizeof(TYPE), 2 * sizeof(TYPE), &count, \
+                   from, from_len, from_extent,                         \
+                   to, to_length, to_extent);                           \
+                                                                        \
+    if ((OCOMS_PTRDIFF_TYPE)(2 * sizeof(TYPE)) == to_extent &&           \
+        (OCOMS_PTRDIFF_TYPE)(2 * sizeof(TYPE)) == from_extent) {         \
+        ocoms_dt_swap_array(to, sizeof(TYPE), from, sizeof(TYPE), 2 * count, sizeof(TYPE)); \
+    } else {                                                            \
+        for( i = 0; i < count; i++ ) {                                  \
+            ocoms_dt_swap_array(to, sizeof(TYPE), from, sizeof(TYPE), 2, sizeof(TYPE)); \
+            to += to_extent;                                            \
+            from += from_extent;                                        \
+        }                                                               \
+    }                                                                   \
+    *advance = count * from_extent;                                     \
+    return count;                                                       \
+}
+
 
 #define COPY_2TYPE_HETEROGENEOUS( TYPENAME, TYPE1, TYPE2 )              \
 static int32_t                                                          \
@@ -214,76 +419,121 @@ copy_cxx_bool_heterogeneous(ocoms_convertor_t *pConvertor, uint32_t count,
 
 COPY_TYPE_HETEROGENEOUS(int1, int8_t)
 COPY_TYPE_HETEROGENEOUS(int2, int16_t)
+COPY_TYPE_SWAP( int2, int16_t )
 COPY_TYPE_HETEROGENEOUS(int4, int32_t)
+COPY_TYPE_SWAP( int4, int32_t )
 #ifdef HAVE_INT64_T
 COPY_TYPE_HETEROGENEOUS(int8, int64_t)
+COPY_TYPE_SWAP( int8, int64_t )
 #else
 #define copy_int8_heterogeneous NULL
+#define copy_int8_swap NULL
 #endif
 
 #ifdef HAVE_INT128_T
 COPY_TYPE_HETEROGENEOUS(int16, int128_t)
+COPY_TYPE_SWAP( int16, int128_t )
 #else
 #define copy_int16_heterogeneous NULL
+#define copy_int16_swap NULL
 #endif
 
 
 #if SIZEOF_FLOAT == 2
 COPY_TYPE_HETEROGENEOUS( float2, float )
+COPY_TYPE_SWAP( float2, float )
 #elif SIZEOF_DOUBLE == 2
 COPY_TYPE_HETEROGENEOUS( float2, double )
+COPY_TYPE_SWAP( float2, double )
 #elif HAVE_LONG_DOUBLE && SIZEOF_LONG_DOUBLE == 2
 COPY_TYPE_HETEROGENEOUS( float2, long double )
+COPY_TYPE_SWAP( float2, long double )
 #else
 /* #error No basic type for copy function for ocoms_datatype_float2 found */
 #define copy_float2_heterogeneous NULL
+#define copy_float2_swap NULL
 #endif
 
 #if SIZEOF_FLOAT == 4
 COPY_TYPE_HETEROGENEOUS( float4, float )
+COPY_TYPE_SWAP( float4, float )
 #elif SIZEOF_DOUBLE == 4
 COPY_TYPE_HETEROGENEOUS( float4, double )
+COPY_TYPE_SWAP( float4, double )
 #elif HAVE_LONG_DOUBLE && SIZEOF_LONG_DOUBLE == 4
 COPY_TYPE_HETEROGENEOUS( float4, long double )
+COPY_TYPE_SWAP( float4, long double )
 #else
 /* #error No basic type for copy function for ocoms_datatype_float4 found */
 #define copy_float4_heterogeneous NULL
+#define copy_float4_swap NULL
 #endif
 
 #if SIZEOF_FLOAT == 8
 COPY_TYPE_HETEROGENEOUS( float8, float )
+COPY_TYPE_SWAP( float8, float )
 #elif SIZEOF_DOUBLE == 8
 COPY_TYPE_HETEROGENEOUS( float8, double )
+COPY_TYPE_SWAP( float8, double )
 #elif HAVE_LONG_DOUBLE && SIZEOF_LONG_DOUBLE == 8
 COPY_TYPE_HETEROGENEOUS( float8, long double )
+COPY_TYPE_SWAP( float8, long double )
 #else
 /* #error No basic type for copy function for ocoms_datatype_float8 found */
 #define copy_float8_heterogeneous NULL
+#define copy_float8_swap NULL
 #endif
 
 #if SIZEOF_FLOAT == 12
 COPY_TYPE_HETEROGENEOUS( float12, float )
+COPY_TYPE_SWAP( float12, float )
 #elif SIZEOF_DOUBLE == 12
 COPY_TYPE_HETEROGENEOUS( float12, double )
+COPY_TYPE_SWAP( float12, double )
 #elif HAVE_LONG_DOUBLE && SIZEOF_LONG_DOUBLE == 12
 COPY_TYPE_HETEROGENEOUS( float12, long double )
+COPY_TYPE_SWAP( float12, long double )
 #else
 /* #error No basic type for copy function for ocoms_datatype_float12 found */
 #define copy_float12_heterogeneous NULL
+#define copy_float12_swap NULL
 #endif
 
 #if SIZEOF_FLOAT == 16
 COPY_TYPE_HETEROGENEOUS( float16, float )
-#elif SIZEOF_DOUBLE == 8
+COPY_TYPE_SWAP( float16, float )
+#elif SIZEOF_DOUBLE == 16
 COPY_TYPE_HETEROGENEOUS( float16, double )
+COPY_TYPE_SWAP( float16, double )
 #elif HAVE_LONG_DOUBLE && SIZEOF_LONG_DOUBLE == 16
 COPY_TYPE_HETEROGENEOUS( float16, long double )
+COPY_TYPE_SWAP( float16, long double )
 #else
 /* #error No basic type for copy function for ocoms_datatype_float16 found */
 #define copy_float16_heterogeneous NULL
+#define copy_float16_swap NULL
+#endif
+
+#if HAVE_FLOAT__COMPLEX
+COPY_TYPE_SWAP_COMPLEX( float_complex, float )
+#else
+#define copy_float_complex_swap NULL
+#endif
+
+#if HAVE_DOUBLE__COMPLEX
+COPY_TYPE_SWAP_COMPLEX( double_complex, double )
+#else
+#define copy_double_complex_swap NULL
+#endif
+
+#if HAVE_LONG_DOUBLE__COMPLEX
+COPY_TYPE_SWAP_COMPLEX( long_double_complex, long double )
+#else
+#define copy_long_double_complex_swap NULL
 #endif
 
 COPY_TYPE_HETEROGENEOUS (wchar, wchar_t)
+COPY_TYPE_SWAP( wchar, wchar_t )
 
 /* table of predefined copy functions - one for each MPI type */
 conversion_fct_t ocoms_datatype_heterogeneous_copy_functions[OCOMS_DATATYPE_MAX_PREDEFINED] = {
@@ -310,3 +560,25 @@ conversion_fct_t ocoms_datatype_heterogeneous_copy_functions[OCOMS_DATATYPE_MAX_
    (conversion_fct_t) copy_wchar_heterogeneous,              /* OCOMS_DATATYPE_WCHAR       */
    NULL,                                                     /* OCOMS_DATATYPE_UNAVAILABLE */
 };
+
+/* table of the byte swapping copy functions, for the types of the same
+ * size on both sides. The slots left out (single bytes, bool) are NULL. */
+conversion_fct_t ocoms_datatype_swap_copy_functions[OCOMS_DATATYPE_MAX_PREDEFINED] = {
+   [OCOMS_DATATYPE_INT2]                = (conversion_fct_t) copy_int2_swap,
+   [OCOMS_DATATYPE_INT4]                = (conversion_fct_t) copy_int4_swap,
+   [OCOMS_DATATYPE_INT8]                = (conversion_fct_t) copy_int8_swap,
+   [OCOMS_DATATYPE_INT16]               = (conversion_fct_t) copy_int16_swap,
+   [OCOMS_DATATYPE_UINT2]               = (conversion_fct_t) copy_int2_swap,
+   [OCOMS_DATATYPE_UINT4]               = (conversion_fct_t) copy_int4_swap,
+   [OCOMS_DATATYPE_UINT8]               = (conversion_fct_t) copy_int8_swap,
+   [OCOMS_DATATYPE_UINT16]              = (conversion_fct_t) copy_int16_swap,
+   [OCOMS_DATATYPE_FLOAT2]              = (conversion_fct_t) copy_float2_swap,
+   [OCOMS_DATATYPE_FLOAT4]              = (conversion_fct_t) copy_float4_swap,
+   [OCOMS_DATATYPE_FLOAT8]              = (conversion_fct_t) copy_float8_swap,
+   [OCOMS_DATATYPE_FLOAT12]             = (conversion_fct_t) copy_float12_swap,
+   [OCOMS_DATATYPE_FLOAT16]             = (conversion_fct_t) copy_float16_swap,
+   [OCOMS_DATATYPE_FLOAT_COMPLEX]       = (conversion_fct_t) copy_float_complex_swap,
+   [OCOMS_DATATYPE_DOUBLE_COMPLEX]      = (conversion_fct_t) copy_double_complex_swap,
+   [OCOMS_DATATYPE_LONG_DOUBLE_COMPLEX] = (conversion_fct_t) copy_long_double_complex_swap,
+   [OCOMS_DATATYPE_WCHAR]               = (conversion_fct_t) copy_wchar_swap,
+};
@@ -84,6 +84,18 @@ BEGIN_C_DECLS
                                           OCOMS_DATATYPE_FLAG_COMMITED)
 
 
+/*
+ * Storage order of the arrays and distributions of their dimensions, for
+ * the subarray and darray constructors.
+ */
+#define OCOMS_DATATYPE_ORDER_C               0
+#define OCOMS_DATATYPE_ORDER_FORTRAN         1
+
+#define OCOMS_DATATYPE_DISTRIBUTE_NONE       0
+#define OCOMS_DATATYPE_DISTRIBUTE_BLOCK      1
+#define OCOMS_DATATYPE_DISTRIBUTE_CYCLIC     2
+#define OCOMS_DATATYPE_DISTRIBUTE_DFLT_DARG  (-1)
+
 /**
  * The number of supported entries in the data-type definition and the
  * associated type.
@@ -117,6 +129,7 @@ struct ocoms_datatype_t {
     OCOMS_PTRDIFF_TYPE  ub;       /**< upper bound in memory */
     /* --- cacheline 1 boundary (64 bytes) --- */
     uint32_t           align;    /**< data should be aligned to */
+    uint32_t           depth;    /**< maximum nesting of the loops in the descriptions */
     size_t             nbElems;  /**< total number of elements inside the datatype */
 
     /* Attribute fields */
@@ -132,9 +145,14 @@ struct ocoms_datatype_t {
                                       the maximum number of datatypes of all top layers.
                                       Reason being is that Fortran is not at the OCOMS layer. */
     /* --- cacheline 5 boundary (320 bytes) was 32-36 bytes ago --- */
-
-    /* size: 352, cachelines: 6, members: 15 */
-    /* last cacheline: 28-32 bytes */
+    struct ocoms_datatype_plan_t* plan; /**< flattened optimized description used by the homogeneous
+                                      pack and unpack, NULL if the datatype does not have one */
+    struct ocoms_datatype_position_index_t* position_index; /**< checkpoints used to move the convertors
+                                      in long optimized descriptions, NULL if not needed */
+    struct ocoms_convertor_template_t* templates; /**< convertors prepared with this datatype */
+
+    /* size: 376, cachelines: 6, members: 18 */
+    /* last cacheline: 52-56 bytes */
 };
 
 typedef struct ocoms_datatype_t ocoms_datatype_t;
@@ -230,6 +248,23 @@ OCOMS_DECLSPEC void ocoms_datatype_dump_v2( const ocoms_datatype_t* pData, bool
 /* data creation functions */
 OCOMS_DECLSPEC int32_t ocoms_datatype_clone( const ocoms_datatype_t * src_type, ocoms_datatype_t * dest_type );
 OCOMS_DECLSPEC int32_t ocoms_datatype_create_contiguous( int count, const ocoms_datatype_t* oldType, ocoms_datatype_t** newType );
+OCOMS_DECLSPEC int32_t ocoms_datatype_create_vector( int count, int bLength, int stride,
+                                                     const ocoms_datatype_t* oldType, ocoms_datatype_t** newType );
+OCOMS_DECLSPEC int32_t ocoms_datatype_create_hvector( int count, int bLength, OCOMS_PTRDIFF_TYPE stride,
+                                                      const ocoms_datatype_t* oldType, ocoms_datatype_t** newType );
+OCOMS_DECLSPEC int32_t ocoms_datatype_create_indexed( int count, const int* pBlockLength, const int* pDisp,
+                                                      const ocoms_datatype_t* oldType, ocoms_datatype_t** newType );
+OCOMS_DECLSPEC int32_t ocoms_datatype_create_indexed_block( int count, int bLength, const int* pDisp,
+                                                            const ocoms_datatype_t* oldType, ocoms_datatype_t** newType );
+OCOMS_DECLSPEC int32_t ocoms_datatype_create_struct( int count, const int* pBlockLength, const OCOMS_PTRDIFF_TYPE* pDisp,
+                                                     ocoms_datatype_t* const * pTypes, ocoms_datatype_t** newType );
+OCOMS_DECLSPEC int32_t ocoms_datatype_create_subarray( int ndims, const int* pSizes, const int* pSubSizes,
+                                                       const int* pStarts, int order,
+                                                       const ocoms_datatype_t* oldType, ocoms_datatype_t** newType );
+OCOMS_DECLSPEC int32_t ocoms_datatype_create_darray( int size, int rank, int ndims, const int* pGSizes,
+                                                     const int* pDistrib, const int* pDArgs, const int* pPSizes,
+                                                     int order, const ocoms_datatype_t* oldType,
+                                                     ocoms_datatype_t** newType );
 OCOMS_DECLSPEC int32_t ocoms_datatype_resize( ocoms_datatype_t* type, OCOMS_PTRDIFF_TYPE lb, OCOMS_PTRDIFF_TYPE extent );
 OCOMS_DECLSPEC int32_t ocoms_datatype_add( ocoms_datatype_t* pdtBase, const ocoms_datatype_t* pdtAdd, uint32_t count,
                                          OCOMS_PTRDIFF_TYPE disp, OCOMS_PTRDIFF_TYPE extent );
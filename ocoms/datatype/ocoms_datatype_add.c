@@ -260,7 +260,8 @@ int32_t ocoms_datatype_add( ocoms_datatype_t* pdtBase, const ocoms_datatype_t* p
 
     pdtBase->bdt_used |= pdtAdd->bdt_used;
     newLength = pdtBase->desc.used + place_needed;
-    if( newLength > pdtBase->desc.length ) {
+    /* keep room for the fake end loop added by the commit */
+    if( newLength >= pdtBase->desc.length ) {
         newLength = ((newLength / DT_INCREASE_STACK) + 1 ) * DT_INCREASE_STACK;
         pdtBase->desc.desc   = (dt_elem_desc_t*)realloc( pdtBase->desc.desc,
                                                          sizeof(dt_elem_desc_t) * newLength );
@@ -285,8 +286,7 @@ int32_t ocoms_datatype_add( ocoms_datatype_t* pdtBase, const ocoms_datatype_t* p
             pLast++;
             CREATE_LOOP_END( pLast, 2, disp, pdtAdd->size, localFlags );
             pdtBase->desc.used += 3;
-            pdtBase->btypes[OCOMS_DATATYPE_LOOP]     = 1;
-            pdtBase->btypes[OCOMS_DATATYPE_END_LOOP] = 1;
+            pdtBase->btypes[OCOMS_DATATYPE_LOOP] += 2;
         } else {
             pLast->elem.common.type = pdtAdd->id;
             pLast->elem.count       = count;
@@ -0,0 +1,403 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/util/crc.h"
+#include "ocoms/datatype/ocoms_convertor.h"
+#include "ocoms/datatype/ocoms_datatype_checksum.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define OCOMS_DATATYPE_CHECKSUM_X86 1
+#include <immintrin.h>
+#else
+#define OCOMS_DATATYPE_CHECKSUM_X86 0
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/*
+ * Checksums of the convertors with CONVERTOR_WITH_CHECKSUM.
+ *
+ * Each function copies the data (unless the destination is NULL) and
+ * adds it to the checksum of the convertor in the same pass, so the
+ * data is read only once.  The state kept between two calls depends on
+ * the checksum:
+ *  - SUM: the 32 bits sum of ocoms_uicsum_partial, with the bytes of an
+ *    incomplete word in csum_ui1 and their number in csum_ui2;
+ *  - CRC32C: the CRC of the data in csum_ui1, also the checksum;
+ *  - FLETCHER64: the sums A and B of the bytes modulo 2^32-1 in csum_ui1
+ *    and csum_ui2, the checksum is B xor A rotated by 16 bits.
+ * The CRC32C uses the crc32 instruction of SSE4.2 or ARMv8 on 3
+ * independent streams when available, the Fletcher sums use SSE2 or
+ * AVX2 on x86-64.  All of them can be split at any byte.
+ */
+
+int ocoms_datatype_checksum_type = OCOMS_CONVERTOR_CHECKSUM_SUM;
+
+static void ocoms_datatype_checksum_sum( ocoms_convertor_t* convertor,
+                                         void* dst, const void* src, size_t length )
+{
+    if( NULL == dst ) {
+        convertor->checksum += ocoms_uicsum_partial( src, length, &convertor->csum_ui1,
+                                                     &convertor->csum_ui2 );
+    } else {
+        convertor->checksum += ocoms_bcopy_uicsum_partial( src, dst, length, length,
+                                                           &convertor->csum_ui1,
+                                                           &convertor->csum_ui2 );
+    }
+}
+
+/*
+ * CRC-32C
+ */
+#define OCOMS_CRC32C_POLYNOMIAL  0x82f63b78U  /* reflected 0x1edc6f41 */
+/* length of each of the 3 streams of the hardware CRC */
+#define OCOMS_CRC32C_STREAM      256
+
+static uint32_t ocoms_crc32c_table[8][256];
+/* register of a CRC after OCOMS_CRC32C_STREAM zero bytes, by byte of the
+ * initial register, to combine the 3 streams */
+static uint32_t ocoms_crc32c_shift[4][256];
+
+typedef uint32_t (*ocoms_crc32c_fct_t)( uint32_t crc, unsigned char* dst,
+                                        const unsigned char* src, size_t length );
+
+static inline uint64_t ocoms_crc32c_load64( const unsigned char* src )
+{
+    return (uint64_t)src[0] | ((uint64_t)src[1] << 8) | ((uint64_t)src[2] << 16) |
+        ((uint64_t)src[3] << 24) | ((uint64_t)src[4] << 32) | ((uint64_t)src[5] << 40) |
+        ((uint64_t)src[6] << 48) | ((uint64_t)src[7] << 56);
+}
+
+/* slicing-by-8 on the CRC register (no inversion) */
+static uint32_t ocoms_crc32c_register( uint32_t crc, unsigned char* dst,
+                                       const unsigned char* src, size_t length )
+{
+    uint64_t word;
+
+    if( NULL != dst ) memcpy( dst, src, length );
+    for( ; length >= 8; length -= 8, src += 8 ) {
+        word = ocoms_crc32c_load64( src ) ^ crc;
+        crc = ocoms_crc32c_table[7][word & 0xff] ^
+            ocoms_crc32c_table[6][(word >> 8) & 0xff] ^
+            ocoms_crc32c_table[5][(word >> 16) & 0xff] ^
+            ocoms_crc32c_table[4][(word >> 24) & 0xff] ^
+            ocoms_crc32c_table[3][(word >> 32) & 0xff] ^
+            ocoms_crc32c_table[2][(word >> 40) & 0xff] ^
+            ocoms_crc32c_table[1][(word >> 48) & 0xff] ^
+            ocoms_crc32c_table[0][word >> 56];
+    }
+    for( ; length > 0; length--, src++ ) {
+        crc = ocoms_crc32c_table[0][(crc ^ *src) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static inline uint32_t ocoms_crc32c_combine( uint32_t crc )
+{
+    return ocoms_crc32c_shift[0][crc & 0xff] ^ ocoms_crc32c_shift[1][(crc >> 8) & 0xff] ^
+        ocoms_crc32c_shift[2][(crc >> 16) & 0xff] ^ ocoms_crc32c_shift[3][crc >> 24];
+}
+
+/* CRC of 3 consecutive streams of OCOMS_CRC32C_STREAM bytes at once, then
+ * of the remaining data, with the CRC64 and CRC8 instructions */
+#define OCOMS_CRC32C_HARDWARE( CRC64, CRC8 )                            \
+    do {                                                                \
+        uint64_t _c0 = crc, _c1, _c2, _w0, _w1, _w2;                    \
+        size_t _i;                                                      \
+        for( ; length >= 3 * OCOMS_CRC32C_STREAM; length -= 3 * OCOMS_CRC32C_STREAM ) { \
+            _c1 = _c2 = 0;                                              \
+            for( _i = 0; _i < OCOMS_CRC32C_STREAM; _i += 8 ) {          \
+                memcpy( &_w0, src + _i, 8 );                            \
+                memcpy( &_w1, src + OCOMS_CRC32C_STREAM + _i, 8 );      \
+                memcpy( &_w2, src + 2 * OCOMS_CRC32C_STREAM + _i, 8 );  \
+                if( NULL != dst ) {                                     \
+                    memcpy( dst + _i, &_w0, 8 );                        \
+                    memcpy( dst + OCOMS_CRC32C_STREAM + _i, &_w1, 8 );  \
+                    memcpy( dst + 2 * OCOMS_CRC32C_STREAM + _i, &_w2, 8 ); \
+                }                                                       \
+                _c0 = CRC64( _c0, _w0 );                                \
+                _c1 = CRC64( _c1, _w1 );                                \
+                _c2 = CRC64( _c2, _w2 );                                \
+            }                                                           \
+            _c0 = ocoms_crc32c_combine( (uint32_t)_c0 ) ^ _c1;          \
+            _c0 = ocoms_crc32c_combine( (uint32_t)_c0 ) ^ _c2;          \
+            src += 3 * OCOMS_CRC32C_STREAM;                             \
+            if( NULL != dst ) dst += 3 * OCOMS_CRC32C_STREAM;           \
+        }                                                               \
+        for( ; length >= 8; length -= 8 ) {                             \
+            memcpy( &_w0, src, 8 );                                     \
+            if( NULL != dst ) { memcpy( dst, &_w0, 8 ); dst += 8; }     \
+            _c0 = CRC64( _c0, _w0 );                                    \
+            src += 8;                                                   \
+        }                                                               \
+        for( ; length > 0; length-- ) {                                 \
+            if( NULL != dst ) *dst++ = *src;                            \
+            _c0 = CRC8( (uint32_t)_c0, *src++ );                        \
+        }                                                               \
+        return (uint32_t)_c0;                                           \
+    } while (0)
+
+#if OCOMS_DATATYPE_CHECKSUM_X86
+__attribute__((target("sse4.2")))
+static uint32_t ocoms_crc32c_register_sse42( uint32_t crc, unsigned char* dst,
+                                             const unsigned char* src, size_t length )
+{
+    OCOMS_CRC32C_HARDWARE( _mm_crc32_u64, _mm_crc32_u8 );
+}
+#endif  /* OCOMS_DATATYPE_CHECKSUM_X86 */
+
+#if defined(__ARM_FEATURE_CRC32)
+static uint32_t ocoms_crc32c_register_armv8( uint32_t crc, unsigned char* dst,
+                                             const unsigned char* src, size_t length )
+{
+    OCOMS_CRC32C_HARDWARE( __crc32cd, __crc32cb );
+}
+#endif  /* defined(__ARM_FEATURE_CRC32) */
+
+static ocoms_crc32c_fct_t ocoms_crc32c = ocoms_crc32c_register;
+
+static void ocoms_datatype_checksum_crc32c( ocoms_convertor_t* convertor,
+                                            void* dst, const void* src, size_t length )
+{
+    convertor->csum_ui1 = ~ocoms_crc32c( ~convertor->csum_ui1, (unsigned char*)dst,
+                                         (const unsigned char*)src, length );
+    convertor->checksum = convertor->csum_ui1;
+}
+
+static void ocoms_crc32c_init( void )
+{
+    uint32_t crc, column[32];
+    unsigned char zeros[OCOMS_CRC32C_STREAM];
+    int i, j, k;
+
+    for( i = 0; i < 256; i++ ) {
+        crc = i;
+        for( j = 0; j < 8; j++ )
+            crc = (crc & 1) ? (crc >> 1) ^ OCOMS_CRC32C_POLYNOMIAL : (crc >> 1);
+        ocoms_crc32c_table[0][i] = crc;
+    }
+    for( i = 0; i < 256; i++ ) {
+        for( k = 1; k < 8; k++ ) {
+            crc = ocoms_crc32c_table[k-1][i];
+            ocoms_crc32c_table[k][i] = (crc >> 8) ^ ocoms_crc32c_table[0][crc & 0xff];
+        }
+    }
+    /* appending zeros is linear in the register, build it from its columns */
+    memset( zeros, 0, sizeof(zeros) );
+    for( j = 0; j < 32; j++ ) {
+        column[j] = ocoms_crc32c_register( 1U << j, NULL, zeros, sizeof(zeros) );
+    }
+    for( k = 0; k < 4; k++ ) {
+        for( i = 0; i < 256; i++ ) {
+            crc = 0;
+            for( j = 0; j < 8; j++ )
+                if( i & (1 << j) ) crc ^= column[8 * k + j];
+            ocoms_crc32c_shift[k][i] = crc;
+        }
+    }
+
+#if OCOMS_DATATYPE_CHECKSUM_X86
+    if( __builtin_cpu_supports( "sse4.2" ) ) ocoms_crc32c = ocoms_crc32c_register_sse42;
+#elif defined(__ARM_FEATURE_CRC32)
+    ocoms_crc32c = ocoms_crc32c_register_armv8;
+#endif
+}
+
+/*
+ * Fletcher sums modulo 2^32-1 of the bytes: A is the sum of the bytes and
+ * B the sum of the successive values of A.
+ */
+#define OCOMS_FLETCHER_MODULO   0xffffffffULL
+/* bytes summed before a reduction, B stays below 2^64 */
+#define OCOMS_FLETCHER_BLOCK    (64 * 1024)
+
+static inline uint64_t ocoms_fletcher_reduce( uint64_t x )
+{
+    x = (x & OCOMS_FLETCHER_MODULO) + (x >> 32);
+    x = (x & OCOMS_FLETCHER_MODULO) + (x >> 32);
+    return (x >= OCOMS_FLETCHER_MODULO) ? x - OCOMS_FLETCHER_MODULO : x;
+}
+
+typedef void (*ocoms_fletcher_fct_t)( uint64_t* pa, uint64_t* pb, unsigned char* dst,
+                                      const unsigned char* src, size_t length );
+
+static void ocoms_fletcher_generic( uint64_t* pa, uint64_t* pb, unsigned char* dst,
+                                    const unsigned char* src, size_t length )
+{
+    uint64_t a = *pa, b = *pb;
+    size_t i, n;
+
+    while( length > 0 ) {
+        n = (length > OCOMS_FLETCHER_BLOCK) ? OCOMS_FLETCHER_BLOCK : length;
+        if( NULL != dst ) {
+            memcpy( dst, src, n );
+            dst += n;
+        }
+        for( i = 0; i + 8 <= n; i += 8 ) {
+            b += 8 * a + 8 * (uint64_t)src[i] + 7 * (uint64_t)src[i+1] + 6 * (uint64_t)src[i+2] +
+                5 * (uint64_t)src[i+3] + 4 * (uint64_t)src[i+4] + 3 * (uint64_t)src[i+5] +
+                2 * (uint64_t)src[i+6] + (uint64_t)src[i+7];
+            a += (uint64_t)src[i] + src[i+1] + src[i+2] + src[i+3] + src[i+4] + src[i+5] +
+                src[i+6] + src[i+7];
+        }
+        for( ; i < n; i++ ) {
+            a += src[i];
+            b += a;
+        }
+        a = ocoms_fletcher_reduce( a );
+        b = ocoms_fletcher_reduce( b );
+        src += n;
+        length -= n;
+    }
+    *pa = a;
+    *pb = b;
+}
+
+#if OCOMS_DATATYPE_CHECKSUM_X86
+/* 16 bytes at a time: the byte i of a vector adds 16 - i times itself to
+ * B, each vector adds 16 times the previous A */
+static void ocoms_fletcher_sse2( uint64_t* pa, uint64_t* pb, unsigned char* dst,
+                                 const unsigned char* src, size_t length )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w_lo = _mm_setr_epi16( 16, 15, 14, 13, 12, 11, 10, 9 );
+    const __m128i w_hi = _mm_setr_epi16( 8, 7, 6, 5, 4, 3, 2, 1 );
+    __m128i x, va, vp, vw;
+    uint64_t a = *pa, b = *pb, tmp[2];
+    uint32_t tw[4];
+    size_t i, n;
+
+    while( length >= 16 ) {
+        n = (length > OCOMS_FLETCHER_BLOCK) ? OCOMS_FLETCHER_BLOCK : (length & ~(size_t)15);
+        va = vp = vw = zero;
+        for( i = 0; i < n; i += 16 ) {
+            x = _mm_loadu_si128( (const __m128i*)(src + i) );
+            if( NULL != dst ) _mm_storeu_si128( (__m128i*)(dst + i), x );
+            vp = _mm_add_epi64( vp, va );
+            va = _mm_add_epi64( va, _mm_sad_epu8( x, zero ) );
+            vw = _mm_add_epi32( vw, _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi8( x, zero ), w_lo ),
+                                                   _mm_madd_epi16( _mm_unpackhi_epi8( x, zero ), w_hi ) ) );
+        }
+        b += n * a;
+        _mm_storeu_si128( (__m128i*)tmp, vp );
+        b += 16 * (tmp[0] + tmp[1]);
+        _mm_storeu_si128( (__m128i*)tw, vw );
+        b += (uint64_t)tw[0] + tw[1] + tw[2] + tw[3];
+        _mm_storeu_si128( (__m128i*)tmp, va );
+        a += tmp[0] + tmp[1];
+        a = ocoms_fletcher_reduce( a );
+        b = ocoms_fletcher_reduce( b );
+        src += n;
+        if( NULL != dst ) dst += n;
+        length -= n;
+    }
+    *pa = a;
+    *pb = b;
+    if( length > 0 ) ocoms_fletcher_generic( pa, pb, dst, src, length );
+}
+
+/* the same 32 bytes at a time, the weights are applied by pmaddubsw */
+__attribute__((target("avx2")))
+static void ocoms_fletcher_avx2( uint64_t* pa, uint64_t* pb, unsigned char* dst,
+                                 const unsigned char* src, size_t length )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16( 1 );
+    const __m256i weights = _mm256_setr_epi8( 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21,
+                                              20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9,
+                                              8, 7, 6, 5, 4, 3, 2, 1 );
+    __m256i x, va, vp, vw;
+    uint64_t a = *pa, b = *pb, tmp[4];
+    uint32_t tw[8];
+    size_t i, n;
+
+    while( length >= 32 ) {
+        n = (length > OCOMS_FLETCHER_BLOCK) ? OCOMS_FLETCHER_BLOCK : (length & ~(size_t)31);
+        va = vp = vw = zero;
+        for( i = 0; i < n; i += 32 ) {
+            x = _mm256_loadu_si256( (const __m256i*)(src + i) );
+            if( NULL != dst ) _mm256_storeu_si256( (__m256i*)(dst + i), x );
+            vp = _mm256_add_epi64( vp, va );
+            va = _mm256_add_epi64( va, _mm256_sad_epu8( x, zero ) );
+            vw = _mm256_add_epi32( vw, _mm256_madd_epi16( _mm256_maddubs_epi16( x, weights ), ones ) );
+        }
+        b += n * a;
+        _mm256_storeu_si256( (__m256i*)tmp, vp );
+        b += 32 * (tmp[0] + tmp[1] + tmp[2] + tmp[3]);
+        _mm256_storeu_si256( (__m256i*)tw, vw );
+        b += (uint64_t)tw[0] + tw[1] + tw[2] + tw[3] + tw[4] + tw[5] + tw[6] + tw[7];
+        _mm256_storeu_si256( (__m256i*)tmp, va );
+        a += tmp[0] + tmp[1] + tmp[2] + tmp[3];
+        a = ocoms_fletcher_reduce( a );
+        b = ocoms_fletcher_reduce( b );
+        src += n;
+        if( NULL != dst ) dst += n;
+        length -= n;
+    }
+    *pa = a;
+    *pb = b;
+    if( length > 0 ) ocoms_fletcher_generic( pa, pb, dst, src, length );
+}
+#endif  /* OCOMS_DATATYPE_CHECKSUM_X86 */
+
+static ocoms_fletcher_fct_t ocoms_fletcher = ocoms_fletcher_generic;
+
+static void ocoms_datatype_checksum_fletcher64( ocoms_convertor_t* convertor,
+                                                void* dst, const void* src, size_t length )
+{
+    uint64_t a = convertor->csum_ui1, b = convertor->csum_ui2;
+    size_t i;
+
+    if( length < 16 ) {
+        /* predefined elements one at a time */
+        for( i = 0; i < length; i++ ) {
+            a += ((const unsigned char*)src)[i];
+            b += a;
+        }
+        if( NULL != dst ) MEMCPY( dst, src, length );
+        a = ocoms_fletcher_reduce( a );
+        b = ocoms_fletcher_reduce( b );
+    } else {
+        ocoms_fletcher( &a, &b, (unsigned char*)dst, (const unsigned char*)src, length );
+    }
+    convertor->csum_ui1 = (uint32_t)a;
+    convertor->csum_ui2 = (size_t)b;
+    convertor->checksum = (uint32_t)b ^ (((uint32_t)a << 16) | ((uint32_t)a >> 16));
+}
+
+convertor_checksum_fct_t ocoms_datatype_checksum_functions[OCOMS_CONVERTOR_CHECKSUM_MAX] = {
+    [OCOMS_CONVERTOR_CHECKSUM_SUM]        = ocoms_datatype_checksum_sum,
+    [OCOMS_CONVERTOR_CHECKSUM_CRC32C]     = ocoms_datatype_checksum_crc32c,
+    [OCOMS_CONVERTOR_CHECKSUM_FLETCHER64] = ocoms_datatype_checksum_fletcher64,
+};
+
+int32_t ocoms_datatype_checksum_init( void )
+{
+    ocoms_crc32c_init();
+#if OCOMS_DATATYPE_CHECKSUM_X86
+    ocoms_fletcher = __builtin_cpu_supports( "avx2" ) ? ocoms_fletcher_avx2 : ocoms_fletcher_sse2;
+#endif
+    if( (ocoms_datatype_checksum_type < 0) ||
+        (ocoms_datatype_checksum_type >= OCOMS_CONVERTOR_CHECKSUM_MAX) ) {
+        ocoms_datatype_checksum_type = OCOMS_CONVERTOR_CHECKSUM_SUM;
+    }
+    return OCOMS_SUCCESS;
+}
@@ -22,29 +22,36 @@
 #define DATATYPE_CHECKSUM_H_HAS_BEEN_INCLUDED
 
 
+#include "ocoms/datatype/ocoms_convertor.h"
 #include "ocoms/datatype/ocoms_datatype_memcpy.h"
 #include "ocoms/util/crc.h"
 
-#if defined(CHECKSUM)
+BEGIN_C_DECLS
 
-#if defined (OCOMS_CSUM_DST)
-#define MEMCPY_CSUM( DST, SRC, BLENGTH, CONVERTOR ) \
-do { \
-    (CONVERTOR)->checksum += OCOMS_CSUM_BCOPY_PARTIAL( (SRC), (DST), (BLENGTH), (BLENGTH), &(CONVERTOR)->csum_ui1, &(CONVERTOR)->csum_ui2 ); \
-} while (0)
+/** Checksum of the new convertors (MCA ddt_checksum) */
+OCOMS_DECLSPEC extern int ocoms_datatype_checksum_type;
+/** Copy and checksum functions, indexed by OCOMS_CONVERTOR_CHECKSUM_* */
+OCOMS_DECLSPEC extern convertor_checksum_fct_t ocoms_datatype_checksum_functions[OCOMS_CONVERTOR_CHECKSUM_MAX];
+
+/**
+ * Select the checksum functions for the processor, called by
+ * ocoms_datatype_init().
+ */
+int32_t ocoms_datatype_checksum_init( void );
 
-#else  /* if OCOMS_CSUM_DST */
+END_C_DECLS
 
+#if defined(CHECKSUM)
+
+/* the checksum is computed on the source, the packed data on the receiver */
 #define MEMCPY_CSUM( DST, SRC, BLENGTH, CONVERTOR ) \
-do { \
-    (CONVERTOR)->checksum += OCOMS_CSUM_BCOPY_PARTIAL( (SRC), (DST), (BLENGTH), (BLENGTH), &(CONVERTOR)->csum_ui1, &(CONVERTOR)->csum_ui2 ); \
-} while (0)
-#endif  /* if OCOMS_CSUM_DST */
+    (CONVERTOR)->fChecksum( (CONVERTOR), (DST), (SRC), (BLENGTH) )
 
 #define COMPUTE_CSUM( SRC, BLENGTH, CONVERTOR ) \
-do { \
-    (CONVERTOR)->checksum += OCOMS_CSUM_PARTIAL( (SRC), (BLENGTH), &(CONVERTOR)->csum_ui1, &(CONVERTOR)->csum_ui2 ); \
-} while (0)
+    (CONVERTOR)->fChecksum( (CONVERTOR), NULL, (SRC), (BLENGTH) )
+
+/* every block has to go through the checksum */
+#define MEMCPY_STRIDED( DST, DST_STRIDE, SRC, SRC_STRIDE, BLENGTH, COUNT ) 0
 
 #else  /* if CHECKSUM */
 
@@ -53,5 +60,9 @@ do { \
 
 #define COMPUTE_CSUM( SRC, BLENGTH, CONVERTOR )
 
+/* copy COUNT blocks of BLENGTH bytes at once, 0 if it is up to the caller */
+#define MEMCPY_STRIDED( DST, DST_STRIDE, SRC, SRC_STRIDE, BLENGTH, COUNT ) \
+    ocoms_datatype_strided_copy( (DST), (DST_STRIDE), (SRC), (SRC_STRIDE), (BLENGTH), (COUNT) )
+
 #endif  /* if CHECKSUM */
 #endif  /* DATATYPE_CHECKSUM_H_HAS_BEEN_INCLUDED */
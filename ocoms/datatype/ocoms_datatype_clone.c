@@ -44,6 +44,9 @@ int32_t ocoms_datatype_clone( const ocoms_datatype_t * src_type, ocoms_datatype_
 
     dest_type->flags &= (~OCOMS_DATATYPE_FLAG_PREDEFINED);
     dest_type->desc.desc = temp;
+    dest_type->plan = NULL;
+    dest_type->position_index = NULL;
+    dest_type->templates = NULL;
 
     /**
      * Allow duplication of MPI_UB and MPI_LB.
@@ -63,6 +66,12 @@ int32_t ocoms_datatype_clone( const ocoms_datatype_t * src_type, ocoms_datatype_
                 dest_type->opt_desc.used = src_type->opt_desc.used;
                 memcpy( dest_type->opt_desc.desc, src_type->opt_desc.desc, desc_length * sizeof(dt_elem_desc_t) );
             }
+            if( NULL != src_type->plan ) {
+                (void)ocoms_datatype_plan_build( dest_type );
+            }
+            if( NULL != src_type->position_index ) {
+                (void)ocoms_datatype_position_index_build( dest_type );
+            }
         }
     }
     dest_type->id  = src_type->id;  /* preserve the default id. This allow us to
@@ -53,7 +53,9 @@ static size_t ocoms_datatype_memop_block_size = 128 * 1024;
 #define MEM_OP_NAME  non_overlap
 #undef MEM_OP
 #define MEM_OP       MEMCPY
+#define MEM_OP_STRIDED ocoms_datatype_strided_copy
 #include "ocoms_datatype_copy.h"
+#undef MEM_OP_STRIDED
 
 #define MEMMOVE(d, s, l)                                  \
     do {                                                  \
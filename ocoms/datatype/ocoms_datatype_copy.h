@@ -63,8 +63,14 @@ static inline void _predefined_data( const dt_elem_desc_t* ELEM,
         _source      += _copy_blength;
         _destination += _copy_blength;
     } else {
-        uint32_t _i;
-        for( _i = 0; _i < _copy_count; _i++ ) {
+        uint32_t _i = 0;
+#if defined(MEM_OP_STRIDED)
+        if( MEM_OP_STRIDED( _destination, _elem->extent, _source, _elem->extent,
+                            _copy_blength, _copy_count ) ) {
+            _i = _copy_count;
+        }
+#endif  /* defined(MEM_OP_STRIDED) */
+        for( ; _i < _copy_count; _i++ ) {
             OCOMS_DATATYPE_SAFEGUARD_POINTER( _source, _copy_blength, (SOURCE_BASE),
                                         (DATATYPE), (TOTAL_COUNT) );
             DO_DEBUG( ocoms_output( 0, "copy 2. %s( %p, %p, %lu ) => space %lu\n",
@@ -100,7 +106,14 @@ static inline void _contiguous_loop( const dt_elem_desc_t* ELEM,
                                     (DATATYPE), (TOTAL_COUNT) );
         MEM_OP( _destination, _source, _copy_loops );
     } else {
-        for( _i = 0; _i < _copy_loops; _i++ ) {
+        _i = 0;
+#if defined(MEM_OP_STRIDED)
+        if( MEM_OP_STRIDED( _destination, _loop->extent, _source, _loop->extent,
+                            _end_loop->size, _copy_loops ) ) {
+            _i = _copy_loops;
+        }
+#endif  /* defined(MEM_OP_STRIDED) */
+        for( ; _i < _copy_loops; _i++ ) {
             OCOMS_DATATYPE_SAFEGUARD_POINTER( _source, _end_loop->size, (SOURCE_BASE),
                                         (DATATYPE), (TOTAL_COUNT) );
             DO_DEBUG( ocoms_output( 0, "copy 3. %s( %p, %p, %lu ) => space %lu\n",
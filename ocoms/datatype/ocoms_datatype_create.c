@@ -27,6 +27,7 @@
 #include "ocoms/platform/ocoms_constants.h"
 #include "ocoms/datatype/ocoms_datatype.h"
 #include "ocoms/datatype/ocoms_datatype_internal.h"
+#include "ocoms/datatype/ocoms_convertor_internal.h"
 #include "limits.h"
 #include "ocoms/primitives/prefetch.h"
 
@@ -45,7 +46,11 @@ static void ocoms_datatype_construct( ocoms_datatype_t* pData )
     pData->opt_desc.desc      = NULL;
     pData->opt_desc.length    = 0;
     pData->opt_desc.used      = 0;
+    pData->plan               = NULL;
+    pData->position_index     = NULL;
+    pData->templates          = NULL;
     pData->align              = 1;
+    pData->depth              = 0;
     pData->flags              = OCOMS_DATATYPE_FLAG_CONTIGUOUS;
     pData->true_lb            = LONG_MAX;
     pData->true_ub            = LONG_MIN;
@@ -69,6 +74,9 @@ static void ocoms_datatype_destruct( ocoms_datatype_t* datatype )
             datatype->opt_desc.used   = 0;
             datatype->opt_desc.desc   = NULL;
         }
+        ocoms_datatype_plan_release( datatype );
+        ocoms_datatype_position_index_release( datatype );
+        ocoms_convertor_release_templates( datatype );
     }
     /**
      * As the default description and the optimized description can point to the
@@ -0,0 +1,126 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
+ *                         University Research and Technology
+ *                         Corporation.  All rights reserved.
+ * Copyright (c) 2004-2010 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
+ *                         University of Stuttgart.  All rights reserved.
+ * Copyright (c) 2004-2006 The Regents of the University of California.
+ *                         All rights reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stdlib.h>
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/datatype/ocoms_datatype.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+
+/*
+ * Size of the blocks of a distributed dimension, or 0 if the arguments
+ * are invalid.
+ */
+static OCOMS_PTRDIFF_TYPE
+ocoms_datatype_darray_block( int gsize, int distrib, int darg, int psize )
+{
+    OCOMS_PTRDIFF_TYPE block;
+
+    switch( distrib ) {
+    case OCOMS_DATATYPE_DISTRIBUTE_NONE:
+        return (1 == psize) ? gsize : 0;
+    case OCOMS_DATATYPE_DISTRIBUTE_BLOCK:
+        if( OCOMS_DATATYPE_DISTRIBUTE_DFLT_DARG == darg )
+            return (gsize + psize - 1) / psize;
+        block = darg;
+        return ((darg > 0) && ((block * psize) >= gsize)) ? block : 0;
+    case OCOMS_DATATYPE_DISTRIBUTE_CYCLIC:
+        if( OCOMS_DATATYPE_DISTRIBUTE_DFLT_DARG == darg ) return 1;
+        return (darg > 0) ? darg : 0;
+    }
+    return 0;
+}
+
+/*
+ * The blocks of a dimension are dealt to the processes in turn, so the
+ * process at coordinate coord owns the blocks coord, coord + psize, ...
+ * A block distribution is the case where there are at most psize blocks.
+ */
+int32_t ocoms_datatype_create_darray( int size, int rank, int ndims, const int* pGSizes,
+                                      const int* pDistrib, const int* pDArgs, const int* pPSizes,
+                                      int order, const ocoms_datatype_t* oldType,
+                                      ocoms_datatype_t** newType )
+{
+    OCOMS_PTRDIFF_TYPE *intervals, *block, stride, start;
+    ocoms_datatype_dim_t* dims;
+    int i, d, coord, nprocs = 1, total = 0;
+    int32_t rc;
+
+    if( (ndims < 1) || (rank < 0) || (rank >= size) ||
+        ((OCOMS_DATATYPE_ORDER_C != order) && (OCOMS_DATATYPE_ORDER_FORTRAN != order)) )
+        return OCOMS_ERR_BAD_PARAM;
+
+    dims  = (ocoms_datatype_dim_t*)malloc( sizeof(ocoms_datatype_dim_t) * ndims );
+    block = (OCOMS_PTRDIFF_TYPE*)malloc( sizeof(OCOMS_PTRDIFF_TYPE) * ndims );
+    if( (NULL == dims) || (NULL == block) ) {
+        rc = OCOMS_ERR_OUT_OF_RESOURCE;
+        goto cleanup;
+    }
+
+    rc = OCOMS_ERR_BAD_PARAM;
+    for( i = 0; i < ndims; i++ ) {
+        if( (pGSizes[i] < 1) || (pPSizes[i] < 1) ) goto cleanup;
+        block[i] = ocoms_datatype_darray_block( pGSizes[i], pDistrib[i], pDArgs[i], pPSizes[i] );
+        if( 0 == block[i] ) goto cleanup;
+        nprocs *= pPSizes[i];
+        /* the number of blocks owned by any process */
+        stride = block[i] * pPSizes[i];
+        total += (int)((pGSizes[i] + stride - 1) / stride);
+    }
+    if( nprocs != size ) goto cleanup;
+
+    intervals = (OCOMS_PTRDIFF_TYPE*)malloc( sizeof(OCOMS_PTRDIFF_TYPE) * 2 * total );
+    if( NULL == intervals ) {
+        rc = OCOMS_ERR_OUT_OF_RESOURCE;
+        goto cleanup;
+    }
+
+    /* the processes are always in row-major order, whatever the order of the array */
+    for( i = ndims - 1, total = 0; i >= 0; i-- ) {
+        coord = rank % pPSizes[i];
+        rank /= pPSizes[i];
+
+        d = (OCOMS_DATATYPE_ORDER_C == order) ? i : (ndims - 1 - i);
+        dims[d].size   = pGSizes[i];
+        dims[d].count  = 0;
+        dims[d].start  = &intervals[total];
+        stride = block[i] * pPSizes[i];
+        for( start = coord * block[i]; start < pGSizes[i]; start += stride )
+            dims[d].count++;
+        dims[d].length = &intervals[total + dims[d].count];
+        total += 2 * dims[d].count;
+
+        for( start = coord * block[i], coord = 0; start < pGSizes[i]; start += stride, coord++ ) {
+            dims[d].start[coord]  = start;
+            dims[d].length[coord] = (start + block[i] > pGSizes[i]) ? (pGSizes[i] - start) : block[i];
+        }
+    }
+
+    rc = ocoms_datatype_create_dims( ndims, dims, oldType, newType );
+    free( intervals );
+
+ cleanup:
+    free( block );
+    free( dims );
+    return rc;
+}
@@ -0,0 +1,136 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
+ *                         University Research and Technology
+ *                         Corporation.  All rights reserved.
+ * Copyright (c) 2004-2010 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
+ *                         University of Stuttgart.  All rights reserved.
+ * Copyright (c) 2004-2006 The Regents of the University of California.
+ *                         All rights reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stdlib.h>
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/datatype/ocoms_datatype.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+
+/* runs of blocks shorter than this are added one block at a time */
+#define OCOMS_DATATYPE_INDEXED_MIN_RUN  3
+
+/*
+ * Add the blocks (already merged when contiguous) to the datatype. The
+ * runs of blocks with the same length and a constant stride become a
+ * vector, i.e. a single loop, instead of one entry per block.
+ */
+int32_t
+ocoms_datatype_add_blocks( ocoms_datatype_t* pdt, const ocoms_datatype_t* oldType,
+                           const ocoms_datatype_block_t* blocks, int nblocks )
+{
+    OCOMS_PTRDIFF_TYPE extent = oldType->ub - oldType->lb, stride;
+    ocoms_datatype_t* pBlock;
+    int32_t rc = OCOMS_SUCCESS;
+    int i, run;
+
+    for( i = 0; (i < nblocks) && (OCOMS_SUCCESS == rc); i += run ) {
+        run = 1;
+        if( i + 1 < nblocks ) {
+            stride = blocks[i+1].disp - blocks[i].disp;
+            while( (i + run < nblocks) && (blocks[i+run].length == blocks[i].length) &&
+                   ((blocks[i+run].disp - blocks[i+run-1].disp) == stride) ) {
+                run++;
+            }
+            if( (run < OCOMS_DATATYPE_INDEXED_MIN_RUN) || (stride <= 0) ) run = 1;
+        }
+        if( 1 == run ) {
+            rc = ocoms_datatype_add( pdt, oldType, blocks[i].length, blocks[i].disp, extent );
+        } else if( 1 == blocks[i].length ) {
+            rc = ocoms_datatype_add( pdt, oldType, run, blocks[i].disp, stride );
+        } else {
+            pBlock = ocoms_datatype_create( oldType->desc.used + 2 );
+            rc = ocoms_datatype_add( pBlock, oldType, blocks[i].length, 0, extent );
+            if( OCOMS_SUCCESS == rc )
+                rc = ocoms_datatype_add( pdt, pBlock, run, blocks[i].disp, stride );
+            OBJ_RELEASE( pBlock );
+        }
+    }
+    return rc;
+}
+
+/*
+ * Build the list of blocks, merging the blocks ending where the next
+ * one starts. Empty blocks are dropped.
+ */
+static int32_t
+ocoms_datatype_create_indexed_generic( int count, const int* pBlockLength, int bLength,
+                                       const int* pDisp, const ocoms_datatype_t* oldType,
+                                       ocoms_datatype_t** newType )
+{
+    OCOMS_PTRDIFF_TYPE extent = oldType->ub - oldType->lb;
+    ocoms_datatype_block_t* blocks;
+    ocoms_datatype_t* pdt;
+    int i, length, nblocks = 0;
+    int32_t rc;
+
+    blocks = (ocoms_datatype_block_t*)malloc( sizeof(ocoms_datatype_block_t) * (count > 0 ? count : 1) );
+    if( NULL == blocks ) return OCOMS_ERR_OUT_OF_RESOURCE;
+
+    for( i = 0; i < count; i++ ) {
+        length = (NULL != pBlockLength) ? pBlockLength[i] : bLength;
+        if( 0 == length ) continue;
+        if( (nblocks > 0) &&
+            ((blocks[nblocks-1].disp + blocks[nblocks-1].length * extent) == (pDisp[i] * extent)) ) {
+            blocks[nblocks-1].length += length;
+            continue;
+        }
+        blocks[nblocks].disp   = pDisp[i] * extent;
+        blocks[nblocks].length = length;
+        nblocks++;
+    }
+
+    if( 0 == nblocks ) {
+        pdt = ocoms_datatype_create( 0 );
+        ocoms_datatype_add( pdt, &ocoms_datatype_empty, 0, 0, 0 );
+        free( blocks );
+        *newType = pdt;
+        return OCOMS_SUCCESS;
+    }
+
+    pdt = ocoms_datatype_create( nblocks * (2 + oldType->desc.used) );
+    rc = ocoms_datatype_add_blocks( pdt, oldType, blocks, nblocks );
+    free( blocks );
+    if( OCOMS_SUCCESS != rc ) {
+        OBJ_RELEASE( pdt );
+        return rc;
+    }
+    *newType = pdt;
+    return OCOMS_SUCCESS;
+}
+
+int32_t ocoms_datatype_create_indexed( int count, const int* pBlockLength, const int* pDisp,
+                                       const ocoms_datatype_t* oldType,
+                                       ocoms_datatype_t** newType )
+{
+    return ocoms_datatype_create_indexed_generic( count, pBlockLength, 0, pDisp,
+                                                  oldType, newType );
+}
+
+int32_t ocoms_datatype_create_indexed_block( int count, int bLength, const int* pDisp,
+                                             const ocoms_datatype_t* oldType,
+                                             ocoms_datatype_t** newType )
+{
+    return ocoms_datatype_create_indexed_generic( count, NULL, bLength, pDisp,
+                                                  oldType, newType );
+}
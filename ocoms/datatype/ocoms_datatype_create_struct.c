@@ -0,0 +1,103 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
+ *                         University Research and Technology
+ *                         Corporation.  All rights reserved.
+ * Copyright (c) 2004-2010 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
+ *                         University of Stuttgart.  All rights reserved.
+ * Copyright (c) 2004-2006 The Regents of the University of California.
+ *                         All rights reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/datatype/ocoms_datatype.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+
+/*
+ * The consecutive fields of the same datatype following each other in
+ * memory are merged before being added, so that the description gets a
+ * single entry for them. The first pass only counts the entries.
+ */
+int32_t ocoms_datatype_create_struct( int count, const int* pBlockLength,
+                                      const OCOMS_PTRDIFF_TYPE* pDisp,
+                                      ocoms_datatype_t* const * pTypes,
+                                      ocoms_datatype_t** newType )
+{
+    OCOMS_PTRDIFF_TYPE disp = 0, endto, lastExtent, lastDisp;
+    const ocoms_datatype_t *lastType;
+    ocoms_datatype_t* pdt;
+    int lastBlock, i;
+    int32_t rc;
+
+    if( 0 == count ) {
+        pdt = ocoms_datatype_create( 0 );
+        ocoms_datatype_add( pdt, &ocoms_datatype_empty, 0, 0, 0 );
+        *newType = pdt;
+        return OCOMS_SUCCESS;
+    }
+
+    lastType = pTypes[0];
+    lastBlock = pBlockLength[0];
+    lastExtent = lastType->ub - lastType->lb;
+    lastDisp = pDisp[0];
+    endto = pDisp[0] + lastExtent * lastBlock;
+    for( i = 1; i < count; i++ ) {
+        if( (pTypes[i] == lastType) && (pDisp[i] == endto) ) {
+            lastBlock += pBlockLength[i];
+            endto = lastDisp + lastBlock * lastExtent;
+        } else {
+            disp += lastType->desc.used;
+            if( lastBlock > 1 ) disp += 2;
+            lastType = pTypes[i];
+            lastExtent = lastType->ub - lastType->lb;
+            lastBlock = pBlockLength[i];
+            lastDisp = pDisp[i];
+            endto = lastDisp + lastExtent * lastBlock;
+        }
+    }
+    disp += lastType->desc.used;
+    if( lastBlock != 1 ) disp += 2;
+
+    pdt = ocoms_datatype_create( (int32_t)disp );
+
+    /* same scan, adding the merged fields */
+    lastType = pTypes[0];
+    lastBlock = pBlockLength[0];
+    lastExtent = lastType->ub - lastType->lb;
+    lastDisp = pDisp[0];
+    endto = pDisp[0] + lastExtent * lastBlock;
+    for( i = 1; i < count; i++ ) {
+        if( (pTypes[i] == lastType) && (pDisp[i] == endto) ) {
+            lastBlock += pBlockLength[i];
+            endto = lastDisp + lastBlock * lastExtent;
+        } else {
+            rc = ocoms_datatype_add( pdt, lastType, lastBlock, lastDisp, lastExtent );
+            if( OCOMS_SUCCESS != rc ) goto error;
+            lastType = pTypes[i];
+            lastExtent = lastType->ub - lastType->lb;
+            lastBlock = pBlockLength[i];
+            lastDisp = pDisp[i];
+            endto = lastDisp + lastExtent * lastBlock;
+        }
+    }
+    rc = ocoms_datatype_add( pdt, lastType, lastBlock, lastDisp, lastExtent );
+    if( OCOMS_SUCCESS != rc ) goto error;
+
+    *newType = pdt;
+    return OCOMS_SUCCESS;
+
+ error:
+    OBJ_RELEASE( pdt );
+    return rc;
+}
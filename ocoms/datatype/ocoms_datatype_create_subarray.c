@@ -0,0 +1,191 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
+ *                         University Research and Technology
+ *                         Corporation.  All rights reserved.
+ * Copyright (c) 2004-2010 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
+ *                         University of Stuttgart.  All rights reserved.
+ * Copyright (c) 2004-2006 The Regents of the University of California.
+ *                         All rights reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/datatype/ocoms_datatype.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+
+/*
+ * Remove the empty intervals of a dimension and merge the ones following
+ * each other. Return true if what remains is the whole dimension.
+ */
+static bool ocoms_datatype_dim_compact( ocoms_datatype_dim_t* dim )
+{
+    int i, count = 0;
+
+    for( i = 0; i < dim->count; i++ ) {
+        if( 0 == dim->length[i] ) continue;
+        if( (count > 0) && ((dim->start[count-1] + dim->length[count-1]) == dim->start[i]) &&
+            ((dim->length[count-1] + dim->length[i]) <= INT_MAX) ) {
+            dim->length[count-1] += dim->length[i];
+            continue;
+        }
+        dim->start[count]  = dim->start[i];
+        dim->length[count] = dim->length[i];
+        count++;
+    }
+    dim->count = count;
+    return (1 == count) && (0 == dim->start[0]) && (dim->size == dim->length[0]);
+}
+
+/* A whole dimension folds in the previous one if its intervals stay in an int */
+static bool ocoms_datatype_dim_can_fold( const ocoms_datatype_dim_t* dim, OCOMS_PTRDIFF_TYPE factor )
+{
+    int i;
+
+    for( i = 0; i < dim->count; i++ )
+        if( dim->length[i] > (INT_MAX / factor) ) return false;
+    return true;
+}
+
+/*
+ * Build the datatype selecting the intervals of each dimension of an array
+ * of oldType, dims[0] being the slowest varying dimension. The dimensions
+ * are first flattened: the dimensions of size 1 are dropped and the ones
+ * selected as a whole are folded into the previous dimension, so a
+ * dimension only costs a loop when it really breaks the contiguity. Then
+ * each dimension becomes an indexed datatype of the rows of the inner
+ * dimensions, where the regular runs of intervals are a single loop.
+ *
+ * The dimensions are modified, but the arrays of intervals still belong to
+ * the caller. The extent of the datatype is the extent of the array.
+ */
+int32_t ocoms_datatype_create_dims( int ndims, ocoms_datatype_dim_t* dims,
+                                    const ocoms_datatype_t* oldType,
+                                    ocoms_datatype_t** newType )
+{
+    OCOMS_PTRDIFF_TYPE extent = oldType->ub - oldType->lb, row_extent;
+    const ocoms_datatype_t* pRow = oldType;
+    ocoms_datatype_block_t* blocks = NULL;
+    ocoms_datatype_t *pdt = NULL, *pPrev = NULL;
+    int d, i, k, max_count = 1;
+    bool empty = false;
+    int32_t rc = OCOMS_SUCCESS;
+
+    for( d = 0, k = 0; d < ndims; d++ ) {
+        extent *= dims[d].size;
+        if( !ocoms_datatype_dim_compact( &dims[d] ) ) {
+            if( 0 == dims[d].count ) empty = true;
+        } else if( 1 == dims[d].size ) {
+            continue;
+        } else if( (k > 0) && ocoms_datatype_dim_can_fold( &dims[k-1], dims[d].size ) ) {
+            dims[k-1].size *= dims[d].size;
+            for( i = 0; i < dims[k-1].count; i++ ) {
+                dims[k-1].start[i]  *= dims[d].size;
+                dims[k-1].length[i] *= dims[d].size;
+            }
+            continue;
+        }
+        if( dims[d].count > max_count ) max_count = dims[d].count;
+        dims[k++] = dims[d];
+    }
+
+    if( empty ) {
+        pdt = ocoms_datatype_create( 0 );
+        ocoms_datatype_add( pdt, &ocoms_datatype_empty, 0, 0, 0 );
+        goto resize;
+    }
+    if( 0 == k ) {  /* a single element */
+        pdt = ocoms_datatype_create( oldType->desc.used );
+        rc = ocoms_datatype_add( pdt, oldType, 1, 0, oldType->ub - oldType->lb );
+        if( OCOMS_SUCCESS != rc ) goto error;
+        goto resize;
+    }
+
+    blocks = (ocoms_datatype_block_t*)malloc( sizeof(ocoms_datatype_block_t) * max_count );
+    if( NULL == blocks ) return OCOMS_ERR_OUT_OF_RESOURCE;
+
+    row_extent = oldType->ub - oldType->lb;
+    for( d = k - 1; d >= 0; d-- ) {
+        for( i = 0; i < dims[d].count; i++ ) {
+            blocks[i].disp   = dims[d].start[i] * row_extent;
+            blocks[i].length = (int)dims[d].length[i];
+        }
+        pdt = ocoms_datatype_create( dims[d].count * (2 + pRow->desc.used) );
+        rc = ocoms_datatype_add_blocks( pdt, pRow, blocks, dims[d].count );
+        if( NULL != pPrev ) OBJ_RELEASE( pPrev );
+        if( OCOMS_SUCCESS != rc ) goto error;
+        row_extent *= dims[d].size;
+        /* the next dimension repeats the whole rows of this one */
+        ocoms_datatype_resize( pdt, 0, row_extent );
+        pRow = pPrev = pdt;
+    }
+    free( blocks );
+
+ resize:
+    ocoms_datatype_resize( pdt, 0, extent );
+    *newType = pdt;
+    return OCOMS_SUCCESS;
+
+ error:
+    free( blocks );
+    OBJ_RELEASE( pdt );
+    return rc;
+}
+
+int32_t ocoms_datatype_create_subarray( int ndims, const int* pSizes, const int* pSubSizes,
+                                        const int* pStarts, int order,
+                                        const ocoms_datatype_t* oldType,
+                                        ocoms_datatype_t** newType )
+{
+    ocoms_datatype_dim_t* dims;
+    OCOMS_PTRDIFF_TYPE* intervals;
+    int i, d;
+    int32_t rc;
+
+    if( (ndims < 1) ||
+        ((OCOMS_DATATYPE_ORDER_C != order) && (OCOMS_DATATYPE_ORDER_FORTRAN != order)) )
+        return OCOMS_ERR_BAD_PARAM;
+    for( i = 0; i < ndims; i++ ) {
+        if( (pSizes[i] < 1) || (pSubSizes[i] < 0) || (pStarts[i] < 0) ||
+            (pStarts[i] > (pSizes[i] - pSubSizes[i])) )
+            return OCOMS_ERR_BAD_PARAM;
+    }
+
+    dims = (ocoms_datatype_dim_t*)malloc( sizeof(ocoms_datatype_dim_t) * ndims );
+    intervals = (OCOMS_PTRDIFF_TYPE*)malloc( sizeof(OCOMS_PTRDIFF_TYPE) * 2 * ndims );
+    if( (NULL == dims) || (NULL == intervals) ) {
+        free( dims );
+        free( intervals );
+        return OCOMS_ERR_OUT_OF_RESOURCE;
+    }
+
+    for( i = 0; i < ndims; i++ ) {
+        /* in Fortran order the first dimension is the fastest varying */
+        d = (OCOMS_DATATYPE_ORDER_C == order) ? i : (ndims - 1 - i);
+        dims[d].size   = pSizes[i];
+        dims[d].count  = 1;
+        dims[d].start  = &intervals[2 * d];
+        dims[d].length = &intervals[2 * d + 1];
+        dims[d].start[0]  = pStarts[i];
+        dims[d].length[0] = pSubSizes[i];
+    }
+
+    rc = ocoms_datatype_create_dims( ndims, dims, oldType, newType );
+    free( intervals );
+    free( dims );
+    return rc;
+}
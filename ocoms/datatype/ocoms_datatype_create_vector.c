@@ -0,0 +1,77 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
+ *                         University Research and Technology
+ *                         Corporation.  All rights reserved.
+ * Copyright (c) 2004-2010 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
+ *                         University of Stuttgart.  All rights reserved.
+ * Copyright (c) 2004-2006 The Regents of the University of California.
+ *                         All rights reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/datatype/ocoms_datatype.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+
+/*
+ * A vector is described by a single loop: the elements of a block are
+ * first gathered in a contiguous datatype (unless there is only one of
+ * them), which is then repeated with the stride of the vector. The
+ * contiguous cases collapse into one element.
+ */
+int32_t ocoms_datatype_create_hvector( int count, int bLength, OCOMS_PTRDIFF_TYPE stride,
+                                       const ocoms_datatype_t* oldType,
+                                       ocoms_datatype_t** newType )
+{
+    ocoms_datatype_t *pTempData, *pData;
+    OCOMS_PTRDIFF_TYPE extent = oldType->ub - oldType->lb;
+    int32_t rc;
+
+    if( (0 == count) || (0 == bLength) ) {
+        pData = ocoms_datatype_create( 0 );
+        ocoms_datatype_add( pData, &ocoms_datatype_empty, 0, 0, 0 );
+        *newType = pData;
+        return OCOMS_SUCCESS;
+    }
+
+    pData = ocoms_datatype_create( oldType->desc.used + 2 );
+    if( ((extent * bLength) == stride) || (1 >= count) ) {  /* the elements are contiguous */
+        rc = ocoms_datatype_add( pData, oldType, count * bLength, 0, extent );
+    } else if( 1 == bLength ) {
+        rc = ocoms_datatype_add( pData, oldType, count, 0, stride );
+    } else {
+        rc = ocoms_datatype_add( pData, oldType, bLength, 0, extent );
+        if( OCOMS_SUCCESS == rc ) {
+            pTempData = pData;
+            pData = ocoms_datatype_create( oldType->desc.used + 2 + 2 );
+            rc = ocoms_datatype_add( pData, pTempData, count, 0, stride );
+            OBJ_RELEASE( pTempData );
+        }
+    }
+    if( OCOMS_SUCCESS != rc ) {
+        OBJ_RELEASE( pData );
+        return rc;
+    }
+    *newType = pData;
+    return OCOMS_SUCCESS;
+}
+
+int32_t ocoms_datatype_create_vector( int count, int bLength, int stride,
+                                      const ocoms_datatype_t* oldType,
+                                      ocoms_datatype_t** newType )
+{
+    return ocoms_datatype_create_hvector( count, bLength,
+                                          stride * (oldType->ub - oldType->lb),
+                                          oldType, newType );
+}
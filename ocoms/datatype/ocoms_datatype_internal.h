@@ -478,5 +478,87 @@ OCOMS_DECLSPEC int ocoms_datatype_contain_basic_datatypes( const struct ocoms_da
 OCOMS_DECLSPEC int ocoms_datatype_dump_data_flags( unsigned short usflags, char* ptr, size_t length );
 OCOMS_DECLSPEC int ocoms_datatype_dump_data_desc( union dt_elem_desc* pDesc, int nbElems, char* ptr, size_t length );
 
+/*
+ * The pack plan is the optimized description of a committed datatype
+ * flattened into a list of runs, each of them count blocks of blength
+ * bytes, stride bytes apart. The runs are stored in the order of the
+ * packed data, so the homogeneous pack and unpack can copy them one
+ * after the other without walking the loops of the description.
+ */
+struct ocoms_datatype_plan_run_t {
+    OCOMS_PTRDIFF_TYPE disp;     /**< displacement of the first block */
+    OCOMS_PTRDIFF_TYPE stride;   /**< distance between the blocks */
+    size_t             blength;  /**< length of each block in bytes */
+    size_t             count;    /**< number of blocks */
+    size_t             packed;   /**< packed bytes in the datatype before this run */
+};
+typedef struct ocoms_datatype_plan_run_t ocoms_datatype_plan_run_t;
+
+struct ocoms_datatype_plan_t {
+    uint32_t                  used;     /**< number of runs */
+    ocoms_datatype_plan_run_t runs[1];  /**< the runs, allocated with the plan */
+};
+typedef struct ocoms_datatype_plan_t ocoms_datatype_plan_t;
+
+/* Plans with more runs are not built, 0 disables the plans */
+OCOMS_DECLSPEC extern size_t ocoms_datatype_plan_max_runs;
+
+int32_t ocoms_datatype_plan_build( struct ocoms_datatype_t* pData );
+void ocoms_datatype_plan_release( struct ocoms_datatype_t* pData );
+
+/*
+ * The position index is a sparse list of checkpoints on the top level of
+ * the optimized description, one every OCOMS_DATATYPE_POSITION_STRIDE
+ * entries, each recording the packed bytes in the datatype before the
+ * entry. It lets the generic position jump over the long irregular
+ * descriptions instead of walking them element by element. The last
+ * checkpoint designates the fake OCOMS_DATATYPE_END_LOOP.
+ */
+#define OCOMS_DATATYPE_POSITION_STRIDE 32
+
+struct ocoms_datatype_checkpoint_t {
+    uint32_t index;   /**< top level entry of the optimized description */
+    size_t   packed;  /**< packed bytes in the datatype before this entry */
+};
+typedef struct ocoms_datatype_checkpoint_t ocoms_datatype_checkpoint_t;
+
+struct ocoms_datatype_position_index_t {
+    uint32_t                    used;            /**< number of checkpoints */
+    ocoms_datatype_checkpoint_t checkpoints[1];  /**< the checkpoints, allocated with the index */
+};
+typedef struct ocoms_datatype_position_index_t ocoms_datatype_position_index_t;
+
+int32_t ocoms_datatype_position_index_build( struct ocoms_datatype_t* pData );
+void ocoms_datatype_position_index_release( struct ocoms_datatype_t* pData );
+
+/*
+ * Blocks of consecutive elements of a datatype, used by the constructors
+ * to detect the regular runs of blocks that can be described by a loop.
+ */
+struct ocoms_datatype_block_t {
+    OCOMS_PTRDIFF_TYPE disp;    /**< displacement of the block in bytes */
+    int                length;  /**< number of elements in the block */
+};
+typedef struct ocoms_datatype_block_t ocoms_datatype_block_t;
+
+int32_t ocoms_datatype_add_blocks( struct ocoms_datatype_t* pdt, const struct ocoms_datatype_t* oldType,
+                                   const ocoms_datatype_block_t* blocks, int nblocks );
+
+/*
+ * A dimension of a multidimensional array, and the intervals of it
+ * selected by a subarray or a distributed array.
+ */
+struct ocoms_datatype_dim_t {
+    OCOMS_PTRDIFF_TYPE  size;    /**< number of elements in the dimension */
+    int                 count;   /**< number of intervals */
+    OCOMS_PTRDIFF_TYPE* start;   /**< first element of each interval */
+    OCOMS_PTRDIFF_TYPE* length;  /**< number of elements of each interval */
+};
+typedef struct ocoms_datatype_dim_t ocoms_datatype_dim_t;
+
+int32_t ocoms_datatype_create_dims( int ndims, ocoms_datatype_dim_t* dims,
+                                    const struct ocoms_datatype_t* oldType,
+                                    struct ocoms_datatype_t** newType );
+
 END_C_DECLS
 #endif  /* OCOMS_DATATYPE_INTERNAL_H_HAS_BEEN_INCLUDED */
@@ -0,0 +1,379 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stddef.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/primitives/prefetch.h"
+#include "ocoms/datatype/ocoms_datatype_memcpy.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OCOMS_DATATYPE_MEMCPY_X86 1
+#include <immintrin.h>
+#else
+#define OCOMS_DATATYPE_MEMCPY_X86 0
+#endif
+
+/*
+ * The copy used for the data moved by the datatype engine.
+ *
+ * Every variant copies the small blocks (up to 64 bytes) inline, as
+ * two possibly overlapping moves of the largest power of two that
+ * fits, and leaves the medium sizes to the libc.  The x86 variants
+ * write the copies larger than the non-temporal threshold, by default
+ * the size of the last level cache, with streaming stores: such a copy
+ * would evict the whole cache anyway, and the packed data is usually
+ * not read again by the CPU.
+ */
+
+int ocoms_datatype_memcpy_variant = OCOMS_DATATYPE_MEMCPY_AUTO;
+size_t ocoms_datatype_memcpy_nt_threshold = 0;
+
+static void* ocoms_datatype_memcpy_libc( void* dst, const void* src, size_t len )
+{
+    return memcpy( dst, src, len );
+}
+
+ocoms_datatype_memcpy_fn_t ocoms_datatype_memcpy = ocoms_datatype_memcpy_libc;
+
+ocoms_datatype_strided_fn_t ocoms_datatype_gather4 = NULL;
+ocoms_datatype_strided_fn_t ocoms_datatype_scatter4 = NULL;
+ocoms_datatype_strided_fn_t ocoms_datatype_gather8 = NULL;
+ocoms_datatype_strided_fn_t ocoms_datatype_scatter8 = NULL;
+
+/* the non-temporal threshold once ocoms_datatype_memcpy_init() ran */
+static size_t ocoms_datatype_memcpy_nt_size = (size_t)-1;
+
+typedef struct {
+    uint64_t v[4];
+} ocoms_datatype_block32_t;
+
+#define OCOMS_DATATYPE_MOVE( DST, SRC, TYPE )                           \
+    do {                                                                \
+        TYPE _v;                                                        \
+        memcpy( &_v, (SRC), sizeof(TYPE) );                             \
+        memcpy( (DST), &_v, sizeof(TYPE) );                             \
+    } while (0)
+
+/* copy len <= 64 bytes, the moves are as wide as the caller's target allows */
+static inline void
+ocoms_datatype_memcpy_small( unsigned char* dst, const unsigned char* src, size_t len )
+{
+    if( len >= 32 ) {
+        OCOMS_DATATYPE_MOVE( dst, src, ocoms_datatype_block32_t );
+        OCOMS_DATATYPE_MOVE( dst + len - 32, src + len - 32, ocoms_datatype_block32_t );
+    } else if( len >= 16 ) {
+        OCOMS_DATATYPE_MOVE( dst, src, ocoms_datatype_block16_t );
+        OCOMS_DATATYPE_MOVE( dst + len - 16, src + len - 16, ocoms_datatype_block16_t );
+    } else if( len >= 8 ) {
+        OCOMS_DATATYPE_MOVE( dst, src, uint64_t );
+        OCOMS_DATATYPE_MOVE( dst + len - 8, src + len - 8, uint64_t );
+    } else if( len >= 4 ) {
+        OCOMS_DATATYPE_MOVE( dst, src, uint32_t );
+        OCOMS_DATATYPE_MOVE( dst + len - 4, src + len - 4, uint32_t );
+    } else if( len >= 2 ) {
+        OCOMS_DATATYPE_MOVE( dst, src, uint16_t );
+        OCOMS_DATATYPE_MOVE( dst + len - 2, src + len - 2, uint16_t );
+    } else if( len ) {
+        *dst = *src;
+    }
+}
+
+static void* ocoms_datatype_memcpy_generic( void* dst, const void* src, size_t len )
+{
+    if( len <= 64 ) {
+        ocoms_datatype_memcpy_small( (unsigned char*)dst, (const unsigned char*)src, len );
+        return dst;
+    }
+    return memcpy( dst, src, len );
+}
+
+#if OCOMS_DATATYPE_MEMCPY_X86
+/* Body of a streaming copy: the destination is first aligned on a cache
+ * line, then written with non-temporal stores of VEC bytes, 4 per
+ * iteration.  The source is prefetched a few lines ahead, the hardware
+ * prefetcher does not cross pages. */
+#define OCOMS_DATATYPE_MEMCPY_STREAM( VEC, TYPE, LOAD, STORE )           \
+    do {                                                                \
+        unsigned char* _d = (unsigned char*)dst;                        \
+        const unsigned char* _s = (const unsigned char*)src;            \
+        size_t _head = (64 - ((uintptr_t)_d & 63)) & 63;                \
+        TYPE _v0, _v1, _v2, _v3;                                        \
+        ocoms_datatype_memcpy_small( _d, _s, _head );                   \
+        _d += _head; _s += _head; len -= _head;                         \
+        for( ; len >= 4 * (VEC); len -= 4 * (VEC) ) {                   \
+            OCOMS_PREFETCH( _s + 512, 0, 0 );                           \
+            _v0 = LOAD( (const TYPE*)(_s) );                            \
+            _v1 = LOAD( (const TYPE*)(_s + (VEC)) );                    \
+            _v2 = LOAD( (const TYPE*)(_s + 2 * (VEC)) );                \
+            _v3 = LOAD( (const TYPE*)(_s + 3 * (VEC)) );                \
+            STORE( (TYPE*)(_d), _v0 );                                  \
+            STORE( (TYPE*)(_d + (VEC)), _v1 );                          \
+            STORE( (TYPE*)(_d + 2 * (VEC)), _v2 );                      \
+            STORE( (TYPE*)(_d + 3 * (VEC)), _v3 );                      \
+            _s += 4 * (VEC); _d += 4 * (VEC);                           \
+        }                                                               \
+        _mm_sfence();                                                   \
+        memcpy( _d, _s, len );                                          \
+    } while (0)
+
+__attribute__((target("sse2")))
+static void* ocoms_datatype_memcpy_sse2( void* dst, const void* src, size_t len )
+{
+    if( len <= 64 ) {
+        ocoms_datatype_memcpy_small( (unsigned char*)dst, (const unsigned char*)src, len );
+    } else if( len < ocoms_datatype_memcpy_nt_size ) {
+        memcpy( dst, src, len );
+    } else {
+        OCOMS_DATATYPE_MEMCPY_STREAM( 16, __m128i, _mm_loadu_si128, _mm_stream_si128 );
+    }
+    return dst;
+}
+
+__attribute__((target("avx2")))
+static void* ocoms_datatype_memcpy_avx2( void* dst, const void* src, size_t len )
+{
+    if( len <= 64 ) {
+        ocoms_datatype_memcpy_small( (unsigned char*)dst, (const unsigned char*)src, len );
+    } else if( len < ocoms_datatype_memcpy_nt_size ) {
+        memcpy( dst, src, len );
+    } else {
+        OCOMS_DATATYPE_MEMCPY_STREAM( 32, __m256i, _mm256_loadu_si256, _mm256_stream_si256 );
+    }
+    return dst;
+}
+
+#define OCOMS_DATATYPE_LOADU512( P )    _mm512_loadu_si512( (const void*)(P) )
+#define OCOMS_DATATYPE_STREAM512( P, V ) _mm512_stream_si512( (void*)(P), (V) )
+
+__attribute__((target("avx512f")))
+static void* ocoms_datatype_memcpy_avx512( void* dst, const void* src, size_t len )
+{
+    if( len <= 64 ) {
+        ocoms_datatype_memcpy_small( (unsigned char*)dst, (const unsigned char*)src, len );
+    } else if( len < ocoms_datatype_memcpy_nt_size ) {
+        memcpy( dst, src, len );
+    } else {
+        OCOMS_DATATYPE_MEMCPY_STREAM( 64, __m512i, OCOMS_DATATYPE_LOADU512, OCOMS_DATATYPE_STREAM512 );
+    }
+    return dst;
+}
+
+/* Kernels of ocoms_datatype_strided_copy(), built for their instruction
+ * set whatever the compiler targets and selected at runtime.  The 32
+ * bits gather/scatter indexes must hold lanes * stride. */
+#define OCOMS_DATATYPE_STRIDE_FITS_INT32( STRIDE, LANES )               \
+    (((STRIDE) < 0 ? -(STRIDE) : (STRIDE)) <= (OCOMS_PTRDIFF_TYPE)(INT32_MAX / (LANES)))
+
+__attribute__((target("avx512f")))
+static size_t
+ocoms_datatype_gather8_avx512( unsigned char* dst, const unsigned char* src,
+                               OCOMS_PTRDIFF_TYPE stride, size_t count )
+{
+    const __m512i idx = _mm512_setr_epi64( 0, stride, 2 * stride, 3 * stride,
+                                           4 * stride, 5 * stride, 6 * stride, 7 * stride );
+    size_t i;
+
+    for( i = 0; i + 8 <= count; i += 8 ) {
+        _mm512_storeu_si512( (void*)(dst + 8 * i), _mm512_i64gather_epi64( idx, (const void*)src, 1 ) );
+        src += 8 * stride;
+    }
+    return i;
+}
+
+__attribute__((target("avx512f")))
+static size_t
+ocoms_datatype_scatter8_avx512( unsigned char* dst, const unsigned char* src,
+                                OCOMS_PTRDIFF_TYPE stride, size_t count )
+{
+    const __m512i idx = _mm512_setr_epi64( 0, stride, 2 * stride, 3 * stride,
+                                           4 * stride, 5 * stride, 6 * stride, 7 * stride );
+    size_t i;
+
+    for( i = 0; i + 8 <= count; i += 8 ) {
+        _mm512_i64scatter_epi64( (void*)dst, idx, _mm512_loadu_si512( (const void*)(src + 8 * i) ), 1 );
+        dst += 8 * stride;
+    }
+    return i;
+}
+
+__attribute__((target("avx512f")))
+static size_t
+ocoms_datatype_gather4_avx512( unsigned char* dst, const unsigned char* src,
+                               OCOMS_PTRDIFF_TYPE stride, size_t count )
+{
+    const int32_t s = (int32_t)stride;
+    const __m512i idx = _mm512_setr_epi32( 0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s,
+                                           8 * s, 9 * s, 10 * s, 11 * s, 12 * s, 13 * s,
+                                           14 * s, 15 * s );
+    size_t i;
+
+    if( !OCOMS_DATATYPE_STRIDE_FITS_INT32(stride, 16) ) return 0;
+    for( i = 0; i + 16 <= count; i += 16 ) {
+        _mm512_storeu_si512( (void*)(dst + 4 * i), _mm512_i32gather_epi32( idx, (const void*)src, 1 ) );
+        src += 16 * stride;
+    }
+    return i;
+}
+
+__attribute__((target("avx512f")))
+static size_t
+ocoms_datatype_scatter4_avx512( unsigned char* dst, const unsigned char* src,
+                                OCOMS_PTRDIFF_TYPE stride, size_t count )
+{
+    const int32_t s = (int32_t)stride;
+    const __m512i idx = _mm512_setr_epi32( 0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s,
+                                           8 * s, 9 * s, 10 * s, 11 * s, 12 * s, 13 * s,
+                                           14 * s, 15 * s );
+    size_t i;
+
+    if( !OCOMS_DATATYPE_STRIDE_FITS_INT32(stride, 16) ) return 0;
+    for( i = 0; i + 16 <= count; i += 16 ) {
+        _mm512_i32scatter_epi32( (void*)dst, idx, _mm512_loadu_si512( (const void*)(src + 4 * i) ), 1 );
+        dst += 16 * stride;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t
+ocoms_datatype_gather8_avx2( unsigned char* dst, const unsigned char* src,
+                             OCOMS_PTRDIFF_TYPE stride, size_t count )
+{
+    const __m256i idx = _mm256_setr_epi64x( 0, stride, 2 * stride, 3 * stride );
+    size_t i;
+
+    for( i = 0; i + 4 <= count; i += 4 ) {
+        _mm256_storeu_si256( (__m256i*)(dst + 8 * i),
+                             _mm256_i64gather_epi64( (const long long*)src, idx, 1 ) );
+        src += 4 * stride;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t
+ocoms_datatype_gather4_avx2( unsigned char* dst, const unsigned char* src,
+                             OCOMS_PTRDIFF_TYPE stride, size_t count )
+{
+    const int32_t s = (int32_t)stride;
+    const __m256i idx = _mm256_setr_epi32( 0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s );
+    size_t i;
+
+    if( !OCOMS_DATATYPE_STRIDE_FITS_INT32(stride, 8) ) return 0;
+    for( i = 0; i + 8 <= count; i += 8 ) {
+        _mm256_storeu_si256( (__m256i*)(dst + 4 * i),
+                             _mm256_i32gather_epi32( (const int*)src, idx, 1 ) );
+        src += 8 * stride;
+    }
+    return i;
+}
+#endif  /* OCOMS_DATATYPE_MEMCPY_X86 */
+
+/* size of the last level cache, 0 if unknown */
+static size_t ocoms_datatype_llc_size( void )
+{
+    long size = 0;
+
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    size = sysconf( _SC_LEVEL3_CACHE_SIZE );
+#endif
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    if( size <= 0 ) size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+    return (size > 0) ? (size_t)size : 0;
+}
+
+static int ocoms_datatype_memcpy_supported( int variant )
+{
+    switch( variant ) {
+    case OCOMS_DATATYPE_MEMCPY_LIBC:
+    case OCOMS_DATATYPE_MEMCPY_GENERIC:
+        return 1;
+#if OCOMS_DATATYPE_MEMCPY_X86
+    case OCOMS_DATATYPE_MEMCPY_SSE2:
+        return __builtin_cpu_supports( "sse2" );
+    case OCOMS_DATATYPE_MEMCPY_AVX2:
+        return __builtin_cpu_supports( "avx2" );
+    case OCOMS_DATATYPE_MEMCPY_AVX512:
+        return __builtin_cpu_supports( "avx512f" );
+#endif  /* OCOMS_DATATYPE_MEMCPY_X86 */
+    }
+    return 0;
+}
+
+int32_t ocoms_datatype_memcpy_init( void )
+{
+    int variant = ocoms_datatype_memcpy_variant;
+
+    ocoms_datatype_memcpy_nt_size = ocoms_datatype_memcpy_nt_threshold;
+    if( 0 == ocoms_datatype_memcpy_nt_size ) {
+        ocoms_datatype_memcpy_nt_size = ocoms_datatype_llc_size();
+        if( 0 == ocoms_datatype_memcpy_nt_size ) {
+            ocoms_datatype_memcpy_nt_size = (size_t)-1;
+        }
+    }
+
+    if( OCOMS_DATATYPE_MEMCPY_AUTO == variant ) {
+        for( variant = OCOMS_DATATYPE_MEMCPY_AVX512; variant > OCOMS_DATATYPE_MEMCPY_GENERIC; variant-- ) {
+            if( ocoms_datatype_memcpy_supported( variant ) ) break;
+        }
+    } else if( !ocoms_datatype_memcpy_supported( variant ) ) {
+        /* not for this processor, keep the libc */
+        variant = OCOMS_DATATYPE_MEMCPY_LIBC;
+    }
+
+    switch( variant ) {
+#if OCOMS_DATATYPE_MEMCPY_X86
+    case OCOMS_DATATYPE_MEMCPY_AVX512:
+        ocoms_datatype_memcpy = ocoms_datatype_memcpy_avx512;
+        break;
+    case OCOMS_DATATYPE_MEMCPY_AVX2:
+        ocoms_datatype_memcpy = ocoms_datatype_memcpy_avx2;
+        break;
+    case OCOMS_DATATYPE_MEMCPY_SSE2:
+        ocoms_datatype_memcpy = ocoms_datatype_memcpy_sse2;
+        break;
+#endif  /* OCOMS_DATATYPE_MEMCPY_X86 */
+    case OCOMS_DATATYPE_MEMCPY_GENERIC:
+        ocoms_datatype_memcpy = ocoms_datatype_memcpy_generic;
+        break;
+    default:
+        ocoms_datatype_memcpy = ocoms_datatype_memcpy_libc;
+        variant = OCOMS_DATATYPE_MEMCPY_LIBC;
+    }
+    ocoms_datatype_memcpy_variant = variant;
+
+    /* the strided kernels only depend on the processor, AVX2 has no scatter */
+    ocoms_datatype_gather4 = ocoms_datatype_scatter4 = NULL;
+    ocoms_datatype_gather8 = ocoms_datatype_scatter8 = NULL;
+#if OCOMS_DATATYPE_MEMCPY_X86
+    if( __builtin_cpu_supports( "avx512f" ) ) {
+        ocoms_datatype_gather4 = ocoms_datatype_gather4_avx512;
+        ocoms_datatype_scatter4 = ocoms_datatype_scatter4_avx512;
+        ocoms_datatype_gather8 = ocoms_datatype_gather8_avx512;
+        ocoms_datatype_scatter8 = ocoms_datatype_scatter8_avx512;
+    } else if( __builtin_cpu_supports( "avx2" ) ) {
+        ocoms_datatype_gather4 = ocoms_datatype_gather4_avx2;
+        ocoms_datatype_gather8 = ocoms_datatype_gather8_avx2;
+    }
+#endif  /* OCOMS_DATATYPE_MEMCPY_X86 */
+    return OCOMS_SUCCESS;
+}
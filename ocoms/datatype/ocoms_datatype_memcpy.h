@@ -16,7 +16,179 @@
 #ifndef OCOMS_DATATYPE_MEMCPY_H_HAS_BEEN_INCLUDED
 #define OCOMS_DATATYPE_MEMCPY_H_HAS_BEEN_INCLUDED
 
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stddef.h>
+#include <string.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "ocoms/primitives/prefetch.h"
+
+BEGIN_C_DECLS
+
+/**
+ * Copy variants, selected by ocoms_datatype_memcpy_init() from the
+ * ddt_memcpy MCA variable and the processor features.
+ */
+enum {
+    OCOMS_DATATYPE_MEMCPY_AUTO = 0,     /**< best supported by the processor */
+    OCOMS_DATATYPE_MEMCPY_LIBC,         /**< memcpy from the libc */
+    OCOMS_DATATYPE_MEMCPY_GENERIC,      /**< inline small copies, libc otherwise */
+    OCOMS_DATATYPE_MEMCPY_SSE2,         /**< generic + SSE2 streaming stores */
+    OCOMS_DATATYPE_MEMCPY_AVX2,         /**< generic + AVX2 streaming stores */
+    OCOMS_DATATYPE_MEMCPY_AVX512        /**< generic + AVX-512 streaming stores */
+};
+
+typedef void* (*ocoms_datatype_memcpy_fn_t)( void* dst, const void* src, size_t len );
+
+/** The copy in use, memcpy from the libc until ocoms_datatype_init() */
+OCOMS_DECLSPEC extern ocoms_datatype_memcpy_fn_t ocoms_datatype_memcpy;
+/** Requested variant (MCA ddt_memcpy), the selected one after init */
+OCOMS_DECLSPEC extern int ocoms_datatype_memcpy_variant;
+/** Copies of at least this size bypass the cache, 0 for the size of the
+ *  last level cache (MCA ddt_memcpy_nt_threshold) */
+OCOMS_DECLSPEC extern size_t ocoms_datatype_memcpy_nt_threshold;
+
+/**
+ * Select the copy function, called by ocoms_datatype_init().
+ */
+int32_t ocoms_datatype_memcpy_init( void );
+
+END_C_DECLS
+
 #define MEMCPY( DST, SRC, BLENGTH ) \
-    memcpy( (DST), (SRC), (BLENGTH) )
+    ocoms_datatype_memcpy( (DST), (SRC), (BLENGTH) )
+
+/*
+ * Strided copies of small blocks.
+ *
+ * A vector of predefined types with gaps (a column of a matrix, for
+ * instance) is packed one element at a time, and for elements of a few
+ * bytes the call to memcpy costs far more than the copy itself.  The
+ * functions below copy count blocks of a fixed size with a constant
+ * stride on each side, using plain loads and stores of the block size
+ * and, when the processor supports them, the AVX2 gather and AVX-512
+ * gather/scatter instructions.
+ */
+
+#define OCOMS_DATATYPE_STRIDED_MAX_BLENGTH 16
+
+typedef struct {
+    uint64_t v[2];
+} ocoms_datatype_block16_t;
+
+/* elements ahead of the current one the strided loop prefetches */
+#define OCOMS_DATATYPE_STRIDED_PREFETCH 16
+
+/* copy blocks of sizeof(TYPE) bytes, memcpy of a constant size turns
+ * into a single load and store without any alignment requirement.  The
+ * source of long runs with a stride over a cache line is prefetched,
+ * the hardware prefetcher stops at page boundaries */
+#define OCOMS_DATATYPE_STRIDED_LOOP( TYPE )                             \
+    do {                                                                \
+        TYPE _b0, _b1, _b2, _b3;                                        \
+        if( (count >= 4 * OCOMS_DATATYPE_STRIDED_PREFETCH) &&           \
+            ((src_stride > 64) || (src_stride < -64)) ) {               \
+            for( ; count >= 4; count -= 4 ) {                           \
+                OCOMS_PREFETCH( src + OCOMS_DATATYPE_STRIDED_PREFETCH * src_stride, 0, 0 ); \
+                OCOMS_PREFETCH( src + (OCOMS_DATATYPE_STRIDED_PREFETCH + 1) * src_stride, 0, 0 ); \
+                OCOMS_PREFETCH( src + (OCOMS_DATATYPE_STRIDED_PREFETCH + 2) * src_stride, 0, 0 ); \
+                OCOMS_PREFETCH( src + (OCOMS_DATATYPE_STRIDED_PREFETCH + 3) * src_stride, 0, 0 ); \
+                memcpy( &_b0, src,                  sizeof(TYPE) );     \
+                memcpy( &_b1, src + src_stride,     sizeof(TYPE) );     \
+                memcpy( &_b2, src + 2 * src_stride, sizeof(TYPE) );     \
+                memcpy( &_b3, src + 3 * src_stride, sizeof(TYPE) );     \
+                memcpy( dst,                  &_b0, sizeof(TYPE) );     \
+                memcpy( dst + dst_stride,     &_b1, sizeof(TYPE) );     \
+                memcpy( dst + 2 * dst_stride, &_b2, sizeof(TYPE) );     \
+                memcpy( dst + 3 * dst_stride, &_b3, sizeof(TYPE) );     \
+                src += 4 * src_stride;                                  \
+                dst += 4 * dst_stride;                                  \
+            }                                                           \
+        }                                                               \
+        for( ; count >= 4; count -= 4 ) {                               \
+            memcpy( &_b0, src,                  sizeof(TYPE) );         \
+            memcpy( &_b1, src + src_stride,     sizeof(TYPE) );         \
+            memcpy( &_b2, src + 2 * src_stride, sizeof(TYPE) );         \
+            memcpy( &_b3, src + 3 * src_stride, sizeof(TYPE) );         \
+            memcpy( dst,                  &_b0, sizeof(TYPE) );         \
+            memcpy( dst + dst_stride,     &_b1, sizeof(TYPE) );         \
+            memcpy( dst + 2 * dst_stride, &_b2, sizeof(TYPE) );         \
+            memcpy( dst + 3 * dst_stride, &_b3, sizeof(TYPE) );         \
+            src += 4 * src_stride;                                      \
+            dst += 4 * dst_stride;                                      \
+        }                                                               \
+        for( ; count > 0; count-- ) {                                   \
+            memcpy( dst, src, sizeof(TYPE) );                           \
+            src += src_stride;                                          \
+            dst += dst_stride;                                          \
+        }                                                               \
+    } while (0)
+
+/* Copy count blocks of 4 or 8 bytes between a strided side and a
+ * contiguous one with the AVX2 gather or the AVX-512 gather/scatter
+ * instructions, returning the number of blocks copied (possibly less
+ * than count, or 0 if the stride does not fit).  NULL when the
+ * processor lacks the instructions; set by ocoms_datatype_memcpy_init(). */
+typedef size_t (*ocoms_datatype_strided_fn_t)( unsigned char* dst, const unsigned char* src,
+                                               OCOMS_PTRDIFF_TYPE stride, size_t count );
+OCOMS_DECLSPEC extern ocoms_datatype_strided_fn_t ocoms_datatype_gather4;
+OCOMS_DECLSPEC extern ocoms_datatype_strided_fn_t ocoms_datatype_scatter4;
+OCOMS_DECLSPEC extern ocoms_datatype_strided_fn_t ocoms_datatype_gather8;
+OCOMS_DECLSPEC extern ocoms_datatype_strided_fn_t ocoms_datatype_scatter8;
+
+/**
+ * Copy count blocks of blength bytes, the source blocks being src_stride
+ * bytes apart and the destination blocks dst_stride bytes apart.  Only
+ * the sizes of the predefined types, 1, 2, 4, 8 and 16 bytes, are
+ * handled; the return value is 0 when the caller has to do the copy.
+ * The source and the destination must not overlap.
+ */
+static inline int
+ocoms_datatype_strided_copy( unsigned char* dst, OCOMS_PTRDIFF_TYPE dst_stride,
+                             const unsigned char* src, OCOMS_PTRDIFF_TYPE src_stride,
+                             size_t blength, size_t count )
+{
+    size_t done;
+
+    switch( blength ) {
+    case 1:
+        OCOMS_DATATYPE_STRIDED_LOOP( uint8_t );
+        return 1;
+    case 2:
+        OCOMS_DATATYPE_STRIDED_LOOP( uint16_t );
+        return 1;
+    case 4:
+        done = 0;
+        if( (4 == dst_stride) && (NULL != ocoms_datatype_gather4) ) {
+            done = ocoms_datatype_gather4( dst, src, src_stride, count );
+        } else if( (4 == src_stride) && (NULL != ocoms_datatype_scatter4) ) {
+            done = ocoms_datatype_scatter4( dst, src, dst_stride, count );
+        }
+        src += done * src_stride;
+        dst += done * dst_stride;
+        count -= done;
+        OCOMS_DATATYPE_STRIDED_LOOP( uint32_t );
+        return 1;
+    case 8:
+        done = 0;
+        if( (8 == dst_stride) && (NULL != ocoms_datatype_gather8) ) {
+            done = ocoms_datatype_gather8( dst, src, src_stride, count );
+        } else if( (8 == src_stride) && (NULL != ocoms_datatype_scatter8) ) {
+            done = ocoms_datatype_scatter8( dst, src, dst_stride, count );
+        }
+        src += done * src_stride;
+        dst += done * dst_stride;
+        count -= done;
+        OCOMS_DATATYPE_STRIDED_LOOP( uint64_t );
+        return 1;
+    case 16:
+        OCOMS_DATATYPE_STRIDED_LOOP( ocoms_datatype_block16_t );
+        return 1;
+    }
+    return 0;
+}
 
 #endif  /* OCOMS_DATATYPE_MEMCPY_H_HAS_BEEN_INCLUDED */
@@ -32,6 +32,9 @@
 #include "ocoms/datatype/ocoms_datatype_internal.h"
 #include "ocoms/datatype/ocoms_datatype.h"
 #include "ocoms/datatype/ocoms_convertor_internal.h"
+#include "ocoms/datatype/ocoms_datatype_checksum.h"
+#include "ocoms/datatype/ocoms_datatype_memcpy.h"
+#include "ocoms/datatype/ocoms_datatype_reduce.h"
 #include "ocoms/mca/base/mca_base_var.h"
 
 /* by default the debuging is turned off */
@@ -140,11 +143,125 @@ OCOMS_DECLSPEC const ocoms_datatype_t* ocoms_datatype_basicDatatypes[OCOMS_DATAT
 };
 
 
+static const ocoms_mca_base_var_enum_value_t ocoms_datatype_memcpy_values[] = {
+    {OCOMS_DATATYPE_MEMCPY_AUTO, "auto"},
+    {OCOMS_DATATYPE_MEMCPY_LIBC, "libc"},
+    {OCOMS_DATATYPE_MEMCPY_GENERIC, "generic"},
+    {OCOMS_DATATYPE_MEMCPY_SSE2, "sse2"},
+    {OCOMS_DATATYPE_MEMCPY_AVX2, "avx2"},
+    {OCOMS_DATATYPE_MEMCPY_AVX512, "avx512"},
+    {0, NULL}
+};
+
+static const ocoms_mca_base_var_enum_value_t ocoms_datatype_reduce_values[] = {
+    {OCOMS_DATATYPE_REDUCE_AUTO, "auto"},
+    {OCOMS_DATATYPE_REDUCE_GENERIC, "generic"},
+    {OCOMS_DATATYPE_REDUCE_AVX2, "avx2"},
+    {OCOMS_DATATYPE_REDUCE_AVX512, "avx512"},
+    {0, NULL}
+};
+
+static const ocoms_mca_base_var_enum_value_t ocoms_datatype_checksum_values[] = {
+    {OCOMS_CONVERTOR_CHECKSUM_SUM, "sum"},
+    {OCOMS_CONVERTOR_CHECKSUM_CRC32C, "crc32c"},
+    {OCOMS_CONVERTOR_CHECKSUM_FLETCHER64, "fletcher64"},
+    {0, NULL}
+};
+
 int ocoms_datatype_register_params(void)
 {
-#if OCOMS_ENABLE_DEBUG
+    ocoms_mca_base_var_enum_t *new_enum;
     int ret;
 
+    ret = ocoms_mca_base_var_enum_create ("ddt_memcpy", ocoms_datatype_memcpy_values, &new_enum);
+    if (OCOMS_SUCCESS != ret) {
+        return ret;
+    }
+    ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_memcpy",
+                                 "Copy routine used to pack and unpack data (auto: the best one "
+                                 "the processor supports, libc, generic, sse2, avx2 or avx512)",
+                                 MCA_BASE_VAR_TYPE_INT, new_enum, 0, 0, OCOMS_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &ocoms_datatype_memcpy_variant);
+    OBJ_RELEASE(new_enum);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_memcpy_nt_threshold",
+                                 "Size from which the copies bypass the cache with non-temporal "
+                                 "stores (0 = size of the last level cache)",
+                                 MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0, 0, OCOMS_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &ocoms_datatype_memcpy_nt_threshold);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = ocoms_mca_base_var_enum_create ("ddt_reduce", ocoms_datatype_reduce_values, &new_enum);
+    if (OCOMS_SUCCESS != ret) {
+        return ret;
+    }
+    ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_reduce",
+                                 "Kernels of the reduction operations (auto: the best ones the "
+                                 "processor supports, generic, avx2 or avx512)",
+                                 MCA_BASE_VAR_TYPE_INT, new_enum, 0, 0, OCOMS_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &ocoms_datatype_reduce_variant);
+    OBJ_RELEASE(new_enum);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = ocoms_mca_base_var_enum_create ("ddt_checksum", ocoms_datatype_checksum_values, &new_enum);
+    if (OCOMS_SUCCESS != ret) {
+        return ret;
+    }
+    ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_checksum",
+                                 "Checksum computed by the convertors checking the data integrity "
+                                 "(sum: sum of 32 bits words, crc32c or fletcher64)",
+                                 MCA_BASE_VAR_TYPE_INT, new_enum, 0, 0, OCOMS_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &ocoms_datatype_checksum_type);
+    OBJ_RELEASE(new_enum);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_pack_plan_max_runs",
+                                 "Largest number of runs in the flattened description built at commit "
+                                 "for the homogeneous pack and unpack (0 = always interpret the description)",
+                                 MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0, 0, OCOMS_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &ocoms_datatype_plan_max_runs);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_convertor_templates",
+                                 "Number of prepared convertors cached by each datatype, a convertor "
+                                 "prepared again with the same count is copied from the cache (0 = no cache)",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, 0, OCOMS_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &ocoms_convertor_template_max);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_pack_threads",
+                                 "Number of threads packing and unpacking the large messages whose "
+                                 "datatype has a pack plan, including the caller (1 = no helper thread). "
+                                 "Only used when the threads are enabled",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, 0, OCOMS_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &ocoms_convertor_parallel_threads);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_pack_segment_size",
+                                 "Size of the pieces of a message packed or unpacked by each thread, "
+                                 "messages smaller than two pieces are not split",
+                                 MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0, 0, OCOMS_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &ocoms_convertor_parallel_segment_size);
+    if (0 > ret) {
+        return ret;
+    }
+
+#if OCOMS_ENABLE_DEBUG
     ret = ocoms_mca_base_var_register ("ocoms", "mpi", NULL, "ddt_unpack_debug",
 				 "Whether to output debugging information in the ddt unpack functions (nonzero = enabled)",
 				 MCA_BASE_VAR_TYPE_BOOL, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE, OCOMS_INFO_LVL_3,
@@ -221,7 +338,14 @@ int32_t ocoms_datatype_init( void )
         datatype->desc.desc[1].end_loop.size            = datatype->size;
     }
 
-    return OCOMS_SUCCESS;
+    (void)ocoms_convertor_parallel_init();
+    (void)ocoms_convertor_pipeline_init();
+    (void)ocoms_datatype_checksum_init();
+    (void)ocoms_datatype_swap_init();
+    (void)ocoms_datatype_reduce_init();
+    (void)ocoms_datatype_lossy_init();
+
+    return ocoms_datatype_memcpy_init();
 }
 
 
@@ -240,6 +364,10 @@ int32_t ocoms_datatype_finalize( void )
     ocoms_datatype_dfd = -1;
 #endif /* VERBOSE */
 
+    /* stop the pack and unpack helper threads */
+    (void)ocoms_convertor_parallel_finalize();
+    (void)ocoms_convertor_pipeline_finalize();
+
     /* clear all master convertors */
     ocoms_convertor_destroy_masters();
 
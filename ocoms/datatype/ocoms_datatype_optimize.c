@@ -31,6 +31,7 @@
 #include "ocoms/datatype/ocoms_datatype.h"
 #include "ocoms/datatype/ocoms_convertor.h"
 #include "ocoms/datatype/ocoms_datatype_internal.h"
+#include "ocoms/datatype/ocoms_convertor_internal.h"
 
 #define SET_EMPTY_ELEMENT( ELEM )                 \
     do {                                          \
@@ -277,13 +278,31 @@ ocoms_datatype_optimize_short( ocoms_datatype_t* pData,
     return OCOMS_SUCCESS;
 }
 
+/* Maximum nesting of the loops in a description */
+static uint32_t ocoms_datatype_compute_depth( const dt_type_desc_t* pTypeDesc )
+{
+    uint32_t i, depth = 0, max_depth = 0;
+
+    for( i = 0; i < pTypeDesc->used; i++ ) {
+        if( OCOMS_DATATYPE_LOOP == pTypeDesc->desc[i].elem.common.type ) {
+            if( ++depth > max_depth ) max_depth = depth;
+        } else if( OCOMS_DATATYPE_END_LOOP == pTypeDesc->desc[i].elem.common.type ) {
+            depth--;
+        }
+    }
+    return max_depth;
+}
+
 int32_t ocoms_datatype_commit( ocoms_datatype_t * pData )
 {
     ddt_endloop_desc_t* pLast = &(pData->desc.desc[pData->desc.used].end_loop);
     OCOMS_PTRDIFF_TYPE first_elem_disp = 0;
+    uint32_t depth;
 
     if( pData->flags & OCOMS_DATATYPE_FLAG_COMMITED ) return OCOMS_SUCCESS;
     pData->flags |= OCOMS_DATATYPE_FLAG_COMMITED;
+    /* convertors prepared before the commit do not use the new descriptions */
+    ocoms_convertor_release_templates( pData );
 
     /* We have to compute the displacement of the first non loop item in the
      * description.
@@ -305,6 +324,7 @@ int32_t ocoms_datatype_commit( ocoms_datatype_t * pData )
     pLast->items           = pData->desc.used;
     pLast->first_elem_disp = first_elem_disp;
     pLast->size            = pData->size;
+    pData->depth           = ocoms_datatype_compute_depth( &pData->desc );
 
     /* If there is no datatype description how can we have an optimized description ? */
     if( 0 == pData->desc.used ) {
@@ -328,6 +348,13 @@ int32_t ocoms_datatype_commit( ocoms_datatype_t * pData )
         pLast->items           = pData->opt_desc.used;
         pLast->first_elem_disp = first_elem_disp;
         pLast->size            = pData->size;
+        depth = ocoms_datatype_compute_depth( &pData->opt_desc );
+        if( depth > pData->depth ) pData->depth = depth;
+
+        /* and flatten it for the homogeneous pack and unpack */
+        (void)ocoms_datatype_plan_build( pData );
+        /* and index it for the convertors walking it */
+        (void)ocoms_datatype_position_index_build( pData );
     }
     return OCOMS_SUCCESS;
 }
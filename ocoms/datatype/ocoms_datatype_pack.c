@@ -193,17 +193,23 @@ ocoms_pack_homogeneous_contig_with_gaps_function( ocoms_convertor_t* pConv,
         {
             uint32_t counter;
             size_t done;
+            OCOMS_PTRDIFF_TYPE gap;
 
             packed_buffer = (unsigned char *) iov[iov_count].iov_base;
             done = pConv->bConverted - i * pData->size;  /* partial data from last pack */
             if( done != 0 ) {  /* still some data to copy from the last time */
                 done = pData->size - done;
+                gap = extent - pData->size;
+                if( done > max_allowed ) {  /* and not even enough room for it */
+                    done = max_allowed;
+                    gap = 0;  /* stay inside the element */
+                }
                 OCOMS_DATATYPE_SAFEGUARD_POINTER( user_memory, done, pConv->pBaseBuf, pData, pConv->count );
                 MEMCPY_CSUM( packed_buffer, user_memory, done, pConv );
                 packed_buffer += done;
                 max_allowed -= done;
                 total_bytes_converted += done;
-                user_memory += (extent - pData->size + done);
+                user_memory += (gap + done);
             }
             counter = (uint32_t)(max_allowed / pData->size);
             if( counter > pConv->count ) counter = pConv->count;
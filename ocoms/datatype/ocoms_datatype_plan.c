@@ -0,0 +1,407 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/datatype/ocoms_convertor_internal.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+#include "ocoms/datatype/ocoms_datatype_memcpy.h"
+#include "ocoms/datatype/ocoms_datatype_prototypes.h"
+
+/*
+ * Pack plans.
+ *
+ * At commit the optimized description is replayed once for a single
+ * datatype and every block of data it touches is appended to the plan.
+ * Consecutive blocks of the same length and a regular distance are
+ * merged in the same run, as are the iterations of the loops whose body
+ * reduces to a single run, so a vector of any depth ends up as a handful
+ * of runs. Irregular loops are unrolled, and the datatype keeps the
+ * interpreted pack when the plan would have more than
+ * ocoms_datatype_plan_max_runs runs.
+ *
+ * The pack and unpack functions using the plan find their position from
+ * the number of bytes already converted, so they do not need the stack
+ * and they can stop in the middle of any block.
+ */
+
+size_t ocoms_datatype_plan_max_runs = 1024;
+
+typedef struct {
+    ocoms_datatype_plan_t* plan;
+    uint32_t length;   /* allocated runs */
+    uint32_t floor;    /* first run a new block can be merged with */
+    uint32_t max_runs; /* ocoms_datatype_plan_max_runs, clamped */
+} ocoms_datatype_plan_builder_t;
+
+static int ocoms_datatype_plan_append( ocoms_datatype_plan_builder_t* builder,
+                                       OCOMS_PTRDIFF_TYPE disp, size_t blength,
+                                       OCOMS_PTRDIFF_TYPE stride, size_t count )
+{
+    ocoms_datatype_plan_t* plan = builder->plan;
+    ocoms_datatype_plan_run_t* run;
+
+    if( 0 == count || 0 == blength ) return OCOMS_SUCCESS;
+    if( 1 == count ) {
+        stride = (OCOMS_PTRDIFF_TYPE)blength;
+    } else if( stride == (OCOMS_PTRDIFF_TYPE)blength ) {
+        blength *= count;
+        stride = (OCOMS_PTRDIFF_TYPE)blength;
+        count = 1;
+    }
+
+    if( plan->used > builder->floor ) {
+        run = &(plan->runs[plan->used - 1]);
+        /* the new blocks extend the last one */
+        if( (1 == run->count) && (1 == count) &&
+            ((run->disp + (OCOMS_PTRDIFF_TYPE)run->blength) == disp) ) {
+            run->blength += blength;
+            run->stride = (OCOMS_PTRDIFF_TYPE)run->blength;
+            return OCOMS_SUCCESS;
+        }
+        /* the new blocks continue the last run at the same distance */
+        if( run->blength == blength ) {
+            if( (1 == run->count) && (1 == count) &&
+                (disp - run->disp) >= (OCOMS_PTRDIFF_TYPE)blength ) {
+                run->stride = disp - run->disp;
+                run->count = 2;
+                return OCOMS_SUCCESS;
+            }
+            if( (1 == run->count) && (count > 1) && ((disp - run->disp) == stride) &&
+                (stride >= (OCOMS_PTRDIFF_TYPE)blength) ) {
+                run->stride = stride;
+                run->count = count + 1;
+                return OCOMS_SUCCESS;
+            }
+            if( (run->count > 1) && ((1 == count) || (stride == run->stride)) &&
+                (disp == (run->disp + (OCOMS_PTRDIFF_TYPE)run->count * run->stride)) ) {
+                run->count += count;
+                return OCOMS_SUCCESS;
+            }
+        }
+    }
+
+    if( plan->used == builder->max_runs ) return OCOMS_ERR_OUT_OF_RESOURCE;
+    if( plan->used == builder->length ) {
+        builder->length *= 2;
+        if( builder->length > builder->max_runs )
+            builder->length = builder->max_runs;
+        plan = (ocoms_datatype_plan_t*)realloc( plan, sizeof(ocoms_datatype_plan_t) +
+                                               (builder->length - 1) * sizeof(ocoms_datatype_plan_run_t) );
+        if( NULL == plan ) return OCOMS_ERR_OUT_OF_RESOURCE;
+        builder->plan = plan;
+    }
+    run = &(plan->runs[plan->used++]);
+    run->disp    = disp;
+    run->stride  = stride;
+    run->blength = blength;
+    run->count   = count;
+    return OCOMS_SUCCESS;
+}
+
+/* Append the blocks of the description from start up to (excluding) end,
+ * displaced by disp.
+ */
+static int ocoms_datatype_plan_flatten( ocoms_datatype_plan_builder_t* builder,
+                                        const dt_elem_desc_t* description,
+                                        uint32_t start, uint32_t end,
+                                        OCOMS_PTRDIFF_TYPE disp )
+{
+    uint32_t pos_desc = start, floor, first, i;
+    const dt_elem_desc_t* pElem;
+    ocoms_datatype_plan_run_t body;
+    size_t basic_size;
+    int rc;
+
+    while( pos_desc < end ) {
+        pElem = &(description[pos_desc]);
+        if( pElem->elem.common.flags & OCOMS_DATATYPE_FLAG_DATA ) {
+            basic_size = ocoms_datatype_basicDatatypes[pElem->elem.common.type]->size;
+            rc = ocoms_datatype_plan_append( builder, disp + pElem->elem.disp, basic_size,
+                                             pElem->elem.extent, pElem->elem.count );
+            if( OCOMS_SUCCESS != rc ) return rc;
+            pos_desc++;
+            continue;
+        }
+        assert( OCOMS_DATATYPE_LOOP == pElem->elem.common.type );
+        if( pElem->loop.common.flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS ) {
+            const ddt_endloop_desc_t* end_loop = &(description[pos_desc + pElem->loop.items].end_loop);
+            rc = ocoms_datatype_plan_append( builder, disp + end_loop->first_elem_disp, end_loop->size,
+                                             pElem->loop.extent, pElem->loop.loops );
+            if( OCOMS_SUCCESS != rc ) return rc;
+            pos_desc += pElem->loop.items + 1;
+            continue;
+        }
+        /* Flatten the first iteration on its own. If it is a single run the
+         * whole loop can be described by a single run too, otherwise the
+         * body is unrolled.
+         */
+        floor = builder->floor;
+        first = builder->plan->used;
+        builder->floor = first;
+        rc = ocoms_datatype_plan_flatten( builder, description, pos_desc + 1,
+                                          pos_desc + pElem->loop.items, disp );
+        if( OCOMS_SUCCESS != rc ) return rc;
+        if( (first + 1) == builder->plan->used ) {
+            body = builder->plan->runs[first];
+            builder->plan->used = first;
+            builder->floor = floor;
+            if( 1 == body.count ) {
+                rc = ocoms_datatype_plan_append( builder, body.disp, body.blength,
+                                                 pElem->loop.extent, pElem->loop.loops );
+            } else if( ((OCOMS_PTRDIFF_TYPE)body.count * body.stride) == pElem->loop.extent ) {
+                rc = ocoms_datatype_plan_append( builder, body.disp, body.blength,
+                                                 body.stride, body.count * pElem->loop.loops );
+            } else {
+                rc = ocoms_datatype_plan_append( builder, body.disp, body.blength,
+                                                 body.stride, body.count );
+                for( i = 1; (OCOMS_SUCCESS == rc) && (i < pElem->loop.loops); i++ ) {
+                    rc = ocoms_datatype_plan_append( builder, body.disp + i * pElem->loop.extent,
+                                                     body.blength, body.stride, body.count );
+                }
+            }
+        } else {
+            builder->floor = floor;
+            for( i = 1; (OCOMS_SUCCESS == rc) && (i < pElem->loop.loops); i++ ) {
+                rc = ocoms_datatype_plan_flatten( builder, description, pos_desc + 1,
+                                                  pos_desc + pElem->loop.items,
+                                                  disp + i * pElem->loop.extent );
+            }
+        }
+        if( OCOMS_SUCCESS != rc ) return rc;
+        pos_desc += pElem->loop.items + 1;
+    }
+    return OCOMS_SUCCESS;
+}
+
+int32_t ocoms_datatype_plan_build( ocoms_datatype_t* pData )
+{
+    ocoms_datatype_plan_builder_t builder;
+    size_t packed = 0, max_runs = ocoms_datatype_plan_max_runs;
+    uint32_t i;
+    int rc;
+
+    ocoms_datatype_plan_release( pData );
+    /* The contiguous datatypes have faster functions, and the heterogeneous
+     * conversions still need the description.
+     */
+    if( (0 == max_runs) || (0 == pData->opt_desc.used) ||
+        (pData->flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS) ) {
+        return OCOMS_SUCCESS;
+    }
+    if( max_runs > UINT32_MAX ) max_runs = UINT32_MAX;
+
+    builder.length = 8;
+    if( builder.length > max_runs )
+        builder.length = (uint32_t)max_runs;
+    builder.floor = 0;
+    builder.max_runs = (uint32_t)max_runs;
+    builder.plan = (ocoms_datatype_plan_t*)malloc( sizeof(ocoms_datatype_plan_t) +
+                                                  (builder.length - 1) * sizeof(ocoms_datatype_plan_run_t) );
+    if( NULL == builder.plan ) return OCOMS_ERR_OUT_OF_RESOURCE;
+    builder.plan->used = 0;
+
+    rc = ocoms_datatype_plan_flatten( &builder, pData->opt_desc.desc, 0, pData->opt_desc.used, 0 );
+    if( OCOMS_SUCCESS == rc ) {
+        for( i = 0; i < builder.plan->used; i++ ) {
+            builder.plan->runs[i].packed = packed;
+            packed += builder.plan->runs[i].blength * builder.plan->runs[i].count;
+        }
+        /* the description does not look like what we expected, keep it */
+        if( packed != pData->size ) rc = OCOMS_ERROR;
+    }
+    if( OCOMS_SUCCESS != rc ) {
+        /* not worth it (or no memory), the interpreted pack will do */
+        free( builder.plan );
+        return OCOMS_SUCCESS;
+    }
+    pData->plan = builder.plan;
+    return OCOMS_SUCCESS;
+}
+
+void ocoms_datatype_plan_release( ocoms_datatype_t* pData )
+{
+    if( NULL != pData->plan ) {
+        free( pData->plan );
+        pData->plan = NULL;
+    }
+}
+
+/* Position of a convertor in the plan */
+typedef struct {
+    const ocoms_datatype_plan_run_t* run;
+    const ocoms_datatype_plan_run_t* first;
+    const ocoms_datatype_plan_run_t* last;
+    size_t count;          /* blocks in the current run */
+    size_t block;          /* current block in the run */
+    size_t offset;         /* bytes already done in the current block */
+    unsigned char* base;   /* user memory of the current datatype */
+    OCOMS_PTRDIFF_TYPE extent;
+} ocoms_datatype_plan_cursor_t;
+
+static inline void
+ocoms_datatype_plan_locate( const ocoms_convertor_t* pConv,
+                            ocoms_datatype_plan_cursor_t* cursor )
+{
+    const ocoms_datatype_t* pData = pConv->pDesc;
+    const ocoms_datatype_plan_t* plan = pData->plan;
+    const ocoms_datatype_plan_run_t* run = plan->runs;
+    size_t position = pConv->bConverted, index, low, high, mid;
+
+    cursor->extent = pData->ub - pData->lb;
+    cursor->first = plan->runs;
+    cursor->last = plan->runs + plan->used - 1;
+    cursor->count = run->count;
+    /* a single regular run continues in the next datatype, do all of them at once */
+    if( (1 == plan->used) &&
+        (((OCOMS_PTRDIFF_TYPE)run->count * run->stride) == cursor->extent) ) {
+        cursor->count *= pConv->count;
+        index = 0;
+    } else {
+        index = position / pData->size;
+        position -= index * pData->size;
+        low = 0; high = plan->used - 1;
+        while( low < high ) {
+            mid = (low + high + 1) / 2;
+            if( plan->runs[mid].packed <= position ) low = mid;
+            else high = mid - 1;
+        }
+        run += low;
+        position -= run->packed;
+        cursor->count = run->count;
+    }
+    cursor->run = run;
+    cursor->block = position / run->blength;
+    cursor->offset = position - cursor->block * run->blength;
+    cursor->base = pConv->pBaseBuf + index * cursor->extent;
+}
+
+/* Move length bytes between the user memory and the packed buffer,
+ * starting at the position of the cursor. pack is a constant, each
+ * direction gets its own copy of the loop.
+ */
+static inline void
+ocoms_datatype_plan_copy( ocoms_datatype_plan_cursor_t* cursor,
+                          unsigned char* packed, size_t length, const int pack )
+{
+    const ocoms_datatype_plan_run_t* run = cursor->run;
+    unsigned char* user;
+    size_t blength, n, i;
+
+    while( 0 != length ) {
+        blength = run->blength;
+        user = cursor->base + run->disp + (OCOMS_PTRDIFF_TYPE)cursor->block * run->stride;
+        if( (0 == cursor->offset) && (length >= blength) ) {
+            n = cursor->count - cursor->block;
+            if( (n * blength) > length ) n = length / blength;
+            if( 1 == n ) {
+                /* the small blocks of the predefined sizes are moved inline */
+                if( pack ) {
+                    if( !ocoms_datatype_strided_copy( packed, 0, user, 0, blength, 1 ) )
+                        MEMCPY( packed, user, blength );
+                } else {
+                    if( !ocoms_datatype_strided_copy( user, 0, packed, 0, blength, 1 ) )
+                        MEMCPY( user, packed, blength );
+                }
+            } else if( pack ) {
+                if( !ocoms_datatype_strided_copy( packed, (OCOMS_PTRDIFF_TYPE)blength,
+                                                  user, run->stride, blength, n ) ) {
+                    for( i = 0; i < n; i++ )
+                        MEMCPY( packed + i * blength, user + i * run->stride, blength );
+                }
+            } else {
+                if( !ocoms_datatype_strided_copy( user, run->stride, packed,
+                                                  (OCOMS_PTRDIFF_TYPE)blength, blength, n ) ) {
+                    for( i = 0; i < n; i++ )
+                        MEMCPY( user + i * run->stride, packed + i * blength, blength );
+                }
+            }
+            cursor->block += n;
+            n *= blength;
+        } else {
+            /* the beginning or the end of a block */
+            n = blength - cursor->offset;
+            if( n > length ) n = length;
+            if( pack ) MEMCPY( packed, user + cursor->offset, n );
+            else MEMCPY( user + cursor->offset, packed, n );
+            cursor->offset += n;
+            if( cursor->offset == blength ) {
+                cursor->offset = 0;
+                cursor->block++;
+            }
+        }
+        packed += n;
+        length -= n;
+        if( cursor->block == cursor->count ) {
+            if( run == cursor->last ) {
+                run = cursor->first;
+                cursor->base += cursor->extent;
+            } else {
+                run++;
+            }
+            cursor->block = 0;
+            cursor->count = run->count;
+        }
+    }
+    cursor->run = run;
+}
+
+static inline int32_t
+ocoms_datatype_plan_convert( ocoms_convertor_t* pConv,
+                             struct iovec* iov, uint32_t* out_size,
+                             size_t* max_data, const int pack )
+{
+    ocoms_datatype_plan_cursor_t cursor;
+    size_t total = 0, length;
+    uint32_t iov_count;
+
+    ocoms_datatype_plan_locate( pConv, &cursor );
+    for( iov_count = 0; iov_count < (*out_size); iov_count++ ) {
+        length = pConv->local_size - pConv->bConverted;
+        if( 0 == length ) break;
+        if( (size_t)iov[iov_count].iov_len > length )
+            iov[iov_count].iov_len = length;
+        length = iov[iov_count].iov_len;
+        ocoms_datatype_plan_copy( &cursor, (unsigned char*)iov[iov_count].iov_base, length, pack );
+        pConv->bConverted += length;
+        total += length;
+    }
+    *max_data = total;
+    *out_size = iov_count;
+    if( pConv->bConverted == pConv->local_size ) {
+        pConv->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    return 0;
+}
+
+int32_t
+ocoms_pack_plan( ocoms_convertor_t* pConvertor,
+                 struct iovec* iov, uint32_t* out_size,
+                 size_t* max_data )
+{
+    return ocoms_datatype_plan_convert( pConvertor, iov, out_size, max_data, 1 );
+}
+
+int32_t
+ocoms_unpack_plan( ocoms_convertor_t* pConvertor,
+                   struct iovec* iov, uint32_t* out_size,
+                   size_t* max_data )
+{
+    return ocoms_datatype_plan_convert( pConvertor, iov, out_size, max_data, 0 );
+}
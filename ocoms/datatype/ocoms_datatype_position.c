@@ -77,11 +77,17 @@ static inline void position_predefined_data( ocoms_convertor_t* CONVERTOR,
     *(COUNT)   -= _copy_count;
 }
 
-static inline void position_contiguous_loop( ocoms_convertor_t* CONVERTOR,
-                                             dt_elem_desc_t* ELEM,
-                                             uint32_t* COUNT,
-                                             unsigned char** POINTER,
-                                             size_t* SPACE )
+/*
+ * Skip the complete iterations of a loop fitting in the space left. As all
+ * the iterations have the same size and the same extent this is the same
+ * for the contiguous loops and for the others, only the position inside
+ * the last partial iteration has to be computed by walking the loop.
+ */
+static inline void position_loop( ocoms_convertor_t* CONVERTOR,
+                                  dt_elem_desc_t* ELEM,
+                                  uint32_t* COUNT,
+                                  unsigned char** POINTER,
+                                  size_t* SPACE )
 {
     ddt_loop_desc_t *_loop = (ddt_loop_desc_t*)(ELEM);
     ddt_endloop_desc_t* _end_loop = (ddt_endloop_desc_t*)((ELEM) + (ELEM)->loop.items);
@@ -89,19 +95,56 @@ static inline void position_contiguous_loop( ocoms_convertor_t* CONVERTOR,
 
     if( (_copy_loops * _end_loop->size) > *(SPACE) )
         _copy_loops = (uint32_t)(*(SPACE) / _end_loop->size);
-    OCOMS_DATATYPE_SAFEGUARD_POINTER( *(POINTER) + _end_loop->first_elem_disp,
-                                (_copy_loops - 1) * _loop->extent + _end_loop->size,
-                                (CONVERTOR)->pBaseBuf, (CONVERTOR)->pDesc, (CONVERTOR)->count );
+    if( _loop->common.flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS ) {
+        OCOMS_DATATYPE_SAFEGUARD_POINTER( *(POINTER) + _end_loop->first_elem_disp,
+                                    (_copy_loops - 1) * _loop->extent + _end_loop->size,
+                                    (CONVERTOR)->pBaseBuf, (CONVERTOR)->pDesc, (CONVERTOR)->count );
+    }
     *(POINTER) += _copy_loops * _loop->extent;
     *(SPACE)   -= _copy_loops * _end_loop->size;
     *(COUNT)   -= _copy_loops;
 }
 
+/*
+ * Move a convertor on the top level of the optimized description to the
+ * last checkpoint before the position, if any is after the current entry.
+ * The checkpoints are in increasing order of both index and packed bytes,
+ * so a binary search finds it.
+ */
+static inline void position_checkpoint( ocoms_convertor_t* CONVERTOR,
+                                        size_t POSITION,
+                                        uint32_t* POS_DESC,
+                                        size_t* SPACE )
+{
+    const ocoms_datatype_position_index_t* _index = (CONVERTOR)->pDesc->position_index;
+    size_t _packed, _target;
+    uint32_t _low, _high, _mid;
+
+    if( (NULL == _index) || ((CONVERTOR)->use_desc != &((CONVERTOR)->pDesc->opt_desc)) )
+        return;
+    /* the packed bytes already done in the current datatype */
+    _packed = (POSITION - *(SPACE)) % (CONVERTOR)->pDesc->size;
+    _target = _packed + *(SPACE);
+    _low = 0;
+    _high = _index->used;
+    while( (_high - _low) > 1 ) {
+        _mid = (_low + _high) / 2;
+        if( _index->checkpoints[_mid].packed <= _target ) _low = _mid;
+        else _high = _mid;
+    }
+    if( _index->checkpoints[_low].index <= *(POS_DESC) ) return;
+    *(SPACE)   -= _index->checkpoints[_low].packed - _packed;
+    *(POS_DESC) = _index->checkpoints[_low].index;
+}
+
 #define POSITION_PREDEFINED_DATATYPE( CONVERTOR, ELEM, COUNT, POSITION, SPACE ) \
     position_predefined_data( (CONVERTOR), (ELEM), &(COUNT), &(POSITION), &(SPACE) )
 
-#define POSITION_CONTIGUOUS_LOOP( CONVERTOR, ELEM, COUNT, POSITION, SPACE ) \
-    position_contiguous_loop( (CONVERTOR), (ELEM), &(COUNT), &(POSITION), &(SPACE) )
+#define POSITION_LOOP( CONVERTOR, ELEM, COUNT, POSITION, SPACE ) \
+    position_loop( (CONVERTOR), (ELEM), &(COUNT), &(POSITION), &(SPACE) )
+
+#define POSITION_CHECKPOINT( CONVERTOR, POSITION, POS_DESC, SPACE ) \
+    position_checkpoint( (CONVERTOR), (POSITION), &(POS_DESC), &(SPACE) )
 
 int ocoms_convertor_generic_simple_position( ocoms_convertor_t* pConvertor,
                                             size_t* position )
@@ -152,6 +195,14 @@ int ocoms_convertor_generic_simple_position( ocoms_convertor_t* pConvertor,
     pConvertor->stack_pos--;
     pElem = &(description[pos_desc]);
     base_pointer += pStack->disp;
+    if( 0 == pConvertor->stack_pos ) {  /* on the top level, look for a closer checkpoint */
+        uint32_t current = pos_desc;
+        POSITION_CHECKPOINT( pConvertor, *position, pos_desc, iov_len_local );
+        if( current != pos_desc ) {
+            base_pointer = pConvertor->pBaseBuf + pStack->disp;
+            UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
+        }
+    }
 
     DO_DEBUG( ocoms_output( 0, "position start pos_desc %d count_desc %d disp %llx\n"
                            "stack_pos %d pos_desc %d count_desc %d disp %llx\n",
@@ -173,14 +224,25 @@ int ocoms_convertor_generic_simple_position( ocoms_convertor_t* pConvertor,
                 pStack--;
                 pos_desc++;
             } else {
-                if( pStack->index == -1 ) {
-                    pStack->disp += extent;
-                } else {
+                OCOMS_PTRDIFF_TYPE loop_extent = extent;
+                uint32_t loops = 0;
+
+                if( pStack->index != -1 ) {
                     assert( OCOMS_DATATYPE_LOOP == description[pStack->index].loop.common.type );
-                    pStack->disp += description[pStack->index].loop.extent;
+                    loop_extent = description[pStack->index].loop.extent;
                 }
+                /* skip the complete iterations, keeping the last one to be walked */
+                if( 0 != pElem->end_loop.size ) {
+                    loops = (uint32_t)(iov_len_local / pElem->end_loop.size);
+                    if( loops >= pStack->count ) loops = (uint32_t)pStack->count - 1;
+                }
+                pStack->count -= loops;
+                iov_len_local -= loops * pElem->end_loop.size;
+                pStack->disp  += (loops + 1) * loop_extent;
                 pos_desc = pStack->index + 1;
             }
+            if( 0 == pConvertor->stack_pos )
+                POSITION_CHECKPOINT( pConvertor, *position, pos_desc, iov_len_local );
             base_pointer = pConvertor->pBaseBuf + pStack->disp;
             UPDATE_INTERNAL_COUNTERS( description, pos_desc, pElem, count_desc );
             DO_DEBUG( ocoms_output( 0, "position new_loop count %d stack_pos %d pos_desc %d disp %llx space %lu\n",
@@ -189,15 +251,13 @@ int ocoms_convertor_generic_simple_position( ocoms_convertor_t* pConvertor,
         }
         if( OCOMS_DATATYPE_LOOP == pElem->elem.common.type ) {
             OCOMS_PTRDIFF_TYPE local_disp = (OCOMS_PTRDIFF_TYPE)base_pointer;
-            if( pElem->loop.common.flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS ) {
-                POSITION_CONTIGUOUS_LOOP( pConvertor, pElem, count_desc,
-                                          base_pointer, iov_len_local );
-                if( 0 == count_desc ) {  /* completed */
-                    pos_desc += pElem->loop.items + 1;
-                    goto update_loop_description;
-                }
-                /* Save the stack with the correct last_count value. */
+            POSITION_LOOP( pConvertor, pElem, count_desc,
+                           base_pointer, iov_len_local );
+            if( 0 == count_desc ) {  /* completed */
+                pos_desc += pElem->loop.items + 1;
+                goto update_loop_description;
             }
+            /* Save the stack with the correct last_count value. */
             local_disp = (OCOMS_PTRDIFF_TYPE)base_pointer - local_disp;
             PUSH_STACK( pStack, pConvertor->stack_pos, pos_desc, OCOMS_DATATYPE_LOOP, count_desc,
                         pStack->disp + local_disp );
@@ -241,3 +301,65 @@ int ocoms_convertor_generic_simple_position( ocoms_convertor_t* pConvertor,
     }
     return 1;
 }
+
+int32_t ocoms_datatype_position_index_build( ocoms_datatype_t* pData )
+{
+    ocoms_datatype_position_index_t* index;
+    dt_elem_desc_t* pElem;
+    uint32_t pos_desc, entries = 0;
+    size_t packed = 0;
+
+    ocoms_datatype_position_index_release( pData );
+    if( (0 == pData->opt_desc.used) || (0 == pData->size) ||
+        (pData->flags & OCOMS_DATATYPE_FLAG_CONTIGUOUS) ) {
+        return OCOMS_SUCCESS;
+    }
+    /* the short descriptions are walked fast enough */
+    for( pos_desc = 0; pos_desc < pData->opt_desc.used; entries++ ) {
+        pElem = &(pData->opt_desc.desc[pos_desc]);
+        pos_desc += (OCOMS_DATATYPE_LOOP == pElem->elem.common.type) ? pElem->loop.items + 1 : 1;
+    }
+    if( entries < 2 * OCOMS_DATATYPE_POSITION_STRIDE ) return OCOMS_SUCCESS;
+
+    index = (ocoms_datatype_position_index_t*)malloc( sizeof(ocoms_datatype_position_index_t) +
+                                                      (entries / OCOMS_DATATYPE_POSITION_STRIDE + 1) *
+                                                      sizeof(ocoms_datatype_checkpoint_t) );
+    if( NULL == index ) return OCOMS_ERR_OUT_OF_RESOURCE;
+    index->used = 0;
+
+    for( pos_desc = 0, entries = 0; pos_desc < pData->opt_desc.used; entries++ ) {
+        if( 0 == (entries % OCOMS_DATATYPE_POSITION_STRIDE) ) {
+            index->checkpoints[index->used].index  = pos_desc;
+            index->checkpoints[index->used].packed = packed;
+            index->used++;
+        }
+        pElem = &(pData->opt_desc.desc[pos_desc]);
+        if( OCOMS_DATATYPE_LOOP == pElem->elem.common.type ) {
+            packed += (size_t)pElem->loop.loops * pElem[pElem->loop.items].end_loop.size;
+            pos_desc += pElem->loop.items + 1;
+            continue;
+        }
+        if( pElem->elem.common.flags & OCOMS_DATATYPE_FLAG_DATA )
+            packed += (size_t)pElem->elem.count * ocoms_datatype_basicDatatypes[pElem->elem.common.type]->size;
+        pos_desc++;
+    }
+    index->checkpoints[index->used].index  = pData->opt_desc.used;
+    index->checkpoints[index->used].packed = packed;
+    index->used++;
+
+    /* the description does not look like what we expected, walk it */
+    if( packed != pData->size ) {
+        free( index );
+        return OCOMS_SUCCESS;
+    }
+    pData->position_index = index;
+    return OCOMS_SUCCESS;
+}
+
+void ocoms_datatype_position_index_release( ocoms_datatype_t* pData )
+{
+    if( NULL != pData->position_index ) {
+        free( pData->position_index );
+        pData->position_index = NULL;
+    }
+}
@@ -77,6 +77,38 @@ int32_t
 ocoms_generic_simple_unpack_checksum( ocoms_convertor_t* pConvertor,
                                      struct iovec* iov, uint32_t* out_size,
                                      size_t* max_data );
+int32_t
+ocoms_unpack_reduce_contig( ocoms_convertor_t* pConv,
+                           struct iovec* iov, uint32_t* out_size,
+                           size_t* max_data );
+int32_t
+ocoms_generic_simple_unpack_reduce( ocoms_convertor_t* pConvertor,
+                                   struct iovec* iov, uint32_t* out_size,
+                                   size_t* max_data );
+int32_t
+ocoms_pack_lossy_contig( ocoms_convertor_t* pConv,
+                        struct iovec* iov, uint32_t* out_size,
+                        size_t* max_data );
+int32_t
+ocoms_unpack_lossy_contig( ocoms_convertor_t* pConv,
+                          struct iovec* iov, uint32_t* out_size,
+                          size_t* max_data );
+int32_t
+ocoms_generic_simple_pack_lossy( ocoms_convertor_t* pConvertor,
+                                struct iovec* iov, uint32_t* out_size,
+                                size_t* max_data );
+int32_t
+ocoms_generic_simple_unpack_lossy( ocoms_convertor_t* pConvertor,
+                                  struct iovec* iov, uint32_t* out_size,
+                                  size_t* max_data );
+int32_t
+ocoms_pack_plan( ocoms_convertor_t* pConvertor,
+                struct iovec* iov, uint32_t* out_size,
+                size_t* max_data );
+int32_t
+ocoms_unpack_plan( ocoms_convertor_t* pConvertor,
+                  struct iovec* iov, uint32_t* out_size,
+                  size_t* max_data );
 
 END_C_DECLS
 
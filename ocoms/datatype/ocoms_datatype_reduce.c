@@ -0,0 +1,345 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stddef.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/datatype/ocoms_datatype.h"
+#include "ocoms/datatype/ocoms_datatype_internal.h"
+#include "ocoms/datatype/ocoms_datatype_reduce.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define OCOMS_DATATYPE_REDUCE_X86 1
+#else
+#define OCOMS_DATATYPE_REDUCE_X86 0
+#endif
+
+/* long double is the predefined type of its size when it is not a double */
+#if HAVE_LONG_DOUBLE && ((SIZEOF_LONG_DOUBLE == 12) || (SIZEOF_LONG_DOUBLE == 16))
+#define OCOMS_DATATYPE_REDUCE_LONG_DOUBLE 1
+#else
+#define OCOMS_DATATYPE_REDUCE_LONG_DOUBLE 0
+#endif
+
+/*
+ * The reduction kernels.
+ *
+ * Every kernel is a plain loop over arrays which cannot overlap, that
+ * the compiler turns into vector code. The integers and the reals of 4
+ * and 8 bytes, the types the collectives spend their time on, are
+ * compiled once for the default target of the compiler (SSE2 on x86-64,
+ * NEON on ARMv8) and once for AVX2 and AVX-512 on x86-64, the variant is
+ * selected at runtime. The other types, and the MINLOC and MAXLOC
+ * pairs, only have the default variant.
+ */
+
+int ocoms_datatype_reduce_variant = OCOMS_DATATYPE_REDUCE_AUTO;
+
+ocoms_datatype_reduce_fct_t
+ocoms_datatype_reduce_functions[OCOMS_DATATYPE_OP_NUM][OCOMS_DATATYPE_MAX_PREDEFINED];
+
+#define OCOMS_REDUCE_OP_SUM( A, B )   ((A) + (B))
+#define OCOMS_REDUCE_OP_PROD( A, B )  ((A) * (B))
+#define OCOMS_REDUCE_OP_MIN( A, B )   (((A) < (B)) ? (A) : (B))
+#define OCOMS_REDUCE_OP_MAX( A, B )   (((A) > (B)) ? (A) : (B))
+#define OCOMS_REDUCE_OP_LAND( A, B )  ((A) && (B))
+#define OCOMS_REDUCE_OP_LOR( A, B )   ((A) || (B))
+#define OCOMS_REDUCE_OP_LXOR( A, B )  (!(A) != !(B))
+#define OCOMS_REDUCE_OP_BAND( A, B )  ((A) & (B))
+#define OCOMS_REDUCE_OP_BOR( A, B )   ((A) | (B))
+#define OCOMS_REDUCE_OP_BXOR( A, B )  ((A) ^ (B))
+
+#define OCOMS_REDUCE_FUNCTION( OP, TYPENAME, TYPE, VARIANT, ATTRIBUTE ) \
+ATTRIBUTE static void                                                   \
+ocoms_reduce_##OP##_##TYPENAME##_##VARIANT( const void* in, void* inout, size_t count ) \
+{                                                                       \
+    const TYPE* restrict a = (const TYPE*)in;                           \
+    TYPE* restrict b = (TYPE*)inout;                                    \
+    size_t i;                                                           \
+                                                                        \
+    for( i = 0; i < count; i++ ) {                                      \
+        b[i] = OCOMS_REDUCE_OP_##OP( a[i], b[i] );                      \
+    }                                                                   \
+}
+
+#define OCOMS_REDUCE_INTEGER( TYPENAME, TYPE, VARIANT, ATTRIBUTE )      \
+    OCOMS_REDUCE_FUNCTION( SUM,  TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( PROD, TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( MIN,  TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( MAX,  TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( LAND, TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( LOR,  TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( LXOR, TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( BAND, TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( BOR,  TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( BXOR, TYPENAME, TYPE, VARIANT, ATTRIBUTE )
+
+#define OCOMS_REDUCE_REAL( TYPENAME, TYPE, VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_FUNCTION( SUM,  TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( PROD, TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( MIN,  TYPENAME, TYPE, VARIANT, ATTRIBUTE )   \
+    OCOMS_REDUCE_FUNCTION( MAX,  TYPENAME, TYPE, VARIANT, ATTRIBUTE )
+
+#define OCOMS_REDUCE_COMPLEX( TYPENAME, TYPE )                          \
+    OCOMS_REDUCE_FUNCTION( SUM,  TYPENAME, TYPE, generic, )             \
+    OCOMS_REDUCE_FUNCTION( PROD, TYPENAME, TYPE, generic, )
+
+#define OCOMS_REDUCE_LOGICAL( TYPENAME, TYPE )                          \
+    OCOMS_REDUCE_FUNCTION( LAND, TYPENAME, TYPE, generic, )             \
+    OCOMS_REDUCE_FUNCTION( LOR,  TYPENAME, TYPE, generic, )             \
+    OCOMS_REDUCE_FUNCTION( LXOR, TYPENAME, TYPE, generic, )
+
+/* the value of a pair wins on a strict comparison, or on equal values
+ * with a lower index */
+#define OCOMS_REDUCE_LOC_FUNCTION( OP, TYPENAME, CMP )                  \
+static void                                                             \
+ocoms_reduce_##OP##_##TYPENAME##_generic( const void* in, void* inout, size_t count ) \
+{                                                                       \
+    const ocoms_reduce_##TYPENAME##_int_t* restrict a = (const ocoms_reduce_##TYPENAME##_int_t*)in; \
+    ocoms_reduce_##TYPENAME##_int_t* restrict b = (ocoms_reduce_##TYPENAME##_int_t*)inout; \
+    size_t i;                                                           \
+                                                                        \
+    for( i = 0; i < count; i++ ) {                                      \
+        if( (a[i].v CMP b[i].v) || ((a[i].v == b[i].v) && (a[i].k < b[i].k)) ) { \
+            b[i] = a[i];                                                \
+        }                                                               \
+    }                                                                   \
+}
+
+#define OCOMS_REDUCE_LOC( TYPENAME, TYPE )                              \
+    typedef struct {                                                    \
+        TYPE v;                                                         \
+        int  k;                                                         \
+    } ocoms_reduce_##TYPENAME##_int_t;                                  \
+    OCOMS_REDUCE_LOC_FUNCTION( MINLOC, TYPENAME, < )                    \
+    OCOMS_REDUCE_LOC_FUNCTION( MAXLOC, TYPENAME, > )
+
+/* the types worth a kernel for each instruction set */
+#define OCOMS_REDUCE_VECTOR_KERNELS( VARIANT, ATTRIBUTE )               \
+    OCOMS_REDUCE_INTEGER( int1,  int8_t,   VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_INTEGER( int2,  int16_t,  VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_INTEGER( int4,  int32_t,  VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_INTEGER( int8,  int64_t,  VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_INTEGER( uint1, uint8_t,  VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_INTEGER( uint2, uint16_t, VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_INTEGER( uint4, uint32_t, VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_INTEGER( uint8, uint64_t, VARIANT, ATTRIBUTE )         \
+    OCOMS_REDUCE_REAL( float,  float,  VARIANT, ATTRIBUTE )             \
+    OCOMS_REDUCE_REAL( double, double, VARIANT, ATTRIBUTE )
+
+OCOMS_REDUCE_VECTOR_KERNELS( generic, )
+#if OCOMS_DATATYPE_REDUCE_X86
+OCOMS_REDUCE_VECTOR_KERNELS( avx2, __attribute__((target("avx2"))) )
+#if defined(__clang__)
+OCOMS_REDUCE_VECTOR_KERNELS( avx512, __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"))) )
+#else
+/* gcc keeps to 256 bits vectors unless told otherwise */
+OCOMS_REDUCE_VECTOR_KERNELS( avx512, __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,prefer-vector-width=512"))) )
+#endif  /* defined(__clang__) */
+#endif  /* OCOMS_DATATYPE_REDUCE_X86 */
+
+#ifdef HAVE_INT128_T
+OCOMS_REDUCE_INTEGER( int16, int128_t, generic, )
+#endif
+#ifdef HAVE_UINT128_T
+OCOMS_REDUCE_INTEGER( uint16, uint128_t, generic, )
+#endif
+#if OCOMS_DATATYPE_REDUCE_LONG_DOUBLE
+OCOMS_REDUCE_REAL( long_double, long double, generic, )
+#endif
+#if HAVE_FLOAT__COMPLEX
+OCOMS_REDUCE_COMPLEX( float_complex, float _Complex )
+#endif
+#if HAVE_DOUBLE__COMPLEX
+OCOMS_REDUCE_COMPLEX( double_complex, double _Complex )
+#endif
+#if HAVE_LONG_DOUBLE__COMPLEX
+OCOMS_REDUCE_COMPLEX( long_double_complex, long double _Complex )
+#endif
+OCOMS_REDUCE_LOGICAL( c_bool, _Bool )
+
+OCOMS_REDUCE_LOC( int1,  int8_t )
+OCOMS_REDUCE_LOC( int2,  int16_t )
+OCOMS_REDUCE_LOC( int4,  int32_t )
+OCOMS_REDUCE_LOC( int8,  int64_t )
+OCOMS_REDUCE_LOC( uint1, uint8_t )
+OCOMS_REDUCE_LOC( uint2, uint16_t )
+OCOMS_REDUCE_LOC( uint4, uint32_t )
+OCOMS_REDUCE_LOC( uint8, uint64_t )
+OCOMS_REDUCE_LOC( float,  float )
+OCOMS_REDUCE_LOC( double, double )
+#if OCOMS_DATATYPE_REDUCE_LONG_DOUBLE
+OCOMS_REDUCE_LOC( long_double, long double )
+#endif
+
+#define OCOMS_REDUCE_SET( OP, ID, TYPENAME, VARIANT )                   \
+    ocoms_datatype_reduce_functions[OCOMS_DATATYPE_OP_##OP][OCOMS_DATATYPE_##ID] = \
+        ocoms_reduce_##OP##_##TYPENAME##_##VARIANT
+
+#define OCOMS_REDUCE_SET_INTEGER( ID, TYPENAME, VARIANT )               \
+    do {                                                                \
+        OCOMS_REDUCE_SET( SUM,  ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( PROD, ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( MIN,  ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( MAX,  ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( LAND, ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( LOR,  ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( LXOR, ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( BAND, ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( BOR,  ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( BXOR, ID, TYPENAME, VARIANT );                \
+    } while (0)
+
+#define OCOMS_REDUCE_SET_REAL( ID, TYPENAME, VARIANT )                  \
+    do {                                                                \
+        OCOMS_REDUCE_SET( SUM,  ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( PROD, ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( MIN,  ID, TYPENAME, VARIANT );                \
+        OCOMS_REDUCE_SET( MAX,  ID, TYPENAME, VARIANT );                \
+    } while (0)
+
+#define OCOMS_REDUCE_SET_LOC( ID, TYPENAME )                            \
+    do {                                                                \
+        OCOMS_REDUCE_SET( MINLOC, ID, TYPENAME, generic );              \
+        OCOMS_REDUCE_SET( MAXLOC, ID, TYPENAME, generic );              \
+    } while (0)
+
+/* the real types by size, as for the copy functions */
+#if SIZEOF_FLOAT == 4
+#define OCOMS_REDUCE_SET_FLOAT4( VARIANT )  OCOMS_REDUCE_SET_REAL( FLOAT4, float, VARIANT )
+#define OCOMS_REDUCE_SET_LOC_FLOAT4()       OCOMS_REDUCE_SET_LOC( FLOAT4, float )
+#else
+#define OCOMS_REDUCE_SET_FLOAT4( VARIANT )
+#define OCOMS_REDUCE_SET_LOC_FLOAT4()
+#endif
+#if SIZEOF_DOUBLE == 8
+#define OCOMS_REDUCE_SET_FLOAT8( VARIANT )  OCOMS_REDUCE_SET_REAL( FLOAT8, double, VARIANT )
+#define OCOMS_REDUCE_SET_LOC_FLOAT8()       OCOMS_REDUCE_SET_LOC( FLOAT8, double )
+#else
+#define OCOMS_REDUCE_SET_FLOAT8( VARIANT )
+#define OCOMS_REDUCE_SET_LOC_FLOAT8()
+#endif
+
+#define OCOMS_REDUCE_SET_VECTOR( VARIANT )                              \
+    do {                                                                \
+        OCOMS_REDUCE_SET_INTEGER( INT1,  int1,  VARIANT );              \
+        OCOMS_REDUCE_SET_INTEGER( INT2,  int2,  VARIANT );              \
+        OCOMS_REDUCE_SET_INTEGER( INT4,  int4,  VARIANT );              \
+        OCOMS_REDUCE_SET_INTEGER( INT8,  int8,  VARIANT );              \
+        OCOMS_REDUCE_SET_INTEGER( UINT1, uint1, VARIANT );              \
+        OCOMS_REDUCE_SET_INTEGER( UINT2, uint2, VARIANT );              \
+        OCOMS_REDUCE_SET_INTEGER( UINT4, uint4, VARIANT );              \
+        OCOMS_REDUCE_SET_INTEGER( UINT8, uint8, VARIANT );              \
+        OCOMS_REDUCE_SET_FLOAT4( VARIANT );                             \
+        OCOMS_REDUCE_SET_FLOAT8( VARIANT );                             \
+    } while (0)
+
+static void ocoms_datatype_reduce_set_generic( void )
+{
+    OCOMS_REDUCE_SET_VECTOR( generic );
+#ifdef HAVE_INT128_T
+    OCOMS_REDUCE_SET_INTEGER( INT16, int16, generic );
+#endif
+#ifdef HAVE_UINT128_T
+    OCOMS_REDUCE_SET_INTEGER( UINT16, uint16, generic );
+#endif
+#if OCOMS_DATATYPE_REDUCE_LONG_DOUBLE && (SIZEOF_LONG_DOUBLE == 12)
+    OCOMS_REDUCE_SET_REAL( FLOAT12, long_double, generic );
+    OCOMS_REDUCE_SET_LOC( FLOAT12, long_double );
+#elif OCOMS_DATATYPE_REDUCE_LONG_DOUBLE
+    OCOMS_REDUCE_SET_REAL( FLOAT16, long_double, generic );
+    OCOMS_REDUCE_SET_LOC( FLOAT16, long_double );
+#endif
+#if HAVE_FLOAT__COMPLEX
+    OCOMS_REDUCE_SET( SUM,  FLOAT_COMPLEX, float_complex, generic );
+    OCOMS_REDUCE_SET( PROD, FLOAT_COMPLEX, float_complex, generic );
+#endif
+#if HAVE_DOUBLE__COMPLEX
+    OCOMS_REDUCE_SET( SUM,  DOUBLE_COMPLEX, double_complex, generic );
+    OCOMS_REDUCE_SET( PROD, DOUBLE_COMPLEX, double_complex, generic );
+#endif
+#if HAVE_LONG_DOUBLE__COMPLEX
+    OCOMS_REDUCE_SET( SUM,  LONG_DOUBLE_COMPLEX, long_double_complex, generic );
+    OCOMS_REDUCE_SET( PROD, LONG_DOUBLE_COMPLEX, long_double_complex, generic );
+#endif
+    OCOMS_REDUCE_SET( LAND, BOOL, c_bool, generic );
+    OCOMS_REDUCE_SET( LOR,  BOOL, c_bool, generic );
+    OCOMS_REDUCE_SET( LXOR, BOOL, c_bool, generic );
+
+    OCOMS_REDUCE_SET_LOC( INT1,  int1 );
+    OCOMS_REDUCE_SET_LOC( INT2,  int2 );
+    OCOMS_REDUCE_SET_LOC( INT4,  int4 );
+    OCOMS_REDUCE_SET_LOC( INT8,  int8 );
+    OCOMS_REDUCE_SET_LOC( UINT1, uint1 );
+    OCOMS_REDUCE_SET_LOC( UINT2, uint2 );
+    OCOMS_REDUCE_SET_LOC( UINT4, uint4 );
+    OCOMS_REDUCE_SET_LOC( UINT8, uint8 );
+    OCOMS_REDUCE_SET_LOC_FLOAT4();
+    OCOMS_REDUCE_SET_LOC_FLOAT8();
+}
+
+static int ocoms_datatype_reduce_supported( int variant )
+{
+    switch( variant ) {
+    case OCOMS_DATATYPE_REDUCE_GENERIC:
+        return 1;
+#if OCOMS_DATATYPE_REDUCE_X86
+    case OCOMS_DATATYPE_REDUCE_AVX2:
+        return __builtin_cpu_supports( "avx2" );
+    case OCOMS_DATATYPE_REDUCE_AVX512:
+        return __builtin_cpu_supports( "avx512f" ) && __builtin_cpu_supports( "avx512bw" ) &&
+               __builtin_cpu_supports( "avx512dq" ) && __builtin_cpu_supports( "avx512vl" );
+#endif  /* OCOMS_DATATYPE_REDUCE_X86 */
+    }
+    return 0;
+}
+
+int32_t ocoms_datatype_reduce_init( void )
+{
+    int variant = ocoms_datatype_reduce_variant;
+
+    /* fall back on the best supported variant below the requested one */
+    if( OCOMS_DATATYPE_REDUCE_AUTO == variant ) variant = OCOMS_DATATYPE_REDUCE_AVX512;
+    while( !ocoms_datatype_reduce_supported( variant ) ) variant--;
+    ocoms_datatype_reduce_variant = variant;
+
+    ocoms_datatype_reduce_set_generic();
+#if OCOMS_DATATYPE_REDUCE_X86
+    if( OCOMS_DATATYPE_REDUCE_AVX2 == variant ) {
+        OCOMS_REDUCE_SET_VECTOR( avx2 );
+    } else if( OCOMS_DATATYPE_REDUCE_AVX512 == variant ) {
+        OCOMS_REDUCE_SET_VECTOR( avx512 );
+    }
+#endif  /* OCOMS_DATATYPE_REDUCE_X86 */
+    return OCOMS_SUCCESS;
+}
+
+int32_t ocoms_datatype_reduce( int op, const ocoms_datatype_t* datatype,
+                               const void* in, void* inout, size_t count )
+{
+    ocoms_datatype_reduce_fct_t fct;
+
+    if( (op < 0) || (op >= OCOMS_DATATYPE_OP_NUM) ) return OCOMS_ERR_BAD_PARAM;
+    if( !(datatype->flags & OCOMS_DATATYPE_FLAG_PREDEFINED) ||
+        (datatype->id >= OCOMS_DATATYPE_MAX_PREDEFINED) ) return OCOMS_ERR_NOT_SUPPORTED;
+    fct = ocoms_datatype_reduce_functions[op][datatype->id];
+    if( NULL == fct ) return OCOMS_ERR_NOT_SUPPORTED;
+    fct( in, inout, count );
+    return OCOMS_SUCCESS;
+}
@@ -0,0 +1,91 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2004-2009 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef OCOMS_DATATYPE_REDUCE_H_HAS_BEEN_INCLUDED
+#define OCOMS_DATATYPE_REDUCE_H_HAS_BEEN_INCLUDED
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stddef.h>
+
+#include "ocoms/datatype/ocoms_datatype.h"
+
+BEGIN_C_DECLS
+
+/**
+ * Reduction operations on the predefined datatypes.
+ *
+ * The logical operations apply to the integers and to bool, the bitwise
+ * ones to the integers, SUM and PROD to every number, MIN and MAX to the
+ * integers and the reals. MINLOC and MAXLOC work on pairs laid out as a
+ * C structure of the value followed by an int index (the MPI_DOUBLE_INT
+ * layout for ocoms_datatype_float8); on equal values they keep the
+ * lowest index.
+ */
+enum {
+    OCOMS_DATATYPE_OP_SUM = 0,
+    OCOMS_DATATYPE_OP_PROD,
+    OCOMS_DATATYPE_OP_MIN,
+    OCOMS_DATATYPE_OP_MAX,
+    OCOMS_DATATYPE_OP_LAND,
+    OCOMS_DATATYPE_OP_LOR,
+    OCOMS_DATATYPE_OP_LXOR,
+    OCOMS_DATATYPE_OP_BAND,
+    OCOMS_DATATYPE_OP_BOR,
+    OCOMS_DATATYPE_OP_BXOR,
+    OCOMS_DATATYPE_OP_MINLOC,
+    OCOMS_DATATYPE_OP_MAXLOC,
+    OCOMS_DATATYPE_OP_NUM               /**< number of operations */
+};
+
+/**
+ * Kernel variants, selected by ocoms_datatype_reduce_init() from the
+ * ddt_reduce MCA variable and the processor features.
+ */
+enum {
+    OCOMS_DATATYPE_REDUCE_AUTO = 0,     /**< best supported by the processor */
+    OCOMS_DATATYPE_REDUCE_GENERIC,      /**< the compiler's default target (NEON on ARMv8) */
+    OCOMS_DATATYPE_REDUCE_AVX2,         /**< 256 bits vectors */
+    OCOMS_DATATYPE_REDUCE_AVX512        /**< 512 bits vectors */
+};
+
+/**
+ * inout[i] = in[i] op inout[i] for the count elements of the arrays,
+ * which must not overlap.
+ */
+typedef void (*ocoms_datatype_reduce_fct_t)( const void* in, void* inout, size_t count );
+
+/** The kernels by operation and predefined type id, NULL when the
+ *  operation is not defined on the type */
+OCOMS_DECLSPEC extern ocoms_datatype_reduce_fct_t
+ocoms_datatype_reduce_functions[OCOMS_DATATYPE_OP_NUM][OCOMS_DATATYPE_MAX_PREDEFINED];
+/** Requested variant (MCA ddt_reduce), the selected one after init */
+OCOMS_DECLSPEC extern int ocoms_datatype_reduce_variant;
+
+/**
+ * Select the kernels, called by ocoms_datatype_init().
+ */
+int32_t ocoms_datatype_reduce_init( void );
+
+/**
+ * Reduce count elements of a predefined datatype: inout = in op inout.
+ * Return OCOMS_ERR_NOT_SUPPORTED for the derived datatypes and for the
+ * operations not defined on the type.
+ */
+OCOMS_DECLSPEC int32_t ocoms_datatype_reduce( int op, const ocoms_datatype_t* datatype,
+                                              const void* in, void* inout, size_t count );
+
+END_C_DECLS
+
+#endif  /* OCOMS_DATATYPE_REDUCE_H_HAS_BEEN_INCLUDED */
@@ -57,6 +57,65 @@ extern bool ocoms_unpack_debug;
  * of times the datatype is involved in the operation (ie. the count argument
  * in the MPI_ call).
  */
+
+/*
+ * Convert the remaining count_desc elements of the current datatype and
+ * the elements of all the following ones at once, for the datatypes made
+ * of a single element spanning their whole extent (the predefined ones).
+ * Return 1 when everything has been converted, the stack then stands on
+ * the last datatype, 0 when the input was exhausted before.
+ */
+static inline int32_t
+ocoms_unpack_general_single( ocoms_convertor_t* pConvertor, dt_stack_t* pStack,
+                             const dt_elem_desc_t* pElem,
+                             int32_t* count_desc, OCOMS_PTRDIFF_TYPE* disp_desc,
+                             char* pInput, size_t iCount, size_t oCount,
+                             OCOMS_PTRDIFF_TYPE extent, OCOMS_PTRDIFF_TYPE* advance )
+{
+    const ocoms_convertor_master_t* master = pConvertor->master;
+    int type = pElem->elem.common.type;
+    OCOMS_PTRDIFF_TYPE length;
+    size_t repeat, done;
+    int32_t rc;
+
+    *advance = 0;
+    while( 1 ) {
+        /* the conversion functions take a 32 bits count */
+        repeat = pStack->count - 1;
+        if( repeat > (size_t)(INT32_MAX - *count_desc) / pElem->elem.count )
+            repeat = (size_t)(INT32_MAX - *count_desc) / pElem->elem.count;
+        done = *count_desc + repeat * pElem->elem.count;
+        rc = master->pFunctions[type]( pConvertor, (uint32_t)done,
+                                       pInput, iCount, ocoms_datatype_basicDatatypes[type]->size,
+                                       pConvertor->pBaseBuf + pStack->disp + *disp_desc,
+                                       oCount, pElem->elem.extent, &length );
+        *advance += length;
+        pInput   += length;
+        iCount   -= length;
+        if( (size_t)rc != done ) break;
+        pStack->count -= repeat;
+        pStack->disp  += repeat * extent;
+        if( 1 == pStack->count ) return 1;
+        /* the count was truncated, continue with the next datatype */
+        pStack->count--;
+        pStack->disp += extent;
+        *count_desc = pElem->elem.count;
+        *disp_desc  = pElem->elem.disp;
+    }
+    if( rc < *count_desc ) {
+        *count_desc -= rc;
+        *disp_desc  += rc * pElem->elem.extent;
+        return 0;
+    }
+    done = (rc - *count_desc) / pElem->elem.count + 1;  /* the datatypes completed */
+    rc   = (rc - *count_desc) % pElem->elem.count;      /* the elements in the next one */
+    pStack->count -= done;
+    pStack->disp  += done * extent;
+    *count_desc = pElem->elem.count - rc;
+    *disp_desc  = pElem->elem.disp + rc * pElem->elem.extent;
+    return 0;
+}
+
 /* Convert data from multiple input buffers (as received from the network layer)
  * to a contiguous output buffer with a predefined size.
  * return OCOMS_SUCCESS if everything went OK and if there is still room before the complete
@@ -137,6 +196,25 @@ ocoms_unpack_general_function( ocoms_convertor_t* pConvertor,
             while( description[pos_desc].elem.common.flags & OCOMS_DATATYPE_FLAG_DATA ) {
                 /* now here we have a basic datatype */
                 type = description[pos_desc].elem.common.type;
+                if( (0 == pos_desc) && (0 == pConvertor->stack_pos) &&
+                    (OCOMS_DATATYPE_END_LOOP == description[1].elem.common.type) &&
+                    ((description[0].elem.count * description[0].elem.extent) == extent) ) {
+                    /* A single element covering the whole extent: the following
+                     * datatypes continue it, convert them all in one call. */
+                    rc = ocoms_unpack_general_single( pConvertor, pStack, &description[0],
+                                                      &count_desc, &disp_desc, pInput, iCount,
+                                                      oCount, extent, &advance );
+                    iCount -= advance;
+                    pInput += advance;
+                    bConverted += advance;
+                    if( !rc ) goto save_and_return;
+                    pos_desc++;
+                    count_desc = description[pos_desc].elem.count;
+                    disp_desc = description[pos_desc].elem.disp;
+                    if( iCount == 0 )
+                        goto save_and_return;
+                    continue;
+                }
                 rc = master->pFunctions[type]( pConvertor, count_desc,
                                                pInput, iCount, ocoms_datatype_basicDatatypes[type]->size,
                                                pConvertor->pBaseBuf + pStack->disp + disp_desc,
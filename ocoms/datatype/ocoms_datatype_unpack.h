@@ -29,6 +29,8 @@
 #undef MEMCPY_CSUM
 #define MEMCPY_CSUM( DST, SRC, BLENGTH, CONVERTOR ) \
     CONVERTOR->cbmemcpy( (DST), (SRC), (BLENGTH), (CONVERTOR) )
+#undef MEMCPY_STRIDED
+#define MEMCPY_STRIDED( DST, DST_STRIDE, SRC, SRC_STRIDE, BLENGTH, COUNT ) 0
 #endif
 
 #include "ocoms/datatype/ocoms_convertor.h"
@@ -62,6 +64,14 @@ static inline void unpack_predefined_data( ocoms_convertor_t* CONVERTOR, /* the
         MEMCPY_CSUM( _destination, *(SOURCE), _copy_blength, (CONVERTOR) );
         *(SOURCE)    += _copy_blength;
         _destination += _copy_blength;
+    } else if( MEMCPY_STRIDED( _destination, _elem->extent, *(SOURCE),
+                               (OCOMS_PTRDIFF_TYPE)_copy_blength, _copy_blength, _copy_count ) ) {
+        /* all the elements at once */
+        OCOMS_DATATYPE_SAFEGUARD_POINTER( _destination + (_copy_count - 1) * _elem->extent, _copy_blength,
+                                    (CONVERTOR)->pBaseBuf, (CONVERTOR)->pDesc, (CONVERTOR)->count );
+        _destination  += _copy_count * _elem->extent;
+        _copy_blength *= _copy_count;
+        *(SOURCE)     += _copy_blength;
     } else {
         uint32_t _i;
         for( _i = 0; _i < _copy_count; _i++ ) {
@@ -95,7 +105,15 @@ static inline void unpack_contiguous_loop( ocoms_convertor_t* CONVERTOR,
 
     if( (_copy_loops * _end_loop->size) > *(SPACE) )
         _copy_loops = (uint32_t)(*(SPACE) / _end_loop->size);
-    for( _i = 0; _i < _copy_loops; _i++ ) {
+    _i = 0;
+    if( (_copy_loops > 0) &&
+        MEMCPY_STRIDED( _destination, _loop->extent, *(SOURCE), (OCOMS_PTRDIFF_TYPE)_end_loop->size,
+                        _end_loop->size, _copy_loops ) ) {
+        *(SOURCE)    += _copy_loops * _end_loop->size;
+        _destination += _copy_loops * _loop->extent;
+        _i = _copy_loops;
+    }
+    for( ; _i < _copy_loops; _i++ ) {
         OCOMS_DATATYPE_SAFEGUARD_POINTER( _destination, _end_loop->size, (CONVERTOR)->pBaseBuf,
                                     (CONVERTOR)->pDesc, (CONVERTOR)->count );
         DO_DEBUG( ocoms_output( 0, "unpack 3. memcpy( %p, %p, %lu ) => space %lu\n",
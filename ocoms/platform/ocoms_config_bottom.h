@@ -258,6 +258,19 @@
 #include "ocoms_stdint.h"
 #endif
 
+/*
+ * 128-bit integer type, used by the 128-bit atomic compare-and-swap
+ */
+#if defined(HAVE_INT128_T)
+typedef int128_t ocoms_int128_t;
+#define HAVE_OCOMS_INT128_T 1
+#elif defined(HAVE___INT128)
+typedef __int128 ocoms_int128_t;
+#define HAVE_OCOMS_INT128_T 1
+#else
+#define HAVE_OCOMS_INT128_T 0
+#endif
+
 /***********************************************************************
  *
  * Code that is only for when building Open MPI or utilities that are
@@ -20,6 +20,12 @@
 #ifndef OCOMS_HASH_STRING_H
 #define OCOMS_HASH_STRING_H
 
+#include "ocoms/platform/ocoms_config.h"
+
+#include <string.h>
+
+#include "ocoms/primitives/prefetch.h"
+
 /**
  *  Compute the hash value and the string length simultaneously
  *
@@ -68,4 +74,140 @@
         (hash) = (_hash + (_hash << 15));     \
     } while(0)
 
+/*
+ * Word-at-a-time hashing of arbitrary byte strings, after wyhash by
+ * Wang Yi.  The input is consumed 8 bytes (48 bytes in the main loop)
+ * at a time and every step is a 64x64->128 bit multiply folded back to
+ * 64 bits, which mixes much better than the per-character hashes
+ * above on keys sharing a long common prefix.  The result depends on
+ * the byte order of the host and must not be sent over the wire.
+ */
+
+#define OCOMS_HASH_P0 0xa0761d6478bd642fULL
+#define OCOMS_HASH_P1 0xe7037ed1a0b428dbULL
+#define OCOMS_HASH_P2 0x8ebc6af09c88c6e3ULL
+#define OCOMS_HASH_P3 0x589965cc75374cc3ULL
+
+static inline void ocoms_hash_mum(uint64_t *a, uint64_t *b)
+{
+#if defined(HAVE___INT128)
+    unsigned __int128 r = (unsigned __int128)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), lo, c = t < rl;
+
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t ocoms_hash_mix(uint64_t a, uint64_t b)
+{
+    ocoms_hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t ocoms_hash_read8(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t ocoms_hash_read4(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ *  Compute a 64 bit hash value of a byte string
+ *
+ *  @param key (IN)     The bytes to hash
+ *  @param len (IN)     The number of bytes
+ *  @param seed (IN)    Seed of the hash
+ *  @return             The hash value
+ */
+static inline uint64_t ocoms_hash_bytes(const void *key, size_t len, uint64_t seed)
+{
+    const unsigned char *p = (const unsigned char *)key;
+    uint64_t a, b;
+    size_t i;
+
+    seed ^= ocoms_hash_mix(seed ^ OCOMS_HASH_P0, OCOMS_HASH_P1);
+    if (OCOMS_LIKELY(len <= 16)) {
+        if (OCOMS_LIKELY(len >= 4)) {
+            a = (ocoms_hash_read4(p) << 32) | ocoms_hash_read4(p + ((len >> 3) << 2));
+            b = (ocoms_hash_read4(p + len - 4) << 32) |
+                ocoms_hash_read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (OCOMS_LIKELY(len > 0)) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        i = len;
+        if (OCOMS_UNLIKELY(i > 48)) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = ocoms_hash_mix(ocoms_hash_read8(p) ^ OCOMS_HASH_P1,
+                                      ocoms_hash_read8(p + 8) ^ seed);
+                see1 = ocoms_hash_mix(ocoms_hash_read8(p + 16) ^ OCOMS_HASH_P2,
+                                      ocoms_hash_read8(p + 24) ^ see1);
+                see2 = ocoms_hash_mix(ocoms_hash_read8(p + 32) ^ OCOMS_HASH_P3,
+                                      ocoms_hash_read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (OCOMS_LIKELY(i > 48));
+            seed ^= see1 ^ see2;
+        }
+        while (OCOMS_UNLIKELY(i > 16)) {
+            seed = ocoms_hash_mix(ocoms_hash_read8(p) ^ OCOMS_HASH_P1,
+                                  ocoms_hash_read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = ocoms_hash_read8(p + i - 16);
+        b = ocoms_hash_read8(p + i - 8);
+    }
+    a ^= OCOMS_HASH_P1;
+    b ^= seed;
+    ocoms_hash_mum(&a, &b);
+    return ocoms_hash_mix(a ^ OCOMS_HASH_P0 ^ len, b ^ OCOMS_HASH_P1);
+}
+
+/**
+ *  Compute a 64 bit hash value of a string with ocoms_hash_bytes
+ *
+ *  @param str (IN)     The string which will be parsed   (char*)
+ *  @param hash (OUT)   Where the hash value will be stored (uint64_t)
+ */
+#define OCOMS_HASH_STR64( str, hash )                                   \
+    do {                                                                \
+        const char *_str = (str);                                       \
+        (hash) = ocoms_hash_bytes(_str, strlen(_str), 0);               \
+    } while(0)
+
+/**
+ *  Compute the 64 bit hash value and the string length simultaneously
+ *
+ *  @param str (IN)     The string which will be parsed   (char*)
+ *  @param hash (OUT)   Where the hash value will be stored (uint64_t)
+ *  @param length (OUT) The computed length of the string (uint32_t)
+ */
+#define OCOMS_HASH_STRLEN64( str, hash, length )                        \
+    do {                                                                \
+        const char *_str = (str);                                       \
+        size_t _len = strlen(_str);                                     \
+        (hash) = ocoms_hash_bytes(_str, _len, 0);                       \
+        (length) = (uint32_t)_len;                                      \
+    } while(0)
+
 #endif  /* OCOMS_HASH_STRING_H */
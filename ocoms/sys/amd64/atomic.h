@@ -126,6 +126,45 @@ static inline int ocoms_atomic_cmpset_64( volatile int64_t *addr,
 #define ocoms_atomic_cmpset_acq_64 ocoms_atomic_cmpset_64
 #define ocoms_atomic_cmpset_rel_64 ocoms_atomic_cmpset_64
 
+#if OCOMS_GCC_INLINE_ASSEMBLY && OCOMS_HAVE_CMPXCHG16B && HAVE_OCOMS_INT128_T
+
+static inline int ocoms_atomic_cmpset_128 (volatile ocoms_int128_t *addr, ocoms_int128_t oldval,
+                                          ocoms_int128_t newval)
+{
+    unsigned char ret;
+    int64_t low = ((int64_t *)&oldval)[0], high = ((int64_t *)&oldval)[1];
+
+    /* cmpxchg16b compares the value at the address with rdx:rax (high:low). if the values
+     * are the same the contents of rcx:rbx are stored at the address. in all cases the
+     * value stored at the address is returned in rdx:rax, so they are outputs too. the
+     * address must be 16-byte aligned. */
+    __asm__ __volatile__ (SMPLOCK "cmpxchg16b %1   \n\t"
+                                  "sete     %0     \n\t"
+                          : "=qm" (ret), "+m" (*addr), "+a" (low), "+d" (high)
+                          : "b" (((int64_t *)&newval)[0]), "c" (((int64_t *)&newval)[1])
+                          : "memory", "cc");
+
+    return (int) ret;
+}
+
+#define OCOMS_HAVE_ATOMIC_CMPSET_128 1
+
+#endif /* OCOMS_GCC_INLINE_ASSEMBLY && OCOMS_HAVE_CMPXCHG16B && HAVE_OCOMS_INT128_T */
+
+#if OCOMS_GCC_INLINE_ASSEMBLY
+
+#define OCOMS_HAVE_ATOMIC_PAUSE 1
+
+/**
+ * Hint to the processor that we are in a spin-wait loop.
+ */
+static inline void ocoms_atomic_pause (void)
+{
+    __asm__ __volatile__ ("pause" : : : "memory");
+}
+
+#endif /* OCOMS_GCC_INLINE_ASSEMBLY */
+
 
 #if OCOMS_C_GCC_INLINE_ASSEMBLY
 
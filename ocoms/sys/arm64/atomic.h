@@ -282,6 +282,71 @@ static inline int ocoms_atomic_sc_64 (volatile int64_t *addr, int64_t newval)
     return ret == 0;
 }
 
+#if HAVE_OCOMS_INT128_T
+
+#define OCOMS_HAVE_ATOMIC_CMPSET_128 1
+
+#if defined(__ARM_FEATURE_ATOMICS)
+
+/* ARMv8.1 LSE: a single compare-and-swap pair instruction */
+static inline int ocoms_atomic_cmpset_128 (volatile ocoms_int128_t *addr, ocoms_int128_t oldval,
+                                          ocoms_int128_t newval)
+{
+    register int64_t old_lo __asm__ ("x0") = (int64_t) oldval;
+    register int64_t old_hi __asm__ ("x1") = (int64_t) (oldval >> 64);
+    register int64_t new_lo __asm__ ("x2") = (int64_t) newval;
+    register int64_t new_hi __asm__ ("x3") = (int64_t) (newval >> 64);
+    int64_t exp_lo = old_lo, exp_hi = old_hi;
+
+    __asm__ __volatile__ ("caspal   %0, %1, %2, %3, [%4]  \n"
+                          : "+r" (old_lo), "+r" (old_hi)
+                          : "r" (new_lo), "r" (new_hi), "r" (addr)
+                          : "memory");
+
+    return (old_lo == exp_lo && old_hi == exp_hi);
+}
+
+#else
+
+static inline int ocoms_atomic_cmpset_128 (volatile ocoms_int128_t *addr, ocoms_int128_t oldval,
+                                          ocoms_int128_t newval)
+{
+    int64_t old_lo = (int64_t) oldval, old_hi = (int64_t) (oldval >> 64);
+    int64_t new_lo = (int64_t) newval, new_hi = (int64_t) (newval >> 64);
+    int64_t prev_lo, prev_hi;
+    int tmp;
+
+    /* the pair must be written back even when the comparison fails so that the
+     * exclusive monitor is cleared and the observed value is single-copy atomic */
+    __asm__ __volatile__ ("1:  ldaxp    %0, %1, [%3]       \n"
+                          "    cmp      %0, %4             \n"
+                          "    ccmp     %1, %5, #0, eq     \n"
+                          "    bne      2f                 \n"
+                          "    stlxp    %w2, %6, %7, [%3]  \n"
+                          "    cbnz     %w2, 1b            \n"
+                          "    b        3f                 \n"
+                          "2:  stlxp    %w2, %0, %1, [%3]  \n"
+                          "    cbnz     %w2, 1b            \n"
+                          "3:                              \n"
+                          : "=&r" (prev_lo), "=&r" (prev_hi), "=&r" (tmp)
+                          : "r" (addr), "r" (old_lo), "r" (old_hi),
+                            "r" (new_lo), "r" (new_hi)
+                          : "cc", "memory");
+
+    return (prev_lo == old_lo && prev_hi == old_hi);
+}
+
+#endif /* __ARM_FEATURE_ATOMICS */
+
+#endif /* HAVE_OCOMS_INT128_T */
+
+#define OCOMS_HAVE_ATOMIC_PAUSE 1
+
+static inline void ocoms_atomic_pause (void)
+{
+    __asm__ __volatile__ ("yield" : : : "memory");
+}
+
 #define OCOMS_ASM_MAKE_ATOMIC(type, bits, name, inst, reg)                   \
     static inline type ocoms_atomic_ ## name ## _ ## bits (volatile type *addr, type value) \
     {                                                                   \
@@ -38,6 +38,7 @@
  *  - \c OCOMS_HAVE_ATOMIC_SPINLOCKS atomic spinlocks
  *  - \c OCOMS_HAVE_ATOMIC_MATH_32 if 32 bit add/sub/cmpset can be done "atomicly"
  *  - \c OCOMS_HAVE_ATOMIC_MATH_64 if 64 bit add/sub/cmpset can be done "atomicly"
+ *  - \c OCOMS_HAVE_ATOMIC_CMPSET_128 if a 128 bit cmpset can be done "atomicly"
  *
  * Note that for the Atomic math, atomic add/sub may be implemented as
  * C code using ocoms_atomic_cmpset.  The appearance of atomic
@@ -203,8 +204,22 @@ enum {
 #ifndef OCOMS_HAVE_ATOMIC_LLSC_64
 #define OCOMS_HAVE_ATOMIC_LLSC_64 0
 #endif
+#ifndef OCOMS_HAVE_ATOMIC_PAUSE
+#define OCOMS_HAVE_ATOMIC_PAUSE 0
+#endif
 #endif /* DOXYGEN */
 
+#if !OCOMS_HAVE_ATOMIC_PAUSE && !defined(DOXYGEN)
+/* no spin-wait hint available: a compiler barrier keeps the wait loop
+   from being optimized away */
+static inline void ocoms_atomic_pause(void)
+{
+#if OCOMS_GCC_INLINE_ASSEMBLY
+    __asm__ __volatile__ ("" : : : "memory");
+#endif
+}
+#endif
+
 /**********************************************************************
  *
  * Memory Barriers - defined here if running doxygen or have barriers
@@ -393,6 +408,24 @@ int ocoms_atomic_cmpset_rel_64(volatile int64_t *addr, int64_t oldval,
 
 #endif
 
+#if defined(DOXYGEN) || OCOMS_HAVE_ATOMIC_CMPSET_128
+
+/**
+ * Atomic compare and set of a 128-bit value.
+ *
+ * \note The address must be aligned on a 16-byte boundary.
+ *
+ * @param addr          Address of the 128-bit value.
+ * @param oldval        Comparison value.
+ * @param newval        New value to set if comparision is true.
+ * @return              1 if the value was set, 0 otherwise.
+ */
+static inline int ocoms_atomic_cmpset_128(volatile ocoms_int128_t *addr,
+                                         ocoms_int128_t oldval,
+                                         ocoms_int128_t newval);
+
+#endif
+
 #if !defined(OCOMS_HAVE_ATOMIC_MATH_32) && !defined(DOXYGEN)
   /* define to 0 for these tests.  WIll fix up later. */
   #define OCOMS_HAVE_ATOMIC_MATH_32 0
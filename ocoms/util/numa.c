@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ * 
+ * Additional copyrights may follow
+ * 
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/sys/atomic.h"
+#include "ocoms/util/numa.h"
+
+#define OCOMS_NUMA_SYSFS_NODE_DIR "/sys/devices/system/node"
+
+/* from <numaif.h>, which we do not want to depend on */
+#define OCOMS_NUMA_MPOL_PREFERRED 1
+#define OCOMS_NUMA_MPOL_MF_MOVE   (1 << 1)
+
+static volatile int32_t numa_initialized = 0;
+static ocoms_atomic_lock_t numa_lock = { { OCOMS_ATOMIC_UNLOCKED } };
+static int numa_num_nodes = 1;
+static int numa_num_cpus = 0;
+static int *numa_cpu_to_node = NULL;
+
+/* Parse a sysfs cpulist ("0-3,8,10-11") and record node for each cpu */
+static void numa_parse_cpulist(const char *list, int node)
+{
+    const char *p = list;
+    char *end;
+    long first, last, cpu;
+    int *tmp;
+
+    while (*p != '\0' && *p != '\n') {
+        first = strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            return;
+        }
+        last = first;
+        if ('-' == *end) {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) {
+                return;
+            }
+        }
+        if (last >= numa_num_cpus) {
+            tmp = (int*)realloc(numa_cpu_to_node, (last + 1) * sizeof(int));
+            if (NULL == tmp) {
+                return;
+            }
+            for (cpu = numa_num_cpus; cpu <= last; cpu++) {
+                tmp[cpu] = 0;
+            }
+            numa_cpu_to_node = tmp;
+            numa_num_cpus = (int)last + 1;
+        }
+        for (cpu = first; cpu <= last; cpu++) {
+            numa_cpu_to_node[cpu] = node;
+        }
+        p = (',' == *end) ? end + 1 : end;
+    }
+}
+
+static void numa_init(void)
+{
+#ifdef HAVE_DIRENT_H
+    DIR *dir;
+    struct dirent *entry;
+    char path[256], line[4096];
+    FILE *fp;
+    int node;
+#endif
+
+    if (numa_initialized) {
+        return;
+    }
+    ocoms_atomic_lock(&numa_lock);
+    if (numa_initialized) {
+        ocoms_atomic_unlock(&numa_lock);
+        return;
+    }
+
+#ifdef HAVE_DIRENT_H
+    dir = opendir(OCOMS_NUMA_SYSFS_NODE_DIR);
+    if (NULL != dir) {
+        while (NULL != (entry = readdir(dir))) {
+            if (0 != strncmp(entry->d_name, "node", 4) ||
+                1 != sscanf(entry->d_name + 4, "%d", &node) || node < 0) {
+                continue;
+            }
+            if (node + 1 > numa_num_nodes) {
+                numa_num_nodes = node + 1;
+            }
+            snprintf(path, sizeof(path), OCOMS_NUMA_SYSFS_NODE_DIR "/node%d/cpulist", node);
+            fp = fopen(path, "r");
+            if (NULL == fp) {
+                continue;
+            }
+            if (NULL != fgets(line, sizeof(line), fp)) {
+                numa_parse_cpulist(line, node);
+            }
+            fclose(fp);
+        }
+        closedir(dir);
+    }
+#endif
+
+    ocoms_atomic_wmb();
+    numa_initialized = 1;
+    ocoms_atomic_unlock(&numa_lock);
+}
+
+int ocoms_numa_get_num_nodes(void)
+{
+    numa_init();
+    return numa_num_nodes;
+}
+
+int ocoms_numa_get_current_node(void)
+{
+#ifdef HAVE_SCHED_GETCPU
+    int cpu;
+
+    numa_init();
+    if (1 == numa_num_nodes) {
+        return 0;
+    }
+    cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= numa_num_cpus) {
+        return 0;
+    }
+    return numa_cpu_to_node[cpu];
+#else
+    return 0;
+#endif
+}
+
+int ocoms_numa_bind_memory(void *addr, size_t len, int node)
+{
+#if defined(SYS_mbind) && defined(HAVE_SYSCONF)
+    unsigned long mask[4];
+    unsigned long nbits = sizeof(mask) * 8;
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)addr + page - 1) & ~(page - 1);
+    uintptr_t end = ((uintptr_t)addr + len) & ~(page - 1);
+
+    if (end <= start) {
+        return OCOMS_SUCCESS;
+    }
+    if (node < 0 || (unsigned long)node >= nbits) {
+        return OCOMS_ERR_BAD_PARAM;
+    }
+    memset(mask, 0, sizeof(mask));
+    mask[node / (sizeof(unsigned long) * 8)] = 1UL << (node % (sizeof(unsigned long) * 8));
+    if (0 != syscall(SYS_mbind, (void*)start, (unsigned long)(end - start),
+                     OCOMS_NUMA_MPOL_PREFERRED, mask, nbits + 1,
+                     OCOMS_NUMA_MPOL_MF_MOVE)) {
+        return OCOMS_ERR_NOT_SUPPORTED;
+    }
+    return OCOMS_SUCCESS;
+#else
+    return OCOMS_ERR_NOT_SUPPORTED;
+#endif
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ * 
+ * Additional copyrights may follow
+ * 
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * Minimal NUMA topology and memory placement support.
+ *
+ * The topology is read from /sys/devices/system/node the first time
+ * it is needed.  On systems without this information every CPU is
+ * reported on node 0 and memory binding is a no-op.
+ */
+
+#ifndef OCOMS_UTIL_NUMA_H_
+#define OCOMS_UTIL_NUMA_H_
+
+#include "ocoms/platform/ocoms_config.h"
+
+BEGIN_C_DECLS
+
+/**
+ * Return the number of NUMA nodes of the host (at least 1).
+ */
+OCOMS_DECLSPEC int ocoms_numa_get_num_nodes(void);
+
+/**
+ * Return the NUMA node of the CPU the calling thread is running on.
+ */
+OCOMS_DECLSPEC int ocoms_numa_get_current_node(void);
+
+/**
+ * Prefer node-local placement for a range of memory.
+ *
+ * @param addr Start of the range
+ * @param len  Length of the range in bytes
+ * @param node NUMA node the pages should be placed on
+ *
+ * @returns OCOMS_SUCCESS if the policy was applied (or the range
+ *          contains no whole page).
+ * @returns OCOMS_ERR_NOT_SUPPORTED if the system cannot bind memory.
+ *
+ * Only the pages entirely contained in the range are affected. Pages
+ * that have not been touched yet will be allocated on the node when
+ * they are first touched; pages already in memory are migrated.
+ */
+OCOMS_DECLSPEC int ocoms_numa_bind_memory(void *addr, size_t len, int node);
+
+END_C_DECLS
+
+#endif
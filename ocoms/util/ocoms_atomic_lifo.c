@@ -25,7 +25,8 @@ static void ocoms_atomic_lifo_construct( ocoms_atomic_lifo_t* lifo )
 {
     OBJ_CONSTRUCT( &(lifo->ocoms_lifo_ghost), ocoms_list_item_t );
     lifo->ocoms_lifo_ghost.ocoms_list_next = &(lifo->ocoms_lifo_ghost);
-    lifo->ocoms_lifo_head = &(lifo->ocoms_lifo_ghost);
+    lifo->ocoms_lifo_head.data.item = &(lifo->ocoms_lifo_ghost);
+    lifo->ocoms_lifo_head.data.counter = 0;
 }
 
 OBJ_CLASS_INSTANCE( ocoms_atomic_lifo_t,
@@ -32,6 +32,34 @@
 
 BEGIN_C_DECLS
 
+/* When the processor provides a 128-bit compare-and-swap the head of the
+ * LIFO is a (pointer, counter) pair. Every pop increments the counter, so
+ * a head that was popped and pushed back in between our read and our
+ * compare-and-swap will no longer match, and the ABA problem is solved
+ * with a single atomic operation per push or pop.
+ */
+#if OCOMS_ENABLE_MULTI_THREADS && OCOMS_HAVE_ATOMIC_CMPSET_128 && OCOMS_WANT_LIFO_CMPSET_128
+#define OCOMS_ATOMIC_LIFO_COUNTED_HEAD 1
+#else
+#define OCOMS_ATOMIC_LIFO_COUNTED_HEAD 0
+#endif
+
+/* Upper bound (in pause iterations) of the exponential backoff applied
+ * after a failed compare-and-swap on the head.
+ */
+#define OCOMS_ATOMIC_LIFO_MAX_BACKOFF 1024
+
+union ocoms_counted_pointer_t {
+    struct {
+        ocoms_list_item_t * volatile item;
+        volatile intptr_t counter;
+    } data;
+#if OCOMS_ATOMIC_LIFO_COUNTED_HEAD
+    ocoms_int128_t value;
+#endif
+};
+typedef union ocoms_counted_pointer_t ocoms_counted_pointer_t;
+
 /* Atomic Last In First Out lists. If we are in a multi-threaded environment then the
  * atomicity is insured via the compare-and-swap operation, if not we simply do a read
  * and/or a write.
@@ -43,9 +71,9 @@ BEGIN_C_DECLS
  */
 struct ocoms_atomic_lifo_t
 {
-    ocoms_object_t     super;
-    ocoms_list_item_t* ocoms_lifo_head;
-    ocoms_list_item_t  ocoms_lifo_ghost;
+    ocoms_object_t          super;
+    ocoms_counted_pointer_t ocoms_lifo_head;
+    ocoms_list_item_t       ocoms_lifo_ghost;
 };
 
 typedef struct ocoms_atomic_lifo_t ocoms_atomic_lifo_t;
@@ -59,9 +87,163 @@ OCOMS_DECLSPEC OBJ_CLASS_DECLARATION(ocoms_atomic_lifo_t);
  */
 static inline bool ocoms_atomic_lifo_is_empty( ocoms_atomic_lifo_t* lifo )
 {
-    return (lifo->ocoms_lifo_head == &(lifo->ocoms_lifo_ghost) ? true : false);
+    return (lifo->ocoms_lifo_head.data.item == &(lifo->ocoms_lifo_ghost) ? true : false);
+}
+
+#if OCOMS_ENABLE_MULTI_THREADS
+/* Back off after a failed compare-and-swap on the head. The delay doubles
+ * on every consecutive failure, up to OCOMS_ATOMIC_LIFO_MAX_BACKOFF.
+ */
+static inline void ocoms_atomic_lifo_backoff( int* delay )
+{
+    int i;
+
+    for( i = 0; i < *delay; i++ ) {
+        ocoms_atomic_pause();
+    }
+    if( *delay < OCOMS_ATOMIC_LIFO_MAX_BACKOFF ) {
+        *delay <<= 1;
+    }
 }
+#endif  /* OCOMS_ENABLE_MULTI_THREADS */
+
+#if OCOMS_ATOMIC_LIFO_COUNTED_HEAD
 
+static inline int ocoms_atomic_lifo_update_head( ocoms_atomic_lifo_t* lifo,
+                                                 ocoms_counted_pointer_t old,
+                                                 ocoms_list_item_t* item )
+{
+    ocoms_counted_pointer_t new_head;
+
+    new_head.data.item = item;
+    new_head.data.counter = old.data.counter + 1;
+    return ocoms_atomic_cmpset_128( &(lifo->ocoms_lifo_head.value),
+                                    old.value, new_head.value );
+}
+
+/* Add one element to the LIFO. We will return the last head of the list
+ * to allow the upper level to detect if this element is the first one in the
+ * list (if the list was empty before this operation). Only the pop side
+ * increments the counter, so a push can be done with a pointer-sized
+ * compare-and-swap on the item half of the head.
+ */
+static inline ocoms_list_item_t* ocoms_atomic_lifo_push( ocoms_atomic_lifo_t* lifo,
+                                                       ocoms_list_item_t* item )
+{
+    ocoms_list_item_t* next;
+    int delay = 1;
+
+    do {
+        next = lifo->ocoms_lifo_head.data.item;
+        item->ocoms_list_next = next;
+        ocoms_atomic_wmb();
+        if( ocoms_atomic_cmpset_ptr( &(lifo->ocoms_lifo_head.data.item),
+                                    (void*)next, item ) ) {
+            return next;
+        }
+        ocoms_atomic_lifo_backoff( &delay );
+    } while( 1 );
+}
+
+/* Add a chain of elements, already linked from first to last through
+ * ocoms_list_next, with a single compare-and-swap. Returns the previous
+ * head like ocoms_atomic_lifo_push.
+ */
+static inline ocoms_list_item_t* ocoms_atomic_lifo_push_chain( ocoms_atomic_lifo_t* lifo,
+                                                             ocoms_list_item_t* first,
+                                                             ocoms_list_item_t* last )
+{
+    ocoms_list_item_t* next;
+    int delay = 1;
+
+    do {
+        next = lifo->ocoms_lifo_head.data.item;
+        last->ocoms_list_next = next;
+        ocoms_atomic_wmb();
+        if( ocoms_atomic_cmpset_ptr( &(lifo->ocoms_lifo_head.data.item),
+                                    (void*)next, first ) ) {
+            return next;
+        }
+        ocoms_atomic_lifo_backoff( &delay );
+    } while( 1 );
+}
+
+/* Detach up to count elements with a single compare-and-swap. The chain
+ * is walked before the swap; any concurrent pop changes the counter and
+ * any push changes the pointer, so a successful swap means the walked
+ * chain was still the top of the LIFO. The detached elements are
+ * returned linked through ocoms_list_next, *last is set to the last one
+ * and the number of elements is returned.
+ */
+static inline size_t ocoms_atomic_lifo_pop_n( ocoms_atomic_lifo_t* lifo, size_t count,
+                                             ocoms_list_item_t** first,
+                                             ocoms_list_item_t** last )
+{
+    ocoms_counted_pointer_t old_head;
+    ocoms_list_item_t *item, *next;
+    size_t n;
+    int delay = 1;
+
+    if( 0 == count ) {
+        return 0;
+    }
+    do {
+        old_head.data.counter = lifo->ocoms_lifo_head.data.counter;
+        ocoms_atomic_rmb();
+        old_head.data.item = item = lifo->ocoms_lifo_head.data.item;
+
+        if( item == &(lifo->ocoms_lifo_ghost) ) {
+            return 0;
+        }
+        for( n = 1; ; n++ ) {
+            next = (ocoms_list_item_t*)item->ocoms_list_next;
+            /* NULL: the element was popped under us, the swap will fail */
+            if( n == count || NULL == next || next == &(lifo->ocoms_lifo_ghost) ) {
+                break;
+            }
+            item = next;
+        }
+        if( NULL != next &&
+            ocoms_atomic_lifo_update_head( lifo, old_head, next ) ) {
+            ocoms_atomic_wmb();
+            item->ocoms_list_next = NULL;
+            *first = old_head.data.item;
+            *last = item;
+            return n;
+        }
+        ocoms_atomic_lifo_backoff( &delay );
+    } while( 1 );
+}
+
+/* Retrieve one element from the LIFO. If we reach the ghost element then the LIFO
+ * is empty so we return NULL.
+ */
+static inline ocoms_list_item_t* ocoms_atomic_lifo_pop( ocoms_atomic_lifo_t* lifo )
+{
+    ocoms_counted_pointer_t old_head;
+    ocoms_list_item_t* item;
+    int delay = 1;
+
+    do {
+        old_head.data.counter = lifo->ocoms_lifo_head.data.counter;
+        ocoms_atomic_rmb();
+        old_head.data.item = item = lifo->ocoms_lifo_head.data.item;
+
+        if( item == &(lifo->ocoms_lifo_ghost) ) {
+            return NULL;
+        }
+
+        if( ocoms_atomic_lifo_update_head( lifo, old_head,
+                                           (ocoms_list_item_t*)item->ocoms_list_next ) ) {
+            ocoms_atomic_wmb();
+            item->ocoms_list_next = NULL;
+            return item;
+        }
+        ocoms_atomic_lifo_backoff( &delay );
+    } while( 1 );
+}
+
+#else
 
 /* Add one element to the LIFO. We will return the last head of the list
  * to allow the upper level to detect if this element is the first one in the
@@ -71,20 +253,22 @@ static inline ocoms_list_item_t* ocoms_atomic_lifo_push( ocoms_atomic_lifo_t* li
                                                        ocoms_list_item_t* item )
 {
 #if OCOMS_ENABLE_MULTI_THREADS
+    int delay = 1;
+
     do {
-        item->ocoms_list_next = lifo->ocoms_lifo_head;
+        item->ocoms_list_next = lifo->ocoms_lifo_head.data.item;
         ocoms_atomic_wmb();
-        if( ocoms_atomic_cmpset_ptr( &(lifo->ocoms_lifo_head),
+        if( ocoms_atomic_cmpset_ptr( &(lifo->ocoms_lifo_head.data.item),
                                     (void*)item->ocoms_list_next,
                                     item ) ) {
             ocoms_atomic_cmpset_32((volatile int32_t*)&item->item_free, 1, 0);
             return (ocoms_list_item_t*)item->ocoms_list_next;
         }
-        /* DO some kind of pause to release the bus */
+        ocoms_atomic_lifo_backoff( &delay );
     } while( 1 );
 #else
-    item->ocoms_list_next = lifo->ocoms_lifo_head;
-    lifo->ocoms_lifo_head = item;
+    item->ocoms_list_next = lifo->ocoms_lifo_head.data.item;
+    lifo->ocoms_lifo_head.data.item = item;
     return (ocoms_list_item_t*)item->ocoms_list_next;
 #endif  /* OCOMS_ENABLE_MULTI_THREADS */
 }
@@ -96,27 +280,98 @@ static inline ocoms_list_item_t* ocoms_atomic_lifo_pop( ocoms_atomic_lifo_t* lif
 {
     ocoms_list_item_t* item;
 #if OCOMS_ENABLE_MULTI_THREADS
-    while((item = lifo->ocoms_lifo_head) != &(lifo->ocoms_lifo_ghost))
+    int delay = 1;
+
+    while((item = lifo->ocoms_lifo_head.data.item) != &(lifo->ocoms_lifo_ghost))
     {
         ocoms_atomic_rmb();
         if(!ocoms_atomic_cmpset_32((volatile int32_t*)&item->item_free, 0, 1))
             continue;
-        if( ocoms_atomic_cmpset_ptr( &(lifo->ocoms_lifo_head),
+        if( ocoms_atomic_cmpset_ptr( &(lifo->ocoms_lifo_head.data.item),
                                     item,
                                     (void*)item->ocoms_list_next ) )
             break;
         ocoms_atomic_cmpset_32((volatile int32_t*)&item->item_free, 1, 0);
-        /* Do some kind of pause to release the bus */
+        ocoms_atomic_lifo_backoff( &delay );
     } 
 #else
-    item = lifo->ocoms_lifo_head;
-    lifo->ocoms_lifo_head = (ocoms_list_item_t*)item->ocoms_list_next;
+    item = lifo->ocoms_lifo_head.data.item;
+    lifo->ocoms_lifo_head.data.item = (ocoms_list_item_t*)item->ocoms_list_next;
 #endif  /* OCOMS_ENABLE_MULTI_THREADS */
     if( item == &(lifo->ocoms_lifo_ghost) ) return NULL;
     item->ocoms_list_next = NULL;
     return item;
 }
 
+/* Add a chain of elements, already linked from first to last through
+ * ocoms_list_next, with a single compare-and-swap. Returns the previous
+ * head like ocoms_atomic_lifo_push.
+ */
+static inline ocoms_list_item_t* ocoms_atomic_lifo_push_chain( ocoms_atomic_lifo_t* lifo,
+                                                             ocoms_list_item_t* first,
+                                                             ocoms_list_item_t* last )
+{
+#if OCOMS_ENABLE_MULTI_THREADS
+    ocoms_list_item_t *next, *item, *follow;
+    int delay = 1;
+
+    do {
+        next = lifo->ocoms_lifo_head.data.item;
+        last->ocoms_list_next = next;
+        ocoms_atomic_wmb();
+        if( ocoms_atomic_cmpset_ptr( &(lifo->ocoms_lifo_head.data.item),
+                                    (void*)next, first ) ) {
+            break;
+        }
+        ocoms_atomic_lifo_backoff( &delay );
+    } while( 1 );
+    /* the elements stay busy for pop until released, as for a single push.
+     * A released element can be popped and reused at once, so its next
+     * pointer is read before the release. */
+    for( item = first; NULL != item; item = follow ) {
+        follow = (item == last) ? NULL : (ocoms_list_item_t*)item->ocoms_list_next;
+        ocoms_atomic_cmpset_32((volatile int32_t*)&item->item_free, 1, 0);
+    }
+    return next;
+#else
+    last->ocoms_list_next = lifo->ocoms_lifo_head.data.item;
+    lifo->ocoms_lifo_head.data.item = first;
+    return (ocoms_list_item_t*)last->ocoms_list_next;
+#endif  /* OCOMS_ENABLE_MULTI_THREADS */
+}
+
+/* Detach up to count elements. Without a counted head a multi-element
+ * detach is not ABA safe, so the elements are popped one at a time. The
+ * detached elements are returned linked through ocoms_list_next, *last is
+ * set to the last one and the number of elements is returned.
+ */
+static inline size_t ocoms_atomic_lifo_pop_n( ocoms_atomic_lifo_t* lifo, size_t count,
+                                             ocoms_list_item_t** first,
+                                             ocoms_list_item_t** last )
+{
+    ocoms_list_item_t *item, *tail = NULL;
+    size_t n;
+
+    for( n = 0; n < count; n++ ) {
+        item = ocoms_atomic_lifo_pop( lifo );
+        if( NULL == item ) {
+            break;
+        }
+        if( NULL == tail ) {
+            *first = item;
+        } else {
+            tail->ocoms_list_next = item;
+        }
+        tail = item;
+    }
+    if( NULL != tail ) {
+        *last = tail;
+    }
+    return n;
+}
+
+#endif  /* OCOMS_ATOMIC_LIFO_COUNTED_HEAD */
+
 END_C_DECLS
 
 #endif  /* OCOMS_ATOMIC_LIFO_H_HAS_BEEN_INCLUDED */
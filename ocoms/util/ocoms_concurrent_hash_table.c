@@ -0,0 +1,545 @@
+/*
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ocoms/util/ocoms_concurrent_hash_table.h"
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/primitives/hash_string.h"
+
+/*
+ * ocoms_concurrent_hash_table_t
+ *
+ * Separate chaining.  A bucket is a singly linked list of immutable
+ * nodes (only the value and the link to the next node ever change),
+ * new nodes are pushed at the head.  A reader walks a chain without
+ * any lock: a node is fully initialized before the store that links it
+ * (wmb), and a removed node keeps its next link so that a reader
+ * standing on it still reaches the rest of the chain.
+ *
+ * Writers take the stripe lock selected by the low bits of the key
+ * hash.  There are fewer stripes than buckets, so all the buckets a
+ * key can live in, in the old and in the new array during a resize,
+ * are covered by the same stripe.
+ *
+ * Resize: a new array twice as large is published as cht_table while
+ * the previous one stays reachable as cht_old.  Updates move buckets
+ * of the old array a few at a time: the nodes of the bucket are copied
+ * into the new array, then the old bucket is marked migrated.  Readers
+ * search the old array before the new one, so an entry is found in at
+ * least one of them while it moves.  A reader that meets a migrated
+ * bucket of an array that is no longer the current one starts over
+ * from the current array.  Until a bucket is migrated its keys are
+ * updated in the old array, afterwards in the new one.
+ */
+
+#define OCOMS_CHASH_MIN_BUCKETS OCOMS_CONCURRENT_HASH_TABLE_STRIPES
+
+/* head of an old bucket whose nodes were moved to the new array */
+#define OCOMS_CHASH_MIGRATED ((ocoms_chash_node_t*)1)
+
+struct ocoms_chash_node_t {
+    struct ocoms_chash_node_t * volatile next;  /* chain link, read lock free */
+    struct ocoms_chash_node_t * retired_next;   /* retire list link */
+    uint64_t    hash;
+    void * volatile value;
+    size_t      key_size;       /* 0 for uint64 keys */
+    union {
+        uint64_t        u64;
+        unsigned char   bytes[sizeof(uint64_t)];
+    }           key;            /* ptr keys extend past the end */
+};
+typedef struct ocoms_chash_node_t ocoms_chash_node_t;
+
+struct ocoms_chash_buckets_t {
+    size_t      mask;           /* number of buckets - 1 */
+    struct ocoms_chash_buckets_t * retired_next;
+    ocoms_chash_node_t * volatile buckets[1];
+};
+typedef struct ocoms_chash_buckets_t ocoms_chash_buckets_t;
+
+static void ocoms_concurrent_hash_table_construct(ocoms_concurrent_hash_table_t* ht);
+static void ocoms_concurrent_hash_table_destruct(ocoms_concurrent_hash_table_t* ht);
+
+OBJ_CLASS_INSTANCE(
+    ocoms_concurrent_hash_table_t,
+    ocoms_object_t,
+    ocoms_concurrent_hash_table_construct,
+    ocoms_concurrent_hash_table_destruct
+);
+
+static void
+ocoms_concurrent_hash_table_construct(ocoms_concurrent_hash_table_t* ht)
+{
+    int ii;
+
+    ht->cht_table = NULL;
+    ht->cht_old = NULL;
+    ht->cht_size = 0;
+    ht->cht_migrate_next = 0;
+    ht->cht_migrating = 0;
+    for (ii = 0; ii < OCOMS_CONCURRENT_HASH_TABLE_STRIPES; ii++) {
+        ocoms_atomic_init(&ht->cht_stripes[ii], OCOMS_ATOMIC_UNLOCKED);
+    }
+    ocoms_atomic_init(&ht->cht_retire_lock, OCOMS_ATOMIC_UNLOCKED);
+    ht->cht_retired_nodes = NULL;
+    ht->cht_retired_tables = NULL;
+}
+
+static void
+ocoms_chash_free_buckets(ocoms_chash_buckets_t * table, int free_nodes)
+{
+    ocoms_chash_node_t *node, *next;
+    size_t ii;
+
+    if (free_nodes) {
+        for (ii = 0; ii <= table->mask; ii++) {
+            for (node = table->buckets[ii];
+                 NULL != node && OCOMS_CHASH_MIGRATED != node; node = next) {
+                next = node->next;
+                free(node);
+            }
+        }
+    }
+    free(table);
+}
+
+static void
+ocoms_concurrent_hash_table_destruct(ocoms_concurrent_hash_table_t* ht)
+{
+    ocoms_concurrent_hash_table_reclaim(ht);
+    if (NULL != ht->cht_old) {
+        /* nodes of the buckets not yet migrated belong to the old array */
+        ocoms_chash_free_buckets(ht->cht_old, 1);
+        ht->cht_old = NULL;
+    }
+    if (NULL != ht->cht_table) {
+        ocoms_chash_free_buckets(ht->cht_table, 1);
+        ht->cht_table = NULL;
+    }
+}
+
+static ocoms_chash_buckets_t *
+ocoms_chash_alloc_buckets(size_t count)
+{
+    ocoms_chash_buckets_t * table;
+
+    table = (ocoms_chash_buckets_t*) calloc(1, sizeof(ocoms_chash_buckets_t) +
+                                            (count - 1) * sizeof(ocoms_chash_node_t*));
+    if (NULL != table) {
+        table->mask = count - 1;
+    }
+    return table;
+}
+
+int
+ocoms_concurrent_hash_table_init(ocoms_concurrent_hash_table_t* ht, size_t table_size)
+{
+    size_t count = OCOMS_CHASH_MIN_BUCKETS;
+
+    while (count < table_size) {
+        count <<= 1;
+    }
+    ht->cht_table = ocoms_chash_alloc_buckets(count);
+    if (NULL == ht->cht_table) {
+        return OCOMS_ERR_OUT_OF_RESOURCE;
+    }
+    return OCOMS_SUCCESS;
+}
+
+int
+ocoms_concurrent_hash_table_reclaim(ocoms_concurrent_hash_table_t* ht)
+{
+    ocoms_chash_node_t *node;
+    ocoms_chash_buckets_t *table;
+
+    ocoms_atomic_lock(&ht->cht_retire_lock);
+    while (NULL != (node = ht->cht_retired_nodes)) {
+        ht->cht_retired_nodes = node->retired_next;
+        free(node);
+    }
+    while (NULL != (table = ht->cht_retired_tables)) {
+        ht->cht_retired_tables = table->retired_next;
+        ocoms_chash_free_buckets(table, 0);
+    }
+    ocoms_atomic_unlock(&ht->cht_retire_lock);
+    return OCOMS_SUCCESS;
+}
+
+static void
+ocoms_chash_retire_node(ocoms_concurrent_hash_table_t* ht, ocoms_chash_node_t* node)
+{
+    ocoms_atomic_lock(&ht->cht_retire_lock);
+    node->retired_next = ht->cht_retired_nodes;
+    ht->cht_retired_nodes = node;
+    ocoms_atomic_unlock(&ht->cht_retire_lock);
+}
+
+/***************************************************************************/
+
+static inline int
+ocoms_chash_key_equal(const ocoms_chash_node_t * node, uint64_t hash,
+                      const void * key, size_t key_size)
+{
+    if (node->hash != hash || node->key_size != key_size) {
+        return 0;
+    }
+    if (0 == key_size) {
+        return node->key.u64 == *(const uint64_t*)key;
+    }
+    return 0 == memcmp(node->key.bytes, key, key_size);
+}
+
+static inline ocoms_chash_node_t *
+ocoms_chash_node_alloc(uint64_t hash, const void * key, size_t key_size, void * value)
+{
+    ocoms_chash_node_t * node;
+    size_t extra = key_size > sizeof(uint64_t) ? key_size - sizeof(uint64_t) : 0;
+
+    node = (ocoms_chash_node_t*) malloc(sizeof(ocoms_chash_node_t) + extra);
+    if (NULL == node) {
+        return NULL;
+    }
+    node->next = NULL;
+    node->retired_next = NULL;
+    node->hash = hash;
+    node->value = value;
+    node->key_size = key_size;
+    if (0 == key_size) {
+        node->key.u64 = *(const uint64_t*)key;
+    } else {
+        memcpy(node->key.bytes, key, key_size);
+    }
+    return node;
+}
+
+/* Search one bucket.  Returns the node, NULL, or OCOMS_CHASH_MIGRATED
+   if the bucket was moved to a newer array. */
+static inline ocoms_chash_node_t *
+ocoms_chash_search(ocoms_chash_buckets_t * table, uint64_t hash,
+                   const void * key, size_t key_size)
+{
+    ocoms_chash_node_t * node = table->buckets[hash & table->mask];
+
+    ocoms_atomic_rmb();
+    while (NULL != node && OCOMS_CHASH_MIGRATED != node) {
+        if (ocoms_chash_key_equal(node, hash, key, key_size)) {
+            return node;
+        }
+        node = node->next;
+        ocoms_atomic_rmb();
+    }
+    return node;
+}
+
+static int
+ocoms_chash_get_value(ocoms_concurrent_hash_table_t * ht, uint64_t hash,
+                      const void * key, size_t key_size, void ** value)
+{
+    ocoms_chash_buckets_t *table, *old;
+    ocoms_chash_node_t * node;
+
+    do {
+        table = ht->cht_table;
+        ocoms_atomic_rmb();
+        old = ht->cht_old;
+        if (NULL != old && old != table) {
+            node = ocoms_chash_search(old, hash, key, key_size);
+            if (NULL != node && OCOMS_CHASH_MIGRATED != node) {
+                *value = node->value;
+                return OCOMS_SUCCESS;
+            }
+        }
+        node = ocoms_chash_search(table, hash, key, key_size);
+        /* our array was drained by a later resize, look again */
+    } while (OCOMS_CHASH_MIGRATED == node);
+
+    if (NULL == node) {
+        return OCOMS_ERR_NOT_FOUND;
+    }
+    *value = node->value;
+    return OCOMS_SUCCESS;
+}
+
+/* The bucket a key lives in, with its stripe lock held */
+static inline ocoms_chash_node_t * volatile *
+ocoms_chash_bucket_locked(ocoms_concurrent_hash_table_t * ht, uint64_t hash)
+{
+    ocoms_chash_buckets_t * old = ht->cht_old;
+    ocoms_chash_node_t * volatile * bucket;
+
+    if (NULL != old) {
+        bucket = &old->buckets[hash & old->mask];
+        if (OCOMS_CHASH_MIGRATED != *bucket) {
+            return bucket;
+        }
+    }
+    return &ht->cht_table->buckets[hash & ht->cht_table->mask];
+}
+
+static inline size_t
+ocoms_chash_node_size(const ocoms_chash_node_t * node)
+{
+    return sizeof(ocoms_chash_node_t) +
+        (node->key_size > sizeof(uint64_t) ? node->key_size - sizeof(uint64_t) : 0);
+}
+
+/* Move one bucket of the old array, with its stripe lock held.  All
+   the copies are made before the first one is published, so the move
+   either happens completely or not at all. */
+static int
+ocoms_chash_migrate_bucket(ocoms_concurrent_hash_table_t * ht,
+                           ocoms_chash_buckets_t * old,
+                           ocoms_chash_buckets_t * table, size_t index)
+{
+    ocoms_chash_node_t *node, *copy, *copies = NULL, *next;
+    ocoms_chash_node_t * volatile * bucket;
+
+    for (node = old->buckets[index]; NULL != node; node = node->next) {
+        copy = (ocoms_chash_node_t*) malloc(ocoms_chash_node_size(node));
+        if (NULL == copy) {
+            for (; NULL != copies; copies = next) {
+                next = copies->retired_next;
+                free(copies);
+            }
+            return OCOMS_ERR_OUT_OF_RESOURCE;
+        }
+        memcpy(copy, node, ocoms_chash_node_size(node));
+        copy->retired_next = copies;
+        copies = copy;
+    }
+    for (copy = copies; NULL != copy; copy = next) {
+        next = copy->retired_next;
+        copy->retired_next = NULL;
+        bucket = &table->buckets[copy->hash & table->mask];
+        copy->next = *bucket;
+        ocoms_atomic_wmb();
+        *bucket = copy;
+    }
+    ocoms_atomic_wmb();
+    node = old->buckets[index];
+    old->buckets[index] = OCOMS_CHASH_MIGRATED;
+    for (; NULL != node; node = next) {
+        next = node->next;
+        ocoms_chash_retire_node(ht, node);
+    }
+    return OCOMS_SUCCESS;
+}
+
+/* Move up to OCOMS_CONCURRENT_HASH_TABLE_MIGRATE_STEP buckets, called
+   by updates without any stripe lock held.  One thread migrates at a
+   time; the others do not wait for it. */
+static void
+ocoms_chash_migrate(ocoms_concurrent_hash_table_t * ht)
+{
+    ocoms_chash_buckets_t *old, *table;
+    ocoms_atomic_lock_t * lock;
+    size_t step, index;
+
+    if (OCOMS_LIKELY(NULL == ht->cht_old) ||
+        !ocoms_atomic_cmpset_32(&ht->cht_migrating, 0, 1)) {
+        return;
+    }
+    /* stable while we hold the migration flag */
+    old = ht->cht_old;
+    table = ht->cht_table;
+    for (step = 0; NULL != old && step < OCOMS_CONCURRENT_HASH_TABLE_MIGRATE_STEP; step++) {
+        index = ht->cht_migrate_next;
+        lock = &ht->cht_stripes[index & (OCOMS_CONCURRENT_HASH_TABLE_STRIPES - 1)];
+        ocoms_atomic_lock(lock);
+        if (OCOMS_SUCCESS != ocoms_chash_migrate_bucket(ht, old, table, index)) {
+            /* out of memory, try again with the next update */
+            ocoms_atomic_unlock(lock);
+            break;
+        }
+        ocoms_atomic_unlock(lock);
+
+        if (++ht->cht_migrate_next > old->mask) {
+            /* last bucket moved: retire the old array, end the resize */
+            ht->cht_old = NULL;
+            ocoms_atomic_wmb();
+            ocoms_atomic_lock(&ht->cht_retire_lock);
+            old->retired_next = ht->cht_retired_tables;
+            ht->cht_retired_tables = old;
+            ocoms_atomic_unlock(&ht->cht_retire_lock);
+            old = NULL;
+        }
+    }
+    ocoms_atomic_wmb();
+    ht->cht_migrating = 0;
+}
+
+/* Start a resize if the table is too dense, called by updates without
+   any stripe lock held */
+static void
+ocoms_chash_maybe_grow(ocoms_concurrent_hash_table_t * ht)
+{
+    ocoms_chash_buckets_t *table, *larger;
+    int ii;
+
+    table = ht->cht_table;
+    if (OCOMS_LIKELY(ht->cht_size <= table->mask + 1) || NULL != ht->cht_old ||
+        !ocoms_atomic_cmpset_32(&ht->cht_migrating, 0, 1)) {
+        return;
+    }
+    table = ht->cht_table;
+    if (NULL != ht->cht_old || ht->cht_size <= table->mask + 1) {
+        ht->cht_migrating = 0;
+        return;
+    }
+    larger = ocoms_chash_alloc_buckets((table->mask + 1) * 2);
+    if (NULL == larger) {
+        ht->cht_migrating = 0;
+        return;
+    }
+    /* the arrays are switched with every writer out of the way; the
+       elements themselves are moved incrementally */
+    for (ii = 0; ii < OCOMS_CONCURRENT_HASH_TABLE_STRIPES; ii++) {
+        ocoms_atomic_lock(&ht->cht_stripes[ii]);
+    }
+    ht->cht_migrate_next = 0;
+    ht->cht_old = table;
+    ocoms_atomic_wmb();
+    ht->cht_table = larger;
+    for (ii = 0; ii < OCOMS_CONCURRENT_HASH_TABLE_STRIPES; ii++) {
+        ocoms_atomic_unlock(&ht->cht_stripes[ii]);
+    }
+    ht->cht_migrating = 0;
+}
+
+static int
+ocoms_chash_set_value(ocoms_concurrent_hash_table_t * ht, uint64_t hash,
+                      const void * key, size_t key_size, void * value)
+{
+    ocoms_atomic_lock_t * lock = &ht->cht_stripes[hash & (OCOMS_CONCURRENT_HASH_TABLE_STRIPES - 1)];
+    ocoms_chash_node_t * volatile * bucket;
+    ocoms_chash_node_t * node;
+
+    ocoms_atomic_lock(lock);
+    bucket = ocoms_chash_bucket_locked(ht, hash);
+    for (node = *bucket; NULL != node; node = node->next) {
+        if (ocoms_chash_key_equal(node, hash, key, key_size)) {
+            node->value = value;
+            ocoms_atomic_unlock(lock);
+            ocoms_chash_migrate(ht);
+            return OCOMS_SUCCESS;
+        }
+    }
+    node = ocoms_chash_node_alloc(hash, key, key_size, value);
+    if (NULL == node) {
+        ocoms_atomic_unlock(lock);
+        return OCOMS_ERR_OUT_OF_RESOURCE;
+    }
+    node->next = *bucket;
+    ocoms_atomic_wmb();
+    *bucket = node;
+    ocoms_atomic_unlock(lock);
+    ocoms_atomic_add_size_t(&ht->cht_size, 1);
+
+    ocoms_chash_migrate(ht);
+    ocoms_chash_maybe_grow(ht);
+    return OCOMS_SUCCESS;
+}
+
+static int
+ocoms_chash_remove_value(ocoms_concurrent_hash_table_t * ht, uint64_t hash,
+                         const void * key, size_t key_size)
+{
+    ocoms_atomic_lock_t * lock = &ht->cht_stripes[hash & (OCOMS_CONCURRENT_HASH_TABLE_STRIPES - 1)];
+    ocoms_chash_node_t * volatile * link;
+    ocoms_chash_node_t * node;
+
+    ocoms_atomic_lock(lock);
+    for (link = ocoms_chash_bucket_locked(ht, hash); NULL != (node = *link);
+         link = &node->next) {
+        if (ocoms_chash_key_equal(node, hash, key, key_size)) {
+            /* the node keeps its next link for readers standing on it */
+            *link = node->next;
+            ocoms_atomic_unlock(lock);
+            ocoms_chash_retire_node(ht, node);
+            ocoms_atomic_sub_size_t(&ht->cht_size, 1);
+            ocoms_chash_migrate(ht);
+            return OCOMS_SUCCESS;
+        }
+    }
+    ocoms_atomic_unlock(lock);
+    ocoms_chash_migrate(ht);
+    return OCOMS_ERR_NOT_FOUND;
+}
+
+/***************************************************************************/
+
+static inline uint64_t
+ocoms_chash_hash_uint64(uint64_t key)
+{
+    return ocoms_hash_mix(key ^ OCOMS_HASH_P0, OCOMS_HASH_P1);
+}
+
+int
+ocoms_concurrent_hash_table_get_value_uint64(ocoms_concurrent_hash_table_t * ht,
+                                             uint64_t key, void ** value)
+{
+    return ocoms_chash_get_value(ht, ocoms_chash_hash_uint64(key), &key, 0, value);
+}
+
+int
+ocoms_concurrent_hash_table_set_value_uint64(ocoms_concurrent_hash_table_t * ht,
+                                             uint64_t key, void * value)
+{
+    return ocoms_chash_set_value(ht, ocoms_chash_hash_uint64(key), &key, 0, value);
+}
+
+int
+ocoms_concurrent_hash_table_remove_value_uint64(ocoms_concurrent_hash_table_t * ht,
+                                                uint64_t key)
+{
+    return ocoms_chash_remove_value(ht, ocoms_chash_hash_uint64(key), &key, 0);
+}
+
+/* ptr keys use key_size to tell them from uint64 keys, so an empty
+   key is not allowed */
+
+int
+ocoms_concurrent_hash_table_get_value_ptr(ocoms_concurrent_hash_table_t * ht,
+                                          const void * key, size_t key_size,
+                                          void ** value)
+{
+    if (0 == key_size) {
+        return OCOMS_ERR_BAD_PARAM;
+    }
+    return ocoms_chash_get_value(ht, ocoms_hash_bytes(key, key_size, 0),
+                                 key, key_size, value);
+}
+
+int
+ocoms_concurrent_hash_table_set_value_ptr(ocoms_concurrent_hash_table_t * ht,
+                                          const void * key, size_t key_size,
+                                          void * value)
+{
+    if (0 == key_size) {
+        return OCOMS_ERR_BAD_PARAM;
+    }
+    return ocoms_chash_set_value(ht, ocoms_hash_bytes(key, key_size, 0),
+                                 key, key_size, value);
+}
+
+int
+ocoms_concurrent_hash_table_remove_value_ptr(ocoms_concurrent_hash_table_t * ht,
+                                             const void * key, size_t key_size)
+{
+    if (0 == key_size) {
+        return OCOMS_ERR_BAD_PARAM;
+    }
+    return ocoms_chash_remove_value(ht, ocoms_hash_bytes(key, key_size, 0),
+                                    key, key_size);
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ *  A hash table for read-mostly data shared between threads.
+ *
+ *  Lookups take no lock and write nothing to shared memory.  Updates
+ *  serialize on one of a fixed set of stripe locks chosen by the key
+ *  hash, so writers of different keys rarely contend.  When the table
+ *  grows the old and the new bucket arrays stay live and every update
+ *  moves a bounded number of buckets to the new array, so no single
+ *  operation pays for a full rehash.
+ *
+ *  Entries removed from the table and bucket arrays left behind by a
+ *  resize may still be visited by concurrent readers, so they are not
+ *  freed right away.  They are kept until ocoms_concurrent_hash_table_reclaim()
+ *  is called at a point where no thread is inside a lookup (e.g. after
+ *  all progress threads went through a barrier), or until the table is
+ *  destructed.
+ *
+ *  As with ocoms_hash_table_t, only one key type may be used in a
+ *  given table.
+ */
+
+#ifndef OCOMS_CONCURRENT_HASH_TABLE_H
+#define OCOMS_CONCURRENT_HASH_TABLE_H
+
+#include "ocoms/platform/ocoms_config.h"
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#include "ocoms/util/ocoms_object.h"
+#include "ocoms/sys/atomic.h"
+
+BEGIN_C_DECLS
+
+/** Number of writer locks */
+#define OCOMS_CONCURRENT_HASH_TABLE_STRIPES 64
+
+/** Buckets moved to the new array by each update during a resize */
+#define OCOMS_CONCURRENT_HASH_TABLE_MIGRATE_STEP 16
+
+OCOMS_DECLSPEC OBJ_CLASS_DECLARATION(ocoms_concurrent_hash_table_t);
+
+struct ocoms_concurrent_hash_table_t
+{
+    ocoms_object_t        super;          /**< subclass of ocoms_object_t */
+    struct ocoms_chash_buckets_t * volatile cht_table; /**< bucket array updates go to */
+    struct ocoms_chash_buckets_t * volatile cht_old;   /**< array being drained by a resize */
+    volatile size_t       cht_size;       /**< number of extant entries */
+    size_t                cht_migrate_next;  /**< next old bucket to move */
+    volatile int32_t      cht_migrating;  /**< held while starting a resize or moving buckets */
+    ocoms_atomic_lock_t   cht_stripes[OCOMS_CONCURRENT_HASH_TABLE_STRIPES]; /**< writer locks */
+    ocoms_atomic_lock_t   cht_retire_lock;   /**< protects the retire lists */
+    struct ocoms_chash_node_t * cht_retired_nodes;      /**< removed entries */
+    struct ocoms_chash_buckets_t * cht_retired_tables;  /**< drained arrays */
+};
+typedef struct ocoms_concurrent_hash_table_t ocoms_concurrent_hash_table_t;
+
+/**
+ *  Initializes the table size, must be called before using the table.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   size    The initial number of buckets, rounded up to a
+ *                   power of two (IN).
+ *  @return  OCOMS error code.
+ */
+
+OCOMS_DECLSPEC int ocoms_concurrent_hash_table_init(ocoms_concurrent_hash_table_t *ht,
+                                                   size_t table_size);
+
+/**
+ *  Returns the number of elements currently stored in the table.
+ */
+
+static inline size_t ocoms_concurrent_hash_table_get_size(ocoms_concurrent_hash_table_t *ht)
+{
+    return ht->cht_size;
+}
+
+/**
+ *  Free the removed entries and drained bucket arrays.
+ *
+ *  The caller must guarantee that no other thread is accessing the
+ *  table during the call.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @return  OCOMS return code.
+ */
+
+OCOMS_DECLSPEC int ocoms_concurrent_hash_table_reclaim(ocoms_concurrent_hash_table_t *ht);
+
+/**
+ *  Retrieve value via uint64_t key. Lock free.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   ptr     The value associated with the key
+ *  @return  integer return code:
+ *           - OCOMS_SUCCESS       if key was found
+ *           - OCOMS_ERR_NOT_FOUND if key was not found
+ */
+
+OCOMS_DECLSPEC int ocoms_concurrent_hash_table_get_value_uint64(ocoms_concurrent_hash_table_t *ht,
+                                                               uint64_t key, void **ptr);
+
+/**
+ *  Set value based on uint64_t key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   value   The value to be associated with the key (IN).
+ *  @return  OCOMS return code.
+ */
+
+OCOMS_DECLSPEC int ocoms_concurrent_hash_table_set_value_uint64(ocoms_concurrent_hash_table_t *ht,
+                                                               uint64_t key, void *value);
+
+/**
+ *  Remove value based on uint64_t key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @return  OCOMS return code.
+ */
+
+OCOMS_DECLSPEC int ocoms_concurrent_hash_table_remove_value_uint64(ocoms_concurrent_hash_table_t *ht,
+                                                                  uint64_t key);
+
+/**
+ *  Retrieve value via arbitrary length binary key. Lock free.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   keylen  The length of the key (IN).
+ *  @param   ptr     The value associated with the key
+ *  @return  integer return code:
+ *           - OCOMS_SUCCESS       if key was found
+ *           - OCOMS_ERR_NOT_FOUND if key was not found
+ */
+
+OCOMS_DECLSPEC int ocoms_concurrent_hash_table_get_value_ptr(ocoms_concurrent_hash_table_t *ht,
+                                                            const void *key, size_t keylen,
+                                                            void **ptr);
+
+/**
+ *  Set value based on arbitrary length binary key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN), copied by the table.
+ *  @param   keylen  The length of the key (IN).
+ *  @param   value   The value to be associated with the key (IN).
+ *  @return  OCOMS return code.
+ */
+
+OCOMS_DECLSPEC int ocoms_concurrent_hash_table_set_value_ptr(ocoms_concurrent_hash_table_t *ht,
+                                                            const void *key, size_t keylen,
+                                                            void *value);
+
+/**
+ *  Remove value based on arbitrary length binary key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   keylen  The length of the key (IN).
+ *  @return  OCOMS return code.
+ */
+
+OCOMS_DECLSPEC int ocoms_concurrent_hash_table_remove_value_ptr(ocoms_concurrent_hash_table_t *ht,
+                                                               const void *key, size_t keylen);
+
+END_C_DECLS
+
+#endif  /* OCOMS_CONCURRENT_HASH_TABLE_H */
@@ -24,6 +24,8 @@
 
 #include "ocoms/util/ocoms_free_list.h"
 #include "ocoms/primitives/align.h"
+#include "ocoms/sys/atomic.h"
+#include "ocoms/util/numa.h"
 
 
 static void ocoms_free_list_construct(ocoms_free_list_t* fl);
@@ -36,7 +38,15 @@ OBJ_CLASS_INSTANCE(ocoms_free_list_item_t,
                    ocoms_list_item_t,
                    NULL, NULL); 
 
-typedef struct ocoms_free_list_item_t ocoms_free_list_memory_t;
+/* Header of a chunk of elements allocated by ocoms_free_list_grow */
+struct ocoms_free_list_memory_t {
+    ocoms_free_list_item_t super;
+    unsigned char* first;               /* first element descriptor */
+    size_t num_elements;                /* elements carved from the chunk */
+    size_t head_size;                   /* stride between descriptors */
+    size_t num_free;                    /* idle elements, used by shrink */
+};
+typedef struct ocoms_free_list_memory_t ocoms_free_list_memory_t;
 
 static void ocoms_free_list_construct(ocoms_free_list_t* fl)
 {
@@ -56,7 +66,282 @@ static void ocoms_free_list_construct(ocoms_free_list_t* fl)
     fl->alloc = NULL;
     fl->free = NULL;
     fl->ctx = NULL;
+    fl->fl_flags = 0;
+    fl->fl_tc_magazine_size = OCOMS_FREE_LIST_TC_MAGAZINE_SIZE;
+    fl->fl_tc_refills = 0;
+    fl->fl_tc_flushes = 0;
+    fl->fl_numa_node = -1;
+    fl->fl_low_water = 0;
     OBJ_CONSTRUCT(&(fl->fl_allocations), ocoms_list_t);
+    OBJ_CONSTRUCT(&(fl->fl_tc_full), ocoms_atomic_lifo_t);
+    OBJ_CONSTRUCT(&(fl->fl_tc_empty), ocoms_atomic_lifo_t);
+    OBJ_CONSTRUCT(&(fl->fl_tc_caches), ocoms_list_t);
+}
+
+static ocoms_free_list_magazine_t* ocoms_free_list_magazine_alloc(ocoms_free_list_t* fl)
+{
+    ocoms_free_list_magazine_t* mag;
+
+    mag = (ocoms_free_list_magazine_t*)ocoms_atomic_lifo_pop(&(fl->fl_tc_empty));
+    if( NULL != mag ) {
+        return mag;
+    }
+    mag = (ocoms_free_list_magazine_t*)malloc(sizeof(ocoms_free_list_magazine_t) +
+                                              (fl->fl_tc_magazine_size - 1) *
+                                              sizeof(ocoms_free_list_item_t*));
+    if( NULL == mag ) {
+        return NULL;
+    }
+    OBJ_CONSTRUCT(mag, ocoms_list_item_t);
+    mag->mag_count = 0;
+    return mag;
+}
+
+static void ocoms_free_list_magazine_free(ocoms_free_list_magazine_t* mag)
+{
+    OBJ_DESTRUCT(&mag->super);
+    free(mag);
+}
+
+/* Put every item of the magazine back on the shared list */
+static void ocoms_free_list_magazine_drain(ocoms_free_list_t* fl,
+                                           ocoms_free_list_magazine_t* mag)
+{
+    while( mag->mag_count > 0 ) {
+        ocoms_atomic_lifo_push(&(fl->super), &(mag->mag_items[--mag->mag_count]->super));
+    }
+}
+
+static void ocoms_free_list_signal_waiters(ocoms_free_list_t* fl)
+{
+    OCOMS_THREAD_LOCK(&fl->fl_lock);
+    if( fl->fl_num_waiting > 0 ) {
+        if( 1 == fl->fl_num_waiting ) {
+            ocoms_condition_signal(&(fl->fl_condition));
+        } else {
+            ocoms_condition_broadcast(&(fl->fl_condition));
+        }
+    }
+    OCOMS_THREAD_UNLOCK(&fl->fl_lock);
+}
+
+/* Thread exit: give the magazines of the thread back to the depots */
+static void ocoms_free_list_tc_destructor(void* value)
+{
+    ocoms_free_list_tc_t* tc = (ocoms_free_list_tc_t*)value;
+    ocoms_free_list_t* fl = tc->tc_list;
+    ocoms_free_list_magazine_t* mags[2] = { tc->tc_loaded, tc->tc_previous };
+    int i;
+
+    OCOMS_THREAD_LOCK(&fl->fl_lock);
+    ocoms_list_remove_item(&(fl->fl_tc_caches), &(tc->super));
+    OCOMS_THREAD_UNLOCK(&fl->fl_lock);
+
+    for( i = 0; i < 2; i++ ) {
+        if( mags[i]->mag_count > 0 ) {
+            ocoms_atomic_lifo_push(&(fl->fl_tc_full), &(mags[i]->super));
+        } else {
+            ocoms_atomic_lifo_push(&(fl->fl_tc_empty), &(mags[i]->super));
+        }
+    }
+    OBJ_DESTRUCT(&tc->super);
+    free(tc);
+
+    ocoms_free_list_signal_waiters(fl);
+}
+
+static ocoms_free_list_tc_t* ocoms_free_list_tc_create(ocoms_free_list_t* fl)
+{
+    ocoms_free_list_tc_t* tc;
+
+    tc = (ocoms_free_list_tc_t*)malloc(sizeof(ocoms_free_list_tc_t));
+    if( NULL == tc ) {
+        return NULL;
+    }
+    tc->tc_list = fl;
+    tc->tc_loaded = ocoms_free_list_magazine_alloc(fl);
+    tc->tc_previous = ocoms_free_list_magazine_alloc(fl);
+    if( NULL == tc->tc_loaded || NULL == tc->tc_previous ||
+        OCOMS_SUCCESS != ocoms_tsd_setspecific(fl->fl_tc_key, tc) ) {
+        if( NULL != tc->tc_loaded ) ocoms_free_list_magazine_free(tc->tc_loaded);
+        if( NULL != tc->tc_previous ) ocoms_free_list_magazine_free(tc->tc_previous);
+        free(tc);
+        return NULL;
+    }
+    OBJ_CONSTRUCT(&tc->super, ocoms_list_item_t);
+
+    OCOMS_THREAD_LOCK(&fl->fl_lock);
+    ocoms_list_append(&(fl->fl_tc_caches), &(tc->super));
+    OCOMS_THREAD_UNLOCK(&fl->fl_lock);
+    return tc;
+}
+
+ocoms_free_list_item_t*
+ocoms_free_list_tc_refill(ocoms_free_list_t* fl, ocoms_free_list_tc_t* tc)
+{
+    ocoms_free_list_magazine_t* mag;
+    ocoms_free_list_item_t* item;
+    ocoms_list_item_t *first, *last;
+    size_t n;
+
+    if( NULL == tc ) {
+        tc = ocoms_free_list_tc_create(fl);
+        if( NULL == tc ) {
+            return (ocoms_free_list_item_t*)ocoms_atomic_lifo_pop(&(fl->super));
+        }
+    }
+
+    /* both magazines are empty: swap the previous one for a loaded
+     * magazine from the depot, never taking an empty one */
+    while( NULL != (mag = (ocoms_free_list_magazine_t*)ocoms_atomic_lifo_pop(&(fl->fl_tc_full))) &&
+           0 == mag->mag_count ) {
+        ocoms_atomic_lifo_push(&(fl->fl_tc_empty), &(mag->super));
+    }
+    if( NULL != mag ) {
+        ocoms_atomic_lifo_push(&(fl->fl_tc_empty), &(tc->tc_previous->super));
+        tc->tc_previous = tc->tc_loaded;
+        tc->tc_loaded = mag;
+    } else {
+        /* the depot is empty, load the magazine from the shared list */
+        mag = tc->tc_loaded;
+        n = ocoms_atomic_lifo_pop_n(&(fl->super), fl->fl_tc_magazine_size,
+                                    &first, &last);
+        if( 0 == n ) {
+            return NULL;
+        }
+        for( item = (ocoms_free_list_item_t*)first; n > 0; n-- ) {
+            mag->mag_items[mag->mag_count++] = item;
+            item = (ocoms_free_list_item_t*)item->super.ocoms_list_next;
+        }
+    }
+    ocoms_atomic_add_size_t(&fl->fl_tc_refills, 1);
+    return mag->mag_items[--mag->mag_count];
+}
+
+void ocoms_free_list_tc_flush(ocoms_free_list_t* fl, ocoms_free_list_tc_t* tc,
+                              ocoms_free_list_item_t* item)
+{
+    ocoms_free_list_magazine_t* mag = NULL;
+
+    /* somebody waits for an item: keep it out of the caches */
+    if( 0 == fl->fl_num_waiting ) {
+        if( NULL == tc ) {
+            tc = ocoms_free_list_tc_create(fl);
+        }
+        if( NULL != tc ) {
+            mag = tc->tc_loaded;
+            if( mag->mag_count < fl->fl_tc_magazine_size ) {
+                /* the cache of this thread was just created */
+                mag->mag_items[mag->mag_count++] = item;
+                return;
+            }
+            mag = ocoms_free_list_magazine_alloc(fl);
+        }
+    }
+    if( NULL == mag ) {
+        /* waiters, or no memory for the cache: bypass it */
+        ocoms_atomic_lifo_push(&(fl->super), &(item->super));
+        if( 0 < fl->fl_num_waiting ) {
+            ocoms_free_list_signal_waiters(fl);
+        }
+        return;
+    }
+
+    /* both magazines are full: hand the previous one to the depot */
+    ocoms_atomic_lifo_push(&(fl->fl_tc_full), &(tc->tc_previous->super));
+    tc->tc_previous = tc->tc_loaded;
+    tc->tc_loaded = mag;
+    mag->mag_items[mag->mag_count++] = item;
+    ocoms_atomic_add_size_t(&fl->fl_tc_flushes, 1);
+
+    if( 0 < fl->fl_num_waiting ) {
+        ocoms_free_list_signal_waiters(fl);
+    }
+}
+
+/* Detach up to count items from the shared list into items */
+static size_t ocoms_free_list_pop_n(ocoms_free_list_t* fl,
+                                    ocoms_free_list_item_t** items,
+                                    size_t count)
+{
+    ocoms_list_item_t *first, *last, *item;
+    size_t i, n;
+
+    n = ocoms_atomic_lifo_pop_n(&(fl->super), count, &first, &last);
+    for( i = 0, item = first; i < n; i++ ) {
+        items[i] = (ocoms_free_list_item_t*)item;
+        item = (ocoms_list_item_t*)item->ocoms_list_next;
+    }
+    return n;
+}
+
+size_t ocoms_free_list_get_n(ocoms_free_list_t* fl,
+                             ocoms_free_list_item_t** items,
+                             size_t count)
+{
+    size_t n, num_to_alloc;
+
+    if( fl->fl_flags & OCOMS_FREE_LIST_FLAG_THREAD_CACHE ) {
+        /* the thread cache already amortizes the shared list accesses */
+        for( n = 0; n < count; n++ ) {
+            items[n] = ocoms_free_list_tc_get(fl);
+            if( NULL == items[n] ) {
+                break;
+            }
+        }
+    } else {
+        n = ocoms_free_list_pop_n(fl, items, count);
+    }
+    if( OCOMS_LIKELY(n == count) ) {
+        return n;
+    }
+
+    /* the list is short: grow once by at least what is missing */
+    num_to_alloc = count - n;
+    if( num_to_alloc < fl->fl_num_per_alloc ) {
+        num_to_alloc = fl->fl_num_per_alloc;
+    }
+    OCOMS_THREAD_LOCK(&fl->fl_lock);
+    ocoms_free_list_grow(fl, num_to_alloc);
+    OCOMS_THREAD_UNLOCK(&fl->fl_lock);
+
+    if( fl->fl_flags & OCOMS_FREE_LIST_FLAG_THREAD_CACHE ) {
+        for( ; n < count; n++ ) {
+            items[n] = ocoms_free_list_tc_get(fl);
+            if( NULL == items[n] ) {
+                break;
+            }
+        }
+        return n;
+    }
+    return n + ocoms_free_list_pop_n(fl, items + n, count - n);
+}
+
+void ocoms_free_list_return_n(ocoms_free_list_t* fl,
+                              ocoms_free_list_item_t** items,
+                              size_t count)
+{
+    ocoms_list_item_t* original;
+    size_t i;
+
+    if( 0 == count ) {
+        return;
+    }
+    if( fl->fl_flags & OCOMS_FREE_LIST_FLAG_THREAD_CACHE ) {
+        for( i = 0; i < count; i++ ) {
+            ocoms_free_list_tc_return(fl, items[i]);
+        }
+        return;
+    }
+
+    for( i = 0; i + 1 < count; i++ ) {
+        items[i]->super.ocoms_list_next = &(items[i + 1]->super);
+    }
+    original = ocoms_atomic_lifo_push_chain(&(fl->super), &(items[0]->super),
+                                            &(items[count - 1]->super));
+    if( &(fl->super.ocoms_lifo_ghost) == original ) {
+        ocoms_free_list_signal_waiters(fl);
+    }
 }
 
 static void ocoms_free_list_destruct(ocoms_free_list_t* fl)
@@ -71,6 +356,33 @@ static void ocoms_free_list_destruct(ocoms_free_list_t* fl)
             fl->super.super.cls_init_file_name, fl->super.super.cls_init_lineno);
     }
 #endif
+    if( fl->fl_flags & OCOMS_FREE_LIST_FLAG_THREAD_CACHE ) {
+        ocoms_free_list_tc_t *tc;
+        ocoms_free_list_magazine_t *mag;
+
+        /* no thread destructor runs once the key is gone, so every cache
+         * still alive is reclaimed here */
+        ocoms_tsd_setspecific(fl->fl_tc_key, NULL);
+        ocoms_tsd_key_delete(fl->fl_tc_key);
+        while(NULL != (item = ocoms_list_remove_first(&(fl->fl_tc_caches)))) {
+            tc = (ocoms_free_list_tc_t*)item;
+            ocoms_free_list_magazine_drain(fl, tc->tc_loaded);
+            ocoms_free_list_magazine_drain(fl, tc->tc_previous);
+            ocoms_free_list_magazine_free(tc->tc_loaded);
+            ocoms_free_list_magazine_free(tc->tc_previous);
+            OBJ_DESTRUCT(item);
+            free(tc);
+        }
+        while(NULL != (item = ocoms_atomic_lifo_pop(&(fl->fl_tc_full)))) {
+            mag = (ocoms_free_list_magazine_t*)item;
+            ocoms_free_list_magazine_drain(fl, mag);
+            ocoms_free_list_magazine_free(mag);
+        }
+        while(NULL != (item = ocoms_atomic_lifo_pop(&(fl->fl_tc_empty)))) {
+            ocoms_free_list_magazine_free((ocoms_free_list_magazine_t*)item);
+        }
+    }
+
     while(NULL != (item = ocoms_atomic_lifo_pop(&(fl->super)))) {
         fl_item = (ocoms_free_list_item_t*)item;
 
@@ -84,7 +396,8 @@ static void ocoms_free_list_destruct(ocoms_free_list_t* fl)
         while(NULL != (item = ocoms_list_remove_first(&(fl->fl_allocations)))) {
             fl_mem = (ocoms_free_list_memory_t*)item;
 
-            fl->free(fl->alloc_handle.allocator_context, fl_mem->ptr, fl_mem->registration);
+            fl->free(fl->alloc_handle.allocator_context, fl_mem->super.ptr,
+                     fl_mem->super.registration);
 
             /* destruct the item (we constructed it), then free the memory chunk */
             OBJ_DESTRUCT(item);
@@ -98,6 +411,9 @@ static void ocoms_free_list_destruct(ocoms_free_list_t* fl)
         }
     }
 
+    OBJ_DESTRUCT(&fl->fl_tc_caches);
+    OBJ_DESTRUCT(&fl->fl_tc_empty);
+    OBJ_DESTRUCT(&fl->fl_tc_full);
     OBJ_DESTRUCT(&fl->fl_allocations);
     OBJ_DESTRUCT(&fl->fl_condition);
     OBJ_DESTRUCT(&fl->fl_lock);
@@ -168,6 +484,30 @@ int ocoms_free_list_init_ex_new(ocoms_free_list_t *flist,
     allocator_handle_t handle,
     ocoms_progress_fn_t ocoms_progress
     )
+{
+    return ocoms_free_list_init_ex_flags(flist, frag_size, frag_alignment, frag_class,
+            payload_buffer_size, payload_buffer_alignment,
+            num_elements_to_alloc, max_elements_to_alloc, num_elements_per_alloc,
+            item_init, ctx, alloc, free, handle, ocoms_progress, 0);
+}
+
+int ocoms_free_list_init_ex_flags(ocoms_free_list_t *flist,
+    size_t frag_size,
+    size_t frag_alignment,
+    ocoms_class_t* frag_class,
+    size_t payload_buffer_size,
+    size_t payload_buffer_alignment,
+    int num_elements_to_alloc,
+    int max_elements_to_alloc,
+    int num_elements_per_alloc,
+    ocoms_free_list_item_init_fn_t item_init,
+    void* ctx,
+    ocoms_free_list_alloc_fn_t alloc,
+    ocoms_free_list_free_fn_t free,
+    allocator_handle_t handle,
+    ocoms_progress_fn_t ocoms_progress,
+    uint32_t flags
+    )
 {
     /* alignment must be more than zero and power of two */
     if (frag_alignment <= 1 || (frag_alignment & (frag_alignment - 1)))
@@ -200,6 +540,15 @@ int ocoms_free_list_init_ex_new(ocoms_free_list_t *flist,
     assert((NULL != flist->alloc && NULL != flist->free ) ||
            (NULL == flist->alloc && NULL == flist->free));
 
+    if ((flags & OCOMS_FREE_LIST_FLAG_THREAD_CACHE) && 0 < flist->fl_tc_magazine_size) {
+        if (OCOMS_SUCCESS != ocoms_tsd_key_create(&flist->fl_tc_key,
+                                                  ocoms_free_list_tc_destructor))
+            return OCOMS_ERROR;
+    } else {
+        flags &= ~OCOMS_FREE_LIST_FLAG_THREAD_CACHE;
+    }
+    flist->fl_flags = flags;
+
     if (num_elements_to_alloc)
         return ocoms_free_list_grow(flist, num_elements_to_alloc);
     return OCOMS_SUCCESS;
@@ -231,6 +580,10 @@ int ocoms_free_list_grow(ocoms_free_list_t* flist, size_t num_elements)
     if(NULL == alloc_ptr)
         return OCOMS_ERR_TEMP_OUT_OF_RESOURCE;
 
+    /* place the descriptors before they are first touched below */
+    if(flist->fl_numa_node >= 0)
+        ocoms_numa_bind_memory(alloc_ptr, alloc_size, flist->fl_numa_node);
+
     /* allocate the rest from the runtime */
     if(flist->alloc != NULL) {
         elem_size = OCOMS_ALIGN(flist->fl_payload_buffer_size, 
@@ -243,6 +596,9 @@ int ocoms_free_list_grow(ocoms_free_list_t* flist, size_t num_elements)
                 free(alloc_ptr);
                 return OCOMS_ERR_TEMP_OUT_OF_RESOURCE;
             }
+            if(flist->fl_numa_node >= 0)
+                ocoms_numa_bind_memory(runtime_alloc_ptr, num_elements * elem_size,
+                                       flist->fl_numa_node);
         }
     }
 
@@ -251,16 +607,20 @@ int ocoms_free_list_grow(ocoms_free_list_t* flist, size_t num_elements)
     OBJ_CONSTRUCT(alloc_ptr, ocoms_free_list_item_t);
     ocoms_list_append(&(flist->fl_allocations), (ocoms_list_item_t*)alloc_ptr);
 
-    alloc_ptr->registration = reg;
-    alloc_ptr->ptr = runtime_alloc_ptr;
+    alloc_ptr->super.registration = reg;
+    alloc_ptr->super.ptr = runtime_alloc_ptr;
 
     ptr = (unsigned char*)alloc_ptr + sizeof(ocoms_free_list_memory_t);
     ptr = OCOMS_ALIGN_PTR(ptr, flist->fl_frag_alignment, unsigned char*);
+    alloc_ptr->first = ptr;
+    alloc_ptr->num_elements = num_elements;
+    alloc_ptr->head_size = head_size;
 
     for(i=0; i<num_elements; i++) {
         ocoms_free_list_item_t* item = (ocoms_free_list_item_t*)ptr;
         item->registration = reg;
         item->ptr = runtime_alloc_ptr;
+        item->owner = flist;
 
         OBJ_CONSTRUCT_INTERNAL(item, flist->fl_frag_class);
         
@@ -305,3 +665,141 @@ ocoms_free_list_resize(ocoms_free_list_t* flist, size_t size)
 
     return ret;
 }
+
+static int ocoms_free_list_chunk_compare(const void* a, const void* b)
+{
+    const ocoms_free_list_memory_t* ca = *(const ocoms_free_list_memory_t* const*)a;
+    const ocoms_free_list_memory_t* cb = *(const ocoms_free_list_memory_t* const*)b;
+
+    return (ca->first < cb->first) ? -1 : ((ca->first > cb->first) ? 1 : 0);
+}
+
+/* Find the chunk holding an element, chunks being sorted by address */
+static ocoms_free_list_memory_t*
+ocoms_free_list_chunk_lookup(ocoms_free_list_memory_t** chunks, size_t num_chunks,
+                             unsigned char* addr)
+{
+    size_t lo = 0, hi = num_chunks, mid;
+    ocoms_free_list_memory_t* chunk;
+
+    while( lo < hi ) {
+        mid = (lo + hi) / 2;
+        chunk = chunks[mid];
+        if( addr < chunk->first ) {
+            hi = mid;
+        } else if( addr >= chunk->first + chunk->num_elements * chunk->head_size ) {
+            lo = mid + 1;
+        } else {
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Release the chunks whose elements are all back on the free list.
+ * Elements held by a thread's magazines are in use as far as this
+ * function is concerned; full magazines parked in the depot are not.
+ * The released memory may be unmapped at once, and the LIFO gives no
+ * protection to a concurrent pop still reading a detached element, so
+ * the caller guarantees that nobody gets or returns elements meanwhile.
+ */
+int ocoms_free_list_shrink(ocoms_free_list_t* flist, size_t min_elements)
+{
+    ocoms_free_list_memory_t **chunks, *chunk;
+    ocoms_list_item_t *item, *next, *first = NULL, *last = NULL;
+    ocoms_list_item_t *keep_first = NULL, *keep_last = NULL;
+    ocoms_free_list_magazine_t *mag;
+    size_t num_chunks, num_items, i;
+
+    OCOMS_THREAD_LOCK(&flist->fl_lock);
+    num_chunks = ocoms_list_get_size(&flist->fl_allocations);
+    if( 0 == num_chunks || flist->fl_num_allocated <= min_elements ) {
+        OCOMS_THREAD_UNLOCK(&flist->fl_lock);
+        return OCOMS_SUCCESS;
+    }
+    chunks = (ocoms_free_list_memory_t**)malloc(num_chunks * sizeof(*chunks));
+    if( NULL == chunks ) {
+        OCOMS_THREAD_UNLOCK(&flist->fl_lock);
+        return OCOMS_ERR_OUT_OF_RESOURCE;
+    }
+    i = 0;
+    for( item = ocoms_list_get_first(&flist->fl_allocations);
+         item != ocoms_list_get_end(&flist->fl_allocations);
+         item = ocoms_list_get_next(item) ) {
+        chunk = (ocoms_free_list_memory_t*)item;
+        chunk->num_free = 0;
+        chunks[i++] = chunk;
+    }
+    qsort(chunks, num_chunks, sizeof(*chunks), ocoms_free_list_chunk_compare);
+
+    /* take every idle element off the list */
+    if( flist->fl_flags & OCOMS_FREE_LIST_FLAG_THREAD_CACHE ) {
+        while( NULL != (mag = (ocoms_free_list_magazine_t*)
+                        ocoms_atomic_lifo_pop(&(flist->fl_tc_full))) ) {
+            ocoms_free_list_magazine_drain(flist, mag);
+            ocoms_atomic_lifo_push(&(flist->fl_tc_empty), &(mag->super));
+        }
+    }
+    num_items = ocoms_atomic_lifo_pop_n(&(flist->super), flist->fl_num_allocated,
+                                        &first, &last);
+
+    for( i = 0, item = first; i < num_items; i++ ) {
+        chunk = ocoms_free_list_chunk_lookup(chunks, num_chunks, (unsigned char*)item);
+        assert(NULL != chunk);
+        chunk->num_free++;
+        item = (ocoms_list_item_t*)item->ocoms_list_next;
+    }
+
+    /* release the idle chunks, down to min_elements */
+    for( i = 0; i < num_chunks; i++ ) {
+        chunk = chunks[i];
+        if( chunk->num_free != chunk->num_elements ||
+            flist->fl_num_allocated - chunk->num_elements < min_elements ) {
+            chunk->num_free = 0;
+            continue;
+        }
+        ocoms_list_remove_item(&(flist->fl_allocations), &(chunk->super.super));
+        flist->fl_num_allocated -= chunk->num_elements;
+    }
+
+    /* give the elements of the chunks we keep back to the list, and
+     * destruct the others (num_free was reset on the kept chunks) */
+    for( i = 0, item = first; i < num_items; i++, item = next ) {
+        next = (ocoms_list_item_t*)item->ocoms_list_next;
+        chunk = ocoms_free_list_chunk_lookup(chunks, num_chunks, (unsigned char*)item);
+        if( 0 == chunk->num_free ) {
+            if( NULL == keep_first ) {
+                keep_first = item;
+            } else {
+                keep_last->ocoms_list_next = item;
+            }
+            keep_last = item;
+        } else {
+            OBJ_DESTRUCT(item);
+        }
+    }
+    if( NULL != keep_first ) {
+        ocoms_atomic_lifo_push_chain(&(flist->super), keep_first, keep_last);
+    }
+
+    for( i = 0; i < num_chunks; i++ ) {
+        chunk = chunks[i];
+        if( 0 == chunk->num_free ) {
+            continue;
+        }
+        if( NULL != flist->free ) {
+            flist->free(flist->alloc_handle.allocator_context, chunk->super.ptr,
+                        chunk->super.registration);
+        }
+        OBJ_DESTRUCT(&chunk->super);
+        free(chunk);
+    }
+    OCOMS_THREAD_UNLOCK(&flist->fl_lock);
+    free(chunks);
+
+    if( NULL != keep_first && 0 < flist->fl_num_waiting ) {
+        ocoms_free_list_signal_waiters(flist);
+    }
+    return OCOMS_SUCCESS;
+}
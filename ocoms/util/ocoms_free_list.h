@@ -27,6 +27,7 @@
 #include "ocoms/util/ocoms_atomic_lifo.h"
 #include "ocoms/threads/mutex.h"
 #include "ocoms/threads/condition.h"
+#include "ocoms/threads/tsd.h"
 #include "ocoms/platform/ocoms_constants.h"
 #include "ocoms/primitives/prefetch.h"
 #if 0
@@ -61,6 +62,45 @@ typedef void (*ocoms_free_list_free_fn_t)(
     void* addr,
     void* registration);
 
+/**
+ * Flags accepted by ocoms_free_list_init_ex_flags().
+ */
+enum {
+    /** Serve get/return from a per-thread magazine cache and only
+     *  exchange whole magazines with the shared list */
+    OCOMS_FREE_LIST_FLAG_THREAD_CACHE = 0x01
+};
+
+/** Default number of items held by one thread cache magazine */
+#define OCOMS_FREE_LIST_TC_MAGAZINE_SIZE 32
+
+/**
+ * A magazine: a small stack of free items owned by one thread, or
+ * parked in one of the free list depots.
+ */
+struct ocoms_free_list_magazine_t
+{
+    ocoms_list_item_t super;
+    size_t mag_count;
+    struct ocoms_free_list_item_t* mag_items[1];
+};
+typedef struct ocoms_free_list_magazine_t ocoms_free_list_magazine_t;
+
+/**
+ * Per-thread cache of a free list. Like the magazine layer of the
+ * Bonwick slab allocator, the thread keeps a loaded and a previous
+ * magazine so that alternating get/return at a magazine boundary does
+ * not go to the shared depot every time.
+ */
+struct ocoms_free_list_tc_t
+{
+    ocoms_list_item_t super;
+    struct ocoms_free_list_t* tc_list;
+    ocoms_free_list_magazine_t* tc_loaded;
+    ocoms_free_list_magazine_t* tc_previous;
+};
+typedef struct ocoms_free_list_tc_t ocoms_free_list_tc_t;
+
 struct ocoms_free_list_t
 {
     ocoms_atomic_lifo_t super;
@@ -81,6 +121,18 @@ struct ocoms_free_list_t
     allocator_handle_t alloc_handle;
     ocoms_free_list_alloc_fn_t alloc;
     ocoms_free_list_free_fn_t free;
+    uint32_t fl_flags;                  /* OCOMS_FREE_LIST_FLAG_* */
+    /* per-thread magazine cache (OCOMS_FREE_LIST_FLAG_THREAD_CACHE).
+     * fl_tc_magazine_size may be changed between construction and init. */
+    size_t fl_tc_magazine_size;         /* items per magazine */
+    ocoms_tsd_key_t fl_tc_key;          /* thread -> ocoms_free_list_tc_t */
+    ocoms_atomic_lifo_t fl_tc_full;     /* depot of non-empty magazines */
+    ocoms_atomic_lifo_t fl_tc_empty;    /* depot of empty magazines */
+    ocoms_list_t fl_tc_caches;          /* live thread caches, under fl_lock */
+    volatile size_t fl_tc_refills;      /* magazines loaded by a thread cache */
+    volatile size_t fl_tc_flushes;      /* full magazines given back to the depot */
+    int fl_numa_node;                   /* node new chunks are placed on, -1 for none */
+    size_t fl_low_water;                /* elements ocoms_free_list_reclaim keeps */
 };
 typedef struct ocoms_free_list_t ocoms_free_list_t;
 OCOMS_DECLSPEC OBJ_CLASS_DECLARATION(ocoms_free_list_t);
@@ -91,6 +143,7 @@ struct ocoms_free_list_item_t
     ocoms_list_item_t super; 
     void *registration;
     void *ptr;
+    struct ocoms_free_list_t *owner;    /* free list the item was allocated by */
 }; 
 typedef struct ocoms_free_list_item_t ocoms_free_list_item_t; 
 OCOMS_DECLSPEC OBJ_CLASS_DECLARATION(ocoms_free_list_item_t);
@@ -158,6 +211,34 @@ OCOMS_DECLSPEC int ocoms_free_list_init_ex_new(
     ocoms_progress_fn_t ocoms_progress
     );
 
+/**
+ * Initialize a free list with optional behaviors.
+ *
+ * Same as ocoms_free_list_init_ex_new(), with an additional set of
+ * OCOMS_FREE_LIST_FLAG_* flags.
+ *
+ * @param flags                    (IN)  Bitwise OR of OCOMS_FREE_LIST_FLAG_* values.
+ */
+
+OCOMS_DECLSPEC int ocoms_free_list_init_ex_flags(
+    ocoms_free_list_t *free_list,
+    size_t frag_size,
+    size_t frag_alignment,
+    ocoms_class_t* frag_class,
+    size_t payload_buffer_size,
+    size_t payload_buffer_alignment,
+    int num_elements_to_alloc,
+    int max_elements_to_alloc,
+    int num_elements_per_alloc,
+    ocoms_free_list_item_init_fn_t item_init,
+    void *ctx,
+    ocoms_free_list_alloc_fn_t alloc,
+    ocoms_free_list_free_fn_t free,
+    allocator_handle_t handle,
+    ocoms_progress_fn_t ocoms_progress,
+    uint32_t flags
+    );
+
 /**
  * Initialize a free list. - this will replace ocoms_free_list_init
  *
@@ -203,6 +284,100 @@ OCOMS_DECLSPEC int ocoms_free_list_grow(ocoms_free_list_t* flist, size_t num_ele
    num_elements_per_alloc chunks) */
 OCOMS_DECLSPEC int ocoms_free_list_resize(ocoms_free_list_t *flist, size_t size);
 
+/* Give back to the free callback the chunks whose elements are all
+   on the free list, as long as at least min_elements stay allocated.
+   Elements cached by a thread (OCOMS_FREE_LIST_FLAG_THREAD_CACHE) keep
+   their chunk alive.
+   The list must be quiescent: a thread in the middle of a get may still
+   read an element of a released chunk, so no get or return may run
+   concurrently with the shrink. */
+OCOMS_DECLSPEC int ocoms_free_list_shrink(ocoms_free_list_t *flist, size_t min_elements);
+
+/* Low-water-mark reclamation: shrink down to fl_low_water elements once
+   at least a full grow increment is above it. Quiescent points only,
+   as for ocoms_free_list_shrink. */
+static inline int ocoms_free_list_reclaim(ocoms_free_list_t *flist)
+{
+    if( OCOMS_LIKELY(flist->fl_num_allocated < flist->fl_low_water + flist->fl_num_per_alloc) ) {
+        return OCOMS_SUCCESS;
+    }
+    return ocoms_free_list_shrink(flist, flist->fl_low_water);
+}
+
+/* Slow paths of the per-thread magazine cache: load a magazine when both
+   of the thread's magazines are empty, and hand a full magazine back to
+   the depot when both are full. While somebody waits for an item the
+   returned items go to the shared list and wake the waiters up. */
+OCOMS_DECLSPEC ocoms_free_list_item_t*
+ocoms_free_list_tc_refill(ocoms_free_list_t *flist, ocoms_free_list_tc_t *tc);
+OCOMS_DECLSPEC void ocoms_free_list_tc_flush(ocoms_free_list_t *flist,
+                                             ocoms_free_list_tc_t *tc,
+                                             ocoms_free_list_item_t *item);
+
+static inline ocoms_free_list_tc_t* ocoms_free_list_tc_lookup(ocoms_free_list_t* fl)
+{
+    void* tc;
+
+    ocoms_tsd_getspecific(fl->fl_tc_key, &tc);
+    return (ocoms_free_list_tc_t*)tc;
+}
+
+static inline ocoms_free_list_item_t* ocoms_free_list_tc_get(ocoms_free_list_t* fl)
+{
+    ocoms_free_list_tc_t* tc = ocoms_free_list_tc_lookup(fl);
+    ocoms_free_list_magazine_t* mag;
+
+    if( OCOMS_LIKELY(NULL != tc) ) {
+        mag = tc->tc_loaded;
+        if( OCOMS_LIKELY(mag->mag_count > 0) ) {
+            return mag->mag_items[--mag->mag_count];
+        }
+        mag = tc->tc_previous;
+        if( mag->mag_count > 0 ) {
+            tc->tc_previous = tc->tc_loaded;
+            tc->tc_loaded = mag;
+            return mag->mag_items[--mag->mag_count];
+        }
+    }
+    return ocoms_free_list_tc_refill(fl, tc);
+}
+
+static inline void ocoms_free_list_tc_return(ocoms_free_list_t* fl,
+                                             ocoms_free_list_item_t* item)
+{
+    ocoms_free_list_tc_t* tc = ocoms_free_list_tc_lookup(fl);
+    ocoms_free_list_magazine_t* mag;
+
+    /* while somebody blocks in OCOMS_FREE_LIST_WAIT the items bypass the cache */
+    if( OCOMS_LIKELY((NULL != tc) && (0 == fl->fl_num_waiting)) ) {
+        mag = tc->tc_loaded;
+        if( OCOMS_LIKELY(mag->mag_count < fl->fl_tc_magazine_size) ) {
+            mag->mag_items[mag->mag_count++] = item;
+            return;
+        }
+        mag = tc->tc_previous;
+        if( mag->mag_count < fl->fl_tc_magazine_size ) {
+            tc->tc_previous = tc->tc_loaded;
+            tc->tc_loaded = mag;
+            mag->mag_items[mag->mag_count++] = item;
+            return;
+        }
+    }
+    ocoms_free_list_tc_flush(fl, tc, item);
+}
+
+/**
+ * Take one item from the free list (or from the calling thread's
+ * cache), without growing the list.
+ */
+static inline ocoms_free_list_item_t* ocoms_free_list_pop(ocoms_free_list_t* fl)
+{
+    if( fl->fl_flags & OCOMS_FREE_LIST_FLAG_THREAD_CACHE ) {
+        return ocoms_free_list_tc_get(fl);
+    }
+    return (ocoms_free_list_item_t*)ocoms_atomic_lifo_pop(&(fl->super));
+}
+
 /**
  * Attemp to obtain an item from a free list. 
  *
@@ -219,7 +394,7 @@ OCOMS_DECLSPEC int ocoms_free_list_resize(ocoms_free_list_t *flist, size_t size)
 #define OCOMS_FREE_LIST_GET(fl, item, rc) \
 { \
     rc = OCOMS_SUCCESS; \
-    item = (ocoms_free_list_item_t*) ocoms_atomic_lifo_pop(&((fl)->super)); \
+    item = ocoms_free_list_pop(fl); \
     if( OCOMS_UNLIKELY(NULL == item) ) { \
         if(ocoms_using_threads()) { \
             ocoms_mutex_lock(&((fl)->fl_lock)); \
@@ -228,11 +403,43 @@ OCOMS_DECLSPEC int ocoms_free_list_resize(ocoms_free_list_t *flist, size_t size)
         } else { \
             ocoms_free_list_grow((fl), (fl)->fl_num_per_alloc); \
         } \
-        item = (ocoms_free_list_item_t*) ocoms_atomic_lifo_pop(&((fl)->super)); \
+        item = ocoms_free_list_pop(fl); \
         if( OCOMS_UNLIKELY(NULL == item) ) rc = OCOMS_ERR_TEMP_OUT_OF_RESOURCE; \
     }  \
 } 
 
+/**
+ * Obtain up to count items from a free list at once.
+ *
+ * @param fl (IN)        Free list.
+ * @param items (OUT)    Array receiving the items.
+ * @param count (IN)     Number of items requested.
+ *
+ * @return               Number of items stored in items.
+ *
+ * The items are detached from the list with a single atomic operation
+ * where the platform allows it. If the list holds fewer than count
+ * items it is grown once; fewer items than requested are returned
+ * only when the list cannot grow any further.
+ */
+OCOMS_DECLSPEC size_t ocoms_free_list_get_n(ocoms_free_list_t *fl,
+                                            ocoms_free_list_item_t **items,
+                                            size_t count);
+
+/**
+ * Return count items to a free list at once.
+ *
+ * @param fl (IN)        Free list.
+ * @param items (IN)     Array of items to return.
+ * @param count (IN)     Number of items in the array.
+ *
+ * The items are linked together and spliced onto the list with a
+ * single compare-and-swap.
+ */
+OCOMS_DECLSPEC void ocoms_free_list_return_n(ocoms_free_list_t *fl,
+                                             ocoms_free_list_item_t **items,
+                                             size_t count);
+
 /**
  * Blocking call to obtain an item from a free list.
  *
@@ -252,7 +459,7 @@ OCOMS_DECLSPEC int ocoms_free_list_resize(ocoms_free_list_t *flist, size_t size)
 static inline int __ocoms_free_list_wait( ocoms_free_list_t* fl,
                                          ocoms_free_list_item_t** item )
 {
-    *item = (ocoms_free_list_item_t*)ocoms_atomic_lifo_pop(&((fl)->super));
+    *item = ocoms_free_list_pop(fl);
     while( NULL == *item ) {
         if( !OCOMS_THREAD_TRYLOCK(&((fl)->fl_lock)) ) {
             if((fl)->fl_max_to_alloc <= (fl)->fl_num_allocated) {
@@ -283,7 +490,7 @@ static inline int __ocoms_free_list_wait( ocoms_free_list_t* fl,
             OCOMS_THREAD_LOCK(&((fl)->fl_lock));
         }
         OCOMS_THREAD_UNLOCK(&((fl)->fl_lock));
-        *item = (ocoms_free_list_item_t*)ocoms_atomic_lifo_pop(&((fl)->super));
+        *item = ocoms_free_list_pop(fl);
     }
     return OCOMS_SUCCESS;
 } 
@@ -300,6 +507,11 @@ static inline int __ocoms_free_list_wait( ocoms_free_list_t* fl,
     do {                                                                \
         ocoms_list_item_t* original;                                     \
                                                                         \
+        if( (fl)->fl_flags & OCOMS_FREE_LIST_FLAG_THREAD_CACHE ) {       \
+            ocoms_free_list_tc_return((fl),                              \
+                                      (ocoms_free_list_item_t*)(item)); \
+            break;                                                      \
+        }                                                               \
         original = ocoms_atomic_lifo_push( &(fl)->super,                 \
                                           &(item)->super);              \
         if( &(fl)->super.ocoms_lifo_ghost == original ) {                \
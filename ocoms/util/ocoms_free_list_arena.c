@@ -0,0 +1,278 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stdlib.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/primitives/align.h"
+#include "ocoms/util/ocoms_free_list_arena.h"
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+struct ocoms_free_list_arena_region_t
+{
+    ocoms_list_item_t super;
+    unsigned char* base;                /* start of the usable region */
+    size_t size;                        /* usable size */
+    void* map_base;                     /* what was actually mapped */
+    size_t map_size;
+    size_t used;                        /* bytes carved so far */
+    size_t live;                        /* chunks not yet freed */
+    void* registration;
+};
+typedef struct ocoms_free_list_arena_region_t ocoms_free_list_arena_region_t;
+
+static void ocoms_free_list_arena_construct(ocoms_free_list_arena_t* arena);
+static void ocoms_free_list_arena_destruct(ocoms_free_list_arena_t* arena);
+
+OBJ_CLASS_INSTANCE(ocoms_free_list_arena_t, ocoms_object_t,
+        ocoms_free_list_arena_construct, ocoms_free_list_arena_destruct);
+
+
+static void ocoms_free_list_arena_construct(ocoms_free_list_arena_t* arena)
+{
+    OBJ_CONSTRUCT(&arena->fla_lock, ocoms_mutex_t);
+    OBJ_CONSTRUCT(&arena->fla_regions, ocoms_list_t);
+    arena->fla_current = NULL;
+    arena->fla_region_size = OCOMS_FREE_LIST_ARENA_REGION_SIZE;
+    arena->fla_flags = 0;
+    arena->fla_register = NULL;
+    arena->fla_deregister = NULL;
+    arena->fla_reg_context = NULL;
+    arena->fla_num_registrations = 0;
+}
+
+/* Map size bytes (a multiple of the huge page size) on a huge page
+ * boundary. */
+static int ocoms_free_list_arena_map(ocoms_free_list_arena_t* arena,
+                                     ocoms_free_list_arena_region_t* region,
+                                     size_t size)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    unsigned char *ptr, *aligned;
+
+#ifdef MAP_HUGETLB
+    if (arena->fla_flags & OCOMS_FREE_LIST_ARENA_FLAG_HUGETLB) {
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (MAP_FAILED != ptr) {
+            region->map_base = region->base = ptr;
+            region->map_size = region->size = size;
+            return OCOMS_SUCCESS;
+        }
+        /* the huge page pool is exhausted, use transparent huge pages */
+    }
+#endif
+
+    /* over-map by one huge page and trim to get an aligned region */
+    ptr = mmap(NULL, size + OCOMS_FREE_LIST_ARENA_PAGE_SIZE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == ptr) {
+        return OCOMS_ERR_OUT_OF_RESOURCE;
+    }
+    aligned = OCOMS_ALIGN_PTR(ptr, OCOMS_FREE_LIST_ARENA_PAGE_SIZE, unsigned char*);
+    if (aligned > ptr) {
+        munmap(ptr, aligned - ptr);
+    }
+    if (aligned + size < ptr + size + OCOMS_FREE_LIST_ARENA_PAGE_SIZE) {
+        munmap(aligned + size, ptr + OCOMS_FREE_LIST_ARENA_PAGE_SIZE - aligned);
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    region->map_base = region->base = aligned;
+    region->map_size = region->size = size;
+    return OCOMS_SUCCESS;
+#else
+    void* ptr = malloc(size + OCOMS_FREE_LIST_ARENA_PAGE_SIZE);
+
+    (void)arena;
+    if (NULL == ptr) {
+        return OCOMS_ERR_OUT_OF_RESOURCE;
+    }
+    region->map_base = ptr;
+    region->map_size = size + OCOMS_FREE_LIST_ARENA_PAGE_SIZE;
+    region->base = OCOMS_ALIGN_PTR(ptr, OCOMS_FREE_LIST_ARENA_PAGE_SIZE, unsigned char*);
+    region->size = size;
+    return OCOMS_SUCCESS;
+#endif
+}
+
+static void ocoms_free_list_arena_unmap(ocoms_free_list_arena_region_t* region)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    munmap(region->map_base, region->map_size);
+#else
+    free(region->map_base);
+#endif
+    OBJ_DESTRUCT(&region->super);
+    free(region);
+}
+
+static void ocoms_free_list_arena_region_release(ocoms_free_list_arena_t* arena,
+                                                 ocoms_free_list_arena_region_t* region)
+{
+    if (NULL != arena->fla_deregister) {
+        arena->fla_deregister(arena->fla_reg_context, region->base, region->size,
+                              region->registration);
+    }
+    ocoms_free_list_arena_unmap(region);
+}
+
+static ocoms_free_list_arena_region_t*
+ocoms_free_list_arena_region_create(ocoms_free_list_arena_t* arena, size_t size)
+{
+    ocoms_free_list_arena_region_t* region;
+
+    region = (ocoms_free_list_arena_region_t*)malloc(sizeof(ocoms_free_list_arena_region_t));
+    if (NULL == region) {
+        return NULL;
+    }
+    size = OCOMS_ALIGN(size, OCOMS_FREE_LIST_ARENA_PAGE_SIZE, size_t);
+    if (size < arena->fla_region_size) {
+        size = arena->fla_region_size;
+    }
+    if (OCOMS_SUCCESS != ocoms_free_list_arena_map(arena, region, size)) {
+        free(region);
+        return NULL;
+    }
+    OBJ_CONSTRUCT(&region->super, ocoms_list_item_t);
+    region->used = 0;
+    region->live = 0;
+    region->registration = NULL;
+    if (NULL != arena->fla_register) {
+        region->registration = arena->fla_register(arena->fla_reg_context,
+                                                   region->base, region->size);
+        if (NULL == region->registration) {
+            ocoms_free_list_arena_unmap(region);
+            return NULL;
+        }
+        arena->fla_num_registrations++;
+    }
+    ocoms_list_append(&arena->fla_regions, &region->super);
+    return region;
+}
+
+static void ocoms_free_list_arena_destruct(ocoms_free_list_arena_t* arena)
+{
+    ocoms_list_item_t* item;
+
+    while (NULL != (item = ocoms_list_remove_first(&arena->fla_regions))) {
+        ocoms_free_list_arena_region_release(arena, (ocoms_free_list_arena_region_t*)item);
+    }
+    arena->fla_current = NULL;
+    OBJ_DESTRUCT(&arena->fla_regions);
+    OBJ_DESTRUCT(&arena->fla_lock);
+}
+
+int ocoms_free_list_arena_init(ocoms_free_list_arena_t* arena,
+                               size_t region_size,
+                               uint32_t flags,
+                               ocoms_free_list_arena_register_fn_t reg,
+                               ocoms_free_list_arena_deregister_fn_t dereg,
+                               void* reg_context)
+{
+    if (0 == region_size) {
+        region_size = OCOMS_FREE_LIST_ARENA_REGION_SIZE;
+    }
+    arena->fla_region_size = OCOMS_ALIGN(region_size, OCOMS_FREE_LIST_ARENA_PAGE_SIZE, size_t);
+    arena->fla_flags = flags;
+    arena->fla_register = reg;
+    arena->fla_deregister = dereg;
+    arena->fla_reg_context = reg_context;
+    return OCOMS_SUCCESS;
+}
+
+void* ocoms_free_list_arena_alloc(void* context, size_t size, size_t align,
+                                  uint32_t flags, void** registration)
+{
+    ocoms_free_list_arena_t* arena = (ocoms_free_list_arena_t*)context;
+    ocoms_free_list_arena_region_t* region;
+    size_t offset = 0;
+    void* ptr;
+
+    (void)flags;
+    if (align < 1) {
+        align = 1;
+    }
+
+    OCOMS_THREAD_LOCK(&arena->fla_lock);
+    region = arena->fla_current;
+    if (NULL != region) {
+        offset = OCOMS_ALIGN(region->used, align, size_t);
+    }
+    if (NULL == region || offset + size > region->size) {
+        /* the region base is huge page aligned, which covers any
+         * reasonable payload alignment */
+        region = ocoms_free_list_arena_region_create(arena, size + align - 1);
+        if (NULL == region) {
+            OCOMS_THREAD_UNLOCK(&arena->fla_lock);
+            return NULL;
+        }
+        offset = OCOMS_ALIGN_PTR(region->base, align, unsigned char*) - region->base;
+        /* keep carving from the region with the most room left */
+        if (NULL == arena->fla_current ||
+            region->size - offset - size > arena->fla_current->size - arena->fla_current->used) {
+            if (NULL != arena->fla_current && 0 == arena->fla_current->live) {
+                ocoms_list_remove_item(&arena->fla_regions, &arena->fla_current->super);
+                ocoms_free_list_arena_region_release(arena, arena->fla_current);
+            }
+            arena->fla_current = region;
+        }
+    }
+    ptr = region->base + offset;
+    region->used = offset + size;
+    region->live++;
+    *registration = region->registration;
+    OCOMS_THREAD_UNLOCK(&arena->fla_lock);
+    return ptr;
+}
+
+void ocoms_free_list_arena_free(void* context, void* addr, void* registration)
+{
+    ocoms_free_list_arena_t* arena = (ocoms_free_list_arena_t*)context;
+    ocoms_free_list_arena_region_t* region;
+    ocoms_list_item_t* item;
+
+    (void)registration;
+    if (NULL == addr) {
+        return;
+    }
+
+    OCOMS_THREAD_LOCK(&arena->fla_lock);
+    for (item = ocoms_list_get_first(&arena->fla_regions);
+         item != ocoms_list_get_end(&arena->fla_regions);
+         item = ocoms_list_get_next(item)) {
+        region = (ocoms_free_list_arena_region_t*)item;
+        if ((unsigned char*)addr < region->base ||
+            (unsigned char*)addr >= region->base + region->size) {
+            continue;
+        }
+        if (0 == --region->live) {
+            if (region == arena->fla_current) {
+                /* nothing left in use, start carving from the beginning */
+                region->used = 0;
+            } else {
+                ocoms_list_remove_item(&arena->fla_regions, &region->super);
+                ocoms_free_list_arena_region_release(arena, region);
+            }
+        }
+        break;
+    }
+    OCOMS_THREAD_UNLOCK(&arena->fla_lock);
+}
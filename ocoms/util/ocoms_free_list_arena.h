@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * Stock backing allocator for free list payload buffers.
+ *
+ * Payload chunks are carved out of large regions mapped on 2MB
+ * boundaries and backed by huge pages, either explicit (hugetlbfs) or
+ * transparent.  An optional registration callback is invoked once per
+ * region and every chunk carved from the region shares its handle.
+ *
+ * To use it pass ocoms_free_list_arena_alloc/ocoms_free_list_arena_free
+ * as the alloc/free callbacks of the free list and the arena as the
+ * allocator_context of its allocator_handle_t.
+ */
+
+#ifndef OCOMS_FREE_LIST_ARENA_H
+#define OCOMS_FREE_LIST_ARENA_H
+
+#include "ocoms/platform/ocoms_config.h"
+#include "ocoms/util/ocoms_list.h"
+#include "ocoms/threads/mutex.h"
+
+BEGIN_C_DECLS
+
+/** Size of the huge pages the regions are aligned to */
+#define OCOMS_FREE_LIST_ARENA_PAGE_SIZE (2UL * 1024 * 1024)
+
+/** Default size of a region */
+#define OCOMS_FREE_LIST_ARENA_REGION_SIZE (16UL * 1024 * 1024)
+
+/**
+ * Flags accepted by ocoms_free_list_arena_init().
+ */
+enum {
+    /** Map regions from the explicit huge page pool (MAP_HUGETLB),
+     *  falling back to transparent huge pages when it is exhausted */
+    OCOMS_FREE_LIST_ARENA_FLAG_HUGETLB = 0x01
+};
+
+/**
+ * Register a region, returning the handle given to every chunk of it.
+ */
+typedef void* (*ocoms_free_list_arena_register_fn_t)(
+    void* reg_context,
+    void* base,
+    size_t size);
+
+/**
+ * Deregister a region before it is unmapped.
+ */
+typedef void (*ocoms_free_list_arena_deregister_fn_t)(
+    void* reg_context,
+    void* base,
+    size_t size,
+    void* registration);
+
+struct ocoms_free_list_arena_region_t;
+
+struct ocoms_free_list_arena_t
+{
+    ocoms_object_t super;
+    ocoms_mutex_t fla_lock;
+    ocoms_list_t fla_regions;           /* all mapped regions */
+    struct ocoms_free_list_arena_region_t* fla_current; /* region being carved */
+    size_t fla_region_size;             /* size of a new region */
+    uint32_t fla_flags;                 /* OCOMS_FREE_LIST_ARENA_FLAG_* */
+    ocoms_free_list_arena_register_fn_t fla_register;
+    ocoms_free_list_arena_deregister_fn_t fla_deregister;
+    void* fla_reg_context;
+    size_t fla_num_registrations;       /* registrations performed */
+};
+typedef struct ocoms_free_list_arena_t ocoms_free_list_arena_t;
+OCOMS_DECLSPEC OBJ_CLASS_DECLARATION(ocoms_free_list_arena_t);
+
+/**
+ * Initialize an arena.
+ *
+ * @param arena          (IN)  Arena.
+ * @param region_size    (IN)  Size of a region, 0 for the default. Rounded
+ *                             up to OCOMS_FREE_LIST_ARENA_PAGE_SIZE.
+ * @param flags          (IN)  Bitwise OR of OCOMS_FREE_LIST_ARENA_FLAG_*.
+ * @param reg            (IN)  Optional region registration callback.
+ * @param dereg          (IN)  Optional region deregistration callback.
+ * @param reg_context    (IN)  Context given to the callbacks.
+ */
+OCOMS_DECLSPEC int ocoms_free_list_arena_init(
+    ocoms_free_list_arena_t* arena,
+    size_t region_size,
+    uint32_t flags,
+    ocoms_free_list_arena_register_fn_t reg,
+    ocoms_free_list_arena_deregister_fn_t dereg,
+    void* reg_context);
+
+/**
+ * ocoms_free_list_alloc_fn_t carving a chunk out of the arena given as
+ * context. Chunks larger than a region get a region of their own.
+ */
+OCOMS_DECLSPEC void* ocoms_free_list_arena_alloc(
+    void* context,
+    size_t size,
+    size_t align,
+    uint32_t flags,
+    void** registration);
+
+/**
+ * ocoms_free_list_free_fn_t for chunks of ocoms_free_list_arena_alloc.
+ * A region is unmapped once none of its chunks is in use, which is why
+ * ocoms_free_list_shrink is restricted to quiescent lists.
+ */
+OCOMS_DECLSPEC void ocoms_free_list_arena_free(
+    void* context,
+    void* addr,
+    void* registration);
+
+END_C_DECLS
+#endif
@@ -28,89 +28,100 @@
 #include "ocoms/util/output.h"
 #include "ocoms/util/ocoms_hash_table.h"
 #include "ocoms/platform/ocoms_constants.h"
+#include "ocoms/primitives/hash_string.h"
 
 /*
  * ocoms_hash_table_t
  * 
  * Sketch: [Constributed by David Linden of Hewlett-Packard]
- * 
- * This has been found to be good for search and insert and
- * (seldom-)remove, all with probablistic O(1) time.  Having a good
- * distribution of the hash indices is important, so even if you know
- * the keys distribute well under a mask, that micro-optimization
- * isn't worth doing.
  *
- * One aspect is that the concept of buckets and elements is
- * unified. The buckets aka elements are in a single array, each
- * element having a valid flag.  The key hashes to a keyhash, the
+ * The concept of buckets and elements is unified. The buckets aka
+ * elements are in a single array.  The key hashes to a keyhash, the
  * keyhash determines the first index to probe.  Missing probes search
- * forward (wrapping) until the key is found or an invalid entry is
- * found.
+ * forward (wrapping) until the key is found, an empty element is
+ * found, or (see below) an element closer to its home than we are.
  *
- * One parameter of the hash table is a maximum density, which must be
- * less than 1, expressed a numerator and denominator.  1/2 seems to
- * work well.  A density less than 1 ensures the search will stop
- * because searching will eventually find an invalid element.  At
- * maximum density, assuming random usage of the elements, the
- * expected search length is 1/(1-density); for a density of 1/2, this
- * is 2.  
+ * The keyhash is computed once, when the key is inserted, and stored
+ * in the element next to the key.  An element is empty when its
+ * stored hash is zero; every stored hash has its top bit set.  Growing
+ * and removal never call back into the key type to rehash, and a probe
+ * compares the hashes before it looks at the key at all.
  *
- * I believe this blinded bucket/element scheme is actually more
- * storage-efficient than a bucket having a linear list of elements.
- * It is certainly better on the cache.
+ * The capacity is a power of two and the first index to probe is the
+ * keyhash under a mask.  Keys that vary only in their high bits would
+ * collide under a mask, so integer keys go through a 64-bit mixing
+ * function rather than being used as their own hash.
  *
- * Another parameter is the growth factor, another ratio, greater than
- * 1, expressed as a numerator and denominator.  2/1 seems to work
- * well.  When the hash table reaches maximum density, it is grown by
- * the growth factor (thus reducing the density).  Growing requires
- * rehashing and reinserting existing elements.  It turns out this
- * keeps insertion at O(1): multiplies the coefficient by
- * growth/(growth-1); for a growth of 2/1 this is 2.
+ * Insertion uses Robin Hood hashing: when the element being inserted
+ * is further from its home index than the element in the slot being
+ * probed, they trade places and the displaced element continues the
+ * search.  This keeps the variance of the probe lengths low, and lets a
+ * lookup stop as soon as it meets an element closer to its home than
+ * the number of probes done so far.
+ *
+ * One parameter of the hash table is a maximum density, which must be
+ * less than 1, expressed a numerator and denominator.  1/2 seems to
+ * work well.  Another parameter is the growth factor, another ratio,
+ * greater than 1, expressed as a numerator and denominator.  2/1 seems
+ * to work well.  When the hash table reaches maximum density, it is
+ * grown by (at least) the growth factor, rounded up to a power of two.
  *
- * The key is hashed to a keyhash.  The keyhash determines the first
- * index to probe by using the remainder of the keyhash by the table's
- * 'capacity.'  The capacity is not a power of 2.  (Keys that vary
- * only in the high 32 bits of a 64 bit key would always colide with a
- * power-of-2 capacity.)  Rather, the capacity is arranged not to be a
- * multiple of 2, 3 or 5.  A potential capacity is rounded up to be (1
- * mod 30).
+ * Removing a key shifts the following elements that are not at their
+ * home index back by one, up to the next empty element or element at
+ * home (backward shift deletion), so no tombstones are needed.
  *
- * Removing a key is the most involved operation.  It is necessary to
- * rehash any valid elements immediately after the removed element,
- * because some (perhaps all) of those elements would normally hash
- * lower if the removed key were never there.  This remains O(1); the
- * implementation just needs to be a little careful.
+ * Growth is either done at once, or incrementally when a growth step
+ * was set: the full table becomes the old table, a new one is
+ * allocated, and every set and remove moves the next few elements of
+ * the old table into the new one, in index order.  A key lives in
+ * exactly one of the two tables, so lookups probe the new table and
+ * then the old one.  Elements of the old table are never shifted; a
+ * moved or removed one keeps its hash, flagged OCOMS_HASH_MOVED, so the
+ * probe sequences through it stay intact while no probe can match it.
  *
  */
 
-#define HASH_MULTIPLIER 31
+/* set in every stored hash, so that 0 means an empty element */
+#define OCOMS_HASH_USED ((uint64_t)1 << 63)
+/* clear in every computed hash, set on elements of the old table that
+   are no longer there */
+#define OCOMS_HASH_MOVED ((uint64_t)1 << 62)
+#define OCOMS_HASH_MIN_CAPACITY 8
 
 /* 
  * Define the structs that are opaque in the .h
  */
 
+union ocoms_hash_key_t {        /* the key, in its various forms */
+    uint32_t        u32;
+    uint64_t        u64;
+    struct {
+        const void * key;
+        size_t      key_size;
+    }       ptr;
+};
+typedef union ocoms_hash_key_t ocoms_hash_key_t;
+
 struct ocoms_hash_element_t {
-    int         valid;          /* whether this element is valid */
-    union {                     /* the key, in its various forms */
-        uint32_t        u32;
-        uint64_t        u64;
-        struct {
-            const void * key;
-            size_t      key_size;
-        }       ptr;
-    }           key;
+    uint64_t    hash;           /* cached keyhash | OCOMS_HASH_USED, 0 if empty */
+    ocoms_hash_key_t key;       /* the key */
     void *      value;          /* the value */
 };
 typedef struct ocoms_hash_element_t ocoms_hash_element_t;
 
+/* key types of the generic operations below */
+enum {
+    OCOMS_HASH_KEY_UINT32,
+    OCOMS_HASH_KEY_UINT64,
+    OCOMS_HASH_KEY_PTR
+};
+
 struct ocoms_hash_type_methods_t {
     /* Frees any storage associated with the element
      * The value is not owned by the hash table
      * The key,key_size of pointer keys is 
      */
     void        (*elt_destructor)(ocoms_hash_element_t * elt);
-    /* Hash the key of the element -- for growing and adjusting-after-removal */
-    uint64_t    (*hash_elt)(ocoms_hash_element_t * elt);
 };
 
 /* interact with the class-like mechanism */
@@ -133,6 +144,11 @@ ocoms_hash_table_construct(ocoms_hash_table_t* ht)
   ht->ht_density_numer = ht->ht_density_denom = 0;
   ht->ht_growth_numer = ht->ht_growth_denom = 0;
   ht->ht_type_methods = NULL;
+  ht->ht_old_table = NULL;
+  ht->ht_old_capacity = ht->ht_migrate_next = 0;
+  ht->ht_migrate_step = ht->ht_growth_step = 0;
+  ht->ht_table_size = 0;
+  ht->ht_mask = 0;
 }
 
 static void
@@ -149,8 +165,96 @@ ocoms_hash_table_destruct(ocoms_hash_table_t* ht)
 static size_t 
 ocoms_hash_round_capacity_up(size_t capacity)
 {
-    /* round up to (1 mod 30) */
-    return ((capacity+29)/30*30 + 1);
+    size_t pow2 = OCOMS_HASH_MIN_CAPACITY;
+
+    while (pow2 < capacity) {
+        pow2 <<= 1;
+    }
+    return pow2;
+}
+
+/* 64-bit finalizer of MurmurHash3: every input bit affects every
+   output bit, so the low bits used as index are well distributed */
+static inline uint64_t
+ocoms_hash_mix64(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (key & ~OCOMS_HASH_MOVED) | OCOMS_HASH_USED;
+}
+
+/* distance of the element in slot ii from its home slot */
+static inline size_t
+ocoms_hash_probe_distance(size_t mask, uint64_t hash, size_t ii)
+{
+    return (ii - (size_t)hash) & mask;
+}
+
+static inline int
+ocoms_hash_key_equal(int key_type, const ocoms_hash_element_t * elt,
+                     const ocoms_hash_key_t * key)
+{
+    switch (key_type) {
+    case OCOMS_HASH_KEY_UINT32:
+        return elt->key.u32 == key->u32;
+    case OCOMS_HASH_KEY_UINT64:
+        return elt->key.u64 == key->u64;
+    default:
+        return elt->key.ptr.key_size == key->ptr.key_size &&
+            0 == memcmp(elt->key.ptr.key, key->ptr.key, key->ptr.key_size);
+    }
+}
+
+/* Look a key up, returning its index or (size_t)-1 if it is not in
+   the table.  key_type is a constant in every caller, so the key
+   comparison is resolved at compile time. */
+static inline size_t
+ocoms_hash_find(ocoms_hash_element_t * elts, size_t mask, int key_type,
+                const ocoms_hash_key_t * key, uint64_t hash)
+{
+    size_t ii, dist;
+    ocoms_hash_element_t * elt;
+
+    for (ii = (size_t)hash & mask, dist = 0; ; ii = (ii + 1) & mask, dist += 1) {
+        elt = &elts[ii];
+        if (0 == elt->hash ||
+            ocoms_hash_probe_distance(mask, elt->hash, ii) < dist) {
+            /* an element that would have been displaced by our key */
+            return (size_t)-1;
+        }
+        if (elt->hash == hash && ocoms_hash_key_equal(key_type, elt, key)) {
+            return ii;
+        }
+    }
+}
+
+/* Insert an element known not to be in the table (Robin Hood) */
+static void
+ocoms_hash_insert_elt(ocoms_hash_element_t * elts, size_t mask,
+                      ocoms_hash_element_t carry)
+{
+    size_t ii, dist, elt_dist;
+    ocoms_hash_element_t * elt;
+    ocoms_hash_element_t tmp;
+
+    for (ii = (size_t)carry.hash & mask, dist = 0; ; ii = (ii + 1) & mask, dist += 1) {
+        elt = &elts[ii];
+        if (0 == elt->hash) {
+            *elt = carry;
+            return;
+        }
+        elt_dist = ocoms_hash_probe_distance(mask, elt->hash, ii);
+        if (elt_dist < dist) {
+            /* the resident is richer: it moves on, we take its place */
+            tmp = *elt;
+            *elt = carry;
+            carry = tmp;
+            dist = elt_dist;
+        }
+    }
 }
 
 /* this could be the new init if people wanted a more general API */
@@ -167,6 +271,7 @@ ocoms_hash_table_init2(ocoms_hash_table_t* ht, size_t estimated_max_size,
         return OCOMS_ERR_OUT_OF_RESOURCE;
     }
     ht->ht_capacity       = capacity;
+    ht->ht_mask           = capacity - 1;
     ht->ht_density_numer  = density_numer;
     ht->ht_density_denom  = density_denom;
     ht->ht_growth_numer   = growth_numer;
@@ -183,16 +288,35 @@ ocoms_hash_table_init(ocoms_hash_table_t* ht, size_t table_size)
     return ocoms_hash_table_init2(ht, table_size, 1, 2, 2, 1);
 }
 
+int                             /* OCOMS_ return code */
+ocoms_hash_table_set_growth_step(ocoms_hash_table_t* ht, size_t step)
+{
+    ht->ht_growth_step = step;
+    return OCOMS_SUCCESS;
+}
+
 int                             /* OCOMS_ return code */
 ocoms_hash_table_remove_all(ocoms_hash_table_t* ht)
 {
     size_t ii;
+
+    if (NULL != ht->ht_old_table) {
+        for (ii = 0; ii < ht->ht_old_capacity; ii += 1) {
+            ocoms_hash_element_t * elt = &ht->ht_old_table[ii];
+            if (elt->hash && !(elt->hash & OCOMS_HASH_MOVED) &&
+                ht->ht_type_methods && ht->ht_type_methods->elt_destructor) {
+                ht->ht_type_methods->elt_destructor(elt);
+            }
+        }
+        free(ht->ht_old_table);
+        ht->ht_old_table = NULL;
+    }
     for (ii = 0; ii < ht->ht_capacity; ii += 1) {
         ocoms_hash_element_t * elt = &ht->ht_table[ii];
-        if (elt->valid && ht->ht_type_methods && ht->ht_type_methods->elt_destructor) {
+        if (elt->hash && ht->ht_type_methods && ht->ht_type_methods->elt_destructor) {
             ht->ht_type_methods->elt_destructor(elt);
         }
-        elt->valid = 0;
+        elt->hash = 0;
         elt->value = NULL;
     }
     ht->ht_size = 0;
@@ -202,52 +326,92 @@ ocoms_hash_table_remove_all(ocoms_hash_table_t* ht)
     return OCOMS_SUCCESS;
 }
 
+/* move up to count elements of the old table into the new one, and
+   release the old table once it has been drained */
+static void
+ocoms_hash_migrate(ocoms_hash_table_t * ht, size_t count)
+{
+    ocoms_hash_element_t * old_table = ht->ht_old_table;
+    size_t ii = ht->ht_migrate_next;
+    size_t end = ht->ht_old_capacity;
+
+    if (count < end - ii) {
+        end = ii + count;
+    }
+    for (; ii < end; ii += 1) {
+        ocoms_hash_element_t * elt = &old_table[ii];
+        if (elt->hash && !(elt->hash & OCOMS_HASH_MOVED)) {
+            /* the key storage of ptr keys moves along */
+            ocoms_hash_insert_elt(ht->ht_table, ht->ht_mask, *elt);
+            elt->hash |= OCOMS_HASH_MOVED;
+        }
+    }
+    ht->ht_migrate_next = ii;
+    if (ii == ht->ht_old_capacity) {
+        free(old_table);
+        ht->ht_old_table = NULL;
+    }
+}
+
 static int                      /* OCOMS_ return code */
 ocoms_hash_grow(ocoms_hash_table_t * ht)
 {
-    size_t jj, ii;
+    size_t jj;
     ocoms_hash_element_t* old_table;
     ocoms_hash_element_t* new_table;
     size_t old_capacity;
     size_t new_capacity;
   
+    if (NULL != ht->ht_old_table) {
+        /* the previous grow is not done yet, finish it first */
+        ocoms_hash_migrate(ht, ht->ht_old_capacity);
+    }
+
     old_table    = ht->ht_table;
     old_capacity = ht->ht_capacity;
     
     new_capacity = old_capacity * ht->ht_growth_numer / ht->ht_growth_denom;
     new_capacity = ocoms_hash_round_capacity_up(new_capacity);
+    if (new_capacity <= old_capacity) {
+        new_capacity = old_capacity * 2;
+    }
 
     new_table    = (ocoms_hash_element_t*) calloc(new_capacity, sizeof(new_table[0]));
     if (NULL == new_table) {
         return OCOMS_ERR_OUT_OF_RESOURCE;
     }
 
-    /* for each element of the old table (indexed by jj), insert it
-       into the new table (indexed by ii), using the hash_elt method
-       to generically hash an element, then modulo the new capacity,
-       and using struct-assignment to copy an old element into its
-       place int he new table.  The hash table never owns the value,
-       and in the case of ptr keys the old dlements will be blindly
+    if (0 != ht->ht_growth_step) {
+        /* keep the old table, the updates will drain it.  Move enough
+           per update that it is empty before the new one is full */
+        ht->ht_table = new_table;
+        ht->ht_capacity = new_capacity;
+        ht->ht_mask = new_capacity - 1;
+        ht->ht_growth_trigger = new_capacity * ht->ht_density_numer / ht->ht_density_denom;
+        ht->ht_old_table = old_table;
+        ht->ht_old_capacity = old_capacity;
+        ht->ht_migrate_next = 0;
+        ht->ht_migrate_step = old_capacity / (ht->ht_growth_trigger - ht->ht_size) + 1;
+        if (ht->ht_migrate_step < ht->ht_growth_step) {
+            ht->ht_migrate_step = ht->ht_growth_step;
+        }
+        return OCOMS_SUCCESS;
+    }
+
+    /* for each element of the old table, insert it into the new table
+       using its cached hash.  The hash table never owns the value, and
+       in the case of ptr keys the old elements will be blindly
        deleted, so we still own the ptr key storage, just in the new
        table now */
     for (jj = 0; jj < old_capacity; jj += 1) {
-        ocoms_hash_element_t * old_elt;
-        ocoms_hash_element_t * new_elt;
-        old_elt =  &old_table[jj];
-        if (old_elt->valid) {
-            for (ii = (ht->ht_type_methods->hash_elt(old_elt)%new_capacity); ; ii += 1) {
-                if (ii == new_capacity) { ii = 0; }
-                new_elt = &new_table[ii];
-                if (! new_elt->valid) {
-                    *new_elt = *old_elt;
-                    break;
-                }
-            }
+        if (old_table[jj].hash) {
+            ocoms_hash_insert_elt(new_table, new_capacity - 1, old_table[jj]);
         }
     }
     /* update with the new, free the old, return */
     ht->ht_table = new_table;
     ht->ht_capacity = new_capacity;
+    ht->ht_mask = new_capacity - 1;
     ht->ht_growth_trigger = new_capacity * ht->ht_density_numer / ht->ht_density_denom;
     free(old_table);
     return OCOMS_SUCCESS;
@@ -255,86 +419,161 @@ ocoms_hash_grow(ocoms_hash_table_t * ht)
 
 /* one of the removal functions has determined which element should be
    removed.  With the help of the type methods this can be generic.
-   The important thing is to rehash any valid elements immediately
-   following the element-being-removed */
+   The elements following the removed one that are not at their home
+   index are shifted back by one */
 static int                      /* OCOMS_ return code */
 ocoms_hash_table_remove_elt_at(ocoms_hash_table_t * ht, size_t ii)
 {
-    size_t jj, capacity = ht->ht_capacity;
+    size_t jj, mask = ht->ht_mask;
     ocoms_hash_element_t* elts = ht->ht_table;
     ocoms_hash_element_t * elt;
 
     elt = &elts[ii];
 
-    if (! elt->valid) {
+    if (! elt->hash) {
         /* huh?  removing a not-valid element? */
         return OCOMS_ERROR;
     }
 
-    elt->valid = 0;
     if (ht->ht_type_methods->elt_destructor) {
         ht->ht_type_methods->elt_destructor(elt);
     }
 
-    /* need to possibly re-insert followers because of the now-gap */
-    /* E.g., XYyAaCbz.  (where upper is ideal, lower is not)
+    /* E.g., XYyAabCz.  (where upper is ideal, lower is not)
      * remove A
-     * leaving XYy.aCbz. and we need to reconsider aCbz
-     * first a gets reinserted where it wants to be: XYya.Cbz.
-     * next  C doesn't move:                         XYya.Cbz.
-     * then  b gets put where it wants to be:        XYyabC.z.
-     * then  z moves down a little:                  XYyabCz..
-     * then  . means we're done
+     * leaving XYy.abCz. 
+     * a and b are shifted back:  XYyab.Cz.
+     * then  C is at home, we're done
      */
-    for (ii = ii+1; ; ii += 1) { /* scan immediately following elements */
-        if (ii == capacity) { ii = 0; }
-        elt = &elts[ii];
-        if (! elt->valid) {
-            break;              /* done */
-        }
-        /* rehash it and move it if necessary */
-        for (jj = ht->ht_type_methods->hash_elt(elt)%capacity; ; jj += 1) {
-            if (jj == capacity) { jj = 0; }
-            if (jj == ii) {
-                /* already in place, either ideal or best-for-now */
-                break;
-            } else if (! elts[jj].valid) {
-                /* move it down, and invaildate where it came from */
-                elts[jj] = elts[ii];
-                elts[ii].valid = 0;
-                break;
-            } else {
-                /* still need to find its place */
-            }
+    for (jj = (ii + 1) & mask; ; ii = jj, jj = (jj + 1) & mask) {
+        elt = &elts[jj];
+        if (0 == elt->hash || 0 == ocoms_hash_probe_distance(mask, elt->hash, jj)) {
+            break;
         }
+        elts[ii] = *elt;
     }
+    elts[ii].hash = 0;
+    elts[ii].value = NULL;
     ht->ht_size -= 1;
     return OCOMS_SUCCESS;
 }
 
+/* generic get/set/remove, key_type is a constant in every caller */
 
-/***************************************************************************/
+static inline int               /* OCOMS_ return code */
+ocoms_hash_table_get_value(ocoms_hash_table_t * ht, int key_type,
+                           const ocoms_hash_key_t * key, uint64_t hash,
+                           void * *value)
+{
+    size_t ii = ocoms_hash_find(ht->ht_table, ht->ht_mask, key_type, key, hash);
+
+    if ((size_t)-1 != ii) {
+        *value = ht->ht_table[ii].value;
+        return OCOMS_SUCCESS;
+    }
+    if (OCOMS_UNLIKELY(NULL != ht->ht_old_table)) {
+        ii = ocoms_hash_find(ht->ht_old_table, ht->ht_old_capacity - 1, key_type, key, hash);
+        if ((size_t)-1 != ii) {
+            *value = ht->ht_old_table[ii].value;
+            return OCOMS_SUCCESS;
+        }
+    }
+    return OCOMS_ERR_NOT_FOUND;
+}
+
+static inline int               /* OCOMS_ return code */
+ocoms_hash_table_set_value(ocoms_hash_table_t * ht, int key_type,
+                           const ocoms_hash_key_t * key, uint64_t hash,
+                           void * value)
+{
+    ocoms_hash_element_t elt;
+    size_t ii;
+    int rc;
+
+    ii = ocoms_hash_find(ht->ht_table, ht->ht_mask, key_type, key, hash);
+    if ((size_t)-1 != ii) {
+        /* replace existing element */
+        ht->ht_table[ii].value = value;
+        return OCOMS_SUCCESS;
+    }
+    if (OCOMS_UNLIKELY(NULL != ht->ht_old_table)) {
+        ii = ocoms_hash_find(ht->ht_old_table, ht->ht_old_capacity - 1, key_type, key, hash);
+        if ((size_t)-1 != ii) {
+            /* not moved yet, replace it where it is */
+            ht->ht_old_table[ii].value = value;
+            return OCOMS_SUCCESS;
+        }
+    }
 
-static uint64_t 
-ocoms_hash_hash_elt_uint32(ocoms_hash_element_t * elt)
+    /* new entry, make room first so the insertion cannot fail */
+    if (ht->ht_size + 1 >= ht->ht_growth_trigger) {
+        if (OCOMS_SUCCESS != (rc = ocoms_hash_grow(ht))) {
+            return rc;
+        }
+    }
+    elt.hash = hash;
+    elt.key = *key;
+    elt.value = value;
+    if (OCOMS_HASH_KEY_PTR == key_type) {
+        void * key_local = malloc(key->ptr.key_size);
+        if (NULL == key_local) {
+            return OCOMS_ERR_OUT_OF_RESOURCE;
+        }
+        memcpy(key_local, key->ptr.key, key->ptr.key_size);
+        elt.key.ptr.key = key_local;
+    }
+    ocoms_hash_insert_elt(ht->ht_table, ht->ht_mask, elt);
+    ht->ht_size += 1;
+    if (OCOMS_UNLIKELY(NULL != ht->ht_old_table)) {
+        ocoms_hash_migrate(ht, ht->ht_migrate_step);
+    }
+    return OCOMS_SUCCESS;
+}
+
+static inline int               /* OCOMS_ return code */
+ocoms_hash_table_remove_value(ocoms_hash_table_t * ht, int key_type,
+                              const ocoms_hash_key_t * key, uint64_t hash)
 {
-  return elt->key.u32;
+    size_t ii = ocoms_hash_find(ht->ht_table, ht->ht_mask, key_type, key, hash);
+    ocoms_hash_element_t * elt;
+    int rc = OCOMS_ERR_NOT_FOUND;
+
+    if ((size_t)-1 != ii) {
+        rc = ocoms_hash_table_remove_elt_at(ht, ii);
+    } else if (OCOMS_UNLIKELY(NULL != ht->ht_old_table)) {
+        ii = ocoms_hash_find(ht->ht_old_table, ht->ht_old_capacity - 1, key_type, key, hash);
+        if ((size_t)-1 != ii) {
+            /* not moved yet, leave it behind flagged as moved */
+            elt = &ht->ht_old_table[ii];
+            if (ht->ht_type_methods->elt_destructor) {
+                ht->ht_type_methods->elt_destructor(elt);
+            }
+            elt->hash |= OCOMS_HASH_MOVED;
+            ht->ht_size -= 1;
+            rc = OCOMS_SUCCESS;
+        }
+    }
+    if (OCOMS_UNLIKELY(NULL != ht->ht_old_table)) {
+        ocoms_hash_migrate(ht, ht->ht_migrate_step);
+    }
+    return rc;
 }
 
+
+/***************************************************************************/
+
 static const struct ocoms_hash_type_methods_t 
 ocoms_hash_type_methods_uint32 = {
-    NULL,
-    ocoms_hash_hash_elt_uint32
+    NULL
 };
 
 int                             /* OCOMS_ return code */
 ocoms_hash_table_get_value_uint32(ocoms_hash_table_t* ht, uint32_t key, void * *value)
 {
-    size_t ii, capacity = ht->ht_capacity;
-    ocoms_hash_element_t * elt;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_get_value_uint32:"
                     "ocoms_hash_table_init() has not been called");
         return OCOMS_ERROR;
@@ -348,30 +587,18 @@ ocoms_hash_table_get_value_uint32(ocoms_hash_table_t* ht, uint32_t key, void * *
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_uint32;
-    for (ii = key%capacity; ; ii += 1) {
-        if (ii == capacity) { ii = 0; }
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            return OCOMS_ERR_NOT_FOUND;
-        } else if (elt->key.u32 == key) {
-            *value = elt->value;
-            return OCOMS_SUCCESS;
-        } else {
-            /* keey looking */
-        }
-    }
-
+    hkey.u32 = key;
+    return ocoms_hash_table_get_value(ht, OCOMS_HASH_KEY_UINT32, &hkey,
+                                      ocoms_hash_mix64(key), value);
 }
 
 int                             /* OCOMS_ return code */
 ocoms_hash_table_set_value_uint32(ocoms_hash_table_t * ht, uint32_t key, void * value)
 {
-    int rc;
-    size_t ii, capacity = ht->ht_capacity;
-    ocoms_hash_element_t * elt;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_set_value_uint32:"
                    "ocoms_hash_table_init() has not been called");
         return OCOMS_ERR_BAD_PARAM;
@@ -385,38 +612,18 @@ ocoms_hash_table_set_value_uint32(ocoms_hash_table_t * ht, uint32_t key, void *
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_uint32;
-    for (ii = key%capacity; ; ii += 1) {
-        if (ii == capacity) { ii = 0; }
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            /* new entry */
-            elt->key.u32 = key;
-            elt->value = value;
-            elt->valid = 1;
-            ht->ht_size += 1;
-            if (ht->ht_size >= ht->ht_growth_trigger) {
-                if (OCOMS_SUCCESS != (rc = ocoms_hash_grow(ht))) {
-                    return rc;
-                }
-            }
-            return OCOMS_SUCCESS;
-        } else if (elt->key.u32 == key) {
-            /* replace existing element */
-            elt->value = value;
-            return OCOMS_SUCCESS;
-        } else {
-            /* keep looking */
-        }
-    }
+    hkey.u32 = key;
+    return ocoms_hash_table_set_value(ht, OCOMS_HASH_KEY_UINT32, &hkey,
+                                      ocoms_hash_mix64(key), value);
 }
 
 int
 ocoms_hash_table_remove_value_uint32(ocoms_hash_table_t * ht, uint32_t key)
 {
-    size_t ii, capacity = ht->ht_capacity;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_get_value_uint32:"
                     "ocoms_hash_table_init() has not been called");
         return OCOMS_ERROR;
@@ -430,45 +637,27 @@ ocoms_hash_table_remove_value_uint32(ocoms_hash_table_t * ht, uint32_t key)
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_uint32;
-    for (ii = key%capacity; ; ii += 1) {
-        ocoms_hash_element_t * elt;
-        if (ii == capacity) ii = 0;
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            return OCOMS_ERR_NOT_FOUND;
-        } else if (elt->key.u32 == key) {
-            return ocoms_hash_table_remove_elt_at(ht, ii);
-        } else {
-            /* keep looking */
-        }
-    }
+    hkey.u32 = key;
+    return ocoms_hash_table_remove_value(ht, OCOMS_HASH_KEY_UINT32, &hkey,
+                                         ocoms_hash_mix64(key));
 }
 
 
 /***************************************************************************/
 
 
-static uint64_t 
-ocoms_hash_hash_elt_uint64(ocoms_hash_element_t * elt)
-{
-  return elt->key.u64;
-}
-
 static const struct ocoms_hash_type_methods_t 
 ocoms_hash_type_methods_uint64 = {
-    NULL,
-    ocoms_hash_hash_elt_uint64
+    NULL
 };
 
 int                             /* OCOMS_ return code */
 ocoms_hash_table_get_value_uint64(ocoms_hash_table_t * ht, uint64_t key, void * *value)
 {
-    size_t ii;
-    size_t capacity = ht->ht_capacity;
-    ocoms_hash_element_t * elt;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_get_value_uint64:"
                    "ocoms_hash_table_init() has not been called");
         return OCOMS_ERROR;
@@ -482,30 +671,18 @@ ocoms_hash_table_get_value_uint64(ocoms_hash_table_t * ht, uint64_t key, void *
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_uint64;
-    for (ii = key%capacity; ; ii += 1) {
-        if (ii == capacity) { ii = 0; }
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            return OCOMS_ERR_NOT_FOUND;
-        } else if (elt->key.u64 == key) {
-            *value = elt->value;
-            return OCOMS_SUCCESS;
-        } else {
-            /* keep looking */
-        }
-    }
-
+    hkey.u64 = key;
+    return ocoms_hash_table_get_value(ht, OCOMS_HASH_KEY_UINT64, &hkey,
+                                      ocoms_hash_mix64(key), value);
 }
 
 int                             /* OCOMS_ return code */
 ocoms_hash_table_set_value_uint64(ocoms_hash_table_t * ht, uint64_t key, void * value)
 {
-    int rc;
-    size_t ii, capacity = ht->ht_capacity;
-    ocoms_hash_element_t * elt;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_set_value_uint64:"
                    "ocoms_hash_table_init() has not been called");
         return OCOMS_ERR_BAD_PARAM;
@@ -519,38 +696,19 @@ ocoms_hash_table_set_value_uint64(ocoms_hash_table_t * ht, uint64_t key, void *
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_uint64;
-    for (ii = key%capacity; ; ii += 1) {
-        if (ii == capacity) { ii = 0; }
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            /* new entry */
-            elt->key.u64 = key;
-            elt->value = value;
-            elt->valid = 1;
-            ht->ht_size += 1;
-            if (ht->ht_size >= ht->ht_growth_trigger) {
-                if (OCOMS_SUCCESS != (rc = ocoms_hash_grow(ht))) {
-                    return rc;
-                }
-            }
-            return OCOMS_SUCCESS;
-        } else if (elt->key.u64 == key) {
-            elt->value = value;
-            return OCOMS_SUCCESS;
-        } else {
-            /* keep looking */
-        }
-    }
+    hkey.u64 = key;
+    return ocoms_hash_table_set_value(ht, OCOMS_HASH_KEY_UINT64, &hkey,
+                                      ocoms_hash_mix64(key), value);
 }
 
 
 int                             /* OCOMS_ return code */
 ocoms_hash_table_remove_value_uint64(ocoms_hash_table_t * ht, uint64_t key)
 {
-    size_t ii, capacity = ht->ht_capacity;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_get_value_uint64:"
                     "ocoms_hash_table_init() has not been called");
         return OCOMS_ERROR;
@@ -564,37 +722,19 @@ ocoms_hash_table_remove_value_uint64(ocoms_hash_table_t * ht, uint64_t key)
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_uint64;
-    for (ii = key%capacity; ; ii += 1) {
-        ocoms_hash_element_t * elt;
-        if (ii == capacity) { ii = 0; }
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            return OCOMS_ERR_NOT_FOUND;
-        } else if (elt->key.u64 == key) {
-            return ocoms_hash_table_remove_elt_at(ht, ii);
-        } else {
-            /* keep looking */
-        }
-    }
+    hkey.u64 = key;
+    return ocoms_hash_table_remove_value(ht, OCOMS_HASH_KEY_UINT64, &hkey,
+                                         ocoms_hash_mix64(key));
 }
 
 
 /***************************************************************************/
 
 /* helper function used in several places */
-static uint64_t 
+static inline uint64_t 
 ocoms_hash_hash_key_ptr(const void * key, size_t key_size)
 {
-    uint64_t hash;
-    const unsigned char *scanner;
-    size_t ii;
-    
-    hash = 0;
-    scanner = (const unsigned char *)key;
-    for (ii = 0; ii < key_size; ii += 1) {
-        hash = HASH_MULTIPLIER*hash + *scanner++;
-    }
-    return hash;
+    return (ocoms_hash_bytes(key, key_size, 0) & ~OCOMS_HASH_MOVED) | OCOMS_HASH_USED;
 }
 
 /* ptr methods */
@@ -610,16 +750,9 @@ ocoms_hash_destruct_elt_ptr(ocoms_hash_element_t * elt)
     }
 }
 
-static uint64_t 
-ocoms_hash_hash_elt_ptr(ocoms_hash_element_t * elt)
-{
-    return ocoms_hash_hash_key_ptr(elt->key.ptr.key, elt->key.ptr.key_size);
-}
-
 static const struct ocoms_hash_type_methods_t 
 ocoms_hash_type_methods_ptr = {
-    ocoms_hash_destruct_elt_ptr,
-    ocoms_hash_hash_elt_ptr
+    ocoms_hash_destruct_elt_ptr
 };
 
 int                             /* OCOMS_ return code */
@@ -627,11 +760,10 @@ ocoms_hash_table_get_value_ptr(ocoms_hash_table_t * ht,
                               const void * key, size_t key_size,
                               void * *value)
 {
-    size_t ii, capacity = ht->ht_capacity;
-    ocoms_hash_element_t * elt;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_get_value_ptr:"
                    "ocoms_hash_table_init() has not been called");
         return OCOMS_ERROR;
@@ -645,19 +777,10 @@ ocoms_hash_table_get_value_ptr(ocoms_hash_table_t * ht,
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_ptr;
-    for (ii = ocoms_hash_hash_key_ptr(key, key_size)%capacity; ; ii += 1) {
-        if (ii == capacity) { ii = 0; }
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            return OCOMS_ERR_NOT_FOUND;
-        } else if (elt->key.ptr.key_size == key_size &&
-                   0 == memcmp(elt->key.ptr.key, key, key_size)) {
-            *value = elt->value;
-            return OCOMS_SUCCESS;
-        } else {
-            /* keep going */
-        }
-    }
+    hkey.ptr.key = key;
+    hkey.ptr.key_size = key_size;
+    return ocoms_hash_table_get_value(ht, OCOMS_HASH_KEY_PTR, &hkey,
+                                      ocoms_hash_hash_key_ptr(key, key_size), value);
 }
 
 int                             /* OCOMS_ return code */
@@ -665,12 +788,10 @@ ocoms_hash_table_set_value_ptr(ocoms_hash_table_t * ht,
                               const void * key, size_t key_size, 
                               void * value)
 {
-    int rc;
-    size_t ii, capacity = ht->ht_capacity;
-    ocoms_hash_element_t * elt;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_set_value_ptr:"
                    "ocoms_hash_table_init() has not been called");
         return OCOMS_ERR_BAD_PARAM;
@@ -684,43 +805,20 @@ ocoms_hash_table_set_value_ptr(ocoms_hash_table_t * ht,
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_ptr;
-    for (ii = ocoms_hash_hash_key_ptr(key, key_size)%capacity; ; ii += 1) {
-        if (ii == capacity) { ii = 0; }
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            /* new entry */
-            void * key_local = malloc(key_size);
-            memcpy(key_local, key, key_size);
-            elt->key.ptr.key      = key_local;
-            elt->key.ptr.key_size = key_size;
-            elt->value = value;
-            elt->valid = 1;
-            ht->ht_size += 1;
-            if (ht->ht_size >= ht->ht_growth_trigger) {
-                if (OCOMS_SUCCESS != (rc = ocoms_hash_grow(ht))) {
-                    return rc;
-                }
-            }
-            return OCOMS_SUCCESS;
-        } else if (elt->key.ptr.key_size == key_size &&
-                   0 == memcmp(elt->key.ptr.key, key, key_size)) {
-            /* replace existing value */
-            elt->value = value; 
-            return OCOMS_SUCCESS;
-        } else {
-            /* keep looking */
-        }
-    }
+    hkey.ptr.key = key;
+    hkey.ptr.key_size = key_size;
+    return ocoms_hash_table_set_value(ht, OCOMS_HASH_KEY_PTR, &hkey,
+                                      ocoms_hash_hash_key_ptr(key, key_size), value);
 }
 
 int                             /* OCOMS_ return code */
 ocoms_hash_table_remove_value_ptr(ocoms_hash_table_t * ht, 
                                  const void * key, size_t key_size)
 {
-    size_t ii, capacity = ht->ht_capacity;
+    ocoms_hash_key_t hkey;
 
 #if OCOMS_ENABLE_DEBUG
-    if(capacity == 0) {
+    if(ht->ht_capacity == 0) {
         ocoms_output(0, "ocoms_hash_table_get_value_ptr:"
                     "ocoms_hash_table_init() has not been called");
         return OCOMS_ERROR;
@@ -734,19 +832,10 @@ ocoms_hash_table_remove_value_ptr(ocoms_hash_table_t * ht,
 #endif
 
     ht->ht_type_methods = &ocoms_hash_type_methods_ptr;
-    for (ii = ocoms_hash_hash_key_ptr(key, key_size)%capacity; ; ii += 1) {
-        ocoms_hash_element_t * elt;
-        if (ii == capacity) { ii = 0; }
-        elt = &ht->ht_table[ii];
-        if (! elt->valid) {
-            return OCOMS_ERR_NOT_FOUND;
-        } else if (elt->key.ptr.key_size == key_size &&
-                   0 == memcmp(elt->key.ptr.key, key, key_size)) {
-            return ocoms_hash_table_remove_elt_at(ht, ii);
-        } else {
-            /* keep looking */
-        }
-    }
+    hkey.ptr.key = key;
+    hkey.ptr.key_size = key_size;
+    return ocoms_hash_table_remove_value(ht, OCOMS_HASH_KEY_PTR, &hkey,
+                                         ocoms_hash_hash_key_ptr(key, key_size));
 }
 
 /***************************************************************************/
@@ -757,12 +846,18 @@ ocoms_hash_table_get_next_elt(ocoms_hash_table_t *ht,
                              ocoms_hash_element_t * prev_elt, /* NULL means find first */
                              ocoms_hash_element_t * *next_elt)
 {
-  ocoms_hash_element_t* elts = ht->ht_table;
+  ocoms_hash_element_t* elts;
   size_t ii, capacity = ht->ht_capacity;
 
+  if (NULL == prev_elt && NULL != ht->ht_old_table) {
+    /* walk a single table */
+    ocoms_hash_migrate(ht, ht->ht_old_capacity);
+  }
+  elts = ht->ht_table;
+
   for (ii = (NULL == prev_elt ? 0 : (prev_elt-elts)+1); ii < capacity; ii += 1) {
     ocoms_hash_element_t * elt = &elts[ii];
-    if (elt->valid) {
+    if (elt->hash) {
       *next_elt = elt;
       return OCOMS_SUCCESS;
     }
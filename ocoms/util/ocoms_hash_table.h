@@ -53,6 +53,11 @@ struct ocoms_hash_table_t
     int                  ht_density_numer, ht_density_denom; /**< max allowed density of table */
     int                  ht_growth_numer, ht_growth_denom;   /**< growth factor when grown  */
     const struct ocoms_hash_type_methods_t * ht_type_methods;
+    struct ocoms_hash_element_t * ht_old_table;   /**< table drained by an incremental grow */
+    size_t               ht_old_capacity;   /**< capacity of ht_old_table */
+    size_t               ht_migrate_next;   /**< next element of ht_old_table to move */
+    size_t               ht_migrate_step;   /**< elements moved per update while draining */
+    size_t               ht_growth_step;    /**< requested step, 0 to grow all at once */
     // FIXME
     // Begin KLUDGE!!  So ompi/debuggers/ompi_common_dll.c doesn't complain
     size_t              ht_table_size;  /**< size of table */
@@ -76,6 +81,25 @@ typedef struct ocoms_hash_table_t ocoms_hash_table_t;
 
 OCOMS_DECLSPEC int ocoms_hash_table_init(ocoms_hash_table_t* ht, size_t table_size);
 
+/**
+ *  Select incremental growth.
+ *
+ *  By default growing the table rehashes every element in one go,
+ *  making the insertion that triggers it O(n).  With incremental growth
+ *  the old table is kept next to the new one and every set or remove
+ *  moves at most step elements of it (or more, if needed to be done
+ *  before the new table fills up), so no single operation pays for the
+ *  whole rehash.  Lookups search both tables while a grow is underway.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   step    Elements of the old table moved per update, 0 to
+ *                   grow all at once (IN).
+ *  @return  OCOMS return code.
+ *
+ */
+
+OCOMS_DECLSPEC int ocoms_hash_table_set_growth_step(ocoms_hash_table_t* ht, size_t step);
+
 
 /**
  *  Returns the number of elements currently stored in the table.
@@ -0,0 +1,91 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stdlib.h>
+
+#include "ocoms/util/ocoms_numa_free_list.h"
+
+
+static void ocoms_numa_free_list_construct(ocoms_numa_free_list_t* nfl);
+static void ocoms_numa_free_list_destruct(ocoms_numa_free_list_t* nfl);
+
+OBJ_CLASS_INSTANCE(ocoms_numa_free_list_t, ocoms_object_t,
+        ocoms_numa_free_list_construct, ocoms_numa_free_list_destruct);
+
+
+static void ocoms_numa_free_list_construct(ocoms_numa_free_list_t* nfl)
+{
+    nfl->nfl_num_nodes = 0;
+    nfl->nfl_lists = NULL;
+    nfl->nfl_steals = 0;
+}
+
+static void ocoms_numa_free_list_destruct(ocoms_numa_free_list_t* nfl)
+{
+    int i;
+
+    for(i = 0; i < nfl->nfl_num_nodes; i++) {
+        OBJ_DESTRUCT(&nfl->nfl_lists[i]);
+    }
+    free(nfl->nfl_lists);
+    nfl->nfl_lists = NULL;
+    nfl->nfl_num_nodes = 0;
+}
+
+int ocoms_numa_free_list_init(ocoms_numa_free_list_t *nfl,
+    size_t frag_size,
+    size_t frag_alignment,
+    ocoms_class_t* frag_class,
+    size_t payload_buffer_size,
+    size_t payload_buffer_alignment,
+    int num_elements_to_alloc,
+    int max_elements_to_alloc,
+    int num_elements_per_alloc,
+    ocoms_free_list_item_init_fn_t item_init,
+    void* ctx,
+    ocoms_free_list_alloc_fn_t alloc,
+    ocoms_free_list_free_fn_t free,
+    allocator_handle_t handle,
+    ocoms_progress_fn_t ocoms_progress,
+    uint32_t flags
+    )
+{
+    int num_nodes, i, rc;
+
+    num_nodes = ocoms_numa_get_num_nodes();
+    if (num_nodes < 1)
+        num_nodes = 1;
+
+    nfl->nfl_lists = (ocoms_free_list_t*)malloc(num_nodes * sizeof(ocoms_free_list_t));
+    if (NULL == nfl->nfl_lists)
+        return OCOMS_ERR_OUT_OF_RESOURCE;
+
+    for (i = 0; i < num_nodes; i++) {
+        OBJ_CONSTRUCT(&nfl->nfl_lists[i], ocoms_free_list_t);
+        /* only bother with placement when there is a choice */
+        if (num_nodes > 1)
+            nfl->nfl_lists[i].fl_numa_node = i;
+        nfl->nfl_num_nodes = i + 1;
+
+        rc = ocoms_free_list_init_ex_flags(&nfl->nfl_lists[i], frag_size,
+                frag_alignment, frag_class, payload_buffer_size,
+                payload_buffer_alignment, num_elements_to_alloc,
+                max_elements_to_alloc, num_elements_per_alloc, item_init,
+                ctx, alloc, free, handle, ocoms_progress, flags);
+        if (OCOMS_SUCCESS != rc) {
+            ocoms_numa_free_list_destruct(nfl);
+            return rc;
+        }
+    }
+    return OCOMS_SUCCESS;
+}
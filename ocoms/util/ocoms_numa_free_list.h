@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2011-2013 UT-Battelle, LLC. All rights reserved.
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * A free list partitioned by NUMA node.
+ *
+ * One ocoms_free_list_t is kept per node and its chunks (descriptors
+ * and payload buffers) are placed on that node.  A get is served from
+ * the list of the node the caller currently runs on; when that list
+ * is exhausted and cannot grow, items are taken from the other nodes.
+ * Items always go back to the list that allocated them, so memory
+ * does not migrate between nodes over time.
+ */
+
+#ifndef OCOMS_NUMA_FREE_LIST_H
+#define OCOMS_NUMA_FREE_LIST_H
+
+#include "ocoms/platform/ocoms_config.h"
+#include "ocoms/util/ocoms_free_list.h"
+#include "ocoms/util/numa.h"
+#include "ocoms/sys/atomic.h"
+
+BEGIN_C_DECLS
+
+struct ocoms_numa_free_list_t
+{
+    ocoms_object_t super;
+    int nfl_num_nodes;                  /* number of per-node lists */
+    ocoms_free_list_t *nfl_lists;       /* one free list per node */
+    volatile size_t nfl_steals;         /* items served by a remote node */
+};
+typedef struct ocoms_numa_free_list_t ocoms_numa_free_list_t;
+OCOMS_DECLSPEC OBJ_CLASS_DECLARATION(ocoms_numa_free_list_t);
+
+/**
+ * Initialize a NUMA partitioned free list.
+ *
+ * The parameters are the same as ocoms_free_list_init_ex_flags().
+ * The element counts apply to each node separately.
+ */
+
+OCOMS_DECLSPEC int ocoms_numa_free_list_init(
+    ocoms_numa_free_list_t *free_list,
+    size_t frag_size,
+    size_t frag_alignment,
+    ocoms_class_t* frag_class,
+    size_t payload_buffer_size,
+    size_t payload_buffer_alignment,
+    int num_elements_to_alloc,
+    int max_elements_to_alloc,
+    int num_elements_per_alloc,
+    ocoms_free_list_item_init_fn_t item_init,
+    void *ctx,
+    ocoms_free_list_alloc_fn_t alloc,
+    ocoms_free_list_free_fn_t free,
+    allocator_handle_t handle,
+    ocoms_progress_fn_t ocoms_progress,
+    uint32_t flags
+    );
+
+static inline ocoms_free_list_item_t*
+ocoms_numa_free_list_get(ocoms_numa_free_list_t *nfl, int *rc)
+{
+    ocoms_free_list_item_t *item;
+    int node = 0, i;
+
+    if( nfl->nfl_num_nodes > 1 ) {
+        node = ocoms_numa_get_current_node();
+        if( OCOMS_UNLIKELY(node < 0 || node >= nfl->nfl_num_nodes) ) {
+            node = 0;
+        }
+    }
+
+    OCOMS_FREE_LIST_GET(&nfl->nfl_lists[node], item, *rc);
+    if( OCOMS_LIKELY(NULL != item) ) {
+        return item;
+    }
+
+    /* the local node is exhausted and cannot grow, take from the others */
+    for( i = 1; i < nfl->nfl_num_nodes; i++ ) {
+        item = ocoms_free_list_pop(&nfl->nfl_lists[(node + i) % nfl->nfl_num_nodes]);
+        if( NULL != item ) {
+            ocoms_atomic_add_size_t(&nfl->nfl_steals, 1);
+            *rc = OCOMS_SUCCESS;
+            return item;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get an item from the list of the local node, falling back to the
+ * other nodes.
+ *
+ * @param fl (IN)        NUMA free list.
+ * @param item (OUT)     Allocated item.
+ * @param rc (OUT)       OCOMS_SUCCESS or error status on failure.
+ */
+
+#define OCOMS_NUMA_FREE_LIST_GET(fl, item, rc)                           \
+    item = ocoms_numa_free_list_get((fl), &(rc))
+
+/**
+ * Return an item to the per-node list it was allocated from.
+ *
+ * @param fl (IN)        NUMA free list.
+ * @param item (IN)      Item to return.
+ */
+
+#define OCOMS_NUMA_FREE_LIST_RETURN(fl, item)                            \
+    OCOMS_FREE_LIST_RETURN(((ocoms_free_list_item_t*)(item))->owner,     \
+                           (ocoms_free_list_item_t*)(item))
+
+END_C_DECLS
+#endif
@@ -0,0 +1,327 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (C) 2013      Mellanox Technologies Ltd. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * Distribution and throughput of the byte hashes.
+ *
+ * Compares ocoms_hash_bytes with the 31*h+c loop the hash table used for
+ * the ptr keys before it, and with the one-at-a-time OCOMS_HASH_STR.
+ * The key sets are MCA parameter names, host names, pointers and 16
+ * bytes process names, plus the lines of a file given as argument, for
+ * instance the output of "ompi_info --param all all --parsable".
+ *
+ * The distribution is measured as the hash table uses it: the low bits
+ * select one of a power of two buckets. The chi-square is normalized by
+ * the degrees of freedom, a uniform hash stays close to 1.0.
+ */
+
+#include "ocoms/platform/ocoms_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ocoms/primitives/hash_string.h"
+
+#define HASH_BENCH_MAX_KEYS  (1 << 20)
+
+typedef struct {
+    const void* key;
+    size_t      len;
+} hash_bench_key_t;
+
+typedef struct {
+    const char* name;
+    hash_bench_key_t* keys;
+    size_t count;
+} hash_bench_set_t;
+
+typedef uint64_t (*hash_bench_fn_t)( const void* key, size_t len );
+
+static uint64_t hash_bench_mult31( const void* key, size_t len )
+{
+    const unsigned char* p = (const unsigned char*)key;
+    uint64_t hash = 0;
+    size_t i;
+
+    for( i = 0; i < len; i++ ) {
+        hash = hash * 31 + p[i];
+    }
+    return hash;
+}
+
+static uint64_t hash_bench_one_at_a_time( const void* key, size_t len )
+{
+    const unsigned char* p = (const unsigned char*)key;
+    uint32_t hash = 0;
+    size_t i;
+
+    /* OCOMS_HASH_STR, without the need for a terminated string */
+    for( i = 0; i < len; i++ ) {
+        hash += p[i];
+        hash += (hash << 10);
+        hash ^= (hash >> 6);
+    }
+    hash += (hash << 3);
+    hash ^= (hash >> 11);
+    return hash + (hash << 15);
+}
+
+static uint64_t hash_bench_bytes( const void* key, size_t len )
+{
+    return ocoms_hash_bytes( key, len, 0 );
+}
+
+static const struct {
+    const char* name;
+    hash_bench_fn_t fn;
+} hash_bench_fns[] = {
+    { "31*h+c",           hash_bench_mult31 },
+    { "one-at-a-time",    hash_bench_one_at_a_time },
+    { "ocoms_hash_bytes", hash_bench_bytes },
+};
+
+static double hash_bench_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static hash_bench_key_t* hash_bench_alloc( size_t count )
+{
+    hash_bench_key_t* keys = (hash_bench_key_t*)calloc( count, sizeof(hash_bench_key_t) );
+
+    if( NULL == keys ) {
+        fprintf( stderr, "out of memory\n" );
+        exit( 1 );
+    }
+    return keys;
+}
+
+static void hash_bench_add_string( hash_bench_set_t* set, const char* str )
+{
+    char* copy = strdup( str );
+
+    if( NULL == copy ) {
+        fprintf( stderr, "out of memory\n" );
+        exit( 1 );
+    }
+    set->keys[set->count].key = copy;
+    set->keys[set->count].len = strlen( copy );
+    set->count++;
+}
+
+/* framework_component_parameter, as the MCA variables are named */
+static void hash_bench_mca_names( hash_bench_set_t* set )
+{
+    static const char* frameworks[] = { "btl", "pml", "mtl", "coll", "osc", "bml", "rcache",
+                                        "mpool", "sbgp", "bcol", "pmix", "oob", "plm", "ras",
+                                        "rmaps", "errmgr", "grpcomm", "routed", "io", "fs" };
+    static const char* components[] = { "tcp", "sm", "vader", "openib", "self", "ob1", "cm",
+                                        "tuned", "basic", "hcoll", "ucx", "mxm", "psm2", "ofi",
+                                        "basesmuma", "ptpcoll", "iboffload", "p2p", "rdma", "base" };
+    static const char* params[] = { "priority", "verbose", "if_include", "if_exclude",
+                                    "eager_limit", "rndv_eager_limit", "max_send_size",
+                                    "free_list_num", "free_list_max", "free_list_inc",
+                                    "exclusivity", "latency", "bandwidth", "use_eager_rdma",
+                                    "segment_size", "num_fragments", "cq_size", "flags",
+                                    "alltoall_algorithm", "allreduce_algorithm_segmentsize" };
+    char name[256];
+    size_t f, c, p, n;
+
+    set->name = "MCA parameter names";
+    set->keys = hash_bench_alloc( 4 * 20 * 20 * 20 );
+    for( n = 0; n < 4; n++ ) {
+        for( f = 0; f < 20; f++ ) {
+            for( c = 0; c < 20; c++ ) {
+                for( p = 0; p < 20; p++ ) {
+                    snprintf( name, sizeof(name), n ? "%s_%s_%s_%d" : "%s_%s_%s",
+                              frameworks[f], components[c], params[p], (int)n );
+                    hash_bench_add_string( set, name );
+                }
+            }
+        }
+    }
+}
+
+static void hash_bench_host_names( hash_bench_set_t* set )
+{
+    char name[256];
+    size_t rack, node;
+
+    set->name = "host names";
+    set->keys = hash_bench_alloc( 64 * 512 );
+    for( rack = 0; rack < 64; rack++ ) {
+        for( node = 0; node < 512; node++ ) {
+            snprintf( name, sizeof(name), "r%02dn%03d.cluster.example.org",
+                      (int)rack, (int)node );
+            hash_bench_add_string( set, name );
+        }
+    }
+}
+
+/* the addresses of objects of a few sizes, as the ptr keys often are */
+static void hash_bench_pointers( hash_bench_set_t* set )
+{
+    static void* ptrs[1 << 16];
+    size_t i;
+
+    set->name = "pointers";
+    set->keys = hash_bench_alloc( 1 << 16 );
+    for( i = 0; i < (1 << 16); i++ ) {
+        ptrs[i] = malloc( 16 << (i % 4) );
+        set->keys[i].key = &ptrs[i];
+        set->keys[i].len = sizeof(void*);
+    }
+    set->count = 1 << 16;
+}
+
+/* jobid:vpid pairs, a 16 bytes process name */
+static void hash_bench_proc_names( hash_bench_set_t* set )
+{
+    static uint64_t names[1 << 16][2];
+    size_t i;
+
+    set->name = "process names";
+    set->keys = hash_bench_alloc( 1 << 16 );
+    for( i = 0; i < (1 << 16); i++ ) {
+        names[i][0] = 0x12340000ULL + (i >> 12);
+        names[i][1] = i & 0xfff;
+        set->keys[i].key = names[i];
+        set->keys[i].len = sizeof(names[i]);
+    }
+    set->count = 1 << 16;
+}
+
+static int hash_bench_file( hash_bench_set_t* set, const char* filename )
+{
+    char line[4096];
+    FILE* file = fopen( filename, "r" );
+
+    if( NULL == file ) {
+        perror( filename );
+        return -1;
+    }
+    set->name = filename;
+    set->keys = hash_bench_alloc( HASH_BENCH_MAX_KEYS );
+    while( (set->count < HASH_BENCH_MAX_KEYS) && (NULL != fgets( line, sizeof(line), file )) ) {
+        line[strcspn( line, "\n" )] = '\0';
+        if( '\0' != line[0] ) {
+            hash_bench_add_string( set, line );
+        }
+    }
+    fclose( file );
+    return 0;
+}
+
+static void hash_bench_distribution( const hash_bench_set_t* set, hash_bench_fn_t fn,
+                                     double* chi2, size_t* max_load )
+{
+    size_t buckets = 1, i, *load;
+    double expected, sum = 0.0, d;
+
+    /* about 4 keys per bucket */
+    while( 4 * buckets < set->count ) buckets <<= 1;
+    load = (size_t*)calloc( buckets, sizeof(size_t) );
+    for( i = 0; i < set->count; i++ ) {
+        load[fn( set->keys[i].key, set->keys[i].len ) & (buckets - 1)]++;
+    }
+    expected = (double)set->count / (double)buckets;
+    *max_load = 0;
+    for( i = 0; i < buckets; i++ ) {
+        d = (double)load[i] - expected;
+        sum += d * d / expected;
+        if( load[i] > *max_load ) *max_load = load[i];
+    }
+    *chi2 = sum / (double)(buckets - 1);
+    free( load );
+}
+
+static double hash_bench_throughput( const hash_bench_set_t* set, hash_bench_fn_t fn )
+{
+    volatile uint64_t sink = 0;
+    double start, elapsed, best = 1e30;
+    size_t i, round;
+    int repeat;
+
+    for( repeat = 0; repeat < 5; repeat++ ) {
+        start = hash_bench_now();
+        for( round = 0; round < 10; round++ ) {
+            for( i = 0; i < set->count; i++ ) {
+                sink += fn( set->keys[i].key, set->keys[i].len );
+            }
+        }
+        elapsed = hash_bench_now() - start;
+        if( elapsed < best ) best = elapsed;
+    }
+    (void)sink;
+    return best * 1e9 / (10.0 * (double)set->count);
+}
+
+static void hash_bench_long_keys( void )
+{
+    static const size_t lengths[] = { 64, 256, 4096, 65536 };
+    size_t l, f, i, total = 1 << 26;
+    unsigned char* buffer = (unsigned char*)malloc( 65536 );
+    volatile uint64_t sink = 0;
+    double start, elapsed;
+
+    for( i = 0; i < 65536; i++ ) buffer[i] = (unsigned char)(i * 131 + 7);
+    printf( "\nlong keys (GB/s)\n%-18s", "length" );
+    for( f = 0; f < sizeof(hash_bench_fns) / sizeof(hash_bench_fns[0]); f++ ) {
+        printf( " %16s", hash_bench_fns[f].name );
+    }
+    printf( "\n" );
+    for( l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++ ) {
+        printf( "%-18zu", lengths[l] );
+        for( f = 0; f < sizeof(hash_bench_fns) / sizeof(hash_bench_fns[0]); f++ ) {
+            start = hash_bench_now();
+            for( i = 0; i < total / lengths[l]; i++ ) {
+                sink += hash_bench_fns[f].fn( buffer, lengths[l] );
+            }
+            elapsed = hash_bench_now() - start;
+            printf( " %16.2f", (double)total / elapsed / 1e9 );
+        }
+        printf( "\n" );
+    }
+    (void)sink;
+    free( buffer );
+}
+
+int main( int argc, char* argv[] )
+{
+    hash_bench_set_t sets[5];
+    size_t s, f, nsets = 4, max_load;
+    double chi2;
+
+    memset( sets, 0, sizeof(sets) );
+    hash_bench_mca_names( &sets[0] );
+    hash_bench_host_names( &sets[1] );
+    hash_bench_pointers( &sets[2] );
+    hash_bench_proc_names( &sets[3] );
+    if( (argc > 1) && (0 == hash_bench_file( &sets[4], argv[1] )) ) {
+        nsets++;
+    }
+
+    for( s = 0; s < nsets; s++ ) {
+        printf( "%s: %zu keys\n", sets[s].name, sets[s].count );
+        printf( "  %-18s %10s %10s %10s\n", "hash", "chi2/dof", "max load", "ns/key" );
+        for( f = 0; f < sizeof(hash_bench_fns) / sizeof(hash_bench_fns[0]); f++ ) {
+            hash_bench_distribution( &sets[s], hash_bench_fns[f].fn, &chi2, &max_load );
+            printf( "  %-18s %10.2f %10zu %10.2f\n", hash_bench_fns[f].name, chi2, max_load,
+                    hash_bench_throughput( &sets[s], hash_bench_fns[f].fn ) );
+        }
+    }
+    hash_bench_long_keys();
+    return 0;
+}